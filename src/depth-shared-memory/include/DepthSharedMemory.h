@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef DEPTHSHAREDMEMORY_H
+#define DEPTHSHAREDMEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * Ring of depth images in a POSIX shared memory segment, used to exchange the depth between processes
+ * running on the same host without serializing it.
+ *
+ * The segment is made of a header and of a fixed number of slots, each one holding a depth image of float
+ * together with its sequence number and time stamp. The writer fills a slot that no reader is using, then
+ * publishes it as the latest one. Readers pin the latest slot and access the image in place, without copies,
+ * until they release it. The writer refreshes a heartbeat at each image, hence readers consider the ring
+ * stale, e.g. because the writer has been closed, if no image arrives within a timeout.
+ */
+namespace DepthSharedMemory
+{
+    /**
+     * Name of the segment associated to a port, e.g. /object-tracking-depth/SFM/depth:o is
+     * associated to /object-tracking-depth_SFM_depth:o.
+     */
+    std::string segmentName(const std::string& port_name);
+
+    struct Header;
+
+    struct Slot;
+}
+
+
+/**
+ * Writer side of the ring. The segment is created when the first image is written and recreated if the size
+ * of the images changes. It is removed on destruction.
+ */
+class DepthSharedMemoryWriter
+{
+public:
+    DepthSharedMemoryWriter(const std::string& name, const std::size_t number_slots = 4);
+
+    virtual ~DepthSharedMemoryWriter();
+
+    /**
+     * Return the buffer of a slot where an image of the given size can be written, or nullptr if the segment
+     * cannot be created or all the slots are in use by the readers. The slot has to be published or discarded.
+     */
+    float* acquire(const std::size_t width, const std::size_t height);
+
+    /**
+     * Make the acquired slot the latest one.
+     */
+    void publish(const int stamp_count, const double stamp_time);
+
+    /**
+     * Give back the acquired slot without publishing it.
+     */
+    void discard();
+
+protected:
+    bool create(const std::size_t width, const std::size_t height);
+
+    void destroy();
+
+    const std::string name_;
+
+    const std::size_t number_slots_;
+
+    /**
+     * Mapping of the segment.
+     */
+    char* data_ = nullptr;
+    std::size_t data_size_ = 0;
+
+    DepthSharedMemory::Header* header_ = nullptr;
+
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+
+    /**
+     * Sequence number of the last published image.
+     */
+    std::uint64_t sequence_ = 0;
+
+    /**
+     * Slot acquired and not yet published, if any.
+     */
+    int acquired_slot_ = -1;
+};
+
+
+/**
+ * Reader side of the ring.
+ */
+class DepthSharedMemoryReader
+{
+public:
+    /**
+     * A depth image pinned within the ring. The data remains valid until the image is released.
+     */
+    struct Frame
+    {
+        const float* data = nullptr;
+        std::size_t width = 0;
+        std::size_t height = 0;
+        std::uint64_t sequence = 0;
+        int stamp_count = 0;
+        double stamp_time = 0.0;
+    };
+
+    DepthSharedMemoryReader(const std::string& name, const double timeout = 0.5);
+
+    virtual ~DepthSharedMemoryReader();
+
+    /**
+     * Return true if the segment exists on this host and the writer published an image within the timeout.
+     * The segment is mapped, or mapped again if it has been recreated, as required.
+     */
+    bool isAvailable();
+
+    /**
+     * Pin the latest image if its sequence number is greater than min_sequence. The image pinned before,
+     * if any, is released only if a new one is pinned.
+     */
+    bool acquireLatest(const std::uint64_t min_sequence, Frame& frame);
+
+    /**
+     * Release the pinned image, if any.
+     */
+    void release();
+
+protected:
+    bool open();
+
+    void close();
+
+    bool isFresh() const;
+
+    const std::string name_;
+
+    const double timeout_;
+
+    /**
+     * Mapping of the segment.
+     */
+    char* data_ = nullptr;
+    std::size_t data_size_ = 0;
+
+    DepthSharedMemory::Header* header_ = nullptr;
+
+    /**
+     * Slot pinned by this reader, if any.
+     */
+    int pinned_slot_ = -1;
+};
+
+#endif /* DEPTHSHAREDMEMORY_H */
@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <DepthSharedMemory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The ring is shared between processes, hence its atomics must not rely on locks private to a process. */
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "DepthSharedMemory requires lock free atomic integers.");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "DepthSharedMemory requires lock free atomic 64 bit integers.");
+
+
+namespace DepthSharedMemory
+{
+    const char magic[8] = {'O', 'T', 'D', 'E', 'P', 'T', 'H', '1'};
+
+    /* Sizes of the header and of the header of the slots, such that the images are aligned to cache lines. */
+    const std::size_t header_size = 128;
+
+    const std::size_t slot_header_size = 64;
+
+    /* The latest image is identified by its sequence number and by its slot, packed in a single word. */
+    const std::size_t slot_bits = 8;
+
+    const std::size_t max_number_slots = 1 << slot_bits;
+
+    struct Header
+    {
+        char magic[8];
+
+        std::uint64_t width;
+
+        std::uint64_t height;
+
+        std::uint64_t number_slots;
+
+        /* Distance in bytes between two slots. */
+        std::uint64_t slot_stride;
+
+        /* (sequence << slot_bits) | slot of the latest image, zero if no image has been published yet. */
+        std::atomic<std::uint64_t> latest;
+
+        /* Time of the last image, in nanoseconds of the monotonic clock. */
+        std::atomic<std::int64_t> heartbeat;
+    };
+
+    struct Slot
+    {
+        /* -1 while the writer fills the slot, otherwise the number of readers pinning it. */
+        std::atomic<std::int32_t> state;
+
+        std::int32_t stamp_count;
+
+        std::uint64_t sequence;
+
+        double stamp_time;
+    };
+
+    static_assert(sizeof(Header) <= header_size, "DepthSharedMemory::Header does not fit the reserved space.");
+    static_assert(sizeof(Slot) <= slot_header_size, "DepthSharedMemory::Slot does not fit the reserved space.");
+
+
+    std::int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+
+    std::size_t slotStride(const std::size_t width, const std::size_t height)
+    {
+        const std::size_t image_size = width * height * sizeof(float);
+
+        return slot_header_size + (image_size + slot_header_size - 1) / slot_header_size * slot_header_size;
+    }
+
+
+    Slot& slot(char* data, const Header& header, const std::size_t index)
+    {
+        return *reinterpret_cast<Slot*>(data + header_size + index * header.slot_stride);
+    }
+
+
+    float* image(char* data, const Header& header, const std::size_t index)
+    {
+        return reinterpret_cast<float*>(data + header_size + index * header.slot_stride + slot_header_size);
+    }
+
+
+    std::string segmentName(const std::string& port_name)
+    {
+        std::string name = port_name;
+        if ((!name.empty()) && (name[0] == '/'))
+            name.erase(0, 1);
+        std::replace(name.begin(), name.end(), '/', '_');
+
+        return "/" + name;
+    }
+}
+
+using namespace DepthSharedMemory;
+
+
+DepthSharedMemoryWriter::DepthSharedMemoryWriter(const std::string& name, const std::size_t number_slots) :
+    name_(name),
+    /* One slot is always taken by the latest image, one by the writer and at least one is needed by the readers. */
+    number_slots_(std::min(std::max(number_slots, std::size_t(3)), max_number_slots))
+{ }
+
+
+DepthSharedMemoryWriter::~DepthSharedMemoryWriter()
+{
+    destroy();
+}
+
+
+float* DepthSharedMemoryWriter::acquire(const std::size_t width, const std::size_t height)
+{
+    if ((header_ == nullptr) || (width != width_) || (height != height_))
+    {
+        destroy();
+
+        if (!create(width, height))
+            return nullptr;
+    }
+
+    if (acquired_slot_ >= 0)
+        return image(data_, *header_, acquired_slot_);
+
+    /* Never overwrite the latest image, readers may be about to pin it. */
+    const std::uint64_t latest = header_->latest.load(std::memory_order_acquire);
+    const int latest_slot = (latest == 0) ? -1 : int(latest & (max_number_slots - 1));
+
+    for (std::size_t i = 1; i <= number_slots_; i++)
+    {
+        const int index = (latest_slot + i) % number_slots_;
+        if (index == latest_slot)
+            continue;
+
+        std::int32_t unused = 0;
+        if (slot(data_, *header_, index).state.compare_exchange_strong(unused, -1, std::memory_order_acquire))
+        {
+            acquired_slot_ = index;
+
+            return image(data_, *header_, index);
+        }
+    }
+
+    return nullptr;
+}
+
+
+void DepthSharedMemoryWriter::publish(const int stamp_count, const double stamp_time)
+{
+    if (acquired_slot_ < 0)
+        return;
+
+    Slot& acquired = slot(data_, *header_, acquired_slot_);
+    acquired.sequence = ++sequence_;
+    acquired.stamp_count = stamp_count;
+    acquired.stamp_time = stamp_time;
+    acquired.state.store(0, std::memory_order_release);
+
+    header_->latest.store((sequence_ << slot_bits) | std::uint64_t(acquired_slot_), std::memory_order_release);
+    header_->heartbeat.store(now(), std::memory_order_release);
+
+    acquired_slot_ = -1;
+}
+
+
+void DepthSharedMemoryWriter::discard()
+{
+    if (acquired_slot_ < 0)
+        return;
+
+    slot(data_, *header_, acquired_slot_).state.store(0, std::memory_order_release);
+
+    acquired_slot_ = -1;
+}
+
+
+bool DepthSharedMemoryWriter::create(const std::size_t width, const std::size_t height)
+{
+    /* A segment left behind by a writer that did not terminate cleanly is replaced. */
+    shm_unlink(name_.c_str());
+
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0)
+        return false;
+
+    const std::size_t size = header_size + number_slots_ * slotStride(width, height);
+    if (ftruncate(fd, size) < 0)
+    {
+        ::close(fd);
+        shm_unlink(name_.c_str());
+
+        return false;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    /* The mapping is still valid after the descriptor is closed. */
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        shm_unlink(name_.c_str());
+
+        return false;
+    }
+
+    data_ = static_cast<char*>(data);
+    data_size_ = size;
+    width_ = width;
+    height_ = height;
+
+    /* The segment is zero filled, the atomics are constructed in place nonetheless. */
+    header_ = new (data_) Header;
+    header_->width = width;
+    header_->height = height;
+    header_->number_slots = number_slots_;
+    header_->slot_stride = slotStride(width, height);
+    new (&header_->latest) std::atomic<std::uint64_t>(0);
+    new (&header_->heartbeat) std::atomic<std::int64_t>(now());
+
+    for (std::size_t i = 0; i < number_slots_; i++)
+    {
+        Slot& current = *new (&slot(data_, *header_, i)) Slot;
+        new (&current.state) std::atomic<std::int32_t>(0);
+        current.stamp_count = 0;
+        current.sequence = 0;
+        current.stamp_time = 0.0;
+    }
+
+    /* Readers accept the segment only once it is complete. */
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, DepthSharedMemory::magic, sizeof(DepthSharedMemory::magic));
+
+    return true;
+}
+
+
+void DepthSharedMemoryWriter::destroy()
+{
+    if (data_ == nullptr)
+        return;
+
+    /* Readers still mapping the segment keep their images and find it stale. */
+    munmap(data_, data_size_);
+    shm_unlink(name_.c_str());
+
+    data_ = nullptr;
+    data_size_ = 0;
+    header_ = nullptr;
+    acquired_slot_ = -1;
+}
+
+
+DepthSharedMemoryReader::DepthSharedMemoryReader(const std::string& name, const double timeout) :
+    name_(name),
+    timeout_(timeout)
+{ }
+
+
+DepthSharedMemoryReader::~DepthSharedMemoryReader()
+{
+    close();
+}
+
+
+bool DepthSharedMemoryReader::isAvailable()
+{
+    if ((header_ != nullptr) && isFresh())
+        return true;
+
+    /* The mapping cannot be replaced while an image within it is in use. */
+    if (pinned_slot_ >= 0)
+        return false;
+
+    /* Either the segment has never been found or it might have been recreated by the writer. */
+    close();
+
+    return open() && isFresh();
+}
+
+
+bool DepthSharedMemoryReader::acquireLatest(const std::uint64_t min_sequence, Frame& frame)
+{
+    if (header_ == nullptr)
+        return false;
+
+    const std::uint64_t latest = header_->latest.load(std::memory_order_acquire);
+    if ((latest == 0) || ((latest >> slot_bits) <= min_sequence))
+        return false;
+
+    const std::size_t index = latest & (max_number_slots - 1);
+    if (index >= header_->number_slots)
+        return false;
+
+    /* Pin the slot, unless the writer is already filling it with a newer image. */
+    Slot& latest_slot = slot(data_, *header_, index);
+    std::int32_t state = latest_slot.state.load(std::memory_order_relaxed);
+    do
+    {
+        if (state < 0)
+            return false;
+    }
+    while (!latest_slot.state.compare_exchange_weak(state, state + 1, std::memory_order_acquire));
+
+    /* The slot might have been filled again in the meanwhile, in which case it holds an image newer than the latest. */
+    if (latest_slot.sequence <= min_sequence)
+    {
+        latest_slot.state.fetch_sub(1, std::memory_order_release);
+
+        return false;
+    }
+
+    release();
+    pinned_slot_ = index;
+
+    frame.data = image(data_, *header_, index);
+    frame.width = header_->width;
+    frame.height = header_->height;
+    frame.sequence = latest_slot.sequence;
+    frame.stamp_count = latest_slot.stamp_count;
+    frame.stamp_time = latest_slot.stamp_time;
+
+    return true;
+}
+
+
+void DepthSharedMemoryReader::release()
+{
+    if (pinned_slot_ < 0)
+        return;
+
+    slot(data_, *header_, pinned_slot_).state.fetch_sub(1, std::memory_order_release);
+
+    pinned_slot_ = -1;
+}
+
+
+bool DepthSharedMemoryReader::open()
+{
+    int fd = shm_open(name_.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat segment_stat;
+    if ((fstat(fd, &segment_stat) < 0) || (std::size_t(segment_stat.st_size) < header_size))
+    {
+        ::close(fd);
+
+        return false;
+    }
+    const std::size_t size = segment_stat.st_size;
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    Header* header = static_cast<Header*>(data);
+    const bool valid = (std::memcmp(header->magic, DepthSharedMemory::magic, sizeof(DepthSharedMemory::magic)) == 0) &&
+                       (header->number_slots <= max_number_slots) &&
+                       (header->slot_stride == slotStride(header->width, header->height)) &&
+                       (header_size + header->number_slots * header->slot_stride <= size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (!valid)
+    {
+        munmap(data, size);
+
+        return false;
+    }
+
+    data_ = static_cast<char*>(data);
+    data_size_ = size;
+    header_ = header;
+
+    return true;
+}
+
+
+void DepthSharedMemoryReader::close()
+{
+    release();
+
+    if (data_ != nullptr)
+        munmap(data_, data_size_);
+
+    data_ = nullptr;
+    data_size_ = 0;
+    header_ = nullptr;
+}
+
+
+bool DepthSharedMemoryReader::isFresh() const
+{
+    return (now() - header_->heartbeat.load(std::memory_order_acquire)) < std::int64_t(timeout_ * 1e9);
+}
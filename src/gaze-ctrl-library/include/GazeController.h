@@ -30,6 +30,8 @@ public:
 
     bool getCameraIntrinsics(const std::string eye_name, double &fx, double &fy, double &cx, double &cy);
 
+    bool getHeadVelocities(yarp::sig::Vector& head_vel);
+
     bool isGazeInterfaceAvailable();
 
     yarp::dev::IGazeControl& getGazeInterface();
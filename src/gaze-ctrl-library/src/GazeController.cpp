@@ -329,6 +329,31 @@ bool GazeController::getCameraIntrinsics
 }
 
 
+bool GazeController::getHeadVelocities(Vector& head_vel)
+{
+    if (use_ienc)
+    {
+        // Neck and eyes joints, in deg/s
+        int number_axes;
+        if (!ienc->getAxes(&number_axes) || (number_axes < 6))
+            return false;
+
+        Vector speeds(number_axes);
+        if (!ienc->getEncoderSpeeds(speeds.data()))
+            return false;
+
+        head_vel = speeds.subVector(0, 5);
+
+        return true;
+    }
+    else if (use_igaze)
+        return igaze->getJointsVelocities(head_vel);
+
+    // Velocities are not available from the raw encoders
+    return false;
+}
+
+
 bool GazeController::isGazeInterfaceAvailable()
 {
     return use_igaze;
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Time a kernel over a number of repetitions, after some warm-up runs, and collect the statistics of all the kernels.
+ *
+ * Each kernel is identified by its name and by a description of its input, e.g. "particles=1000" or "image=640x480",
+ * so that the results of two runs can be matched line by line by script/compare.py.
+ */
+class Benchmark
+{
+public:
+    Benchmark(const std::size_t warmup, const std::size_t repetitions);
+
+    virtual ~Benchmark();
+
+    /**
+     * Run body() warmup + repetitions times and store the statistics of the timed repetitions.
+     * The number of items, e.g. particles or pixels, processed by a single call is used to evaluate the throughput.
+     */
+    void run(const std::string& kernel, const std::string& input, const double items, const std::function<void()>& body);
+
+    /**
+     * Write one line per kernel in CSV format.
+     */
+    bool write(const std::string& path) const;
+
+protected:
+    struct Result
+    {
+        std::string kernel;
+
+        std::string input;
+
+        /**
+         * Statistics of the duration of a single call in milliseconds.
+         */
+        double mean;
+
+        double std;
+
+        double min;
+
+        double p50;
+
+        double p90;
+
+        double p99;
+
+        double items_per_second;
+    };
+
+    const std::size_t warmup_;
+
+    const std::size_t repetitions_;
+
+    std::vector<Result> results_;
+
+    const std::string log_ID_ = "[Benchmark]";
+};
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,58 @@
+#===============================================================================
+#
+# Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+#
+# This software may be modified and distributed under the terms of the
+# GPL-2+ license. See the accompanying LICENSE file for details.
+#
+#===============================================================================
+
+# Compare two outputs of the object-tracking benchmarks and exit with a non-zero status
+# if any kernel is slower than in the baseline by more than the given tolerance.
+#
+# Usage: python3 compare.py baseline.csv current.csv [--metric p50_ms] [--tolerance 0.1]
+
+import argparse
+import csv
+import sys
+
+def read_results(path, metric):
+
+    results = {}
+
+    with open(path, newline='') as csv_file:
+        for row in csv.DictReader(csv_file):
+            results[(row['kernel'], row['input'])] = float(row[metric])
+
+    return results
+
+def main():
+
+    parser = argparse.ArgumentParser(description='Compare two outputs of the object-tracking benchmarks.')
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--metric', default='p50_ms')
+    parser.add_argument('--tolerance', type=float, default=0.1, help='maximum allowed relative slowdown')
+    args = parser.parse_args()
+
+    baseline = read_results(args.baseline, args.metric)
+    current = read_results(args.current, args.metric)
+
+    regressions = 0
+    for key in sorted(baseline.keys()):
+        if key not in current:
+            print('{} [{}]: missing'.format(key[0], key[1]))
+            continue
+
+        ratio = current[key] / baseline[key] if baseline[key] > 0.0 else 1.0
+        status = 'ok'
+        if ratio > 1.0 + args.tolerance:
+            status = 'REGRESSION'
+            regressions += 1
+
+        print('{} [{}]: {:.3f} -> {:.3f} ({:+.1f}%) {}'.format(key[0], key[1], baseline[key], current[key], (ratio - 1.0) * 100.0, status))
+
+    return 1 if regressions > 0 else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <Benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+
+Benchmark::Benchmark(const std::size_t warmup, const std::size_t repetitions) :
+    warmup_(warmup),
+    repetitions_(std::max(repetitions, std::size_t(1)))
+{ }
+
+
+Benchmark::~Benchmark()
+{ }
+
+
+void Benchmark::run(const std::string& kernel, const std::string& input, const double items, const std::function<void()>& body)
+{
+    for (std::size_t i = 0; i < warmup_; i++)
+        body();
+
+    std::vector<double> durations(repetitions_);
+    for (std::size_t i = 0; i < repetitions_; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        body();
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        durations[i] = std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    const double total = std::accumulate(durations.begin(), durations.end(), 0.0);
+
+    Result result;
+    result.kernel = kernel;
+    result.input = input;
+    result.mean = total / repetitions_;
+
+    double variance = 0.0;
+    for (const double duration : durations)
+        variance += (duration - result.mean) * (duration - result.mean);
+    result.std = std::sqrt(variance / repetitions_);
+
+    /* Nearest-rank percentiles. */
+    std::sort(durations.begin(), durations.end());
+    auto percentile = [&durations](const double p)
+    {
+        std::size_t index = static_cast<std::size_t>(std::ceil(p / 100.0 * durations.size()));
+        index = std::min(std::max(index, std::size_t(1)), durations.size());
+
+        return durations[index - 1];
+    };
+
+    result.min = durations.front();
+    result.p50 = percentile(50);
+    result.p90 = percentile(90);
+    result.p99 = percentile(99);
+    result.items_per_second = (total > 0.0) ? items * repetitions_ / (total / 1000.0) : 0.0;
+
+    results_.push_back(result);
+
+    std::cout << log_ID_ << " " << kernel << " [" << input << "]"
+              << " mean " << result.mean << " ms"
+              << " std " << result.std << " ms"
+              << " p50 " << result.p50 << " ms"
+              << " p90 " << result.p90 << " ms"
+              << " items/s " << result.items_per_second << std::endl;
+}
+
+
+bool Benchmark::write(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << log_ID_ << " Cannot open output file " << path << std::endl;
+
+        return false;
+    }
+
+    file << "kernel,input,repetitions,mean_ms,std_ms,min_ms,p50_ms,p90_ms,p99_ms,items_per_second" << std::endl;
+
+    for (const Result& result : results_)
+    {
+        file << result.kernel << ","
+             << result.input << ","
+             << repetitions_ << ","
+             << result.mean << ","
+             << result.std << ","
+             << result.min << ","
+             << result.p50 << ","
+             << result.p90 << ","
+             << result.p99 << ","
+             << result.items_per_second << std::endl;
+    }
+
+    return true;
+}
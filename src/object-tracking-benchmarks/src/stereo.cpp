@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <Benchmark.h>
+
+#include <SFM.h>
+#include <fastBilateral.hpp>
+
+#include <iCub/stereoVision/elas/elas.h>
+#include <iCub/stereoVision/elasWrapper.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+#include <yarp/sig/Image.h>
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace yarp::os;
+
+
+/**
+ * Synthetic rectified stereo pair of a textured slanted plane with a box in front of it.
+ *
+ * The texture is random noise, generated with a fixed seed, and the right image is obtained by shifting
+ * the left one according to the ground truth disparity, i.e. 1/4 of the number of disparities for the
+ * background and 3/4 for the box.
+ */
+struct StereoPair
+{
+    StereoPair(const int width, const int height, const int num_disparities, const unsigned int seed)
+    {
+        cv::RNG rng(seed);
+
+        cv::Mat noise(height / 4, width / 4, CV_8UC1);
+        rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+        cv::resize(noise, left, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+
+        cv::Mat fine_noise(height, width, CV_8UC1);
+        rng.fill(fine_noise, cv::RNG::UNIFORM, 0, 32);
+        left += fine_noise;
+
+        disparity = cv::Mat(height, width, CV_32FC1);
+        for (int v = 0; v < height; v++)
+        {
+            for (int u = 0; u < width; u++)
+            {
+                const bool in_box = (u > width / 3) && (u < 2 * width / 3) && (v > height / 3) && (v < 2 * height / 3);
+
+                disparity.at<float>(v, u) = in_box ? 0.75f * num_disparities :
+                                                     0.25f * num_disparities * (1.0f + 0.5f * float(v) / height);
+            }
+        }
+
+        cv::Mat map_u(height, width, CV_32FC1);
+        cv::Mat map_v(height, width, CV_32FC1);
+        for (int v = 0; v < height; v++)
+        {
+            for (int u = 0; u < width; u++)
+            {
+                map_u.at<float>(v, u) = float(u) + disparity.at<float>(v, u);
+                map_v.at<float>(v, u) = float(v);
+            }
+        }
+        cv::remap(left, right, map_u, map_v, cv::INTER_LINEAR, cv::BORDER_REFLECT);
+    }
+
+    cv::Mat left;
+
+    cv::Mat right;
+
+    cv::Mat disparity;
+};
+
+
+int main(int argc, char** argv)
+{
+    const std::string log_ID = "[Benchmark Stereo]";
+    yInfo() << log_ID << "Configuring...";
+
+    ResourceFinder rf;
+    rf.setVerbose();
+    rf.setDefaultContext("object-tracking-benchmarks");
+    rf.setDefaultConfigFile("config.ini");
+    rf.configure(argc, argv);
+
+    const Bottle& rf_benchmark = rf.findGroup("BENCHMARK");
+    const unsigned int seed = rf_benchmark.check("seed", Value(1)).asInt();
+    const std::size_t warmup = rf_benchmark.check("warmup", Value(3)).asInt();
+    const std::size_t repetitions = rf_benchmark.check("repetitions", Value(20)).asInt();
+
+    const Bottle& rf_stereo = rf.findGroup("STEREO");
+    const double sigma_color = rf_stereo.check("sigma_color", Value(10.0)).asDouble();
+    const double sigma_space = rf_stereo.check("sigma_space", Value(10.0)).asDouble();
+    const double sigma_color_depth = rf_stereo.check("sigma_color_depth", Value(0.05)).asDouble();
+    const double sigma_space_depth = rf_stereo.check("sigma_space_depth", Value(5.0)).asDouble();
+    const std::string output_path = rf_stereo.check("output_file", Value("benchmark_stereo.csv")).asString();
+
+    /* Image sizes, a list of (width height). */
+    std::vector<std::pair<int, int>> sizes;
+    Bottle* sizes_list = rf_stereo.find("sizes").asList();
+    if (sizes_list != nullptr)
+    {
+        for (std::size_t i = 0; i < sizes_list->size(); i++)
+        {
+            Bottle* size = sizes_list->get(i).asList();
+            if ((size == nullptr) || (size->size() != 2))
+            {
+                yError() << log_ID << "Invalid size" << sizes_list->get(i).toString() << ", expected (width height).";
+                return EXIT_FAILURE;
+            }
+
+            sizes.push_back(std::make_pair(size->get(0).asInt(), size->get(1).asInt()));
+        }
+    }
+    else
+        sizes = {{320, 240}, {640, 480}};
+
+    yInfo() << log_ID << "Parameters:";
+    yInfo() << log_ID << "- seed:"        << seed;
+    yInfo() << log_ID << "- warmup:"      << warmup;
+    yInfo() << log_ID << "- repetitions:" << repetitions;
+    yInfo() << log_ID << "- sizes:"       << sizes.size();
+    yInfo() << log_ID << "- output_file:" << output_path;
+
+    Benchmark benchmark(warmup, repetitions);
+
+    for (const std::pair<int, int>& size : sizes)
+    {
+        const int width = size.first;
+        const int height = size.second;
+        const std::string input = "image=" + std::to_string(width) + "x" + std::to_string(height);
+        const double pixels = static_cast<double>(width) * height;
+
+        /* Same number of disparities used by SFM. */
+        const int num_disparities = (width <= 320) ? 96 : 128;
+
+        StereoPair pair(width, height, num_disparities, seed);
+
+        /* ELAS, with the settings used by elasWrapper. */
+        Elas::parameters elas_parameters(Elas::ROBOTICS);
+        elas_parameters.postprocess_only_left = true;
+        elas_parameters.disp_max = num_disparities - 1;
+
+        Elas elas(elas_parameters);
+
+        const int32_t dims[3] = {width, height, width};
+        std::vector<float> disparity_left(width * height);
+        std::vector<float> disparity_right(width * height);
+
+        benchmark.run("Elas::process", input, pixels,
+                      [&]
+                      {
+                          elas.process(pair.left.data, pair.right.data, disparity_left.data(), disparity_right.data(), dims);
+                      });
+
+        elasWrapper elas_wrapper(1.0, "ROBOTICS");
+        cv::Mat elas_disparity;
+
+        benchmark.run("elasWrapper::compute_disparity", input, pixels,
+                      [&]
+                      {
+                          elas_wrapper.compute_disparity(pair.left, pair.right, elas_disparity, num_disparities);
+                      });
+
+        /* Bilateral filter of the 8-bit disparity map, as in SFM::updateDisparity. */
+        cv::Mat disparity_8;
+        pair.disparity.convertTo(disparity_8, CV_8U, 255.0 / num_disparities);
+        cv::Mat filtered_disparity;
+
+        benchmark.run("cv_extend::bilateralFilter", input, pixels,
+                      [&]
+                      {
+                          cv_extend::bilateralFilter(disparity_8, filtered_disparity, sigma_color, sigma_space);
+                      });
+
+        /* Same filter keeping the grid across calls, as in SFM::sendDisparity. */
+        cv_extend::BilateralGrid bilateral_grid;
+
+        benchmark.run("cv_extend::BilateralGrid::apply", input, pixels,
+                      [&]
+                      {
+                          bilateral_grid.apply(disparity_8, filtered_disparity, sigma_color, sigma_space);
+                      });
+
+        /* Disparity to depth conversion, with the 16-bit fixed point disparity of StereoCamera. */
+        cv::Mat disparity_16;
+        pair.disparity.convertTo(disparity_16, CV_16SC1, 16.0);
+
+        const double focal = 0.9 * width;
+        const double baseline = 0.068;
+        cv::Mat Q = (cv::Mat_<double>(4, 4) << 1.0, 0.0, 0.0, -width / 2.0,
+                                               0.0, 1.0, 0.0, -height / 2.0,
+                                               0.0, 0.0, 0.0, focal,
+                                               0.0, 0.0, 1.0 / baseline, 0.0);
+        cv::Mat R = cv::Mat::eye(3, 3, CV_64FC1);
+        yarp::sig::ImageOf<yarp::sig::PixelFloat> depth;
+
+        benchmark.run("SFM::disparityToDepth", input, pixels,
+                      [&]
+                      {
+                          SFM::disparityToDepth(disparity_16, Q, R, depth);
+                      });
+
+        /* Bilateral filter of the depth, skipping the non valid pixels, as in SFM::sendDepth. */
+        cv::Mat depth_mat(depth.height(), depth.width(), CV_32FC1, depth.getRawImage(), depth.getRowSize());
+        cv::Mat filtered_depth;
+
+        benchmark.run("cv_extend::BilateralGrid::apply(depth)", input, pixels,
+                      [&]
+                      {
+                          bilateral_grid.apply(depth_mat, filtered_depth, sigma_color_depth, sigma_space_depth, true);
+                      });
+    }
+
+    if (!benchmark.write(output_path))
+        return EXIT_FAILURE;
+
+    yInfo() << log_ID << "Results written to" << output_path;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <Benchmark.h>
+
+#include <Correction.h>
+#include <InitParticles.h>
+#include <NanoflannPointCloudPrediction.h>
+#include <ParticlesCorrection.h>
+#include <ProximityLikelihood.h>
+#include <Random3DPose.h>
+#include <SimulatedPointCloud.h>
+#include <VCGTriMesh.h>
+
+#include <BayesFilters/ParticleSet.h>
+#include <BayesFilters/SimulatedStateModel.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+
+#include <Eigen/Dense>
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace bfl;
+using namespace Eigen;
+using namespace yarp::os;
+
+
+/**
+ * Expose the stages of ParticlesCorrection::correctStep so that they can be timed separately.
+ */
+class ProfiledParticlesCorrection : public ParticlesCorrection
+{
+public:
+    using ParticlesCorrection::ParticlesCorrection;
+
+    void correctGaussian(const ParticleSet& pred_particles, ParticleSet& corr_particles)
+    {
+        gaussian_correction_->correctStep(pred_particles, corr_particles);
+    }
+
+    void sample(ParticleSet& particles)
+    {
+        for (std::size_t i = 0; i < particles.components; i++)
+            particles.state(i) = sampleFromProposal(particles.mean(i), particles.covariance(i));
+    }
+};
+
+
+VectorXd loadVector(const Bottle& group, const std::string& key, const VectorXd& fallback)
+{
+    Bottle* list = group.find(key).asList();
+    if (list == nullptr)
+        return fallback;
+
+    VectorXd vector(list->size());
+    for (std::size_t i = 0; i < list->size(); i++)
+        vector(i) = list->get(i).asDouble();
+
+    return vector;
+}
+
+
+int main(int argc, char** argv)
+{
+    const std::string log_ID = "[Benchmark Tracker]";
+    yInfo() << log_ID << "Configuring...";
+
+    ResourceFinder rf;
+    rf.setVerbose();
+    rf.setDefaultContext("object-tracking-benchmarks");
+    rf.setDefaultConfigFile("config.ini");
+    rf.configure(argc, argv);
+
+    const Bottle& rf_benchmark = rf.findGroup("BENCHMARK");
+    const unsigned int seed = rf_benchmark.check("seed", Value(1)).asInt();
+    const std::size_t warmup = rf_benchmark.check("warmup", Value(3)).asInt();
+    const std::size_t repetitions = rf_benchmark.check("repetitions", Value(20)).asInt();
+
+    const Bottle& rf_tracker = rf.findGroup("TRACKER");
+    const std::string object_name = rf_tracker.check("object_name", Value("ycb_mustard_bottle")).asString();
+    const std::string mesh_root = rf_tracker.check("mesh_path", Value(OBJECT_TRACKING_MESH_PATH)).asString();
+    const std::size_t number_samples = rf_tracker.check("number_samples", Value(500)).asInt();
+    const std::size_t number_points = rf_tracker.check("number_points", Value(1500)).asInt();
+    const double likelihood_variance = rf_tracker.check("likelihood_variance", Value(0.05)).asDouble();
+    const std::string output_path = rf_tracker.check("output_file", Value("benchmark_tracker.csv")).asString();
+
+    const VectorXd radius_0 = loadVector(rf_tracker, "radius_0", (VectorXd(6) << 0.1, 0.1, 0.1, 3.14159, 3.14159, 3.14159).finished());
+    const VectorXd cov_0 = loadVector(rf_tracker, "cov_0", VectorXd::Constant(12, 0.01));
+
+    std::vector<std::size_t> particles_counts;
+    Bottle* particles_list = rf_tracker.find("particles").asList();
+    if (particles_list != nullptr)
+    {
+        for (std::size_t i = 0; i < particles_list->size(); i++)
+            particles_counts.push_back(particles_list->get(i).asInt());
+    }
+    else
+        particles_counts = {100, 500, 1000, 2000};
+
+    if ((radius_0.size() != 6) || (cov_0.size() != 12))
+    {
+        yError() << log_ID << "Wrong size of radius_0 or cov_0, expected 6 and 12 elements respectively.";
+        return EXIT_FAILURE;
+    }
+
+    const std::string mesh_path = mesh_root + "/" + object_name + "/nontextured.ply";
+    const MatrixXd covariance_0 = cov_0.asDiagonal();
+
+    std::string particles_description;
+    for (const std::size_t number_particles : particles_counts)
+        particles_description += std::to_string(number_particles) + " ";
+
+    yInfo() << log_ID << "Parameters:";
+    yInfo() << log_ID << "- seed:"           << seed;
+    yInfo() << log_ID << "- warmup:"         << warmup;
+    yInfo() << log_ID << "- repetitions:"    << repetitions;
+    yInfo() << log_ID << "- mesh:"           << mesh_path;
+    yInfo() << log_ID << "- number_samples:" << number_samples;
+    yInfo() << log_ID << "- number_points:"  << number_points;
+    yInfo() << log_ID << "- particles:"      << particles_description;
+    yInfo() << log_ID << "- output_file:"    << output_path;
+
+    /* Seeds of the components of the benchmark, all derived from the same seed. */
+    std::seed_seq seed_sequence{seed};
+    std::vector<unsigned int> seeds(5);
+    seed_sequence.generate(seeds.begin(), seeds.end());
+
+    /* Each particle count and each correction may consume a measurement, hence enough measurements are prefetched for all of them. */
+    const std::size_t number_measurements = particles_counts.size() * (warmup + repetitions + 1);
+
+    /* Fixed-seed object models and point clouds of the object, slowly moving in front of the observer. */
+    triMeshSurfSampler::SamplingRandomGenerator().initialize(seeds[0]);
+
+    VectorXd state_0 = VectorXd::Zero(3 + 3 + 4 + 3);
+    state_0(6) = 1.0;
+
+    std::unique_ptr<StateModel> rand_pose(new Random3DPose(0.03, 0.01, 0.01, 0.01, 0.3, 0.3, 0.3, seeds[1]));
+    std::unique_ptr<SimulatedStateModel> sim_rand_pose(new SimulatedStateModel(std::move(rand_pose), state_0, number_measurements));
+
+    std::unique_ptr<PointCloudPrediction> pc_prediction(new NanoflannPointCloudPrediction(mesh_path, number_samples));
+
+    std::unique_ptr<SimulatedPointCloud> pc_simulation(
+        new SimulatedPointCloud(mesh_path,
+                                std::move(pc_prediction),
+                                std::move(sim_rand_pose),
+                                MatrixXd::Identity(3, 3) * 0.0001,
+                                (VectorXd(3) << -0.3, 0.0, 0.4).finished(),
+                                number_points,
+                                true,
+                                seeds[2]));
+    pc_simulation->enableNoise(0.004, 0.004, 0.004);
+    if (!pc_simulation->prefetchMeasurements(number_measurements))
+    {
+        yError() << log_ID << "Unable to sample the point clouds.";
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<NanoflannPointCloudPrediction> distances(new NanoflannPointCloudPrediction(mesh_path, number_samples));
+    std::unique_ptr<NanoflannPointCloudPrediction> likelihood_distances(new NanoflannPointCloudPrediction(mesh_path, number_samples));
+
+    std::unique_ptr<Correction> correction(new Correction(std::move(pc_simulation), 12, 1.0, 2.0, 0.0, 3));
+    std::unique_ptr<ProximityLikelihood> likelihood(new ProximityLikelihood(likelihood_variance, std::move(likelihood_distances)));
+
+    ProfiledParticlesCorrection pf_correction(std::move(correction), std::move(likelihood), seeds[3]);
+    MeasurementModel& measurement_model = pf_correction.getMeasurementModel();
+    LikelihoodModel& likelihood_model = pf_correction.getLikelihoodModel();
+
+    /* Run the kernels. */
+    Benchmark benchmark(warmup, repetitions);
+
+    for (const std::size_t number_particles : particles_counts)
+    {
+        const std::string input = "particles=" + std::to_string(number_particles);
+
+        ParticleSet pred_particles(number_particles, 9, 3);
+        ParticleSet corr_particles(number_particles, 9, 3);
+
+        InitParticles initialization(seeds[4], VectorXd::Zero(6), radius_0, covariance_0);
+        initialization.initialize(pred_particles);
+
+        bool valid_measurement = measurement_model.freeze();
+
+        Data data_measurement;
+        if (valid_measurement)
+            std::tie(valid_measurement, data_measurement) = measurement_model.measure();
+
+        if (!valid_measurement)
+        {
+            yError() << log_ID << "Unable to get the measurements.";
+            return EXIT_FAILURE;
+        }
+
+        const VectorXd measurement = any::any_cast<MatrixXd>(data_measurement);
+        const double queries = static_cast<double>(number_particles) * (measurement.size() / 3);
+
+        benchmark.run("NanoflannPointCloudPrediction::evalDistances", input, queries,
+                      [&]
+                      {
+                          distances->evalDistances(pred_particles.state(), measurement);
+                      });
+
+        benchmark.run("ProximityLikelihood::likelihood", input, queries,
+                      [&]
+                      {
+                          likelihood_model.likelihood(measurement_model, pred_particles.state());
+                      });
+
+        benchmark.run("Correction::correctStep", input, number_particles,
+                      [&]
+                      {
+                          pf_correction.correctGaussian(pred_particles, corr_particles);
+                      });
+
+        benchmark.run("ParticlesCorrection::sampleFromProposal", input, number_particles,
+                      [&]
+                      {
+                          pf_correction.sample(corr_particles);
+                      });
+
+        benchmark.run("ParticlesCorrection::correct", input, number_particles,
+                      [&]
+                      {
+                          pf_correction.correct(pred_particles, corr_particles);
+                      });
+    }
+
+    if (!benchmark.write(output_path))
+        return EXIT_FAILURE;
+
+    yInfo() << log_ID << "Results written to" << output_path;
+
+    return EXIT_SUCCESS;
+}
@@ -30,13 +30,26 @@ public:
 
         yInfo() << log_ID_ << "Period is:" << period_;
 
+        pipeline_ = rf.check("pipeline", Value(true)).asBool();
+        queue_size_ = rf.check("queue_size", Value(2)).asInt();
+
+        yInfo() << log_ID_ << "Pipeline is:" << pipeline_;
+        yInfo() << log_ID_ << "Queue size is:" << queue_size_;
+
         ResourceFinder rf_sfm;
         rf_sfm.setVerbose(true);
         rf_sfm.setDefaultConfigFile("sfm_config.ini");
         rf_sfm.setDefaultContext("object-tracking");
         rf_sfm.configure(0, NULL);
 
-        return sfm_.configure(rf_sfm);
+        if (!sfm_.configure(rf_sfm))
+            return false;
+
+        /* Acquisition, matching and publication run on their own threads, the module is only kept alive. */
+        if (pipeline_)
+            return sfm_.startDepthPipeline(queue_size_);
+
+        return true;
     }
 
     double getPeriod()
@@ -46,7 +59,8 @@ public:
 
     bool updateModule()
     {
-        sfm_.updateDepth();
+        if (!pipeline_)
+            sfm_.updateDepth();
 
         return true;
     }
@@ -63,6 +77,10 @@ private:
 
     double period_;
 
+    bool pipeline_;
+
+    int queue_size_;
+
     SFM sfm_;
 };
 
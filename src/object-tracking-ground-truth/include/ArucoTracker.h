@@ -17,6 +17,7 @@
 #include <GaussianFilter_.h>
 
 #include <yarp/os/BufferedPort.h>
+#include <yarp/os/Stamp.h>
 #include <yarp/sig/Vector.h>
 
 #include <thrift/ArucoTrackerIDL.h>
@@ -68,6 +69,7 @@ protected:
     void log() override;
 
     yarp::os::BufferedPort<yarp::sig::Vector> port_estimate_out_;
+    yarp::os::Stamp estimate_stamp_;
 
     yarp::os::Port port_rpc_command_;
 
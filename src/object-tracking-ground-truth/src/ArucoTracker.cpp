@@ -201,6 +201,8 @@ void ArucoTracker::filteringStep()
     Vector& estimate_yarp = port_estimate_out_.prepare();
     estimate_yarp.resize(13);
     toEigen(estimate_yarp) = estimate;
+    estimate_stamp_.update();
+    port_estimate_out_.setEnvelope(estimate_stamp_);
     port_estimate_out_.write();
 
     // Allow the state model to evaluate the sampling time online
@@ -8,7 +8,7 @@
 #ifndef OBJECTTRACKINGLOGGER_H
 #define OBJECTTRACKINGLOGGER_H
 
-#include <BayesFilters/Logger.h>
+#include <StampedQueue.h>
 
 #include <Eigen/Dense>
 
@@ -21,13 +21,30 @@
 #include <yarp/os/RFModule.h>
 #include <yarp/sig/Vector.h>
 
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 
 
+/**
+ * Logger of the estimate, of the ground truth and of the execution time of the tracker.
+ *
+ * Each input port is read by a callback that stamps and enqueues the samples, while a writer thread aligns
+ * the streams to the estimate using the time stamps of the envelopes and stores them in the file data.bin.
+ *
+ * The file starts with the 8 bytes magic "OTSYNC01", the number of streams (uint32) and, for each stream,
+ * the length of its name (uint32) followed by the name. Then, a sequence of chunks follows, each made of the
+ * number of records (uint32), the size of the records in bytes (uint64) and the records. Each record is made of
+ * the time stamp of the estimate (float64) and, for each stream, the time stamp of the sample (float64, NaN if
+ * no sample is close enough to the estimate), the number of values (uint32) and the values (float64), all in
+ * little endian. Orientations are converted from axis/angle to Euler ZYX angles.
+ */
 class ObjectTrackingLogger : public yarp::os::RFModule,
-                             public ObjectTrackingLoggerIDL,
-                             public bfl::Logger
+                             public ObjectTrackingLoggerIDL
 {
 public:
     ObjectTrackingLogger(const std::string port_prefix, const double period);
@@ -51,13 +68,27 @@ public:
 protected:
     Eigen::Vector3d axisAngleToEuler210(const Eigen::VectorXd& axis_angle);
 
-    std::vector<std::string> log_filenames(const std::string& prefix_path, const std::string& prefix_name) /* override */
-    {
-        return {prefix_path + "/" + prefix_name + "_estimate",
-                prefix_path + "/" + prefix_name + "_gt_0",
-                prefix_path + "/" + prefix_name + "_gt_1",
-                prefix_path + "/" + prefix_name + "_execution"};
-    }
+    /**
+     * Convert a pose, expressed as position and axis/angle followed by optional values (e.g. velocities),
+     * to position and Euler angles followed by the same values.
+     */
+    Eigen::VectorXd poseToEuler(const Eigen::VectorXd& pose);
+
+    bool startWriter();
+
+    void stopWriter();
+
+    void writerLoop();
+
+    /**
+     * Align and serialize the samples received so far. Unless flush is true, an estimate is held back until
+     * all the other streams received a sample not older than it, or until sync_timeout_ elapsed.
+     */
+    void synchronize(const bool flush);
+
+    void writeChunk();
+
+    void append(const void* data, const std::size_t size);
 
     const std::string log_ID_ = "[LOGGER]";
 
@@ -80,6 +111,34 @@ protected:
     yarp::os::BufferedPort<yarp::sig::Vector> port_execution_time_in_;
 
     yarp::os::Port port_rpc_command_;
+
+    /**
+     * Queues of the input ports. The first one, i.e. the estimate, is the reference for the synchronization.
+     */
+    std::vector<std::unique_ptr<StampedQueue>> queues_;
+
+    /**
+     * Samples taken from the queues and not synchronized yet.
+     */
+    std::vector<std::deque<StampedSample>> pending_;
+
+    std::size_t queue_size_;
+
+    double sync_tolerance_;
+
+    double sync_timeout_;
+
+    std::size_t chunk_size_;
+
+    std::FILE* file_;
+
+    std::vector<char> chunk_;
+
+    std::size_t chunk_records_;
+
+    std::thread writer_;
+
+    std::atomic<bool> writing_;
 };
 
 #endif
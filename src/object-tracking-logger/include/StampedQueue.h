@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef STAMPEDQUEUE_H
+#define STAMPEDQUEUE_H
+
+#include <Eigen/Dense>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/TypedReaderCallback.h>
+#include <yarp/sig/Vector.h>
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+
+
+struct StampedSample
+{
+    /**
+     * Time stamp of the envelope, or time of arrival if the sender did not set the envelope.
+     */
+    double stamp;
+
+    Eigen::VectorXd data;
+};
+
+
+/**
+ * Bounded queue filled by the callback of an input port.
+ *
+ * Samples are stamped and enqueued as soon as they arrive, hence a slow consumer never stalls the reception.
+ * If the queue is full, the oldest sample is dropped and counted.
+ */
+class StampedQueue : public yarp::os::TypedReaderCallback<yarp::sig::Vector>
+{
+public:
+    StampedQueue(const std::string& name, yarp::os::BufferedPort<yarp::sig::Vector>& port, const std::size_t capacity);
+
+    virtual ~StampedQueue();
+
+    using yarp::os::TypedReaderCallback<yarp::sig::Vector>::onRead;
+
+    void onRead(yarp::sig::Vector& data) override;
+
+    /**
+     * Move all the queued samples, in order of arrival, at the end of samples.
+     */
+    void pop(std::deque<StampedSample>& samples);
+
+    void clear();
+
+    std::size_t getDropped();
+
+    const std::string& getName() const;
+
+protected:
+    const std::string name_;
+
+    yarp::os::BufferedPort<yarp::sig::Vector>& port_;
+
+    const std::size_t capacity_;
+
+    std::deque<StampedSample> queue_;
+
+    std::size_t dropped_;
+
+    std::mutex mutex_;
+};
+
+#endif /* STAMPEDQUEUE_H */
@@ -13,10 +13,17 @@ import matplotlib.pyplot as plt
 import csv
 import numpy as np
 import math
+import os
 import sys
 
+from sync_log import read_sync_log
+
 def read_data(prefix, postfix):
 
+    # Synchronized binary log, if available
+    if os.path.isfile(prefix + '.bin'):
+        return read_sync_log(prefix + '.bin')[2][postfix]
+
     data = []
 
     with open(prefix + '_' + postfix + '.txt', newline='') as csv_data:
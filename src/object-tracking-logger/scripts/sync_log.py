@@ -0,0 +1,91 @@
+#===============================================================================
+#
+# Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+#
+# This software may be modified and distributed under the terms of the
+# GPL-2+ license. See the accompanying LICENSE file for details.
+#
+#===============================================================================
+
+# Reader of the synchronized logs written by object-tracking-logger (data.bin).
+#
+# The file starts with the magic "OTSYNC01", the number of streams (uint32) and, for each stream, the length
+# of its name (uint32) followed by the name. Then, a sequence of chunks follows, each made of the number of
+# records (uint32), the size of the records in bytes (uint64) and the records. Each record is made of the time
+# stamp of the estimate (float64) and, for each stream, the time stamp of the sample (float64, NaN if missing),
+# the number of values (uint32) and the values (float64), all in little endian.
+
+import numpy as np
+import struct
+import sys
+
+MAGIC = b'OTSYNC01'
+
+def read_sync_log(file_name):
+
+    # Return the time stamps of the estimates and, for each stream, the time stamps of the samples and
+    # the samples as rows of a matrix. Missing samples are filled with NaN.
+    with open(file_name, 'rb') as log:
+        data = log.read()
+
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError(file_name + ' is not a synchronized log.')
+
+    offset = len(MAGIC)
+    number_streams, = struct.unpack_from('<I', data, offset)
+    offset += 4
+
+    names = []
+    for i in range(number_streams):
+        length, = struct.unpack_from('<I', data, offset)
+        offset += 4
+        names.append(data[offset : offset + length].decode())
+        offset += length
+
+    times = []
+    stamps = {name : [] for name in names}
+    samples = {name : [] for name in names}
+
+    while offset + 12 <= len(data):
+        number_records, size = struct.unpack_from('<IQ', data, offset)
+        offset += 12
+
+        if offset + size > len(data):
+            # Truncated chunk, e.g. if the logger has been killed
+            break
+
+        for i in range(number_records):
+            time, = struct.unpack_from('<d', data, offset)
+            offset += 8
+            times.append(time)
+
+            for name in names:
+                stamp, length = struct.unpack_from('<dI', data, offset)
+                offset += 12
+                stamps[name].append(stamp)
+                samples[name].append(np.frombuffer(data, dtype = '<f8', count = length, offset = offset))
+                offset += 8 * length
+
+    for name in names:
+        sizes = [len(sample) for sample in samples[name] if len(sample) > 0]
+        width = max(sizes) if len(sizes) > 0 else 0
+        samples[name] = np.array([sample if len(sample) == width else np.full(width, np.nan) for sample in samples[name]])
+        stamps[name] = np.array(stamps[name])
+
+    return np.array(times), stamps, samples
+
+def main():
+
+    if len(sys.argv) != 2:
+        print('Usage: python3 sync_log.py <data.bin>')
+        sys.exit(1)
+
+    times, stamps, samples = read_sync_log(sys.argv[1])
+
+    print('Records: ' + str(len(times)))
+    for name in samples:
+        missing = np.count_nonzero(np.isnan(stamps[name]))
+        print(name + ': ' + str(samples[name].shape[1] if samples[name].ndim == 2 else 0) + ' values, ' + str(missing) + ' missing')
+
+if __name__ == '__main__':
+    main()
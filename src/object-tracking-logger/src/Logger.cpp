@@ -10,44 +10,63 @@
 #include <Eigen/Dense>
 
 #include <yarp/eigen/Eigen.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Time.h>
 
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 
 using namespace Eigen;
 using namespace yarp::eigen;
+using namespace yarp::os;
+
+
+namespace
+{
+    const char sync_log_magic[8] = {'O', 'T', 'S', 'Y', 'N', 'C', '0', '1'};
+}
+
 
 ObjectTrackingLogger::ObjectTrackingLogger(const std::string port_prefix, const double period) :
     port_prefix_(port_prefix),
     period_(period),
     run_(false),
-    quit_(false)
+    quit_(false),
+    file_(nullptr),
+    chunk_records_(0),
+    writing_(false)
 { }
 
 
 ObjectTrackingLogger::~ObjectTrackingLogger()
-{ }
+{
+    stopWriter();
+}
 
 
 bool ObjectTrackingLogger::run()
 {
-    enable_log(".", "data");
-
     mutex_.lock();
 
-    run_ = true;
+    bool ok = run_ || startWriter();
+    if (ok)
+        run_ = true;
 
     mutex_.unlock();
 
-    return true;
+    return ok;
 }
 
 
 bool ObjectTrackingLogger::stop()
 {
-    disable_log();
-
     mutex_.lock();
 
+    stopWriter();
+
     run_ = false;
 
     mutex_.unlock();
@@ -58,10 +77,10 @@ bool ObjectTrackingLogger::stop()
 
 bool ObjectTrackingLogger::quit()
 {
-    disable_log();
-
     mutex_.lock();
 
+    stopWriter();
+
     quit_ = true;
 
     stopModule();
@@ -74,6 +93,11 @@ bool ObjectTrackingLogger::quit()
 
 bool ObjectTrackingLogger::configure(yarp::os::ResourceFinder& rf)
 {
+    queue_size_ = rf.check("queue_size", Value(1000)).asInt();
+    sync_tolerance_ = rf.check("sync_tolerance", Value(0.02)).asDouble();
+    sync_timeout_ = rf.check("sync_timeout", Value(0.5)).asDouble();
+    chunk_size_ = rf.check("chunk_size", Value(64)).asInt();
+
     bool ports_ok = true;
 
     ports_ok &= port_estimate_in_.open("/" + port_prefix_ + "/estimate:i");
@@ -88,7 +112,29 @@ bool ObjectTrackingLogger::configure(yarp::os::ResourceFinder& rf)
 
     ports_ok &= this->yarp().attachAsServer(port_rpc_command_);
 
-    return ports_ok;
+    if (!ports_ok)
+        return false;
+
+    /* Samples are read as soon as they arrive, none of them is overwritten within the ports. */
+    queues_.emplace_back(new StampedQueue("estimate", port_estimate_in_, queue_size_));
+    queues_.emplace_back(new StampedQueue("gt_0", port_ground_truth_0_in_, queue_size_));
+    queues_.emplace_back(new StampedQueue("gt_1", port_ground_truth_1_in_, queue_size_));
+    queues_.emplace_back(new StampedQueue("execution", port_execution_time_in_, queue_size_));
+    pending_.resize(queues_.size());
+
+    port_estimate_in_.setStrict();
+    port_estimate_in_.useCallback(*queues_[0]);
+
+    port_ground_truth_0_in_.setStrict();
+    port_ground_truth_0_in_.useCallback(*queues_[1]);
+
+    port_ground_truth_1_in_.setStrict();
+    port_ground_truth_1_in_.useCallback(*queues_[2]);
+
+    port_execution_time_in_.setStrict();
+    port_execution_time_in_.useCallback(*queues_[3]);
+
+    return true;
 }
 
 
@@ -100,76 +146,235 @@ double ObjectTrackingLogger::getPeriod()
 
 bool ObjectTrackingLogger::updateModule()
 {
-    bool run_local;
-
     bool quit_local;
 
     mutex_.lock();
 
-    run_local = run_;
     quit_local = quit_;
 
     mutex_.unlock();
 
-    if (!quit_local)
-    {
-        if (run_local)
-        {
-            yarp::sig::Vector* estimate = port_estimate_in_.read(true);
-            yarp::sig::Vector* ground_truth_0 = port_ground_truth_0_in_.read(true);
-            yarp::sig::Vector* ground_truth_1 = port_ground_truth_1_in_.read(true);
-            yarp::sig::Vector* execution_time = port_execution_time_in_.read(true);
-
-            VectorXd estimate_eigen = toEigen(*estimate);
-            VectorXd ground_truth_0_eigen = toEigen(*ground_truth_0);
-            VectorXd ground_truth_1_eigen = toEigen(*ground_truth_1);
-            VectorXd execution_time_eigen = toEigen(*execution_time);
-
-            VectorXd estimate_euler(12);
-            VectorXd ground_truth_0_euler(12);
-            VectorXd ground_truth_1_euler(6);
-            estimate_euler.head<3>() = estimate_eigen.head<3>();
-            ground_truth_0_euler.head<3>() = ground_truth_0_eigen.head<3>();
-            ground_truth_1_euler.head<3>() = ground_truth_1_eigen.head<3>();
-
-            estimate_euler.segment<3>(3) = axisAngleToEuler210(estimate_eigen.segment(3, 4));
-            ground_truth_0_euler.segment<3>(3) = axisAngleToEuler210(ground_truth_0_eigen.segment(3, 4));
-            ground_truth_1_euler.tail<3>() = axisAngleToEuler210(ground_truth_1_eigen.segment(3, 4));
-
-            estimate_euler.segment<6>(6) = estimate_eigen.segment<6>(7);
-            ground_truth_0_euler.segment<6>(6) = ground_truth_0_eigen.segment<6>(7);
-
-            // std::cout << estimate_eigen.transpose() << std::endl << std::flush;
-            // std::cout << ground_truth_0_eigen.transpose() << std::endl << std::flush;
-            // std::cout << ground_truth_1_eigen.transpose() << std::endl << std::flush;
-            // std::cout << execution_time_eigen.transpose() << std::endl << std::flush;
-
-            logger(estimate_euler.transpose(), ground_truth_0_euler.transpose(), ground_truth_1_euler.transpose(), execution_time_eigen.transpose());
-        }
-
-        return true;
-    }
-
-    return false;
+    return !quit_local;
 }
 
 
 bool ObjectTrackingLogger::close()
 {
+    port_estimate_in_.disableCallback();
     port_estimate_in_.close();
 
+    port_ground_truth_0_in_.disableCallback();
     port_ground_truth_0_in_.close();
 
+    port_ground_truth_1_in_.disableCallback();
     port_ground_truth_1_in_.close();
 
+    port_execution_time_in_.disableCallback();
     port_execution_time_in_.close();
 
+    stopWriter();
+
     return true;
 }
 
+
 Eigen::Vector3d ObjectTrackingLogger::axisAngleToEuler210(const Eigen::VectorXd& axis_angle)
 {
     AngleAxisd angle_axis(axis_angle(3), axis_angle.head<3>());
 
     return angle_axis.toRotationMatrix().eulerAngles(2, 1, 0);
 }
+
+
+VectorXd ObjectTrackingLogger::poseToEuler(const VectorXd& pose)
+{
+    if (pose.size() < 7)
+        return pose;
+
+    VectorXd pose_euler(pose.size() - 1);
+    pose_euler.head<3>() = pose.head<3>();
+    pose_euler.segment<3>(3) = axisAngleToEuler210(pose.segment(3, 4));
+    pose_euler.tail(pose.size() - 7) = pose.tail(pose.size() - 7);
+
+    return pose_euler;
+}
+
+
+bool ObjectTrackingLogger::startWriter()
+{
+    const std::string file_name = "./data.bin";
+
+    file_ = std::fopen(file_name.c_str(), "wb");
+    if (file_ == nullptr)
+    {
+        yError() << log_ID_ << "Cannot open file" << file_name;
+
+        return false;
+    }
+
+    std::fwrite(sync_log_magic, 1, sizeof(sync_log_magic), file_);
+
+    const std::uint32_t number_streams = queues_.size();
+    std::fwrite(&number_streams, sizeof(number_streams), 1, file_);
+    for (const auto& queue : queues_)
+    {
+        const std::uint32_t name_length = queue->getName().size();
+        std::fwrite(&name_length, sizeof(name_length), 1, file_);
+        std::fwrite(queue->getName().data(), 1, name_length, file_);
+    }
+
+    /* Samples received while the logger was stopped are discarded. */
+    for (std::size_t i = 0; i < queues_.size(); i++)
+    {
+        queues_[i]->clear();
+        pending_[i].clear();
+    }
+    chunk_.clear();
+    chunk_records_ = 0;
+
+    writing_ = true;
+    writer_ = std::thread(&ObjectTrackingLogger::writerLoop, this);
+
+    return true;
+}
+
+
+void ObjectTrackingLogger::stopWriter()
+{
+    if (!writer_.joinable())
+        return;
+
+    writing_ = false;
+    writer_.join();
+
+    std::fclose(file_);
+    file_ = nullptr;
+
+    for (const auto& queue : queues_)
+    {
+        if (queue->getDropped() > 0)
+            yWarning() << log_ID_ << queue->getDropped() << "samples have been dropped from stream" << queue->getName() << ", consider increasing queue_size.";
+    }
+}
+
+
+void ObjectTrackingLogger::writerLoop()
+{
+    while (writing_)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        synchronize(false);
+    }
+
+    synchronize(true);
+    writeChunk();
+
+    std::fflush(file_);
+}
+
+
+void ObjectTrackingLogger::synchronize(const bool flush)
+{
+    for (std::size_t i = 0; i < queues_.size(); i++)
+        queues_[i]->pop(pending_[i]);
+
+    const double now = Time::now();
+    std::deque<StampedSample>& estimates = pending_[0];
+
+    while (!estimates.empty())
+    {
+        const StampedSample& estimate = estimates.front();
+        const double stamp = estimate.stamp;
+
+        /* Samples of a stream are received in order, hence a sample not older than the estimate means that no closer sample will arrive. */
+        if (!flush && ((now - stamp) < sync_timeout_))
+        {
+            bool ready = true;
+            for (std::size_t i = 1; i < pending_.size(); i++)
+                ready &= (!pending_[i].empty()) && (pending_[i].back().stamp >= stamp);
+
+            if (!ready)
+                break;
+        }
+
+        append(&stamp, sizeof(stamp));
+
+        const VectorXd estimate_euler = poseToEuler(estimate.data);
+        const std::uint32_t estimate_size = estimate_euler.size();
+        append(&stamp, sizeof(stamp));
+        append(&estimate_size, sizeof(estimate_size));
+        append(estimate_euler.data(), sizeof(double) * estimate_size);
+
+        for (std::size_t i = 1; i < pending_.size(); i++)
+        {
+            std::deque<StampedSample>& samples = pending_[i];
+
+            std::size_t closest = samples.size();
+            for (std::size_t j = 0; j < samples.size(); j++)
+            {
+                if ((closest == samples.size()) || (std::abs(samples[j].stamp - stamp) < std::abs(samples[closest].stamp - stamp)))
+                    closest = j;
+            }
+
+            if ((closest != samples.size()) && (std::abs(samples[closest].stamp - stamp) <= sync_tolerance_))
+            {
+                /* The execution time is stored as it is. */
+                const VectorXd data = (queues_[i]->getName() == "execution") ? samples[closest].data : poseToEuler(samples[closest].data);
+                const std::uint32_t size = data.size();
+                append(&samples[closest].stamp, sizeof(double));
+                append(&size, sizeof(size));
+                append(data.data(), sizeof(double) * size);
+
+                /* The same sample might be the closest one to the next estimate as well. */
+                samples.erase(samples.begin(), samples.begin() + closest);
+            }
+            else
+            {
+                const double missing = std::numeric_limits<double>::quiet_NaN();
+                const std::uint32_t size = 0;
+                append(&missing, sizeof(missing));
+                append(&size, sizeof(size));
+
+                while ((!samples.empty()) && (samples.front().stamp < stamp - sync_tolerance_))
+                    samples.pop_front();
+            }
+        }
+
+        estimates.pop_front();
+
+        chunk_records_++;
+        if (chunk_records_ >= chunk_size_)
+            writeChunk();
+    }
+
+    /* Streams might be received while the estimate is not. */
+    for (std::size_t i = 1; i < pending_.size(); i++)
+    {
+        while (pending_[i].size() > queue_size_)
+            pending_[i].pop_front();
+    }
+}
+
+
+void ObjectTrackingLogger::writeChunk()
+{
+    if (chunk_records_ == 0)
+        return;
+
+    const std::uint32_t number_records = chunk_records_;
+    const std::uint64_t chunk_size = chunk_.size();
+    std::fwrite(&number_records, sizeof(number_records), 1, file_);
+    std::fwrite(&chunk_size, sizeof(chunk_size), 1, file_);
+    std::fwrite(chunk_.data(), 1, chunk_.size(), file_);
+
+    chunk_.clear();
+    chunk_records_ = 0;
+}
+
+
+void ObjectTrackingLogger::append(const void* data, const std::size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    chunk_.insert(chunk_.end(), bytes, bytes + size);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <StampedQueue.h>
+
+#include <yarp/eigen/Eigen.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/os/Time.h>
+
+using namespace yarp::eigen;
+using namespace yarp::os;
+
+
+StampedQueue::StampedQueue(const std::string& name, BufferedPort<yarp::sig::Vector>& port, const std::size_t capacity) :
+    name_(name),
+    port_(port),
+    capacity_(capacity),
+    dropped_(0)
+{ }
+
+
+StampedQueue::~StampedQueue()
+{ }
+
+
+void StampedQueue::onRead(yarp::sig::Vector& data)
+{
+    StampedSample sample;
+
+    Stamp stamp;
+    if (port_.getEnvelope(stamp) && stamp.isValid())
+        sample.stamp = stamp.getTime();
+    else
+        sample.stamp = Time::now();
+
+    sample.data = toEigen(data);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (queue_.size() >= capacity_)
+    {
+        queue_.pop_front();
+        dropped_++;
+    }
+
+    queue_.push_back(std::move(sample));
+}
+
+
+void StampedQueue::pop(std::deque<StampedSample>& samples)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (StampedSample& sample : queue_)
+        samples.push_back(std::move(sample));
+
+    queue_.clear();
+}
+
+
+void StampedQueue::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    queue_.clear();
+}
+
+
+std::size_t StampedQueue::getDropped()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return dropped_;
+}
+
+
+const std::string& StampedQueue::getName() const
+{
+    return name_;
+}
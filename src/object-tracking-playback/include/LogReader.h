@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef LOGREADER_H
+#define LOGREADER_H
+
+#include <Eigen/Dense>
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Log file mapped in memory and indexed by frame.
+ *
+ * Both the text logs written by bfl::Logger, one frame per line, and the uncompressed binary logs written
+ * by BinaryLogger are supported. Only the offsets of the frames are evaluated when the file is opened,
+ * while the frames are decoded on request.
+ */
+class MappedLog
+{
+public:
+    MappedLog(const std::string& filename);
+
+    virtual ~MappedLog();
+
+    std::size_t size() const;
+
+    /**
+     * Decode the values of a frame. Can be called concurrently.
+     */
+    std::pair<bool, std::vector<double>> frame(const std::size_t index) const;
+
+    const std::string& getFilename() const;
+
+private:
+    void indexText();
+
+    void indexBinary();
+
+    std::string filename_;
+
+    const char* data_;
+
+    std::size_t data_size_;
+
+    bool binary_;
+
+    /**
+     * Offset of the beginning and of the end of each frame within the mapped data.
+     */
+    std::vector<std::pair<std::size_t, std::size_t>> index_;
+};
+
+
+/**
+ * Lazy reader of a log file.
+ *
+ * Frames are decoded on request and a worker thread prefetches the frames within a window around the last
+ * requested one, so that moving forward and backward does not wait for the decoding. Frames outside the
+ * window are evicted, hence the memory footprint does not depend on the length of the log.
+ */
+class LogReader
+{
+public:
+    /**
+     * Each frame is reshaped as a matrix with the given number of rows. If cols is not zero, frames are
+     * also required to have exactly cols columns.
+     */
+    LogReader(const std::string& filename, const std::size_t rows, const std::size_t cols, const std::size_t window = 32);
+
+    virtual ~LogReader();
+
+    std::size_t size() const;
+
+    std::pair<bool, Eigen::MatrixXd> get(const std::size_t index);
+
+private:
+    std::pair<bool, Eigen::MatrixXd> decode(const std::size_t index) const;
+
+    void prefetchLoop();
+
+    bool inWindow(const std::size_t index, const std::size_t center) const;
+
+    MappedLog log_;
+
+    const std::size_t rows_;
+
+    const std::size_t cols_;
+
+    const std::size_t window_;
+
+    std::map<std::size_t, Eigen::MatrixXd> cache_;
+
+    std::size_t requested_;
+
+    bool running_;
+
+    std::mutex mutex_;
+
+    std::condition_variable request_;
+
+    std::thread worker_;
+};
+
+#endif /* LOGREADER_H */
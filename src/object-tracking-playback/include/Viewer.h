@@ -19,8 +19,11 @@
 #include <vtkSmartPointer.h>
 #include <vtkVertexGlyphFilter.h>
 
+#include <LogReader.h>
+
 #include <Eigen/Dense>
 
+#include <memory>
 #include <string>
 
 class LeftRightArrowManualPlayback;
@@ -128,19 +131,18 @@ public:
     void stepBackward();
 
 private:
-    std::pair<bool, Eigen::MatrixXd> readStateFromFile(const std::string& filename, const std::size_t num_fields);
-
-    std::pair<bool, std::vector<Eigen::MatrixXd>> readMeasurementsFromFile(const std::string& filename);
-
     void updateView();
 
-    Eigen::MatrixXd target_;
+    /**
+     * Logs are indexed when the visualizer is created and each frame is decoded when visited.
+     */
+    std::unique_ptr<LogReader> target_;
 
-    Eigen::MatrixXd estimate_;
+    std::unique_ptr<LogReader> estimate_;
 
-    Eigen::MatrixXd prediction_;
+    std::unique_ptr<LogReader> prediction_;
 
-    std::vector<Eigen::MatrixXd> measurements_;
+    std::unique_ptr<LogReader> measurements_;
 
     std::unique_ptr<Points> vtk_measurements;
 
@@ -0,0 +1,96 @@
+#===============================================================================
+#
+# Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+#
+# This software may be modified and distributed under the terms of the
+# GPL-2+ license. See the accompanying LICENSE file for details.
+#
+#===============================================================================
+
+# Reader of the binary logs written by BinaryLogger, either plain (.bin) or compressed (.bin.gz).
+#
+# The file starts with the magic "OTBLOG01" followed by the records. Each record is made of
+# the number of rows and columns (uint32), the time of the record in seconds (float64) and
+# the data in column-major order (float64), all in little endian.
+
+import gzip
+import numpy as np
+import os
+import struct
+import sys
+
+MAGIC = b'OTBLOG01'
+HEADER = struct.Struct('<IId')
+
+def open_log(file_name):
+
+    if file_name.endswith('.gz'):
+        return gzip.open(file_name, 'rb')
+
+    return open(file_name, 'rb')
+
+def read_records(file_name):
+
+    # Return the list of the times and the list of the records, as 2D arrays
+    times = []
+    records = []
+
+    with open_log(file_name) as log:
+        data = log.read()
+
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError(file_name + ' is not a binary log.')
+
+    offset = len(MAGIC)
+    while offset + HEADER.size <= len(data):
+        rows, cols, time = HEADER.unpack_from(data, offset)
+        offset += HEADER.size
+
+        size = rows * cols
+        if offset + 8 * size > len(data):
+            # Truncated record, e.g. if the tracker has been killed
+            break
+
+        record = np.frombuffer(data, dtype = '<f8', count = size, offset = offset).reshape((rows, cols), order = 'F')
+        offset += 8 * size
+
+        times.append(time)
+        records.append(record)
+
+    return times, records
+
+def read_binary_data(file_name):
+
+    # Return the times and the records as rows of a matrix, as done by read_data for the text logs
+    times, records = read_records(file_name)
+
+    return np.array(times), np.array([record.flatten(order = 'F') for record in records])
+
+def find_log(prefix, postfix):
+
+    # Binary logs are preferred to text logs if both are available
+    for extension in ['.bin', '.bin.gz', '.txt']:
+        file_name = prefix + '_' + postfix + extension
+        if os.path.isfile(file_name):
+            return file_name
+
+    return None
+
+def to_text(file_name, output):
+
+    # Convert a binary log in the text format written by bfl::Logger
+    times, records = read_records(file_name)
+
+    for record in records:
+        output.write(' '.join(repr(float(value)) for value in record.flatten(order = 'F')) + '\n')
+
+def main():
+
+    if len(sys.argv) != 2:
+        print('Usage: python3 binary_log.py <log.bin|log.bin.gz> > <log.txt>')
+        sys.exit(1)
+
+    to_text(sys.argv[1], sys.stdout)
+
+if __name__ == '__main__':
+    main()
@@ -12,8 +12,14 @@ import csv
 import numpy as np
 import math
 
+from binary_log import find_log, read_binary_data
+
 def read_data(prefix, postfix):
 
+    file_name = find_log(prefix, postfix)
+    if file_name is not None and not file_name.endswith('.txt'):
+        return read_binary_data(file_name)[1]
+
     data = []
 
     with open(prefix + '_' + postfix + '.txt', newline='') as csv_data:
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <LogReader.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Eigen;
+
+
+namespace
+{
+    const char binary_log_magic[8] = {'O', 'T', 'B', 'L', 'O', 'G', '0', '1'};
+
+    /* Number of rows and of columns (uint32) and time (float64) preceding each binary record. */
+    const std::size_t binary_record_header_size = 2 * sizeof(std::uint32_t) + sizeof(double);
+}
+
+
+MappedLog::MappedLog(const std::string& filename) :
+    filename_(filename),
+    data_(nullptr),
+    data_size_(0),
+    binary_(false)
+{
+    int fd = open(filename_.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("ERROR::MAPPEDLOG::CTOR\nERROR: Failed to open " + filename_ + ".");
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0)
+    {
+        close(fd);
+
+        throw std::runtime_error("ERROR::MAPPEDLOG::CTOR\nERROR: Failed to get the size of " + filename_ + ".");
+    }
+    data_size_ = file_stat.st_size;
+
+    /* An empty file cannot be mapped, yet it is a valid log without frames. */
+    if (data_size_ > 0)
+    {
+        void* data = mmap(nullptr, data_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+
+            throw std::runtime_error("ERROR::MAPPEDLOG::CTOR\nERROR: Failed to map " + filename_ + " in memory.");
+        }
+        data_ = static_cast<const char*>(data);
+
+        /* Frames are mostly visited in order. */
+        madvise(data, data_size_, MADV_SEQUENTIAL);
+    }
+
+    /* The mapping is still valid after the descriptor is closed. */
+    close(fd);
+
+    binary_ = (data_size_ >= sizeof(binary_log_magic)) && (std::memcmp(data_, binary_log_magic, sizeof(binary_log_magic)) == 0);
+
+    if (binary_)
+        indexBinary();
+    else
+        indexText();
+}
+
+
+MappedLog::~MappedLog()
+{
+    if (data_ != nullptr)
+        munmap(const_cast<char*>(data_), data_size_);
+}
+
+
+std::size_t MappedLog::size() const
+{
+    return index_.size();
+}
+
+
+std::pair<bool, std::vector<double>> MappedLog::frame(const std::size_t index) const
+{
+    if (index >= index_.size())
+        return std::make_pair(false, std::vector<double>());
+
+    const std::size_t begin = index_[index].first;
+    const std::size_t end = index_[index].second;
+
+    if (binary_)
+    {
+        std::vector<double> values((end - begin) / sizeof(double));
+        std::memcpy(values.data(), data_ + begin, end - begin);
+
+        return std::make_pair(true, values);
+    }
+
+    /* The line is copied since std::strtod requires a null terminated string. */
+    const std::string line(data_ + begin, end - begin);
+
+    std::vector<double> values;
+    const char* current = line.c_str();
+    char* next;
+    while (true)
+    {
+        double value = std::strtod(current, &next);
+        if (next == current)
+            break;
+
+        values.push_back(value);
+        current = next;
+    }
+
+    /* Anything left other than spaces means that the line is malformed. */
+    while ((*current == ' ') || (*current == '\t') || (*current == '\r'))
+        current++;
+    if (*current != '\0')
+        return std::make_pair(false, std::vector<double>());
+
+    return std::make_pair(true, values);
+}
+
+
+const std::string& MappedLog::getFilename() const
+{
+    return filename_;
+}
+
+
+void MappedLog::indexText()
+{
+    std::size_t begin = 0;
+    while (begin < data_size_)
+    {
+        const char* newline = static_cast<const char*>(std::memchr(data_ + begin, '\n', data_size_ - begin));
+        const std::size_t end = (newline != nullptr) ? (newline - data_) : data_size_;
+
+        index_.emplace_back(begin, end);
+
+        begin = end + 1;
+    }
+}
+
+
+void MappedLog::indexBinary()
+{
+    std::size_t begin = sizeof(binary_log_magic);
+    while (begin + binary_record_header_size <= data_size_)
+    {
+        std::uint32_t rows;
+        std::uint32_t cols;
+        std::memcpy(&rows, data_ + begin, sizeof(rows));
+        std::memcpy(&cols, data_ + begin + sizeof(rows), sizeof(cols));
+
+        const std::size_t data_begin = begin + binary_record_header_size;
+        const std::size_t data_end = data_begin + sizeof(double) * rows * cols;
+
+        /* Truncated record, e.g. if the tracker has been killed. */
+        if (data_end > data_size_)
+            break;
+
+        index_.emplace_back(data_begin, data_end);
+
+        begin = data_end;
+    }
+}
+
+
+LogReader::LogReader(const std::string& filename, const std::size_t rows, const std::size_t cols, const std::size_t window) :
+    log_(filename),
+    rows_(rows),
+    cols_(cols),
+    window_(window),
+    requested_(0),
+    running_(true)
+{
+    worker_ = std::thread(&LogReader::prefetchLoop, this);
+}
+
+
+LogReader::~LogReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    request_.notify_one();
+
+    worker_.join();
+}
+
+
+std::size_t LogReader::size() const
+{
+    return log_.size();
+}
+
+
+std::pair<bool, MatrixXd> LogReader::get(const std::size_t index)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        requested_ = index;
+
+        for (auto it = cache_.begin(); it != cache_.end();)
+        {
+            if (inWindow(it->first, requested_))
+                it++;
+            else
+                it = cache_.erase(it);
+        }
+    }
+    request_.notify_one();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = cache_.find(index);
+        if (it != cache_.end())
+            return std::make_pair(true, it->second);
+    }
+
+    /* Not prefetched yet, decode here. */
+    bool valid_frame;
+    MatrixXd frame;
+    std::tie(valid_frame, frame) = decode(index);
+    if (!valid_frame)
+    {
+        std::cout << "Malformed input file " << log_.getFilename() << '\n';
+
+        return std::make_pair(false, MatrixXd(0, 0));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_[index] = frame;
+
+    return std::make_pair(true, frame);
+}
+
+
+std::pair<bool, MatrixXd> LogReader::decode(const std::size_t index) const
+{
+    bool valid_frame;
+    std::vector<double> values;
+    std::tie(valid_frame, values) = log_.frame(index);
+    if (!valid_frame)
+        return std::make_pair(false, MatrixXd(0, 0));
+
+    if ((values.size() % rows_) != 0)
+        return std::make_pair(false, MatrixXd(0, 0));
+
+    const std::size_t cols = values.size() / rows_;
+    if ((cols_ != 0) && (cols != cols_))
+        return std::make_pair(false, MatrixXd(0, 0));
+
+    MatrixXd frame = Map<MatrixXd>(values.data(), rows_, cols);
+
+    return std::make_pair(true, frame);
+}
+
+
+void LogReader::prefetchLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    std::size_t served = log_.size();
+    while (running_)
+    {
+        request_.wait(lock, [this, &served]{ return !running_ || (requested_ != served); });
+
+        served = requested_;
+
+        /* Frames ahead of the requested one first, then those behind. */
+        std::vector<std::size_t> missing;
+        for (std::size_t i = served; (i <= served + window_) && (i < log_.size()); i++)
+            missing.push_back(i);
+        for (std::size_t i = 1; (i <= window_) && (i <= served); i++)
+            missing.push_back(served - i);
+
+        for (const std::size_t index : missing)
+        {
+            if (!running_ || (requested_ != served))
+                break;
+
+            if (cache_.find(index) != cache_.end())
+                continue;
+
+            lock.unlock();
+
+            bool valid_frame;
+            MatrixXd frame;
+            std::tie(valid_frame, frame) = decode(index);
+
+            lock.lock();
+
+            /* Malformed frames are reported when they are requested. */
+            if (valid_frame && inWindow(index, requested_))
+                cache_[index] = frame;
+        }
+    }
+}
+
+
+bool LogReader::inWindow(const std::size_t index, const std::size_t center) const
+{
+    return (index + window_ >= center) && (index <= center + window_);
+}
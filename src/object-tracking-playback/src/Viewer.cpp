@@ -12,9 +12,7 @@
 #include <vtkInteractorStyleTrackballCamera.h>
 #include <vtkTransform.h>
 
-#include <fstream>
 #include <memory>
-#include <sstream>
 #include <string>
 
 using namespace Eigen;
@@ -60,106 +58,6 @@ private:
 vtkStandardNewMacro(LeftRightArrowManualPlayback);
 
 
-std::pair<bool, MatrixXd> Visualizer::readStateFromFile(const std::string& filename, const std::size_t num_fields)
-{
-    MatrixXd data;
-
-    std::ifstream istrm(filename);
-
-    if (!istrm.is_open())
-    {
-        std::cout << "Failed to open " << filename << '\n';
-
-        return std::make_pair(false, MatrixXd(0,0));
-    }
-    else
-    {
-        std::vector<std::string> istrm_strings;
-        std::string line;
-        while (std::getline(istrm, line))
-        {
-            istrm_strings.push_back(line);
-        }
-
-        data.resize(num_fields, istrm_strings.size());
-        std::size_t found_lines = 0;
-        for (auto line : istrm_strings)
-        {
-            std::size_t found_fields = 0;
-            std::string number_str;
-            std::istringstream iss(line);
-
-            while (iss >> number_str)
-            {
-                std::size_t index = (num_fields * found_lines) + found_fields;
-                *(data.data() + index) = std::stod(number_str);
-                found_fields++;
-            }
-            if (num_fields != found_fields)
-            {
-                std::cout << "Malformed input file " << filename << '\n';
-
-                return std::make_pair(false, MatrixXd(0,0));
-            }
-            found_lines++;
-        }
-
-        return std::make_pair(true, data);
-    }
-}
-
-
-std::pair<bool, std::vector<MatrixXd>> Visualizer::readMeasurementsFromFile(const std::string& filename)
-{
-    std::vector<MatrixXd> data;
-
-    std::ifstream istrm(filename);
-
-    if (!istrm.is_open())
-    {
-        std::cout << "Failed to open " << filename << '\n';
-
-        return std::make_pair(false, std::vector<MatrixXd>());
-    }
-    else
-    {
-        std::vector<std::string> istrm_strings;
-        std::string line;
-        while (std::getline(istrm, line))
-        {
-            istrm_strings.push_back(line);
-        }
-
-        istrm.close();
-
-        for (auto line : istrm_strings)
-        {
-            std::istringstream iss(line);
-
-            std::string number_str;
-            std::vector<double> points;
-            while (iss >> number_str)
-                points.push_back(std::stod(number_str));
-
-            if ((points.size() % 3) != 0)
-            {
-                std::cout << "Malformed input file " << filename << '\n';
-
-                return std::make_pair(false, std::vector<MatrixXd>());
-            }
-
-            MatrixXd data_i = MatrixXd(3, points.size() / 3);
-            for (std::size_t i = 0; i < points.size(); i++)
-                *(data_i.data() + i) = points[i];
-
-            data.push_back(data_i);
-        }
-
-        return std::make_pair(true, data);
-    }
-}
-
-
 Visualizer::Visualizer
 (
     const std::string mesh_filename,
@@ -173,46 +71,45 @@ Visualizer::Visualizer
     use_ground_truth_ = (use_ground_truth == "true");
     if (use_ground_truth_)
     {
-        // Load target data
-        bool valid_target;
-        std::tie(valid_target, target_) = readStateFromFile(target_data_filename, 13);
-        if (!valid_target)
+        // Index target data
+        target_ = std::unique_ptr<LogReader>(new LogReader(target_data_filename, 13, 1));
+        if (!target_->get(0).first)
         {
             throw std::runtime_error("ERROR::VISUALIZER::CTOR\nERROR:Invalid target data.");
         }
     }
 
-    // Load estimate data
-    bool valid_estimate;
-    std::tie(valid_estimate, estimate_) = readStateFromFile(estimate_data_filename, 12);
-    if (!valid_estimate)
+    // Index estimate data
+    estimate_ = std::unique_ptr<LogReader>(new LogReader(estimate_data_filename, 12, 1));
+    if (!estimate_->get(0).first)
     {
         throw std::runtime_error("ERROR::VISUALIZER::CTOR\nERROR:Invalid estimate data.");
     }
 
-    // Load prediction data
-    bool valid_prediction;
-    std::tie(valid_prediction, prediction_) = readStateFromFile(prediction_data_filename, 12);
-    if (!valid_prediction)
+    // Index prediction data
+    prediction_ = std::unique_ptr<LogReader>(new LogReader(prediction_data_filename, 12, 1));
+    if (!prediction_->get(0).first)
     {
         throw std::runtime_error("ERROR::VISUALIZER::CTOR\nERROR:Invalid prediction data.");
     }
 
-    // Load measurements
+    // Index measurements
+    measurements_ = std::unique_ptr<LogReader>(new LogReader(measurements_data_filename, 3, 0));
     bool valid_measurements;
-    std::tie(valid_measurements, measurements_) = readMeasurementsFromFile(measurements_data_filename);
+    MatrixXd measurements_0;
+    std::tie(valid_measurements, measurements_0) = measurements_->get(0);
     if (!valid_measurements)
     {
         throw std::runtime_error("ERROR::VISUALIZER::CTOR\nERROR:Invalid measurements data.");
     }
-    vtk_measurements = std::unique_ptr<Points>(new Points(measurements_[0], 4));
+    vtk_measurements = std::unique_ptr<Points>(new Points(measurements_0, 4));
     vtk_measurements->set_color("red");
 
     // Evaluate the total number of steps taking into account the size of the data
-    std::vector<int> sizes{static_cast<int>(estimate_.cols()), static_cast<int>(prediction_.cols()), measurements_.size()};
+    std::vector<std::size_t> sizes{estimate_->size(), prediction_->size(), measurements_->size()};
     if (use_ground_truth_)
-        sizes.push_back(static_cast<int>(target_.cols()));
-    num_steps_ = *(std::min_element(sizes.begin(), sizes.end()));
+        sizes.push_back(target_->size());
+    num_steps_ = static_cast<int>(*(std::min_element(sizes.begin(), sizes.end())));
 
     // Load mesh
     reader_ = vtkSmartPointer<vtkPLYReader>::New();
@@ -301,9 +198,14 @@ void Visualizer::updateView()
     if (use_ground_truth_)
     {
         // Get the current data
-        Ref<VectorXd> state = target_.col(step_);
-        Ref<Vector3d> pos = state.topRows(3);
-        Ref<Vector4d> quaternion = state.segment(6, 4);
+        bool valid_state;
+        MatrixXd state;
+        std::tie(valid_state, state) = target_->get(step_);
+        if (!valid_state)
+            state = MatrixXd::Zero(13, 1);
+
+        Vector3d pos = state.col(0).topRows(3);
+        Vector4d quaternion = state.col(0).segment(6, 4);
 
         // Create a new transform
         vtkSmartPointer<vtkTransform> vtk_transform = vtkSmartPointer<vtkTransform>::New();
@@ -327,9 +229,14 @@ void Visualizer::updateView()
     // Estimate
     {
         // Get the current data
-        Ref<VectorXd> state = estimate_.col(step_);
-        Ref<Vector3d> pos = state.topRows(3);
-        Ref<Vector3d> euler = state.bottomRows(3);
+        bool valid_state;
+        MatrixXd state;
+        std::tie(valid_state, state) = estimate_->get(step_);
+        if (!valid_state)
+            state = MatrixXd::Zero(12, 1);
+
+        Vector3d pos = state.col(0).topRows(3);
+        Vector3d euler = state.col(0).bottomRows(3);
 
         // Create a new transform
         vtkSmartPointer<vtkTransform> vtk_transform = vtkSmartPointer<vtkTransform>::New();
@@ -351,9 +258,14 @@ void Visualizer::updateView()
     // Prediction
     {
         // Get the current data
-        Ref<VectorXd> state = prediction_.col(step_);
-        Ref<Vector3d> pos = state.topRows(3);
-        Ref<Vector3d> euler = state.bottomRows(3);
+        bool valid_state;
+        MatrixXd state;
+        std::tie(valid_state, state) = prediction_->get(step_);
+        if (!valid_state)
+            state = MatrixXd::Zero(12, 1);
+
+        Vector3d pos = state.col(0).topRows(3);
+        Vector3d euler = state.col(0).bottomRows(3);
 
         // Create a new transform
         vtkSmartPointer<vtkTransform> vtk_transform = vtkSmartPointer<vtkTransform>::New();
@@ -374,7 +286,10 @@ void Visualizer::updateView()
     }
 
     // Set measurements
-    vtk_measurements->set_points(measurements_[step_]);
+    bool valid_measurements;
+    MatrixXd measurements;
+    std::tie(valid_measurements, measurements) = measurements_->get(step_);
+    vtk_measurements->set_points(measurements);
     vtk_measurements->set_color("red");
 
     // Render
@@ -16,9 +16,9 @@ int main(int argc, char* argv[])
                   << " <use_ground_truth> (true/false)"
                   << " Filename(.ply)"
                   << " Trajectory(.txt)"
-                  << " Estimate(.txt)"
-                  << " Prediction(.txt)"
-                  << " Measurements(.txt)" << std::endl;
+                  << " Estimate(.txt/.bin)"
+                  << " Prediction(.txt/.bin)"
+                  << " Measurements(.txt/.bin)" << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <SessionFile.h>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/Port.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/RFModule.h>
+#include <yarp/os/RpcClient.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * Input port storing each received message, together with its time of arrival and its envelope, in the session file.
+ */
+class StreamRecorder : public yarp::os::BufferedPort<RawMessage>
+{
+public:
+    StreamRecorder(SessionWriter& session, const std::uint32_t stream, const double start_time);
+
+    void onRead(RawMessage& message) override;
+
+protected:
+    SessionWriter& session_;
+
+    const std::uint32_t stream_;
+
+    const double start_time_;
+};
+
+
+/**
+ * RPC server standing between the tracker and the OPC.
+ *
+ * Requests are forwarded to the OPC and the replies are sent back to the tracker and stored in the session file.
+ */
+class OPCProxy : public yarp::os::PortReader
+{
+public:
+    OPCProxy(yarp::os::RpcClient& opc_client, SessionWriter& session, const std::uint32_t stream, const double start_time);
+
+    bool read(yarp::os::ConnectionReader& connection) override;
+
+protected:
+    yarp::os::RpcClient& opc_client_;
+
+    SessionWriter& session_;
+
+    const std::uint32_t stream_;
+
+    const double start_time_;
+};
+
+
+/**
+ * Record the input streams of the tracker, i.e. depth, images, encoders and hand poses,
+ * and the interaction with the OPC in a session file that can be served back using Replayer.
+ *
+ * Streams are given as a list of names in the group [STREAMS]. For each name, a group with the same name
+ * contains the port to record from (source). The OPC is recorded if the group [OPC] is available,
+ * in which case the port of the OPC (server) and the RPC client of the tracker (client) are required.
+ */
+class Recorder : public yarp::os::RFModule
+{
+public:
+    Recorder(const std::string port_prefix, const double period);
+
+    virtual ~Recorder();
+
+    bool configure(yarp::os::ResourceFinder& rf) override;
+
+    double getPeriod() override;
+
+    bool updateModule() override;
+
+    bool close() override;
+
+protected:
+    /**
+     * Connect the sources that are not connected yet. Sources are allowed to appear after the recorder is started.
+     */
+    void connectSources();
+
+    const std::string log_ID_ = "[RECORDER]";
+
+    const std::string port_prefix_;
+
+    double period_;
+
+    std::vector<SessionStream> streams_;
+
+    std::unique_ptr<SessionWriter> session_;
+
+    std::vector<std::unique_ptr<StreamRecorder>> ports_in_;
+
+    /**
+     * OPC proxy.
+     */
+    bool record_opc_;
+
+    std::string opc_client_name_;
+
+    yarp::os::RpcClient opc_client_;
+
+    yarp::os::Port opc_server_;
+
+    std::unique_ptr<OPCProxy> opc_proxy_;
+
+    double last_report_time_;
+};
+
+#endif /* RECORDER_H */
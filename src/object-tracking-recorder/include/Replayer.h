@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef REPLAYER_H
+#define REPLAYER_H
+
+#include <SessionFile.h>
+
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/Port.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/RFModule.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+/**
+ * RPC server replacing the OPC.
+ *
+ * Each request is answered with the latest reply, among those replayed so far, recorded for the same request.
+ * Requests issued before their first recorded occurrence are answered with that one.
+ */
+class FakeOPC : public yarp::os::PortReader
+{
+public:
+    bool read(yarp::os::ConnectionReader& connection) override;
+
+    void setReply(const std::string& request, const std::string& reply, const bool overwrite);
+
+protected:
+    std::unordered_map<std::string, std::string> replies_;
+
+    std::mutex mutex_;
+};
+
+
+/**
+ * Serve back a session recorded with Recorder.
+ *
+ * Each stream is published, with the recorded envelopes, on a port having the same name of the port it was recorded from,
+ * so that the tracker can be connected as if the robot was available, and it is also connected
+ * to the port, or list of ports, optionally given as destination in the group named after the stream.
+ * The same applies to the OPC, which is replaced by FakeOPC.
+ *
+ * The replay starts as soon as all the destinations are connected, either at the recorded pace scaled by speed,
+ * or as fast as possible if speed is 0.
+ */
+class Replayer : public yarp::os::RFModule
+{
+public:
+    Replayer(const std::string port_prefix, const double period);
+
+    virtual ~Replayer();
+
+    bool configure(yarp::os::ResourceFinder& rf) override;
+
+    double getPeriod() override;
+
+    bool updateModule() override;
+
+    bool close() override;
+
+protected:
+    /**
+     * Return true if all the destinations are connected.
+     */
+    bool connectDestinations();
+
+    const std::string log_ID_ = "[REPLAYER]";
+
+    const std::string port_prefix_;
+
+    double period_;
+
+    double speed_;
+
+    bool loop_;
+
+    std::unique_ptr<SessionReader> session_;
+
+    std::vector<std::unique_ptr<yarp::os::Port>> ports_out_;
+
+    /**
+     * Pairs of source and destination ports.
+     */
+    std::vector<std::pair<std::string, std::string>> connections_;
+
+    std::uint32_t opc_stream_;
+
+    FakeOPC fake_opc_;
+
+    /**
+     * Replay state.
+     */
+    bool started_;
+
+    double start_time_;
+
+    SessionRecord record_;
+
+    bool pending_record_;
+
+    RawMessage message_;
+
+    std::size_t number_of_records_;
+};
+
+#endif /* REPLAYER_H */
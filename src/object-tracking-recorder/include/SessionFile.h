@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef SESSIONFILE_H
+#define SESSIONFILE_H
+
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/Portable.h>
+#include <yarp/os/Stamp.h>
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Message of any type stored in its binary wire format.
+ *
+ * Reading and writing a RawMessage does not require to know the type of the data, e.g. yarp::sig::ImageOf or yarp::os::Bottle,
+ * hence the same class can be used to record and replay all the input streams of the tracker.
+ */
+class RawMessage : public yarp::os::Portable
+{
+public:
+    bool read(yarp::os::ConnectionReader& reader) override;
+
+    bool write(yarp::os::ConnectionWriter& writer) const override;
+
+    std::string data;
+};
+
+
+/**
+ * Description of a recorded stream, i.e. its name and the name of the port it was recorded from.
+ */
+struct SessionStream
+{
+    std::string name;
+
+    std::string source;
+};
+
+
+/**
+ * A single record of a session.
+ *
+ * The time stamp is expressed in seconds, relative to the beginning of the recording,
+ * while the envelope is the one the message was sent with, if any.
+ */
+struct SessionRecord
+{
+    std::uint32_t stream;
+
+    double stamp;
+
+    yarp::os::Stamp envelope;
+
+    std::string payload;
+};
+
+
+/**
+ * The session file is a binary file made of
+ * - the header, i.e. the magic string, the number of streams and, for each stream, its name and its source port;
+ * - a sequence of records, i.e. the index of the stream, the time stamp, the envelope (count and time),
+ *   the size of the payload and the payload.
+ *
+ * The payload of the OPC stream, i.e. the requests sent to the OPC and the replies obtained, is encoded
+ * as the size of the request followed by the request and the reply, both in textual form.
+ */
+class SessionWriter
+{
+public:
+    SessionWriter(const std::string& path, const std::vector<SessionStream>& streams);
+
+    virtual ~SessionWriter();
+
+    /**
+     * Thread safe, records can be written from the callbacks of several ports.
+     */
+    void write(const std::uint32_t stream, const double stamp, const yarp::os::Stamp& envelope, const std::string& payload);
+
+    std::size_t getNumberOfRecords();
+
+protected:
+    std::ofstream file_;
+
+    std::mutex mutex_;
+
+    std::size_t number_of_records_;
+};
+
+
+class SessionReader
+{
+public:
+    SessionReader(const std::string& path);
+
+    virtual ~SessionReader();
+
+    const std::vector<SessionStream>& getStreams() const;
+
+    /**
+     * Read the next record. Return false at the end of the session.
+     */
+    bool next(SessionRecord& record);
+
+    /**
+     * Read the next record skipping the payload if it does not belong to the stream with index payload_stream.
+     */
+    bool next(SessionRecord& record, const std::uint32_t payload_stream);
+
+    /**
+     * Restart from the first record.
+     */
+    void rewind();
+
+protected:
+    bool readHeader(SessionRecord& record, std::uint64_t& size);
+
+    std::ifstream file_;
+
+    std::vector<SessionStream> streams_;
+
+    std::streampos first_record_;
+};
+
+
+/**
+ * Encoding and decoding of the payload of the OPC stream.
+ */
+std::string encodeRequestReply(const std::string& request, const std::string& reply);
+
+bool decodeRequestReply(const std::string& payload, std::string& request, std::string& reply);
+
+#endif /* SESSIONFILE_H */
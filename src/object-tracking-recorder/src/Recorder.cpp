@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <Recorder.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Value.h>
+
+using namespace yarp::os;
+
+
+StreamRecorder::StreamRecorder(SessionWriter& session, const std::uint32_t stream, const double start_time) :
+    session_(session),
+    stream_(stream),
+    start_time_(start_time)
+{ }
+
+
+void StreamRecorder::onRead(RawMessage& message)
+{
+    /* The envelope is restored on replay, as the tracker relies on the stamps of the measurements. */
+    Stamp envelope;
+    getEnvelope(envelope);
+
+    session_.write(stream_, Time::now() - start_time_, envelope, message.data);
+}
+
+
+OPCProxy::OPCProxy(RpcClient& opc_client, SessionWriter& session, const std::uint32_t stream, const double start_time) :
+    opc_client_(opc_client),
+    session_(session),
+    stream_(stream),
+    start_time_(start_time)
+{ }
+
+
+bool OPCProxy::read(ConnectionReader& connection)
+{
+    Bottle request;
+    if (!request.read(connection))
+        return false;
+
+    Bottle reply;
+    if (!opc_client_.write(request, reply))
+        return false;
+
+    session_.write(stream_, Time::now() - start_time_, Stamp(), encodeRequestReply(request.toString(), reply.toString()));
+
+    ConnectionWriter* writer = connection.getWriter();
+    if (writer != nullptr)
+        reply.write(*writer);
+
+    return true;
+}
+
+
+Recorder::Recorder(const std::string port_prefix, const double period) :
+    port_prefix_(port_prefix),
+    period_(period),
+    record_opc_(false),
+    last_report_time_(0.0)
+{ }
+
+
+Recorder::~Recorder()
+{ }
+
+
+bool Recorder::configure(ResourceFinder& rf)
+{
+    const std::string session_path = rf.check("session", Value("session.bin")).asString();
+
+    /* Streams. */
+    Bottle* names = rf.findGroup("STREAMS").find("names").asList();
+    if (names == nullptr)
+    {
+        yError() << log_ID_ << "Cannot find the list of streams to be recorded.";
+
+        return false;
+    }
+
+    for (std::size_t i = 0; i < names->size(); i++)
+    {
+        const std::string name = names->get(i).asString();
+        const Bottle& group = rf.findGroup(name);
+
+        if (!group.check("source"))
+        {
+            yError() << log_ID_ << "Cannot find the source port of stream" << name << ".";
+
+            return false;
+        }
+
+        streams_.push_back({name, group.find("source").asString()});
+    }
+
+    /* OPC. */
+    const Bottle& opc_group = rf.findGroup("OPC");
+    record_opc_ = !opc_group.isNull();
+    if (record_opc_)
+    {
+        if (!(opc_group.check("server") && opc_group.check("client")))
+        {
+            yError() << log_ID_ << "Cannot find the OPC server and client ports.";
+
+            return false;
+        }
+
+        opc_client_name_ = opc_group.find("client").asString();
+
+        streams_.push_back({"opc", opc_group.find("server").asString()});
+    }
+
+    try
+    {
+        session_ = std::unique_ptr<SessionWriter>(new SessionWriter(session_path, streams_));
+    }
+    catch (const std::runtime_error& error)
+    {
+        yError() << log_ID_ << error.what();
+
+        return false;
+    }
+
+    const double start_time = Time::now();
+
+    bool ports_ok = true;
+
+    for (std::size_t i = 0; i < streams_.size() - (record_opc_ ? 1 : 0); i++)
+    {
+        std::unique_ptr<StreamRecorder> port(new StreamRecorder(*session_, i, start_time));
+
+        /* Do not drop messages, the recording has to be complete. */
+        port->setStrict();
+        port->useCallback();
+
+        ports_ok &= port->open("/" + port_prefix_ + "/" + streams_.at(i).name + ":i");
+
+        ports_in_.push_back(std::move(port));
+    }
+
+    if (record_opc_)
+    {
+        opc_proxy_ = std::unique_ptr<OPCProxy>(new OPCProxy(opc_client_, *session_, streams_.size() - 1, start_time));
+
+        ports_ok &= opc_client_.open("/" + port_prefix_ + "/opc/rpc:o");
+
+        opc_server_.setReader(*opc_proxy_);
+        ports_ok &= opc_server_.open("/" + port_prefix_ + "/opc/rpc:i");
+    }
+
+    if (!ports_ok)
+    {
+        yError() << log_ID_ << "Cannot open the ports.";
+
+        return false;
+    }
+
+    connectSources();
+
+    yInfo() << log_ID_ << "Recording" << streams_.size() << "streams to" << session_path;
+
+    return true;
+}
+
+
+double Recorder::getPeriod()
+{
+    return period_;
+}
+
+
+bool Recorder::updateModule()
+{
+    connectSources();
+
+    const double now = Time::now();
+    if (now - last_report_time_ > 5.0)
+    {
+        yInfo() << log_ID_ << "Recorded" << session_->getNumberOfRecords() << "records.";
+
+        last_report_time_ = now;
+    }
+
+    return true;
+}
+
+
+bool Recorder::close()
+{
+    for (auto& port : ports_in_)
+    {
+        port->interrupt();
+        port->close();
+    }
+
+    if (record_opc_)
+    {
+        opc_server_.interrupt();
+        opc_server_.close();
+
+        opc_client_.close();
+    }
+
+    if (session_)
+    {
+        yInfo() << log_ID_ << "Recorded" << session_->getNumberOfRecords() << "records.";
+
+        session_.reset();
+    }
+
+    return true;
+}
+
+
+void Recorder::connectSources()
+{
+    for (std::size_t i = 0; i < ports_in_.size(); i++)
+    {
+        const std::string& source = streams_.at(i).source;
+
+        if (!Network::isConnected(source, ports_in_.at(i)->getName()))
+            Network::connect(source, ports_in_.at(i)->getName(), "", true);
+    }
+
+    if (record_opc_)
+    {
+        if (!Network::isConnected(opc_client_.getName(), streams_.back().source))
+            Network::connect(opc_client_.getName(), streams_.back().source, "", true);
+
+        if (!Network::isConnected(opc_client_name_, opc_server_.getName()))
+            Network::connect(opc_client_name_, opc_server_.getName(), "", true);
+    }
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <Replayer.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Value.h>
+#include <yarp/os/Vocab.h>
+
+#include <stdexcept>
+
+using namespace yarp::os;
+
+
+bool FakeOPC::read(ConnectionReader& connection)
+{
+    Bottle request;
+    if (!request.read(connection))
+        return false;
+
+    Bottle reply;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto entry = replies_.find(request.toString());
+        if (entry != replies_.end())
+            reply.fromString(entry->second);
+        else
+            reply.addVocab(Vocab::encode("nack"));
+    }
+
+    ConnectionWriter* writer = connection.getWriter();
+    if (writer != nullptr)
+        reply.write(*writer);
+
+    return true;
+}
+
+
+void FakeOPC::setReply(const std::string& request, const std::string& reply, const bool overwrite)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (overwrite)
+        replies_[request] = reply;
+    else
+        replies_.emplace(request, reply);
+}
+
+
+Replayer::Replayer(const std::string port_prefix, const double period) :
+    port_prefix_(port_prefix),
+    period_(period),
+    speed_(1.0),
+    loop_(false),
+    started_(false),
+    start_time_(0.0),
+    pending_record_(false),
+    number_of_records_(0)
+{ }
+
+
+Replayer::~Replayer()
+{ }
+
+
+bool Replayer::configure(ResourceFinder& rf)
+{
+    const std::string session_path = rf.check("session", Value("session.bin")).asString();
+    speed_ = rf.check("speed", Value(1.0)).asDouble();
+    loop_ = rf.check("loop", Value(false)).asBool();
+
+    try
+    {
+        session_ = std::unique_ptr<SessionReader>(new SessionReader(session_path));
+    }
+    catch (const std::runtime_error& error)
+    {
+        yError() << log_ID_ << error.what();
+
+        return false;
+    }
+
+    const std::vector<SessionStream>& streams = session_->getStreams();
+
+    opc_stream_ = streams.size();
+    for (std::size_t i = 0; i < streams.size(); i++)
+    {
+        if (streams.at(i).name == "opc")
+            opc_stream_ = i;
+    }
+
+    /* Make the first reply to each OPC request available before the replay starts. */
+    if (opc_stream_ < streams.size())
+    {
+        SessionRecord record;
+        while (session_->next(record, opc_stream_))
+        {
+            std::string request;
+            std::string reply;
+            if ((record.stream == opc_stream_) && decodeRequestReply(record.payload, request, reply))
+                fake_opc_.setReply(request, reply, false);
+        }
+
+        session_->rewind();
+    }
+
+    /* Stand-in ports. */
+    bool ports_ok = true;
+
+    for (std::size_t i = 0; i < streams.size(); i++)
+    {
+        std::unique_ptr<Port> port(new Port());
+
+        if (i == opc_stream_)
+            port->setReader(fake_opc_);
+
+        ports_ok &= port->open(streams.at(i).source);
+
+        const Bottle& group = rf.findGroup(streams.at(i).name);
+        if (group.check("destination"))
+        {
+            /* Destination can be a single port or a list of ports. */
+            Bottle destinations;
+            if (group.find("destination").isList())
+                destinations = *(group.find("destination").asList());
+            else
+                destinations.addString(group.find("destination").asString());
+
+            for (std::size_t j = 0; j < destinations.size(); j++)
+            {
+                const std::string destination = destinations.get(j).asString();
+
+                if (i == opc_stream_)
+                    connections_.push_back(std::make_pair(destination, streams.at(i).source));
+                else
+                    connections_.push_back(std::make_pair(streams.at(i).source, destination));
+            }
+        }
+
+        ports_out_.push_back(std::move(port));
+    }
+
+    if (!ports_ok)
+    {
+        yError() << log_ID_ << "Cannot open the ports.";
+
+        return false;
+    }
+
+    yInfo() << log_ID_ << "Replaying" << streams.size() << "streams from" << session_path << "with speed" << speed_;
+
+    return true;
+}
+
+
+double Replayer::getPeriod()
+{
+    return (speed_ > 0.0) ? period_ : 0.0;
+}
+
+
+bool Replayer::updateModule()
+{
+    if (!started_)
+    {
+        if (!connectDestinations())
+            return true;
+
+        started_ = true;
+        start_time_ = Time::now();
+    }
+
+    /* As fast as possible, one record per iteration. At recorded pace, all the records that are due. */
+    const double stamp_now = (Time::now() - start_time_) * speed_;
+
+    do
+    {
+        if (!pending_record_)
+        {
+            pending_record_ = session_->next(record_);
+
+            if (!pending_record_)
+            {
+                yInfo() << log_ID_ << "Replayed" << number_of_records_ << "records in" << Time::now() - start_time_ << "s.";
+
+                if (!loop_)
+                    return false;
+
+                session_->rewind();
+                start_time_ = Time::now();
+                number_of_records_ = 0;
+
+                return true;
+            }
+        }
+
+        if ((speed_ > 0.0) && (record_.stamp > stamp_now))
+            break;
+
+        if (record_.stream == opc_stream_)
+        {
+            std::string request;
+            std::string reply;
+            if (decodeRequestReply(record_.payload, request, reply))
+                fake_opc_.setReply(request, reply, true);
+        }
+        else
+        {
+            message_.data.swap(record_.payload);
+            ports_out_.at(record_.stream)->setEnvelope(record_.envelope);
+            ports_out_.at(record_.stream)->write(message_);
+        }
+
+        pending_record_ = false;
+        number_of_records_++;
+    }
+    while (speed_ > 0.0);
+
+    return true;
+}
+
+
+bool Replayer::close()
+{
+    for (auto& port : ports_out_)
+    {
+        port->interrupt();
+        port->close();
+    }
+
+    return true;
+}
+
+
+bool Replayer::connectDestinations()
+{
+    bool connected = true;
+
+    for (const auto& connection : connections_)
+    {
+        if (!Network::isConnected(connection.first, connection.second))
+            connected &= Network::connect(connection.first, connection.second, "", true);
+    }
+
+    return connected;
+}
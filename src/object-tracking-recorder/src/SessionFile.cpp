@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <SessionFile.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    const char session_magic[8] = {'O', 'T', 'S', 'E', 'S', 'S', '0', '2'};
+
+
+    template<typename T>
+    void writeValue(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+
+    template<typename T>
+    bool readValue(std::ifstream& file, T& value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+
+    void writeString(std::ofstream& file, const std::string& string)
+    {
+        writeValue(file, static_cast<std::uint32_t>(string.size()));
+        file.write(string.data(), string.size());
+    }
+
+
+    bool readString(std::ifstream& file, std::string& string)
+    {
+        std::uint32_t size;
+        if (!readValue(file, size))
+            return false;
+
+        string.resize(size);
+
+        return static_cast<bool>(file.read(&string[0], size));
+    }
+}
+
+
+bool RawMessage::read(yarp::os::ConnectionReader& reader)
+{
+    data.resize(reader.getSize());
+
+    if (data.size() == 0)
+        return true;
+
+    return reader.expectBlock(&data[0], data.size());
+}
+
+
+bool RawMessage::write(yarp::os::ConnectionWriter& writer) const
+{
+    writer.appendBlock(data.data(), data.size());
+
+    return true;
+}
+
+
+SessionWriter::SessionWriter(const std::string& path, const std::vector<SessionStream>& streams) :
+    file_(path, std::ios::out | std::ios::binary | std::ios::trunc),
+    number_of_records_(0)
+{
+    if (!file_.is_open())
+        throw(std::runtime_error("SESSIONWRITER::CTOR::ERROR\n\tError: cannot open session file " + path + "."));
+
+    file_.write(session_magic, sizeof(session_magic));
+
+    writeValue(file_, static_cast<std::uint32_t>(streams.size()));
+    for (const SessionStream& stream : streams)
+    {
+        writeString(file_, stream.name);
+        writeString(file_, stream.source);
+    }
+}
+
+
+SessionWriter::~SessionWriter()
+{
+    file_.close();
+}
+
+
+void SessionWriter::write(const std::uint32_t stream, const double stamp, const yarp::os::Stamp& envelope, const std::string& payload)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    writeValue(file_, stream);
+    writeValue(file_, stamp);
+    writeValue(file_, static_cast<std::int32_t>(envelope.getCount()));
+    writeValue(file_, envelope.getTime());
+    writeValue(file_, static_cast<std::uint64_t>(payload.size()));
+    file_.write(payload.data(), payload.size());
+
+    number_of_records_++;
+}
+
+
+std::size_t SessionWriter::getNumberOfRecords()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return number_of_records_;
+}
+
+
+SessionReader::SessionReader(const std::string& path) :
+    file_(path, std::ios::in | std::ios::binary)
+{
+    if (!file_.is_open())
+        throw(std::runtime_error("SESSIONREADER::CTOR::ERROR\n\tError: cannot open session file " + path + "."));
+
+    char magic[sizeof(session_magic)];
+    if (!file_.read(magic, sizeof(magic)) || (std::memcmp(magic, session_magic, sizeof(magic)) != 0))
+        throw(std::runtime_error("SESSIONREADER::CTOR::ERROR\n\tError: " + path + " is not a valid session file."));
+
+    std::uint32_t number_of_streams;
+    if (!readValue(file_, number_of_streams))
+        throw(std::runtime_error("SESSIONREADER::CTOR::ERROR\n\tError: cannot read the streams of session file " + path + "."));
+
+    streams_.resize(number_of_streams);
+    for (SessionStream& stream : streams_)
+    {
+        if (!(readString(file_, stream.name) && readString(file_, stream.source)))
+            throw(std::runtime_error("SESSIONREADER::CTOR::ERROR\n\tError: cannot read the streams of session file " + path + "."));
+    }
+
+    first_record_ = file_.tellg();
+}
+
+
+SessionReader::~SessionReader()
+{
+    file_.close();
+}
+
+
+const std::vector<SessionStream>& SessionReader::getStreams() const
+{
+    return streams_;
+}
+
+
+bool SessionReader::next(SessionRecord& record)
+{
+    std::uint64_t size;
+    if (!readHeader(record, size))
+        return false;
+
+    record.payload.resize(size);
+    if (size == 0)
+        return true;
+
+    return static_cast<bool>(file_.read(&record.payload[0], size));
+}
+
+
+bool SessionReader::next(SessionRecord& record, const std::uint32_t payload_stream)
+{
+    std::uint64_t size;
+    if (!readHeader(record, size))
+        return false;
+
+    if (record.stream != payload_stream)
+    {
+        record.payload.clear();
+
+        return static_cast<bool>(file_.seekg(size, std::ios::cur));
+    }
+
+    record.payload.resize(size);
+    if (size == 0)
+        return true;
+
+    return static_cast<bool>(file_.read(&record.payload[0], size));
+}
+
+
+void SessionReader::rewind()
+{
+    file_.clear();
+    file_.seekg(first_record_);
+}
+
+
+bool SessionReader::readHeader(SessionRecord& record, std::uint64_t& size)
+{
+    std::int32_t envelope_count;
+    double envelope_time;
+    if (!(readValue(file_, record.stream) && readValue(file_, record.stamp) &&
+          readValue(file_, envelope_count) && readValue(file_, envelope_time) && readValue(file_, size)))
+        return false;
+
+    record.envelope = yarp::os::Stamp(envelope_count, envelope_time);
+
+    /* Truncated records, e.g. due to a recorder killed abruptly, are discarded. */
+    return record.stream < streams_.size();
+}
+
+
+std::string encodeRequestReply(const std::string& request, const std::string& reply)
+{
+    const std::uint32_t request_size = request.size();
+
+    std::string payload(reinterpret_cast<const char*>(&request_size), sizeof(request_size));
+    payload += request;
+    payload += reply;
+
+    return payload;
+}
+
+
+bool decodeRequestReply(const std::string& payload, std::string& request, std::string& reply)
+{
+    std::uint32_t request_size;
+    if (payload.size() < sizeof(request_size))
+        return false;
+
+    std::memcpy(&request_size, payload.data(), sizeof(request_size));
+    if (payload.size() < sizeof(request_size) + request_size)
+        return false;
+
+    request = payload.substr(sizeof(request_size), request_size);
+    reply = payload.substr(sizeof(request_size) + request_size);
+
+    return true;
+}
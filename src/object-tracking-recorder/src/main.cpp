@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <Recorder.h>
+#include <Replayer.h>
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+
+#include <cstdlib>
+
+using namespace yarp::os;
+
+
+int main(int argc, char** argv)
+{
+    const std::string log_ID = "[Main]";
+    yInfo() << log_ID << "Configuring and starting module...";
+
+    Network yarp;
+    if (!yarp.checkNetwork())
+    {
+        yError() << log_ID << "Yarp is not available.";
+        return EXIT_FAILURE;
+    }
+
+    ResourceFinder rf;
+    rf.setVerbose();
+    rf.setDefaultContext("object-tracking-recorder");
+    rf.setDefaultConfigFile("config.ini");
+    rf.configure(argc, argv);
+
+    /* Get mode and period. */
+    const std::string mode = rf.check("mode", Value("record")).asString();
+    const double period = rf.check("period", Value(0.01)).asDouble();
+
+    /* Run module. */
+    if (mode == "record")
+    {
+        Recorder recorder("object-tracking-recorder", period);
+
+        recorder.runModule(rf);
+    }
+    else if (mode == "replay")
+    {
+        Replayer replayer("object-tracking-replayer", period);
+
+        replayer.runModule(rf);
+    }
+    else
+    {
+        yError() << log_ID << "Unknown mode" << mode << ", use record or replay.";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <SceneRenderer.h>
+
+#include <Eigen/Dense>
+
+#include <iCub/iKin/iKinFwd.h>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/Port.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/RFModule.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/sig/Image.h>
+#include <yarp/sig/Vector.h>
+
+#include <opencv2/opencv.hpp>
+
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+
+
+/**
+ * Minimal OPC answering the queries of BoundingBoxEstimator, i.e. the id of an object given its name
+ * and its bounding box in the left camera (position_2d_left), as rendered in the last frame.
+ */
+class OPCServer : public yarp::os::PortReader
+{
+public:
+    OPCServer(const std::string& object_name);
+
+    bool read(yarp::os::ConnectionReader& connection) override;
+
+    void setBoundingBox(const bool valid, const cv::Point& top_left, const cv::Point& bottom_right);
+
+protected:
+    const std::string object_name_;
+
+    /**
+     * Id of the object.
+     */
+    const int object_id_ = 1;
+
+    std::mutex mutex_;
+
+    bool valid_;
+
+    cv::Point top_left_;
+
+    cv::Point bottom_right_;
+};
+
+
+/**
+ * Render a moving object and the hand holding it, in front of a textured background, as seen by the eyes of the robot.
+ *
+ * The generator publishes the same streams that the tracker and object-tracking-depth read from the robot,
+ * i.e. the images of the calibrated cameras, the encoders of the head, the torso and the right arm, the pose
+ * of the hand and the OPC, together with the depth of the left camera and the ground truth of the object.
+ * All the streams of a frame share the same envelope.
+ */
+class SceneGenerator : public yarp::os::RFModule
+{
+public:
+    SceneGenerator(const std::string port_prefix);
+
+    virtual ~SceneGenerator();
+
+    bool configure(yarp::os::ResourceFinder& rf) override;
+
+    double getPeriod() override;
+
+    bool updateModule() override;
+
+    bool close() override;
+
+protected:
+    /**
+     * Pose of the object, and its velocity in the format of the tracker state, at time t.
+     */
+    void objectState(const double t, Eigen::Transform<double, 3, Eigen::Affine>& pose, Eigen::VectorXd& velocity);
+
+    /**
+     * Pose of the left eye from the forward kinematics of the head and the torso, as in GazeController.
+     */
+    Eigen::Transform<double, 3, Eigen::Affine> leftEyePose();
+
+    /**
+     * Pose of the right eye, given that of the left eye, using the stereo extrinsics of SFM.
+     */
+    Eigen::Transform<double, 3, Eigen::Affine> rightEyePose(const Eigen::Transform<double, 3, Eigen::Affine>& left_eye_pose);
+
+    bool loadCameraParameters();
+
+    void publishImage(yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>>& port, const cv::Mat& image, const yarp::os::Stamp& stamp);
+
+    void publishVector(yarp::os::BufferedPort<yarp::sig::Vector>& port, const Eigen::Ref<const Eigen::VectorXd>& vector, const yarp::os::Stamp& stamp);
+
+    const std::string log_ID_ = "[SceneGenerator]";
+
+    const std::string port_prefix_;
+
+    double period_;
+
+    /**
+     * Image size and intrinsic parameters, scaled to the image size.
+     */
+    std::size_t width_;
+
+    std::size_t height_;
+
+    double fx_left_;
+
+    double fy_left_;
+
+    double cx_left_;
+
+    double cy_left_;
+
+    double fx_right_;
+
+    double fy_right_;
+
+    double cx_right_;
+
+    double cy_right_;
+
+    /**
+     * Stereo extrinsics, i.e. the pose of the left camera in the right camera frame for the reference configuration of the eyes.
+     */
+    Eigen::Matrix4d stereo_extrinsics_;
+
+    Eigen::Vector3d eyes_0_;
+
+    /**
+     * Encoders of the robot, in degrees.
+     */
+    Eigen::VectorXd head_encoders_;
+
+    Eigen::VectorXd torso_encoders_;
+
+    Eigen::VectorXd arm_encoders_;
+
+    iCub::iKin::iCubEye eye_kinematics_;
+
+    /**
+     * Poses of the cameras in the robot root frame.
+     */
+    Eigen::Transform<double, 3, Eigen::Affine> camera_left_pose_;
+
+    Eigen::Transform<double, 3, Eigen::Affine> camera_right_pose_;
+
+    /**
+     * Scene.
+     */
+    std::unique_ptr<SceneRenderer> renderer_;
+
+    std::size_t object_index_;
+
+    std::size_t hand_index_;
+
+    std::size_t background_index_;
+
+    Eigen::Transform<double, 3, Eigen::Affine> background_pose_;
+
+    Eigen::Transform<double, 3, Eigen::Affine> hand_offset_;
+
+    /**
+     * Trajectory of the object, expressed in the robot root frame.
+     */
+    Eigen::Vector3d center_position_;
+
+    Eigen::Vector3d center_orientation_;
+
+    Eigen::Vector3d amplitude_position_;
+
+    Eigen::Vector3d amplitude_orientation_;
+
+    double frequency_;
+
+    /**
+     * Images.
+     */
+    cv::Mat rgb_left_;
+
+    cv::Mat rgb_right_;
+
+    cv::Mat depth_left_;
+
+    cv::Mat depth_right_;
+
+    double depth_noise_std_;
+
+    std::mt19937 generator_;
+
+    std::normal_distribution<float> depth_noise_;
+
+    /**
+     * Ports.
+     */
+    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_left_out_;
+
+    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_right_out_;
+
+    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelFloat>> port_depth_out_;
+
+    yarp::os::BufferedPort<yarp::sig::Vector> port_head_out_;
+
+    yarp::os::BufferedPort<yarp::sig::Vector> port_torso_out_;
+
+    yarp::os::BufferedPort<yarp::sig::Vector> port_arm_out_;
+
+    yarp::os::BufferedPort<yarp::sig::Vector> port_hand_pose_out_;
+
+    yarp::os::BufferedPort<yarp::sig::Vector> port_ground_truth_out_;
+
+    bool use_opc_;
+
+    yarp::os::Port opc_server_;
+
+    std::unique_ptr<OPCServer> opc_;
+
+    /**
+     * Statistics.
+     */
+    std::size_t frame_;
+
+    std::size_t report_frames_;
+
+    double report_time_;
+
+    double report_render_time_;
+};
+
+#endif /* SCENEGENERATOR_H */
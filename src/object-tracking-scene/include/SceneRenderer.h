@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include <Eigen/Dense>
+
+#include <opencv2/opencv.hpp>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * Software z-buffer rasterizer of triangle meshes, seen from a pinhole camera.
+ *
+ * Each mesh is painted with its color modulated by a procedural texture, evaluated in the frame of the mesh
+ * on a regular grid of cells. Since the texture is attached to the surface, the same point has the same color
+ * in any view, hence the images of a stereo pair can be matched as those of a real scene.
+ *
+ * The camera follows the computer vision convention, i.e. z forward, x right and y down.
+ */
+class SceneRenderer
+{
+public:
+    SceneRenderer(const std::size_t width, const std::size_t height, const double texture_cell_size);
+
+    virtual ~SceneRenderer();
+
+    /**
+     * Load a mesh from file and return its index.
+     */
+    std::size_t addMesh(const std::string& mesh_path, const Eigen::Ref<const Eigen::Vector3d>& color);
+
+    /**
+     * Add a square of the given side, lying on the x-y plane of its frame, and return its index.
+     */
+    std::size_t addPlane(const double side, const Eigen::Ref<const Eigen::Vector3d>& color);
+
+    /**
+     * Render all the meshes, given their poses and the pose of the camera in the same frame.
+     *
+     * The RGB image, of type CV_8UC3 in RGB order, and the depth image, of type CV_32FC1 in meters,
+     * must be already allocated. Depth is 0 where no mesh is visible.
+     */
+    void render(const std::vector<Eigen::Transform<double, 3, Eigen::Affine>>& poses, const Eigen::Transform<double, 3, Eigen::Affine>& camera_pose,
+                const double fx, const double fy, const double cx, const double cy,
+                cv::Mat& rgb, cv::Mat& depth);
+
+    /**
+     * Bounding box, i.e. top left and bottom right corners, of the pixels covered by a given mesh in the last rendering.
+     */
+    std::tuple<bool, cv::Point, cv::Point> getBoundingBox(const std::size_t mesh_index) const;
+
+protected:
+    struct Mesh
+    {
+        Eigen::Matrix3Xf vertices;
+
+        Eigen::Matrix3Xi faces;
+
+        Eigen::Vector3f color;
+    };
+
+    void rasterize(const Mesh& mesh, const int mesh_index, const Eigen::Ref<const Eigen::Matrix3Xf>& vertices_camera,
+                   const float fx, const float fy, const float cx, const float cy,
+                   cv::Mat& rgb, cv::Mat& depth);
+
+    float texture(const Eigen::Ref<const Eigen::Vector3f>& point) const;
+
+    const std::size_t width_;
+
+    const std::size_t height_;
+
+    const float texture_cell_size_;
+
+    std::vector<Mesh> meshes_;
+
+    /**
+     * Index of the mesh visible in each pixel, -1 if none.
+     */
+    cv::Mat mesh_index_;
+
+    const std::string log_ID_ = "[SceneRenderer]";
+};
+
+#endif /* SCENERENDERER_H */
@@ -0,0 +1,580 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <SceneGenerator.h>
+
+#include <yarp/eigen/Eigen.h>
+#include <yarp/math/Math.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Value.h>
+#include <yarp/os/Vocab.h>
+
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+using namespace Eigen;
+using namespace iCub::iKin;
+using namespace yarp::eigen;
+using namespace yarp::math;
+using namespace yarp::os;
+using namespace yarp::sig;
+
+
+namespace
+{
+    VectorXd loadVector(const Bottle& group, const std::string& key, const VectorXd& fallback)
+    {
+        Bottle* list = group.find(key).asList();
+        if (list == nullptr)
+            return fallback;
+
+        VectorXd vector(list->size());
+        for (std::size_t i = 0; i < list->size(); i++)
+            vector(i) = list->get(i).asDouble();
+
+        return vector;
+    }
+
+
+    Transform<double, 3, Affine> poseFromAxisAngle(const Ref<const VectorXd>& pose)
+    {
+        Transform<double, 3, Affine> transform = Transform<double, 3, Affine>::Identity();
+        transform.translation() = pose.head<3>();
+        transform.rotate(AngleAxisd(pose(6), pose.segment<3>(3).normalized()));
+
+        return transform;
+    }
+
+
+    VectorXd poseToAxisAngle(const Transform<double, 3, Affine>& transform)
+    {
+        AngleAxisd angle_axis(transform.rotation());
+
+        VectorXd pose(7);
+        pose.head<3>() = transform.translation();
+        pose.segment<3>(3) = angle_axis.axis();
+        pose(6) = angle_axis.angle();
+
+        return pose;
+    }
+}
+
+
+OPCServer::OPCServer(const std::string& object_name) :
+    object_name_(object_name),
+    valid_(false)
+{ }
+
+
+bool OPCServer::read(ConnectionReader& connection)
+{
+    Bottle request;
+    if (!request.read(connection))
+        return false;
+
+    Bottle reply;
+    const int command = request.get(0).asVocab();
+
+    if (command == Vocab::encode("ask"))
+    {
+        /* Request format is [ask] ((name == <object_name>)). */
+        Bottle* condition = request.get(1).asList();
+        if ((condition != nullptr) && (condition->get(0).asList() != nullptr))
+            condition = condition->get(0).asList();
+
+        if ((condition != nullptr) && (condition->get(0).asString() == "name") && (condition->get(2).asString() == object_name_))
+        {
+            reply.addVocab(Vocab::encode("ack"));
+            Bottle& id_field = reply.addList();
+            id_field.addString("id");
+            id_field.addList().addInt(object_id_);
+        }
+        else
+            reply.addVocab(Vocab::encode("nack"));
+    }
+    else if (command == Vocab::encode("get"))
+    {
+        /* Request format is [get] ((id <id>) (propSet (position_2d_left))). */
+        Bottle* content = request.get(1).asList();
+        Bottle* id_field = (content != nullptr) ? content->get(0).asList() : nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (valid_ && (id_field != nullptr) && (id_field->get(1).asInt() == object_id_))
+        {
+            reply.addVocab(Vocab::encode("ack"));
+            Bottle& property = reply.addList().addList();
+            property.addString("position_2d_left");
+            Bottle& box = property.addList();
+            box.addInt(top_left_.x);
+            box.addInt(top_left_.y);
+            box.addInt(bottom_right_.x);
+            box.addInt(bottom_right_.y);
+        }
+        else
+            reply.addVocab(Vocab::encode("nack"));
+    }
+    else
+        reply.addVocab(Vocab::encode("nack"));
+
+    ConnectionWriter* writer = connection.getWriter();
+    if (writer != nullptr)
+        reply.write(*writer);
+
+    return true;
+}
+
+
+void OPCServer::setBoundingBox(const bool valid, const cv::Point& top_left, const cv::Point& bottom_right)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    valid_ = valid;
+    top_left_ = top_left;
+    bottom_right_ = bottom_right;
+}
+
+
+SceneGenerator::SceneGenerator(const std::string port_prefix) :
+    port_prefix_(port_prefix),
+    use_opc_(false),
+    frame_(0),
+    report_frames_(0),
+    report_time_(0.0),
+    report_render_time_(0.0)
+{ }
+
+
+SceneGenerator::~SceneGenerator()
+{ }
+
+
+bool SceneGenerator::configure(ResourceFinder& rf)
+{
+    /* Scene. */
+    const Bottle& rf_scene = rf.findGroup("SCENE");
+    const double fps = rf_scene.check("fps", Value(30.0)).asDouble();
+    width_ = rf_scene.check("width", Value(320)).asInt();
+    height_ = rf_scene.check("height", Value(240)).asInt();
+    const std::string object_name = rf_scene.check("object_name", Value("ycb_mustard_bottle")).asString();
+    const double texture_cell_size = rf_scene.check("texture_cell_size", Value(0.01)).asDouble();
+    const double background_distance = rf_scene.check("background_distance", Value(1.0)).asDouble();
+    const double background_side = rf_scene.check("background_side", Value(3.0)).asDouble();
+    depth_noise_std_ = rf_scene.check("depth_noise_std", Value(0.0)).asDouble();
+    const unsigned int seed = rf_scene.check("seed", Value(1)).asInt();
+
+    if ((fps <= 0.0) || (width_ == 0) || (height_ == 0))
+    {
+        yError() << log_ID_ << "Invalid frame rate or image size.";
+        return false;
+    }
+    period_ = 1.0 / fps;
+
+    /* Robot. */
+    const Bottle& rf_robot = rf.findGroup("ROBOT");
+    const std::string eye_version = rf_robot.check("eye_version", Value("v2")).asString();
+    head_encoders_ = loadVector(rf_robot, "head", (VectorXd(6) << -20.0, 0.0, 0.0, -12.0, 0.0, 5.0).finished());
+    torso_encoders_ = loadVector(rf_robot, "torso", VectorXd::Zero(3));
+    arm_encoders_ = loadVector(rf_robot, "right_arm", (VectorXd(16) << -40.0, 30.0, 0.0, 60.0, 0.0, 0.0, 0.0, 15.0,
+                                                                      30.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0).finished());
+
+    if ((head_encoders_.size() != 6) || (torso_encoders_.size() != 3))
+    {
+        yError() << log_ID_ << "Wrong size of head or torso encoders, expected 6 and 3 elements respectively.";
+        return false;
+    }
+
+    /* Trajectory of the object, whose center is given in the left camera frame. */
+    const Bottle& rf_trajectory = rf.findGroup("TRAJECTORY");
+    const VectorXd center_camera = loadVector(rf_trajectory, "center", (VectorXd(3) << 0.0, 0.05, 0.4).finished());
+    const VectorXd center_orientation = loadVector(rf_trajectory, "orientation", VectorXd::Zero(3));
+    const VectorXd amplitude_position = loadVector(rf_trajectory, "amplitude_position", (VectorXd(3) << 0.05, 0.05, 0.02).finished());
+    const VectorXd amplitude_orientation = loadVector(rf_trajectory, "amplitude_orientation", (VectorXd(3) << 0.5, 0.2, 0.2).finished());
+    frequency_ = rf_trajectory.check("frequency", Value(0.1)).asDouble();
+
+    /* Hand, given as the pose of the palm in the object frame. */
+    const Bottle& rf_hand = rf.findGroup("HAND");
+    const VectorXd hand_offset = loadVector(rf_hand, "offset", (VectorXd(7) << 0.0, 0.07, 0.0, 1.0, 0.0, 0.0, -M_PI / 2.0).finished());
+
+    if ((center_camera.size() != 3) || (center_orientation.size() != 3) || (amplitude_position.size() != 3) ||
+        (amplitude_orientation.size() != 3) || (hand_offset.size() != 7))
+    {
+        yError() << log_ID_ << "Wrong size of the trajectory or of the hand offset.";
+        return false;
+    }
+
+    center_orientation_ = center_orientation;
+    amplitude_position_ = amplitude_position;
+    amplitude_orientation_ = amplitude_orientation;
+    hand_offset_ = poseFromAxisAngle(hand_offset);
+
+    /* Ports, named after those of the robot and of the modules feeding the tracker. */
+    const Bottle& rf_ports = rf.findGroup("PORTS");
+    const std::string port_left = rf_ports.check("left", Value("/icub/camcalib/left/out")).asString();
+    const std::string port_right = rf_ports.check("right", Value("/icub/camcalib/right/out")).asString();
+    const std::string port_depth = rf_ports.check("depth", Value("/" + port_prefix_ + "/depth:o")).asString();
+    const std::string port_head = rf_ports.check("head", Value("/icub/head/state:o")).asString();
+    const std::string port_torso = rf_ports.check("torso", Value("/icub/torso/state:o")).asString();
+    const std::string port_arm = rf_ports.check("right_arm", Value("/icub/right_arm/state:o")).asString();
+    const std::string port_hand_pose = rf_ports.check("hand_pose", Value("/handTracking/VisualSIS/left/estimates:o")).asString();
+    const std::string port_ground_truth = rf_ports.check("ground_truth", Value("/" + port_prefix_ + "/ground-truth:o")).asString();
+
+    /* OPC. */
+    const Bottle& rf_opc = rf.findGroup("OPC");
+    use_opc_ = rf_opc.check("enable", Value(true)).asBool();
+    const std::string port_opc = rf_opc.check("port", Value("/memory/rpc")).asString();
+    const std::string iol_object_name = rf_opc.check("object_name", Value("Bottle")).asString();
+
+    yInfo() << log_ID_ << "Parameters:";
+    yInfo() << log_ID_ << "- fps:"             << fps;
+    yInfo() << log_ID_ << "- width:"           << width_;
+    yInfo() << log_ID_ << "- height:"          << height_;
+    yInfo() << log_ID_ << "- object_name:"     << object_name;
+    yInfo() << log_ID_ << "- depth_noise_std:" << depth_noise_std_;
+    yInfo() << log_ID_ << "- head:"            << head_encoders_.transpose();
+    yInfo() << log_ID_ << "- torso:"           << torso_encoders_.transpose();
+    yInfo() << log_ID_ << "- use_opc:"         << use_opc_;
+
+    if ((width_ != 320) || (height_ != 240))
+        yWarning() << log_ID_ << "The tracker assumes images of size 320x240, other sizes are meant for object-tracking-depth only.";
+
+    /* Cameras. */
+    if (!loadCameraParameters())
+        return false;
+
+    eye_kinematics_ = iCubEye("left_" + eye_version);
+    eye_kinematics_.setAllConstraints(false);
+    eye_kinematics_.releaseLink(0);
+    eye_kinematics_.releaseLink(1);
+    eye_kinematics_.releaseLink(2);
+
+    camera_left_pose_ = leftEyePose();
+    camera_right_pose_ = rightEyePose(camera_left_pose_);
+
+    center_position_ = camera_left_pose_ * Vector3d(center_camera);
+
+    /* Background, facing the left camera. */
+    background_pose_ = camera_left_pose_ * Translation3d(0.0, 0.0, background_distance);
+
+    /* Meshes, installed with the tracker. */
+    ResourceFinder rf_tracker;
+    rf_tracker.setVerbose(true);
+    rf_tracker.setDefaultContext("object-tracking");
+    rf_tracker.configure(0, nullptr);
+
+    const std::string object_mesh_path = rf_tracker.findPath("mesh/" + object_name) + "/nontextured.obj";
+    const std::string hand_mesh_path = rf_tracker.findFileByName("r_palm.obj");
+
+    try
+    {
+        renderer_ = std::unique_ptr<SceneRenderer>(new SceneRenderer(width_, height_, texture_cell_size));
+        object_index_ = renderer_->addMesh(object_mesh_path, Vector3d(230.0, 190.0, 40.0));
+        hand_index_ = renderer_->addMesh(hand_mesh_path, Vector3d(210.0, 210.0, 210.0));
+        background_index_ = renderer_->addPlane(background_side, Vector3d(140.0, 120.0, 100.0));
+    }
+    catch (const std::runtime_error& error)
+    {
+        yError() << log_ID_ << error.what();
+        return false;
+    }
+
+    rgb_left_ = cv::Mat(height_, width_, CV_8UC3);
+    rgb_right_ = cv::Mat(height_, width_, CV_8UC3);
+    depth_left_ = cv::Mat(height_, width_, CV_32FC1);
+    depth_right_ = cv::Mat(height_, width_, CV_32FC1);
+
+    generator_.seed(seed);
+    if (depth_noise_std_ > 0.0)
+        depth_noise_ = std::normal_distribution<float>(0.0, depth_noise_std_);
+
+    /* Open ports. */
+    bool ports_ok = true;
+    ports_ok &= port_left_out_.open(port_left);
+    ports_ok &= port_right_out_.open(port_right);
+    ports_ok &= port_depth_out_.open(port_depth);
+    ports_ok &= port_head_out_.open(port_head);
+    ports_ok &= port_torso_out_.open(port_torso);
+    ports_ok &= port_arm_out_.open(port_arm);
+    ports_ok &= port_hand_pose_out_.open(port_hand_pose);
+    ports_ok &= port_ground_truth_out_.open(port_ground_truth);
+
+    if (use_opc_)
+    {
+        opc_ = std::unique_ptr<OPCServer>(new OPCServer(iol_object_name));
+        opc_server_.setReader(*opc_);
+        ports_ok &= opc_server_.open(port_opc);
+    }
+
+    if (!ports_ok)
+    {
+        yError() << log_ID_ << "Cannot open the output ports.";
+        return false;
+    }
+
+    report_time_ = Time::now();
+
+    return true;
+}
+
+
+double SceneGenerator::getPeriod()
+{
+    return period_;
+}
+
+
+bool SceneGenerator::updateModule()
+{
+    /* Time of the scene, independent of the achieved frame rate. */
+    const double t = frame_ * period_;
+
+    Transform<double, 3, Affine> object_pose;
+    VectorXd velocity;
+    objectState(t, object_pose, velocity);
+
+    const Transform<double, 3, Affine> hand_pose = object_pose * hand_offset_;
+
+    std::vector<Transform<double, 3, Affine>> poses(3);
+    poses[object_index_] = object_pose;
+    poses[hand_index_] = hand_pose;
+    poses[background_index_] = background_pose_;
+
+    /* Render both views. The bounding box is taken from the left view, as position_2d_left. */
+    const double render_start = Time::now();
+
+    renderer_->render(poses, camera_right_pose_, fx_right_, fy_right_, cx_right_, cy_right_, rgb_right_, depth_right_);
+    renderer_->render(poses, camera_left_pose_, fx_left_, fy_left_, cx_left_, cy_left_, rgb_left_, depth_left_);
+
+    report_render_time_ += Time::now() - render_start;
+
+    if (use_opc_)
+    {
+        bool valid;
+        cv::Point top_left;
+        cv::Point bottom_right;
+        std::tie(valid, top_left, bottom_right) = renderer_->getBoundingBox(object_index_);
+
+        opc_->setBoundingBox(valid, top_left, bottom_right);
+    }
+
+    if (depth_noise_std_ > 0.0)
+    {
+        for (std::size_t v = 0; v < height_; v++)
+        {
+            float* depth_row = depth_left_.ptr<float>(v);
+            for (std::size_t u = 0; u < width_; u++)
+            {
+                if (depth_row[u] > 0.0f)
+                    depth_row[u] = std::max(depth_row[u] + depth_noise_(generator_), 0.0f);
+            }
+        }
+    }
+
+    /* Publish all the streams with the same envelope. */
+    Stamp stamp(frame_, Time::now());
+
+    publishImage(port_left_out_, rgb_left_, stamp);
+    publishImage(port_right_out_, rgb_right_, stamp);
+
+    if (port_depth_out_.getOutputCount() > 0)
+    {
+        ImageOf<PixelFloat>& depth = port_depth_out_.prepare();
+        depth.resize(width_, height_);
+        for (std::size_t v = 0; v < height_; v++)
+            std::memcpy(depth.getRow(v), depth_left_.ptr<float>(v), width_ * sizeof(float));
+
+        port_depth_out_.setEnvelope(stamp);
+        port_depth_out_.write();
+    }
+
+    publishVector(port_head_out_, head_encoders_, stamp);
+    publishVector(port_torso_out_, torso_encoders_, stamp);
+    publishVector(port_arm_out_, arm_encoders_, stamp);
+    publishVector(port_hand_pose_out_, poseToAxisAngle(hand_pose), stamp);
+
+    VectorXd ground_truth(13);
+    ground_truth.head<7>() = poseToAxisAngle(object_pose);
+    ground_truth.tail<6>() = velocity;
+    publishVector(port_ground_truth_out_, ground_truth, stamp);
+
+    frame_++;
+    report_frames_++;
+
+    /* Report the achieved frame rate. */
+    const double now = Time::now();
+    if (now - report_time_ > 5.0)
+    {
+        yInfo() << log_ID_ << "Frame rate:" << report_frames_ / (now - report_time_)
+                << "fps, rendering time:" << report_render_time_ / report_frames_ * 1000.0 << "ms";
+
+        report_frames_ = 0;
+        report_render_time_ = 0.0;
+        report_time_ = now;
+    }
+
+    return true;
+}
+
+
+bool SceneGenerator::close()
+{
+    port_left_out_.close();
+    port_right_out_.close();
+    port_depth_out_.close();
+    port_head_out_.close();
+    port_torso_out_.close();
+    port_arm_out_.close();
+    port_hand_pose_out_.close();
+    port_ground_truth_out_.close();
+
+    if (use_opc_)
+    {
+        opc_server_.interrupt();
+        opc_server_.close();
+    }
+
+    return true;
+}
+
+
+void SceneGenerator::objectState(const double t, Transform<double, 3, Affine>& pose, VectorXd& velocity)
+{
+    /* Each coordinate oscillates with a different phase, so that the object follows a Lissajous curve. */
+    const double omega = 2.0 * M_PI * frequency_;
+    const Vector3d phase(0.0, M_PI / 2.0, M_PI);
+
+    Vector3d position;
+    Vector3d euler;
+    velocity.resize(6);
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        position(i) = center_position_(i) + amplitude_position_(i) * std::sin(omega * t + phase(i));
+        euler(i) = center_orientation_(i) + amplitude_orientation_(i) * std::sin(omega * t + phase(i));
+
+        velocity(i) = amplitude_position_(i) * omega * std::cos(omega * t + phase(i));
+        velocity(3 + i) = amplitude_orientation_(i) * omega * std::cos(omega * t + phase(i));
+    }
+
+    /* Euler angles in the ZYX convention used by the tracker. */
+    pose = Transform<double, 3, Affine>::Identity();
+    pose.translation() = position;
+    pose.rotate(AngleAxisd(euler(0), Vector3d::UnitZ()) *
+                AngleAxisd(euler(1), Vector3d::UnitY()) *
+                AngleAxisd(euler(2), Vector3d::UnitX()));
+}
+
+
+Transform<double, 3, Affine> SceneGenerator::leftEyePose()
+{
+    /* Torso in reversed order, then neck and eyes tilt, then the left eye from version and vergence. */
+    yarp::sig::Vector root_eye_enc(8, 0.0);
+    root_eye_enc(0) = torso_encoders_(2);
+    root_eye_enc(1) = torso_encoders_(1);
+    root_eye_enc(2) = torso_encoders_(0);
+    for (std::size_t i = 0; i < 4; i++)
+        root_eye_enc(3 + i) = head_encoders_(i);
+    root_eye_enc(7) = head_encoders_(4) + head_encoders_(5) / 2.0;
+
+    yarp::sig::Vector left_eye_pose = eye_kinematics_.EndEffPose(M_PI / 180.0 * root_eye_enc);
+
+    return poseFromAxisAngle(toEigen(left_eye_pose));
+}
+
+
+Transform<double, 3, Affine> SceneGenerator::rightEyePose(const Transform<double, 3, Affine>& left_eye_pose)
+{
+    /* Same as SFM::updateViaKinematics, i.e. the calibrated extrinsics corrected by the change of version and vergence. */
+    const Vector3d deyes = head_encoders_.tail<3>() - eyes_0_;
+    const double dpan = M_PI / 180.0 * deyes(1);
+    const double dver = M_PI / 180.0 * deyes(2);
+
+    Matrix4d L1 = Matrix4d::Identity();
+    L1.topLeftCorner<3, 3>() = AngleAxisd(dpan + dver / 2.0, Vector3d::UnitY()).toRotationMatrix();
+
+    Matrix4d R1 = Matrix4d::Identity();
+    R1.topLeftCorner<3, 3>() = AngleAxisd(dpan - dver / 2.0, Vector3d::UnitY()).toRotationMatrix();
+
+    /* H maps points from the left to the right camera frame. */
+    Transform<double, 3, Affine> H(R1.inverse() * stereo_extrinsics_ * L1);
+
+    return left_eye_pose * H.inverse();
+}
+
+
+bool SceneGenerator::loadCameraParameters()
+{
+    /* Intrinsic and extrinsic parameters used by SFM, installed with the tracker. */
+    ResourceFinder rf;
+    rf.setVerbose(true);
+    rf.setDefaultContext("object-tracking");
+    rf.setDefaultConfigFile("sfm_config.ini");
+    rf.configure(0, nullptr);
+
+    const Bottle& rf_left = rf.findGroup("CAMERA_CALIBRATION_LEFT");
+    const Bottle& rf_right = rf.findGroup("CAMERA_CALIBRATION_RIGHT");
+
+    /* Intrinsics are scaled from the calibrated size to the requested one. */
+    const double scale_left_u = static_cast<double>(width_) / rf_left.check("w", Value(320)).asDouble();
+    const double scale_left_v = static_cast<double>(height_) / rf_left.check("h", Value(240)).asDouble();
+    fx_left_ = rf_left.check("fx", Value(234.88)).asDouble() * scale_left_u;
+    fy_left_ = rf_left.check("fy", Value(234.582)).asDouble() * scale_left_v;
+    cx_left_ = rf_left.check("cx", Value(160.77)).asDouble() * scale_left_u;
+    cy_left_ = rf_left.check("cy", Value(123.491)).asDouble() * scale_left_v;
+
+    const double scale_right_u = static_cast<double>(width_) / rf_right.check("w", Value(320)).asDouble();
+    const double scale_right_v = static_cast<double>(height_) / rf_right.check("h", Value(240)).asDouble();
+    fx_right_ = rf_right.check("fx", Value(234.666)).asDouble() * scale_right_u;
+    fy_right_ = rf_right.check("fy", Value(234.25)).asDouble() * scale_right_v;
+    cx_right_ = rf_right.check("cx", Value(149.795)).asDouble() * scale_right_u;
+    cy_right_ = rf_right.check("cy", Value(123.059)).asDouble() * scale_right_v;
+
+    const Bottle& rf_stereo = rf.findGroup("STEREO_DISPARITY");
+    const VectorXd eyes_0 = loadVector(rf_stereo, "eyes", VectorXd::Zero(3));
+    const VectorXd extrinsics = loadVector(rf_stereo, "HN", VectorXd());
+
+    if ((eyes_0.size() != 3) || (extrinsics.size() != 16))
+    {
+        yError() << log_ID_ << "Cannot load the stereo extrinsics (eyes and HN) from sfm_config.ini.";
+        return false;
+    }
+
+    eyes_0_ = eyes_0;
+    stereo_extrinsics_ = Map<const Matrix<double, 4, 4, RowMajor>>(extrinsics.data());
+
+    return true;
+}
+
+
+void SceneGenerator::publishImage(BufferedPort<ImageOf<PixelRgb>>& port, const cv::Mat& image, const Stamp& stamp)
+{
+    if (port.getOutputCount() == 0)
+        return;
+
+    ImageOf<PixelRgb>& image_out = port.prepare();
+    image_out.resize(width_, height_);
+    for (std::size_t v = 0; v < height_; v++)
+        std::memcpy(image_out.getRow(v), image.ptr<cv::Vec3b>(v), width_ * sizeof(cv::Vec3b));
+
+    port.setEnvelope(stamp);
+    port.write();
+}
+
+
+void SceneGenerator::publishVector(BufferedPort<yarp::sig::Vector>& port, const Ref<const VectorXd>& vector, const Stamp& stamp)
+{
+    yarp::sig::Vector& vector_out = port.prepare();
+    vector_out.resize(vector.size());
+    toEigen(vector_out) = vector;
+
+    port.setEnvelope(stamp);
+    port.write();
+}
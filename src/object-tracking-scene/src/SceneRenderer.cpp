@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <SceneRenderer.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+using namespace Eigen;
+
+
+SceneRenderer::SceneRenderer(const std::size_t width, const std::size_t height, const double texture_cell_size) :
+    width_(width),
+    height_(height),
+    texture_cell_size_(texture_cell_size),
+    mesh_index_(height, width, CV_32SC1, cv::Scalar(-1))
+{ }
+
+
+SceneRenderer::~SceneRenderer()
+{ }
+
+
+std::size_t SceneRenderer::addMesh(const std::string& mesh_path, const Ref<const Vector3d>& color)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(mesh_path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+    if ((scene == nullptr) || (scene->mNumMeshes == 0))
+        throw(std::runtime_error("SCENERENDERER::ADDMESH::ERROR\n\tError: cannot load mesh " + mesh_path + "."));
+
+    std::size_t number_vertices = 0;
+    std::size_t number_faces = 0;
+    for (std::size_t i = 0; i < scene->mNumMeshes; i++)
+    {
+        number_vertices += scene->mMeshes[i]->mNumVertices;
+        number_faces += scene->mMeshes[i]->mNumFaces;
+    }
+
+    Mesh mesh;
+    mesh.vertices.resize(3, number_vertices);
+    mesh.faces.resize(3, number_faces);
+    mesh.color = color.cast<float>();
+
+    std::size_t vertex_offset = 0;
+    std::size_t face_index = 0;
+    for (std::size_t i = 0; i < scene->mNumMeshes; i++)
+    {
+        const aiMesh* ai_mesh = scene->mMeshes[i];
+
+        for (std::size_t j = 0; j < ai_mesh->mNumVertices; j++)
+            mesh.vertices.col(vertex_offset + j) = Vector3f(ai_mesh->mVertices[j].x, ai_mesh->mVertices[j].y, ai_mesh->mVertices[j].z);
+
+        for (std::size_t j = 0; j < ai_mesh->mNumFaces; j++)
+        {
+            /* Points and lines left after triangulation are skipped. */
+            if (ai_mesh->mFaces[j].mNumIndices != 3)
+                continue;
+
+            for (std::size_t k = 0; k < 3; k++)
+                mesh.faces(k, face_index) = vertex_offset + ai_mesh->mFaces[j].mIndices[k];
+            face_index++;
+        }
+
+        vertex_offset += ai_mesh->mNumVertices;
+    }
+    mesh.faces.conservativeResize(3, face_index);
+
+    meshes_.push_back(mesh);
+
+    return meshes_.size() - 1;
+}
+
+
+std::size_t SceneRenderer::addPlane(const double side, const Ref<const Vector3d>& color)
+{
+    const float half_side = side / 2.0;
+
+    Mesh mesh;
+    mesh.vertices.resize(3, 4);
+    mesh.vertices.col(0) = Vector3f(-half_side, -half_side, 0.0);
+    mesh.vertices.col(1) = Vector3f( half_side, -half_side, 0.0);
+    mesh.vertices.col(2) = Vector3f( half_side,  half_side, 0.0);
+    mesh.vertices.col(3) = Vector3f(-half_side,  half_side, 0.0);
+
+    mesh.faces.resize(3, 2);
+    mesh.faces.col(0) = Vector3i(0, 1, 2);
+    mesh.faces.col(1) = Vector3i(0, 2, 3);
+
+    mesh.color = color.cast<float>();
+
+    meshes_.push_back(mesh);
+
+    return meshes_.size() - 1;
+}
+
+
+void SceneRenderer::render(const std::vector<Transform<double, 3, Affine>>& poses, const Transform<double, 3, Affine>& camera_pose,
+                           const double fx, const double fy, const double cx, const double cy,
+                           cv::Mat& rgb, cv::Mat& depth)
+{
+    if (poses.size() != meshes_.size())
+        throw(std::runtime_error("SCENERENDERER::RENDER::ERROR\n\tError: expected one pose per mesh."));
+
+    rgb.setTo(cv::Scalar(0, 0, 0));
+    depth.setTo(cv::Scalar(0.0f));
+    mesh_index_.setTo(cv::Scalar(-1));
+
+    const Transform<double, 3, Affine> camera_pose_inverse = camera_pose.inverse();
+
+    for (std::size_t i = 0; i < meshes_.size(); i++)
+    {
+        const Transform<float, 3, Affine> mesh_to_camera = (camera_pose_inverse * poses[i]).cast<float>();
+        const Matrix3Xf vertices_camera = mesh_to_camera * meshes_[i].vertices;
+
+        rasterize(meshes_[i], i, vertices_camera, fx, fy, cx, cy, rgb, depth);
+    }
+}
+
+
+std::tuple<bool, cv::Point, cv::Point> SceneRenderer::getBoundingBox(const std::size_t mesh_index) const
+{
+    cv::Mat mask = (mesh_index_ == static_cast<int>(mesh_index));
+
+    std::vector<cv::Point> points;
+    cv::findNonZero(mask, points);
+    if (points.size() == 0)
+        return std::make_tuple(false, cv::Point(), cv::Point());
+
+    cv::Rect box = cv::boundingRect(points);
+
+    return std::make_tuple(true, box.tl(), box.br() - cv::Point(1, 1));
+}
+
+
+void SceneRenderer::rasterize(const Mesh& mesh, const int mesh_index, const Ref<const Matrix3Xf>& vertices_camera,
+                              const float fx, const float fy, const float cx, const float cy,
+                              cv::Mat& rgb, cv::Mat& depth)
+{
+    const float near_plane = 0.01;
+
+    for (std::size_t f = 0; f < mesh.faces.cols(); f++)
+    {
+        const Vector3i& face = mesh.faces.col(f);
+
+        const Vector3f p_0 = vertices_camera.col(face(0));
+        const Vector3f p_1 = vertices_camera.col(face(1));
+        const Vector3f p_2 = vertices_camera.col(face(2));
+
+        /* Triangles crossing the near plane are not clipped but discarded. */
+        if ((p_0(2) < near_plane) || (p_1(2) < near_plane) || (p_2(2) < near_plane))
+            continue;
+
+        /* Projection on the image plane. */
+        const Vector2f u_0(fx * p_0(0) / p_0(2) + cx, fy * p_0(1) / p_0(2) + cy);
+        const Vector2f u_1(fx * p_1(0) / p_1(2) + cx, fy * p_1(1) / p_1(2) + cy);
+        const Vector2f u_2(fx * p_2(0) / p_2(2) + cx, fy * p_2(1) / p_2(2) + cy);
+
+        const float area = (u_1(0) - u_0(0)) * (u_2(1) - u_0(1)) - (u_2(0) - u_0(0)) * (u_1(1) - u_0(1));
+        if (std::abs(area) < 1e-6f)
+            continue;
+
+        const int u_min = std::max(0, static_cast<int>(std::floor(std::min({u_0(0), u_1(0), u_2(0)}))));
+        const int u_max = std::min(static_cast<int>(width_) - 1, static_cast<int>(std::ceil(std::max({u_0(0), u_1(0), u_2(0)}))));
+        const int v_min = std::max(0, static_cast<int>(std::floor(std::min({u_0(1), u_1(1), u_2(1)}))));
+        const int v_max = std::min(static_cast<int>(height_) - 1, static_cast<int>(std::ceil(std::max({u_0(1), u_1(1), u_2(1)}))));
+        if ((u_min > u_max) || (v_min > v_max))
+            continue;
+
+        /* Flat shading, depending on the angle between the normal and the line of sight. */
+        const Vector3f normal = (p_1 - p_0).cross(p_2 - p_0).normalized();
+        const float shading = 0.4f + 0.6f * std::abs(normal.dot(p_0.normalized()));
+
+        /* Vertices in the mesh frame, where the texture is evaluated. */
+        const Vector3f q_0 = mesh.vertices.col(face(0));
+        const Vector3f q_1 = mesh.vertices.col(face(1));
+        const Vector3f q_2 = mesh.vertices.col(face(2));
+
+        for (int v = v_min; v <= v_max; v++)
+        {
+            float* depth_row = depth.ptr<float>(v);
+            int* index_row = mesh_index_.ptr<int>(v);
+            cv::Vec3b* rgb_row = rgb.ptr<cv::Vec3b>(v);
+
+            for (int u = u_min; u <= u_max; u++)
+            {
+                const float x = u + 0.5f;
+                const float y = v + 0.5f;
+
+                /* Barycentric coordinates, positive inside the triangle regardless of its winding. */
+                const float w_0 = ((u_1(0) - x) * (u_2(1) - y) - (u_2(0) - x) * (u_1(1) - y)) / area;
+                const float w_1 = ((u_2(0) - x) * (u_0(1) - y) - (u_0(0) - x) * (u_2(1) - y)) / area;
+                const float w_2 = 1.0f - w_0 - w_1;
+                if ((w_0 < 0.0f) || (w_1 < 0.0f) || (w_2 < 0.0f))
+                    continue;
+
+                /* Perspective correct interpolation. */
+                const float inverse_z = w_0 / p_0(2) + w_1 / p_1(2) + w_2 / p_2(2);
+                const float z = 1.0f / inverse_z;
+
+                if ((depth_row[u] != 0.0f) && (z >= depth_row[u]))
+                    continue;
+
+                depth_row[u] = z;
+                index_row[u] = mesh_index;
+
+                const Vector3f point = z * (w_0 / p_0(2) * q_0 + w_1 / p_1(2) * q_1 + w_2 / p_2(2) * q_2);
+                const Vector3f color = mesh.color * shading * (0.3f + 0.7f * texture(point));
+
+                rgb_row[u] = cv::Vec3b(cv::saturate_cast<uchar>(color(0)),
+                                       cv::saturate_cast<uchar>(color(1)),
+                                       cv::saturate_cast<uchar>(color(2)));
+            }
+        }
+    }
+}
+
+
+float SceneRenderer::texture(const Ref<const Vector3f>& point) const
+{
+    const std::int32_t i = static_cast<std::int32_t>(std::floor(point(0) / texture_cell_size_));
+    const std::int32_t j = static_cast<std::int32_t>(std::floor(point(1) / texture_cell_size_));
+    const std::int32_t k = static_cast<std::int32_t>(std::floor(point(2) / texture_cell_size_));
+
+    std::uint32_t hash = (static_cast<std::uint32_t>(i) * 73856093u) ^
+                         (static_cast<std::uint32_t>(j) * 19349663u) ^
+                         (static_cast<std::uint32_t>(k) * 83492791u);
+    hash ^= hash >> 13;
+    hash *= 0x5bd1e995u;
+    hash ^= hash >> 15;
+
+    return static_cast<float>(hash & 0xff) / 255.0f;
+}
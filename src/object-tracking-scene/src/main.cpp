@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <SceneGenerator.h>
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+
+#include <cstdlib>
+
+using namespace yarp::os;
+
+
+int main(int argc, char** argv)
+{
+    const std::string log_ID = "[Main]";
+    yInfo() << log_ID << "Configuring and starting module...";
+
+    Network yarp;
+    if (!yarp.checkNetwork())
+    {
+        yError() << log_ID << "Yarp is not available.";
+        return EXIT_FAILURE;
+    }
+
+    ResourceFinder rf;
+    rf.setVerbose();
+    rf.setDefaultContext("object-tracking-scene");
+    rf.setDefaultConfigFile("config.ini");
+    rf.configure(argc, argv);
+
+    SceneGenerator generator("object-tracking-scene");
+
+    return generator.runModule(rf);
+}
@@ -30,6 +30,7 @@
 
 #include <VtkiCubHand.h>
 
+#include <yarp/os/Bottle.h>
 #include <yarp/os/ResourceFinder.h>
 #include <yarp/os/BufferedPort.h>
 #include <yarp/sig/Image.h>
@@ -137,6 +138,28 @@ public:
         return true;
     }
 
+    bool set_colors(const Eigen::Ref<const Eigen::VectorXd>& intensities)
+    {
+        vtk_colors = vtkSmartPointer<vtkUnsignedCharArray>::New();
+        vtk_colors->SetNumberOfComponents(3);
+
+        const double min_intensity = intensities.minCoeff();
+        const double range = intensities.maxCoeff() - min_intensity;
+
+        // From blue (lowest intensity) to red (highest intensity)
+        for (int i = 0; i < intensities.size(); i++)
+        {
+            const double alpha = (range > 0) ? (intensities(i) - min_intensity) / range : 1.0;
+            std::vector<unsigned char> color = {static_cast<unsigned char>(255 * alpha), 0, static_cast<unsigned char>(255 * (1.0 - alpha))};
+
+            vtk_colors->InsertNextTypedTuple(color.data());
+        }
+
+        vtk_polydata->GetPointData()->SetScalars(vtk_colors);
+
+        return true;
+    }
+
     vtkSmartPointer<vtkPolyData> &get_polydata()
     {
         return vtk_polydata;
@@ -166,6 +189,8 @@ private:
 
     yarp::os::BufferedPort<yarp::sig::Vector> port_ground_truth_in_;
 
+    yarp::os::BufferedPort<yarp::os::Bottle> port_particles_in_;
+
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_image_in_;
 
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelFloat>> port_depth_in_;
@@ -174,6 +199,8 @@ private:
 
     std::unique_ptr<Points> vtk_measurements_;
 
+    std::unique_ptr<Points> vtk_particles_;
+
     const std::size_t cam_width_ = 320;
 
     const std::size_t cam_height_ = 240;
@@ -210,6 +237,8 @@ private:
 
     bool show_ground_truth_;
 
+    bool show_particles_;
+
     std::unique_ptr<VtkiCubHand> vtk_icub_hand_;
 
     const std::string log_ID_ = "[VIEWER]";
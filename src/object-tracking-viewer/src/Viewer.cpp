@@ -5,6 +5,7 @@
  * GPL-2+ license. See the accompanying LICENSE file for details.
  */
 
+#include <ParticleCloudCodec.h>
 #include <Viewer.h>
 
 #include <vtkTransform.h>
@@ -80,6 +81,20 @@ Viewer::Viewer(const std::string port_prefix, ResourceFinder& rf) :
         }
     }
 
+    // Load particles visualization boolean
+    show_particles_ = rf.check("show_particles", Value(false)).asBool();
+    yInfo() << log_ID_ << "- show_particles:" << show_particles_;
+
+    if (show_particles_)
+    {
+        // Open particles input port
+        if(!port_particles_in_.open("/" + port_prefix + "/particles:i"))
+        {
+            std::string err = "VIEWER::CTOR::ERROR\n\tError: cannot open particles input port.";
+            throw(std::runtime_error(err));
+        }
+    }
+
     // Load mesh from the default configuration file of module object-tracking
     ResourceFinder rf_object_tracking;
     rf_object_tracking.setVerbose(true);
@@ -126,6 +141,10 @@ Viewer::Viewer(const std::string port_prefix, ResourceFinder& rf) :
     int points_size = 2;
     vtk_measurements_ = std::unique_ptr<Points>(new Points(points_size));
 
+    // Configure particles actor
+    if (show_particles_)
+        vtk_particles_ = std::unique_ptr<Points>(new Points(4));
+
     // Configure vtk hand actors
     if (show_hand_)
         vtk_icub_hand_ = std::unique_ptr<VtkiCubHand>(new VtkiCubHand(port_prefix + "/hand/" + hand_laterality, hand_laterality));
@@ -160,6 +179,8 @@ Viewer::Viewer(const std::string port_prefix, ResourceFinder& rf) :
         vtk_icub_hand_->addToRenderer(*renderer_);
     if (show_ground_truth_)
         renderer_->AddActor(mesh_actor_ground_truth_);
+    if (show_particles_)
+        renderer_->AddActor(vtk_particles_->get_actor());
 
     renderer_->SetBackground(0.8, 0.8, 0.8);
 
@@ -194,6 +215,8 @@ Viewer::~Viewer()
     port_estimate_in_.close();
     port_image_in_.close();
     port_depth_in_.close();
+    if (show_particles_)
+        port_particles_in_.close();
 }
 
 
@@ -245,6 +268,27 @@ void Viewer::updateView()
         }
     }
 
+    // Update particles
+    if (show_particles_)
+    {
+        yarp::os::Bottle* particles = port_particles_in_.read(false);
+
+        if (particles != nullptr)
+        {
+            bool valid_particles;
+            MatrixXd states;
+            VectorXd log_weights;
+            std::tie(valid_particles, states, log_weights) = ParticleCloudCodec::decode(*particles);
+
+            // Show the positions of the particles colored according to their weights
+            if (valid_particles && (states.cols() > 0))
+            {
+                vtk_particles_->set_points(states.topRows<3>());
+                vtk_particles_->set_colors(log_weights);
+            }
+        }
+    }
+
     // Update point cloud of the scene
     {
         // Try to get input image
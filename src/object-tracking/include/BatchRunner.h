@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <Eigen/Dense>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/**
+ * Parameters of a simulated trial, as found in the groups of config_simulation.ini.
+ */
+struct TrialParameters
+{
+    std::string filter_type;
+
+    /* UPF. */
+    std::size_t number_particles;
+    double resampling_threshold;
+    double likelihood_variance;
+    std::string point_estimate_method;
+    std::size_t point_estimate_window_size;
+
+    /* Initial condition. */
+    Eigen::VectorXd x_0;
+    Eigen::VectorXd v_0;
+    Eigen::VectorXd euler_0;
+    Eigen::VectorXd euler_dot_0;
+    Eigen::VectorXd cov_x_0;
+    Eigen::VectorXd cov_v_0;
+    Eigen::VectorXd cov_eul_0;
+    Eigen::VectorXd cov_eul_dot_0;
+    Eigen::VectorXd center_0;
+    Eigen::VectorXd radius_0;
+
+    /* Kinematic and measurement models. */
+    Eigen::VectorXd kin_q_x;
+    Eigen::VectorXd kin_q_eul;
+    Eigen::VectorXd noise_covariance;
+
+    /* Unscented transform. */
+    double ut_alpha;
+    double ut_beta;
+    double ut_kappa;
+
+    /* Point cloud prediction. */
+    std::size_t pc_pred_num_samples;
+
+    /* Simulation. */
+    double sim_sample_time;
+    double sim_duration;
+    Eigen::VectorXd sim_psd_acc;
+    Eigen::VectorXd sim_psd_w;
+    Eigen::VectorXd sim_x_0;
+    Eigen::VectorXd sim_v_0;
+    Eigen::VectorXd sim_q_0;
+    Eigen::VectorXd sim_w_0;
+    std::size_t sim_point_cloud_number;
+    Eigen::VectorXd sim_point_cloud_observer;
+    Eigen::VectorXd sim_point_cloud_noise_std;
+    bool sim_point_cloud_back_culling;
+
+    /* Object. */
+    std::string object_mesh_path_ply;
+};
+
+
+/**
+ * Run simulated trials, i.e. SimulatedFilter or SimulatedPFilter on a simulated trajectory, on a pool of threads
+ * and summarize the error and the latency of the trials sharing the same parameters.
+ *
+ * Each trial builds its own object models, state models and random number generators, all seeded from the seed of the trial,
+ * so that its outcome does not depend on the other trials nor on the number of threads.
+ * In particular:
+ * - trials with the same seed simulate the same trajectory and measurements, regardless of the filter parameters;
+ * - the mesh sampling performed by VCG uses a process-wide generator, hence the object models are built
+ *   one trial at a time and the generator is reseeded before each trial.
+ */
+class BatchRunner
+{
+public:
+    BatchRunner(const std::size_t number_of_threads, const std::size_t threads_per_trial, const std::size_t skip_steps);
+
+    virtual ~BatchRunner();
+
+    /**
+     * Add a trial belonging to the parameter combination with the given description.
+     * Trials added with the same description are aggregated in the summary.
+     */
+    void addTrial(const std::string& description, const TrialParameters& parameters, const unsigned int seed);
+
+    void run();
+
+    /**
+     * Write one line per parameter combination with the mean and the standard deviation across seeds
+     * of the position and orientation RMSE and the percentiles of the step latency of all its trials.
+     */
+    bool writeSummary(const std::string& path) const;
+
+    /**
+     * Write one line per trial.
+     */
+    bool writeTrials(const std::string& path) const;
+
+protected:
+    struct Trial
+    {
+        std::size_t combination;
+
+        unsigned int seed;
+
+        TrialParameters parameters;
+    };
+
+    struct TrialResult
+    {
+        bool valid = false;
+
+        std::string error;
+
+        /**
+         * Position RMSE in meters and orientation RMSE, i.e. of the angle of the relative rotation, in radians.
+         */
+        double position_rmse;
+
+        double orientation_rmse;
+
+        std::size_t invalid_estimates;
+
+        std::vector<double> step_durations;
+
+        double duration;
+    };
+
+    TrialResult runTrial(const Trial& trial);
+
+    void evaluateErrors(const std::vector<Eigen::VectorXd>& estimates, const std::vector<Eigen::VectorXd>& ground_truth, TrialResult& result) const;
+
+    void worker();
+
+    const std::size_t number_of_threads_;
+
+    const std::size_t threads_per_trial_;
+
+    const std::size_t skip_steps_;
+
+    std::vector<std::string> combinations_;
+
+    std::vector<Trial> trials_;
+
+    std::vector<TrialResult> results_;
+
+    std::atomic<std::size_t> next_trial_;
+
+    std::atomic<std::size_t> completed_trials_;
+
+    std::mutex print_mutex_;
+
+    /**
+     * Serializes the construction of the object models.
+     */
+    std::mutex mesh_sampling_mutex_;
+
+    const std::string log_ID_ = "[BatchRunner]";
+};
+
+#endif /* BATCHRUNNER_H */
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef BINARYLOGGER_H
+#define BINARYLOGGER_H
+
+#include <Eigen/Dense>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Binary log file written asynchronously.
+ *
+ * Records are copied in a lock-free single producer, single consumer ring buffer, hence the producer only pays
+ * a memcpy, and a background thread moves them to disk in large blocks, optionally compressed with gzip.
+ * If the buffer is full, e.g. because the disk cannot keep up, records are dropped and counted instead of
+ * stalling the producer.
+ *
+ * The file starts with the 8 bytes magic "OTBLOG01" followed by the records. Each record is made of
+ * the number of rows and of columns (uint32), the time of the record in seconds (float64) and the data
+ * in column-major order (float64), all in little endian.
+ */
+class BinaryLog
+{
+public:
+    BinaryLog(const std::string& file_name, const std::size_t buffer_size, const bool compress);
+
+    virtual ~BinaryLog();
+
+    /**
+     * Copy a record in the ring buffer. Must be called by one thread at a time.
+     */
+    bool write(const Eigen::Ref<const Eigen::MatrixXd>& data);
+
+    std::size_t getDroppedRecords() const;
+
+    const std::string& getFileName() const;
+
+protected:
+    /**
+     * Body of the writer thread.
+     */
+    void flushLoop();
+
+    /**
+     * Move all the bytes available in the ring buffer to the file.
+     */
+    void flush();
+
+    void writeFile(const char* data, const std::size_t size);
+
+    std::string file_name_;
+
+    bool compress_;
+
+    /**
+     * Either a FILE* or a gzFile.
+     */
+    void* file_;
+
+    std::vector<char> buffer_;
+
+    /**
+     * Total number of bytes written by the producer and read by the consumer. Since the buffer size is a power of two,
+     * positions in the buffer are obtained by masking.
+     */
+    std::atomic<std::uint64_t> head_;
+
+    std::atomic<std::uint64_t> tail_;
+
+    const std::uint64_t mask_;
+
+    /**
+     * The writer thread flushes as soon as this amount of bytes is available, or periodically otherwise.
+     */
+    const std::size_t block_size_;
+
+    std::atomic<bool> running_;
+
+    std::atomic<std::size_t> dropped_;
+
+    std::thread writer_;
+
+    const std::string log_ID_ = "[BinaryLog]";
+};
+
+
+/**
+ * Binary counterpart of bfl::Logger.
+ *
+ * A class deriving from both bfl::Logger and BinaryLogger logs the same quantities, with the same file names
+ * (with extension .bin, or .bin.gz if compressed), either as text or in binary format.
+ */
+class BinaryLogger
+{
+public:
+    virtual ~BinaryLogger();
+
+    bool enable_binary_log(const std::string& prefix_path, const std::string& prefix_name, const bool compress = false, const std::size_t buffer_size = 16 * 1024 * 1024);
+
+    void disable_binary_log();
+
+    bool is_binary_log_enabled() const;
+
+protected:
+    virtual std::vector<std::string> binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name) = 0;
+
+    /**
+     * Log each argument in the corresponding file, in the same order of binary_log_file_names.
+     */
+    template<typename... Data>
+    void binary_logger(const Data&... data)
+    {
+        std::size_t index = 0;
+        binary_logger_helper(index, data...);
+    }
+
+private:
+    void binary_logger_helper(std::size_t&)
+    { }
+
+    template<typename Head, typename... Tail>
+    void binary_logger_helper(std::size_t& index, const Head& head, const Tail&... tail)
+    {
+        if (index < binary_logs_.size())
+            binary_logs_[index]->write(head);
+        index++;
+
+        binary_logger_helper(index, tail...);
+    }
+
+    std::vector<std::unique_ptr<BinaryLog>> binary_logs_;
+};
+
+#endif /* BINARYLOGGER_H */
@@ -13,6 +13,7 @@
 
 #include <Eigen/Dense>
 
+#include <DebugPublisher.h>
 #include <GazeController.h>
 
 #include <opencv2/opencv.hpp>
@@ -134,7 +135,7 @@ protected:
     std::pair<bool, Eigen::VectorXd> measure();
 
     /**
-     * Draw the current object mask on the camera image and send the rendered image on the network.
+     * Send the current object mask on the network. The mask is handed to the publisher thread without copies.
      */
     void sendObjectMask();
 
@@ -270,7 +271,7 @@ protected:
      * Image input/output.
      */
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_image_in_;
-    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_mask_image_out_;
+    std::unique_ptr<DebugPublisher> mask_publisher_;
     bool send_mask_ = false;
 
     const std::string log_ID_ = "[BOUNDINGBOXESTIMATOR]";
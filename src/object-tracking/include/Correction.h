@@ -8,7 +8,7 @@
 #ifndef CORRECTION_H
 #define CORRECTION_H
 
-#include <iCubPointCloud.h>
+#include <PointCloudModel.h>
 #include <BayesFilters/AdditiveMeasurementModel.h>
 #include <BayesFilters/SUKFCorrection.h>
 
@@ -18,9 +18,9 @@ class MeasurementModelReference
 public:
     MeasurementModelReference(bfl::AdditiveMeasurementModel& measurement_model);
 
-    iCubPointCloud& getPointCloudModel();
+    PointCloudModel& getPointCloudModel();
 private:
-    iCubPointCloud& meas_model_;
+    PointCloudModel& meas_model_;
 };
 
 
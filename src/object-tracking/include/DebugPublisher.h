@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef DEBUGPUBLISHER_H
+#define DEBUGPUBLISHER_H
+
+#include <opencv2/opencv.hpp>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/sig/Image.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Publisher of debugging images running in a low priority thread.
+ *
+ * The filtering thread only collects lightweight draw commands (polygons, boxes, points and contours of masks)
+ * that are rasterized and sent by the publisher thread. Commands are expected to be collected only if
+ * hasConnections() is true. If the publisher thread is still busy with the previous frame, the new one replaces it.
+ *
+ * The image is either the latest one received on the background port or, if none is used, the background mask.
+ */
+class DebugPublisher
+{
+public:
+    DebugPublisher(const std::string& port_name, const std::string& background_port_name = "");
+
+    virtual ~DebugPublisher();
+
+    bool hasConnections();
+
+    /**
+     * The mask is shared, not copied, hence it must not be modified afterwards.
+     */
+    void setBackgroundMask(const cv::Mat& mask);
+
+    void drawPolygon(const std::vector<cv::Point>& polygon, const cv::Scalar& color);
+
+    /**
+     * Draw the contour having the largest area among those of the mask. The mask is shared, not copied,
+     * hence it must not be modified afterwards.
+     */
+    void drawMaskContour(const cv::Mat& mask, const cv::Scalar& color);
+
+    void drawBox(const cv::Point& top_left, const cv::Point& bottom_right, const cv::Scalar& color);
+
+    void drawPoints(const std::vector<cv::Point>& points, const cv::Scalar& color);
+
+    /**
+     * Hand the commands collected so far to the publisher thread.
+     */
+    void publish();
+
+    std::size_t getDroppedFrames();
+
+protected:
+    struct Command
+    {
+        enum class Type { Polygon, MaskContour, Box, Points };
+
+        Type type;
+
+        std::vector<cv::Point> points;
+
+        cv::Mat mask;
+
+        cv::Scalar color;
+    };
+
+    struct Frame
+    {
+        cv::Mat background_mask;
+
+        std::vector<Command> commands;
+    };
+
+    void publishLoop();
+
+    void render(const Frame& frame);
+
+    void draw(cv::Mat& image, const Command& command);
+
+    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_image_out_;
+
+    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_background_in_;
+
+    const bool use_background_port_;
+
+    /**
+     * Frame being collected by the filtering thread.
+     */
+    Frame collecting_;
+
+    /**
+     * Frame waiting for the publisher thread.
+     */
+    Frame pending_;
+
+    bool is_pending_;
+
+    bool running_;
+
+    std::size_t dropped_;
+
+    std::mutex mutex_;
+
+    std::condition_variable frame_available_;
+
+    std::thread publisher_;
+
+    const std::string log_ID_ = "[DebugPublisher]";
+};
+
+#endif /* DEBUGPUBLISHER_H */
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef DEPTHIMAGEMODEL_H
+#define DEPTHIMAGEMODEL_H
+
+#include <Eigen/Dense>
+
+#include <tuple>
+
+
+/**
+ * Depth measured within the region of interest of the object,
+ * together with the camera parameters that are required to render it.
+ */
+struct DepthROI
+{
+    /**
+     * Measured depth within the region of interest.
+     * Pixels outside the object mask or without a valid measurement have zero depth.
+     */
+    Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> depth;
+
+    /**
+     * Top-left corner of the region of interest on the image plane.
+     */
+    int u_0 = 0;
+    int v_0 = 0;
+
+    /**
+     * Camera position and axis/angle orientation with respect to the root frame.
+     */
+    Eigen::VectorXd camera_position;
+    Eigen::VectorXd camera_orientation;
+
+    /**
+     * Camera intrinsic parameters.
+     */
+    double fx = 0.0;
+    double fy = 0.0;
+    double cx = 0.0;
+    double cy = 0.0;
+};
+
+
+/**
+ * Interface of measurement models that can provide the depth image of the object
+ * in addition to the point cloud, e.g. to be used in render-and-compare likelihoods.
+ */
+class DepthImageModel
+{
+public:
+    virtual ~DepthImageModel() noexcept { };
+
+    /**
+     * Get the depth of the object, as obtained in the last call to freeze().
+     */
+    virtual std::tuple<bool, DepthROI> getDepthROI() const = 0;
+};
+
+#endif /* DEPTHIMAGEMODEL_H */
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef DEPTHLIKELIHOOD_H
+#define DEPTHLIKELIHOOD_H
+
+#include <BayesFilters/LikelihoodModel.h>
+#include <BayesFilters/MeasurementModel.h>
+
+#include <DepthRasterizer.h>
+
+#include <Eigen/Dense>
+
+#include <memory>
+
+/**
+ * Render-and-compare likelihood between the measured depth within the object region of interest
+ * and the depth of the object rendered, for each particle, by a DepthRasterizer.
+ *
+ * The measurement model is required to implement the DepthImageModel interface.
+ */
+class DepthLikelihood : public bfl::LikelihoodModel
+{
+public:
+    DepthLikelihood(const double noise_variance, const double outlier_threshold, std::unique_ptr<DepthRasterizer> rasterizer);
+
+    virtual ~DepthLikelihood();
+
+    std::pair<bool, Eigen::VectorXd> likelihood(const bfl::MeasurementModel& measurement_model, const Eigen::Ref<const Eigen::MatrixXd>& pred_states) override;
+
+protected:
+    const double gain_;
+
+    /**
+     * Per-pixel depth errors are saturated to this threshold in order to be robust with respect to outliers
+     * and to pixels where the object is measured but not rendered.
+     */
+    const float outlier_threshold_;
+
+    std::unique_ptr<DepthRasterizer> rasterizer_;
+};
+
+#endif /* DEPTHLIKELIHOOD_H */
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef DEPTHRASTERIZER_H
+#define DEPTHRASTERIZER_H
+
+#include <Eigen/Dense>
+
+#include <MeshImporter.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * Multithreaded CPU rasterizer rendering the depth of the object mesh for a batch of poses.
+ *
+ * Rendering does not require an OpenGL context. The region of the image to be rendered is split in square tiles,
+ * triangles are binned per tile and tiles are rasterized in parallel using edge functions evaluated on
+ * packets of 8 pixels and a per-tile early depth rejection.
+ */
+class DepthRasterizer : public MeshImporter
+{
+public:
+    using DepthImage = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    /**
+     * Region of the image plane to be rendered (top-left corner and size in pixels).
+     */
+    struct Window
+    {
+        int u_0;
+        int v_0;
+        int width;
+        int height;
+    };
+
+    DepthRasterizer(const std::string& mesh_filename, const std::size_t tile_size = 32, const bool enable_back_culling = true);
+
+    virtual ~DepthRasterizer();
+
+    /**
+     * Set the camera intrinsic parameters.
+     */
+    void setIntrinsics(const double fx, const double fy, const double cx, const double cy);
+
+    /**
+     * Render the depth of the object for each state in `states` within the window `window` of the image plane.
+     * The pose of the camera is given as a position and an axis/angle orientation with respect to the root frame.
+     *
+     * Rendered images are stored in an internal pool of buffers that is reused across calls and are valid until the next call.
+     * Pixels not covered by the object have zero depth.
+     */
+    bool render(const Eigen::Ref<const Eigen::MatrixXd>& states, const Eigen::Ref<const Eigen::VectorXd>& camera_position, const Eigen::Ref<const Eigen::VectorXd>& camera_orientation, const Window& window);
+
+    /**
+     * Get the rendered depth associated to the i-th state of the last call to render().
+     * Only the leftmost window.width columns are meaningful, the remaining are padding.
+     */
+    const DepthImage& getDepth(const std::size_t index) const;
+
+    /**
+     * Get the number of images rendered in the last call to render().
+     */
+    std::size_t getNumberImages() const;
+
+protected:
+    /**
+     * Project the vertices of the mesh and bin the triangles in the tiles for the i-th state.
+     */
+    void setupState(const std::size_t index, const Eigen::Ref<const Eigen::VectorXd>& state, const Eigen::Transform<double, 3, Eigen::Affine>& camera_pose_inverse);
+
+    /**
+     * Rasterize all the triangles binned in the tile `tile` for the i-th state.
+     */
+    void rasterizeTile(const std::size_t index, const std::size_t tile);
+
+    /**
+     * Convert the inverse depth stored in the i-th buffer to depth.
+     */
+    void resolveDepth(const std::size_t index);
+
+    /**
+     * Mesh vertices expressed in the object frame and triangle indices.
+     */
+    Eigen::Matrix3Xd vertices_;
+
+    Eigen::Matrix<std::uint32_t, 3, Eigen::Dynamic> triangles_;
+
+    /**
+     * Camera intrinsic parameters.
+     */
+    double fx_ = 0.0;
+    double fy_ = 0.0;
+    double cx_ = 0.0;
+    double cy_ = 0.0;
+    bool intrinsics_set_ = false;
+
+    /**
+     * Tiling of the current window.
+     */
+    const std::size_t tile_size_;
+    std::size_t tiles_u_ = 0;
+    std::size_t tiles_v_ = 0;
+    Window window_;
+    int stride_ = 0;
+
+    const bool enable_back_culling_;
+
+    /**
+     * Pool of buffers reused across calls to render().
+     * For each state: the depth image, the projected vertices (u, v, 1 / z)
+     * and the list of triangles overlapping each tile.
+     */
+    std::vector<DepthImage> depth_pool_;
+
+    std::vector<Eigen::Matrix3Xf> projected_pool_;
+
+    std::vector<std::vector<std::vector<std::uint32_t>>> bins_pool_;
+
+    std::size_t number_images_ = 0;
+
+    /**
+     * Near plane used to discard triangles lying behind the camera.
+     */
+    const double near_plane_ = 0.01;
+};
+
+#endif /* DEPTHRASTERIZER_H */
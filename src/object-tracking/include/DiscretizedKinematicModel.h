@@ -8,13 +8,16 @@
 #ifndef DISCRETIZEDKINEMATICMODEL_H
 #define DISCRETIZEDKINEMATICMODEL_H
 
+#include <KinematicModelParameters.h>
+
 #include <BayesFilters/LinearStateModel.h>
 
 #include <Eigen/Dense>
 
 #include <chrono>
 
-class DiscretizedKinematicModel : public bfl::LinearStateModel
+class DiscretizedKinematicModel : public bfl::LinearStateModel,
+                                  public KinematicModelParameters
 {
 public:
     DiscretizedKinematicModel
@@ -27,6 +30,21 @@ public:
         const double sigma_psi
     );
 
+    /**
+     * Use a fixed sampling time T instead of evaluating it online, e.g. in simulation where
+     * the execution time of a step does not match the sampling time of the simulated data.
+     */
+    DiscretizedKinematicModel
+    (
+        const double sigma_x,
+        const double sigma_y,
+        const double sigma_z,
+        const double sigma_phi,
+        const double sigma_theta,
+        const double sigma_psi,
+        const double T
+    );
+
     virtual ~DiscretizedKinematicModel();
 
     Eigen::MatrixXd getStateTransitionMatrix() override;
@@ -37,11 +55,22 @@ public:
 
     std::pair<std::size_t, std::size_t> getOutputSize() const override;
 
+    double getSamplingTime() const override;
+
+    const Eigen::VectorXd& getPositionPSD() const override;
+
+    const Eigen::VectorXd& getOrientationPSD() const override;
+
 protected:
     void evaluateStateTransitionMatrix(const double T);
 
     void evaluateNoiseCovarianceMatrix(const double T);
 
+    /**
+     * Evaluate F_ and Q_ if the sampling time changed since they were last evaluated.
+     */
+    void updateMatrices();
+
     /**
      * State transition matrix.
      */
@@ -59,9 +88,18 @@ protected:
 
     Eigen::VectorXd sigma_orientation_;
 
+    /**
+     * Sampling time. A tick only updates it, F_ and Q_ are evaluated when they are requested.
+     */
+    double T_;
+
+    bool matrices_updated_ = true;
+
     std::chrono::high_resolution_clock::time_point last_time_;
 
     bool last_time_set_ = false;
+
+    bool fixed_sample_time_ = false;
 };
 
 #endif /* DISCRETIZEDKINEMATICMODEL_H */
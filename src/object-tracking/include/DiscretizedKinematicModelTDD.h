@@ -8,6 +8,8 @@
 #ifndef DISCRETIZEDKINEMATICMODELTDD_H
 #define DISCRETIZEDKINEMATICMODELTDD_H
 
+#include <KinematicModelParameters.h>
+
 #include <BayesFilters/LinearStateModel.h>
 
 #include <Eigen/Dense>
@@ -15,7 +17,8 @@
 #include <chrono>
 #include <memory>
 
-class DiscretizedKinematicModelTDD : public bfl::LinearStateModel
+class DiscretizedKinematicModelTDD : public bfl::LinearStateModel,
+                                     public KinematicModelParameters
 {
 public:
     DiscretizedKinematicModelTDD
@@ -52,6 +55,12 @@ public:
 
     std::pair<std::size_t, std::size_t> getOutputSize() const override;
 
+    double getSamplingTime() const override;
+
+    const Eigen::VectorXd& getPositionPSD() const override;
+
+    const Eigen::VectorXd& getOrientationPSD() const override;
+
 protected:
     DiscretizedKinematicModelTDD
     (
@@ -68,6 +77,11 @@ protected:
 
     void evaluateNoiseCovarianceMatrix(const double T);
 
+    /**
+     * Evaluate F_ and Q_ if the sampling time changed since they were last evaluated.
+     */
+    void updateMatrices();
+
     /**
      * State transition matrix.
      */
@@ -87,6 +101,13 @@ protected:
 
     Eigen::VectorXd sigma_orientation_;
 
+    /**
+     * Sampling time. A tick only updates it, F_ and Q_ are evaluated when they are requested.
+     */
+    double T_;
+
+    bool matrices_updated_ = true;
+
     std::chrono::high_resolution_clock::time_point last_time_;
 
     bool last_time_set_ = false;
@@ -8,6 +8,7 @@
 #ifndef FILTER_H
 #define FILTER_H
 
+#include <BinaryLogger.h>
 #include <BoundingBoxEstimator.h>
 #include <Correction.h>
 #include <GaussianFilter_.h>
@@ -20,6 +21,7 @@
 
 #include <yarp/os/BufferedPort.h>
 #include <yarp/os/Port.h>
+#include <yarp/os/Stamp.h>
 #include <yarp/sig/Vector.h>
 
 #include <thrift/ObjectTrackingIDL.h>
@@ -27,6 +29,7 @@
 #include <memory>
 
 class Filter : public bfl::GaussianFilter_,
+               public BinaryLogger,
                public ObjectTrackingIDL
 {
 public:
@@ -64,16 +67,23 @@ public:
 
     bool set_history_window(const int16_t window);
 
+    std::vector<std::string> get_stats() override;
+
+    void reset_stats() override;
+
     bool quit() override;
 
 protected:
     std::vector<std::string> log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
 
+    std::vector<std::string> binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
+
     void filteringStep() override;
 
     void log() override;
 
     yarp::os::BufferedPort<yarp::sig::Vector> port_estimate_out_;
+    yarp::os::Stamp estimate_stamp_;
 
     yarp::os::Port port_rpc_command_;
 
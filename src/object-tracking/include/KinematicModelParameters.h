@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef KINEMATICMODELPARAMETERS_H
+#define KINEMATICMODELPARAMETERS_H
+
+#include <Eigen/Dense>
+
+/**
+ * Parameters of the discretized kinematic models (DiscretizedKinematicModel and DiscretizedKinematicModelTDD),
+ * i.e. those their state transition and noise covariance matrices are made of.
+ */
+class KinematicModelParameters
+{
+public:
+    virtual ~KinematicModelParameters()
+    { }
+
+    /**
+     * Sampling time of the current step.
+     */
+    virtual double getSamplingTime() const = 0;
+
+    /**
+     * Squared power spectral densities of the linear and of the angular accelerations.
+     */
+    virtual const Eigen::VectorXd& getPositionPSD() const = 0;
+
+    virtual const Eigen::VectorXd& getOrientationPSD() const = 0;
+};
+
+#endif /* KINEMATICMODELPARAMETERS_H */
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef KINEMATICMODELPREDICTION_H
+#define KINEMATICMODELPREDICTION_H
+
+#include <KinematicModelParameters.h>
+
+#include <BayesFilters/GaussianMixture.h>
+#include <BayesFilters/GaussianPrediction.h>
+#include <BayesFilters/LinearStateModel.h>
+
+#include <Eigen/Dense>
+
+#include <memory>
+
+/**
+ * Kalman prediction step specialized for the discretized kinematic models
+ * (DiscretizedKinematicModel and DiscretizedKinematicModelTDD).
+ *
+ * The state transition matrix F is the identity except for the two 3x3 blocks F(0:2, 3:5) = T_p * I
+ * and F(9:11, 6:8) = T_a * I, while the noise covariance matrix Q is made of diagonal 3x3 blocks.
+ * Hence, F * P * F^{T} + Q is evaluated in place as row and column updates of P
+ * followed by the sum of the non-zero entries of Q, for all the components in parallel.
+ *
+ * T_p = T_a and the entries of Q are evaluated from the KinematicModelParameters of the state model,
+ * if available, instead of reading them from F and Q.
+ */
+class KinematicModelPrediction : public bfl::GaussianPrediction
+{
+public:
+    KinematicModelPrediction(std::unique_ptr<bfl::LinearStateModel> state_model) noexcept;
+
+    virtual ~KinematicModelPrediction() noexcept;
+
+    bfl::StateModel& getStateModel() noexcept override;
+
+protected:
+    void predictStep(const bfl::GaussianMixture& prev_state, bfl::GaussianMixture& pred_state) override;
+
+    std::unique_ptr<bfl::LinearStateModel> state_model_;
+
+    /**
+     * The state model, if it provides its parameters, otherwise nullptr.
+     */
+    const KinematicModelParameters* parameters_;
+};
+
+#endif /* KINEMATICMODELPREDICTION_H */
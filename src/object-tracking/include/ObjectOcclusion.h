@@ -8,6 +8,7 @@
 #ifndef OBJECTOCCLUSION_H
 #define OBJECTOCCLUSION_H
 
+#include <DebugPublisher.h>
 #include <MeshModel.h>
 
 #include <Eigen/Dense>
@@ -23,7 +24,7 @@ public:
 
     void findOcclusionArea();
 
-    void drawOcclusionArea(cv::Mat& image);
+    void drawOcclusionArea(DebugPublisher& publisher);
 
     std::tuple<bool, bool, cv::Mat> removeOcclusion(const cv::Mat& mask_in);
 
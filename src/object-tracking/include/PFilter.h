@@ -14,12 +14,14 @@
 #include <BayesFilters/Resampling.h>
 #include <BayesFilters/SIS.h>
 
+#include <BinaryLogger.h>
 #include <BoundingBoxEstimator.h>
 #include <iCubPointCloud.h>
 #include <ParticlesCorrection.h>
 
 #include <yarp/os/BufferedPort.h>
 #include <yarp/os/Port.h>
+#include <yarp/os/Stamp.h>
 #include <yarp/sig/Vector.h>
 
 #include <thrift/ObjectTrackingIDL.h>
@@ -42,6 +44,7 @@ private:
 
 class PFilter : public ParticleCorrectionReset,
                 public bfl::SIS,
+                public BinaryLogger,
                 public ObjectTrackingIDL
 {
 public:
@@ -57,7 +60,8 @@ public:
         std::unique_ptr<ParticlesCorrection> correction,
         std::unique_ptr<bfl::Resampling> resampling,
         std::unique_ptr<BoundingBoxEstimator> bbox_estimator,
-        std::shared_ptr<iCubPointCloudExogenousData> icub_point_cloud_share
+        std::shared_ptr<iCubPointCloudExogenousData> icub_point_cloud_share,
+        const std::size_t particles_top_k
     );
 
     virtual ~PFilter();
@@ -82,19 +86,40 @@ public:
 
     bool set_history_window(const int16_t window);
 
+    std::vector<std::string> get_stats() override;
+
+    void reset_stats() override;
+
     bool quit() override;
 
 protected:
     std::vector<std::string> log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
 
+    std::vector<std::string> binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
+
     void filteringStep() override;
 
     void log() override;
 
     yarp::os::BufferedPort<yarp::sig::Vector> port_estimate_out_;
 
+    /**
+     * Envelope shared by the estimate, the timings and the particles sent at each step.
+     */
+    yarp::os::Stamp estimate_stamp_;
+
     yarp::os::BufferedPort<yarp::sig::Vector> port_timings_out_;
 
+    /**
+     * Quantized particle set, see ParticleCloudCodec. Only sent if someone is connected.
+     */
+    yarp::os::BufferedPort<yarp::os::Bottle> port_particles_out_;
+
+    /**
+     * If not zero, only the particles_top_k_ particles having the largest weights are sent.
+     */
+    const std::size_t particles_top_k_;
+
     yarp::os::Port port_rpc_command_;
 
     std::unique_ptr<BoundingBoxEstimator> bbox_estimator_;
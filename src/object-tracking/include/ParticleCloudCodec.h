@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef PARTICLECLOUDCODEC_H
+#define PARTICLECLOUDCODEC_H
+
+#include <Eigen/Dense>
+
+#include <yarp/os/Bottle.h>
+
+#include <cstddef>
+#include <tuple>
+
+
+/**
+ * Compact encoding of a particle set for remote inspection.
+ *
+ * Each state is sent as the difference with respect to a reference state, e.g. the estimate or the best particle,
+ * quantized with 16 bits per component using the smallest step that covers the largest difference of the
+ * component within the set. Differences of the angular components are wrapped in [-pi, pi]. Log weights
+ * are quantized with 16 bits between the smallest and the largest one.
+ *
+ * The message is a Bottle made of the number of particles (int), the reference state (list of float64),
+ * the quantization steps (list of float64), the smallest and the largest log weight (float64) and a blob
+ * containing, for each particle, the quantized state (int16) followed by the quantized log weight (uint16),
+ * in little endian.
+ *
+ * With 12 components per state, a particle takes 26 bytes instead of the 104 required by the full precision state and weight.
+ */
+class ParticleCloudCodec
+{
+public:
+    /**
+     * If top_k is not zero, only the top_k particles having the largest weights are encoded.
+     */
+    static void encode
+    (
+        const Eigen::Ref<const Eigen::MatrixXd>& states,
+        const Eigen::Ref<const Eigen::VectorXd>& log_weights,
+        const Eigen::Ref<const Eigen::VectorXd>& estimate,
+        const std::size_t angular_offset,
+        const std::size_t top_k,
+        yarp::os::Bottle& message
+    );
+
+    /**
+     * Return the states, as columns of a matrix, and the log weights.
+     */
+    static std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXd> decode(const yarp::os::Bottle& message);
+};
+
+#endif /* PARTICLECLOUDCODEC_H */
@@ -15,7 +15,6 @@
 #include <BayesFilters/StateModel.h>
 
 #include <Correction.h>
-#include <ProximityLikelihood.h>
 
 #include <functional>
 #include <memory>
@@ -25,9 +24,9 @@
 class ParticlesCorrection : public bfl::PFCorrection
 {
 public:
-    ParticlesCorrection(std::unique_ptr<Correction> gaussian_correction, std::unique_ptr<ProximityLikelihood> likihood_model/*, std::unique_ptr<bfl::StateModel> state_model*/) noexcept;
+    ParticlesCorrection(std::unique_ptr<Correction> gaussian_correction, std::unique_ptr<bfl::LikelihoodModel> likelihood_model/*, std::unique_ptr<bfl::StateModel> state_model*/) noexcept;
 
-    ParticlesCorrection(std::unique_ptr<Correction> gaussian_correction, std::unique_ptr<ProximityLikelihood> likelihood_model/*, std::unique_ptr<bfl::StateModel> state_model*/, unsigned int seed) noexcept;
+    ParticlesCorrection(std::unique_ptr<Correction> gaussian_correction, std::unique_ptr<bfl::LikelihoodModel> likelihood_model/*, std::unique_ptr<bfl::StateModel> state_model*/, unsigned int seed) noexcept;
 
     ParticlesCorrection(ParticlesCorrection&& particles_correction) noexcept;
 
@@ -54,7 +53,7 @@ protected:
 
     std::unique_ptr<Correction> gaussian_correction_;
 
-    std::unique_ptr<ProximityLikelihood> likelihood_model_;
+    std::unique_ptr<bfl::LikelihoodModel> likelihood_model_;
 
     /**
      * The state model is required to evaluate the Markov transition probability
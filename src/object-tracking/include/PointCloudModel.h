@@ -10,6 +10,7 @@
 
 #include <BayesFilters/AdditiveMeasurementModel.h>
 
+#include <BinaryLogger.h>
 #include <PointCloudPrediction.h>
 
 #include <Eigen/Dense>
@@ -17,7 +18,8 @@
 #include <memory>
 
 
-class PointCloudModel : public bfl::AdditiveMeasurementModel
+class PointCloudModel : public bfl::AdditiveMeasurementModel,
+                        public BinaryLogger
 {
 public:
     PointCloudModel(std::unique_ptr<PointCloudPrediction> prediction, const Eigen::Ref<const Eigen::Matrix3d>& noise_covariance_matrix, const Eigen::Ref<const Eigen::Matrix3d>& tactile_noise_covariance_matrix);
@@ -30,6 +32,12 @@ public:
 
     std::pair<bool, Eigen::MatrixXd> getTactileNoiseCovarianceMatrix() const;
 
+    /**
+     * Get the number of points, within the measurement, that have been obtained from vision.
+     * Unless overridden, all the points are assumed to come from vision.
+     */
+    virtual int getVisualPointCloudSize();
+
 protected:
     std::unique_ptr<PointCloudPrediction> prediction_;
 
@@ -41,6 +49,11 @@ protected:
     {
         return {prefix_path + "/" + prefix_name + "_measurements"};
     }
+
+    std::vector<std::string> binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name) override
+    {
+        return log_file_names(prefix_path, prefix_name);
+    }
 };
 
 #endif /* POINTCLOUDMODEL_H */
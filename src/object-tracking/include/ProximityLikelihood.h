@@ -17,7 +17,7 @@
 
 #include <memory>
 
-class ProximityLikelihood : bfl::LikelihoodModel
+class ProximityLikelihood : public bfl::LikelihoodModel
 {
 public:
     ProximityLikelihood(const double noise_variance, std::unique_ptr<NanoflannPointCloudPrediction> squared_distance_estimator_);
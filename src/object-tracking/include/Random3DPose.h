@@ -10,8 +10,10 @@
 
 #include <BayesFilters/StateModel.h>
 
-#include <functional>
+#include <Eigen/Dense>
+
 #include <random>
+#include <vector>
 
 
 class Random3DPose : public bfl::StateModel
@@ -85,13 +87,21 @@ protected:
     Eigen::Matrix3d sqrt_Q_ang_;
 
     /**
-     * A call to `gauss_rnd_sample_()` returns i.i.d normal univariates.
+     * Independent random number generators, one per lane.
+     * The i-th lane draws the noise for a contiguous chunk of the states, hence
+     * the samples do not depend on the number of threads used to generate them.
      */
-    std::function<double()> gauss_rnd_sample_;
+    const std::size_t number_lanes_ = 8;
+
+    std::vector<std::mt19937_64> generators_;
 
-    std::mt19937_64 generator_;
+    std::vector<std::normal_distribution<double>> distributions_;
 
-    std::normal_distribution<double> distribution_;
+    /**
+     * Structure of arrays storage of the quaternions and of the angular velocities used in propagate().
+     * Each column contains one of the components for all the states.
+     */
+    Eigen::ArrayXXd soa_;
 };
 
 #endif /* RANDOM3DPOSE_H */
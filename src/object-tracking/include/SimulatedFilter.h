@@ -8,6 +8,7 @@
 #ifndef SIMULATEDFILTER_H
 #define SIMULATEDFILTER_H
 
+#include <BinaryLogger.h>
 #include <Correction.h>
 
 #include <BayesFilters/Gaussian.h>
@@ -15,9 +16,13 @@
 #include <GaussianFilter_.h>
 #include <BayesFilters/GaussianPrediction.h>
 
+#include <Eigen/Dense>
+
 #include <memory>
+#include <vector>
 
-class SimulatedFilter : public bfl::GaussianFilter_
+class SimulatedFilter : public bfl::GaussianFilter_,
+                        public BinaryLogger
 {
 public:
     SimulatedFilter
@@ -30,17 +35,47 @@ public:
 
     virtual ~SimulatedFilter();
 
+    /**
+     * Corrected mean and duration in seconds of each step executed so far.
+     */
+    const std::vector<Eigen::VectorXd>& getEstimates() const;
+
+    const std::vector<double>& getStepDurations() const;
+
+    /**
+     * Enable or disable the printout of the duration of each step (enabled by default).
+     */
+    void setVerbose(const bool verbose);
+
+    /**
+     * Number of OpenMP threads used by the steps (0, the default, leaves the OpenMP default unchanged).
+     * It is applied within the thread running the filter.
+     */
+    void setNumberOfThreads(const std::size_t number_of_threads);
+
 protected:
+    bool initialization() override;
+
     bool runCondition() override;
 
     std::vector<std::string> log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
 
+    std::vector<std::string> binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
+
     void filteringStep() override;
 
     void log() override;
 
+    std::vector<Eigen::VectorXd> estimates_;
+
+    std::vector<double> step_durations_;
+
 private:
     unsigned int simulation_steps_;
+
+    bool verbose_;
+
+    std::size_t number_of_threads_;
 };
 
 #endif /* SIMULATEDFILTER_H */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef SIMULATEDPFILTER_H
+#define SIMULATEDPFILTER_H
+
+#include <BayesFilters/EstimatesExtraction.h>
+#include <BayesFilters/ParticleSetInitialization.h>
+#include <BayesFilters/PFPrediction.h>
+#include <BayesFilters/Resampling.h>
+#include <BayesFilters/SIS.h>
+
+#include <BinaryLogger.h>
+#include <ParticlesCorrection.h>
+
+#include <Eigen/Dense>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Headless counterpart of PFilter running the UPF on simulated measurements.
+ *
+ * No bounding box estimation and no network communication take place.
+ * At the end of the simulation, per-step latency percentiles, processed particles per second
+ * and point queries per second, i.e. particles times measured points, are reported.
+ */
+class SimulatedPFilter : public bfl::SIS,
+                         public BinaryLogger
+{
+public:
+    SimulatedPFilter
+    (
+        const std::size_t num_particle,
+        const double resampling_threshold,
+        const std::string point_estimate_method,
+        const std::size_t point_estimate_window_size,
+        std::unique_ptr<bfl::ParticleSetInitialization> initialization,
+        std::unique_ptr<bfl::PFPrediction> prediction,
+        std::unique_ptr<ParticlesCorrection> correction,
+        std::unique_ptr<bfl::Resampling> resampling,
+        unsigned int simulation_steps
+    );
+
+    virtual ~SimulatedPFilter();
+
+    bool set_point_estimate_method(const std::string& method);
+
+    /**
+     * Print the statistics of the steps executed so far.
+     */
+    void printStatistics();
+
+    /**
+     * Point estimate and duration in seconds of each step executed so far.
+     * Steps where the point estimate could not be extracted are represented with NaNs.
+     */
+    const std::vector<Eigen::VectorXd>& getEstimates() const;
+
+    const std::vector<double>& getStepDurations() const;
+
+    /**
+     * Enable or disable the printout of the statistics at the end of the simulation (enabled by default).
+     */
+    void setVerbose(const bool verbose);
+
+    /**
+     * Number of OpenMP threads used by the steps (0, the default, leaves the OpenMP default unchanged).
+     * It is applied within the thread running the filter.
+     */
+    void setNumberOfThreads(const std::size_t number_of_threads);
+
+protected:
+    bool initialization() override;
+
+    bool runCondition() override;
+
+    std::vector<std::string> log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
+
+    std::vector<std::string> binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name) override;
+
+    void filteringStep() override;
+
+    void log() override;
+
+    bfl::EstimatesExtraction point_estimate_extraction_;
+
+    Eigen::VectorXd point_estimate_;
+
+    double resampling_threshold_;
+
+    unsigned int simulation_steps_;
+
+    /**
+     * Duration of each step in seconds and number of measured points processed in each step.
+     */
+    std::vector<double> step_durations_;
+
+    std::vector<std::size_t> step_points_;
+
+    std::vector<Eigen::VectorXd> estimates_;
+
+    bool verbose_;
+
+    std::size_t number_of_threads_;
+
+private:
+    const std::string log_ID_ = "[SimulatedPFilter]";
+};
+
+#endif /* SIMULATEDPFILTER_H */
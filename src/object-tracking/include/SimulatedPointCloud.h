@@ -18,6 +18,7 @@
 
 #include <random>
 #include <unordered_map>
+#include <vector>
 
 
 class SimulatedPointCloud : public PointCloudModel, MeshImporter
@@ -58,10 +59,31 @@ public:
 
     Eigen::VectorXd getNoiseSample(const std::size_t number);
 
+    /**
+     * Simulated states, i.e. position, velocity, orientation quaternion (w, x, y, z) and angular velocity,
+     * corresponding to the measurements fetched or prefetched so far.
+     */
+    const std::vector<Eigen::VectorXd>& getGroundTruth() const;
+
 protected:
-    void transformModel(const Eigen::VectorXd& state, simpleTriMesh& transformed);
+    /**
+     * Sample a dense oriented point cloud, expressed in the object frame, from the surface of the mesh.
+     */
+    void sampleDenseCloud(simpleTriMesh& trimesh);
+
+    /**
+     * Sample the point cloud visible from the observer given the object pose `state`.
+     * The dense cloud is transformed, culled by normal and by self-occlusion and then subsampled.
+     */
+    Eigen::VectorXd samplePointCloud(const Eigen::VectorXd& state, std::mt19937_64& generator);
 
-    Eigen::VectorXd samplePointCloud(const Eigen::VectorXd& state);
+    /**
+     * Evaluate which points, among those in `points`, are not occluded by other points
+     * along the rays from the observer.
+     */
+    std::vector<std::size_t> findUnoccludedPoints(const Eigen::Ref<const Eigen::Matrix3Xd>& points, const Eigen::Ref<const Eigen::Vector3d>& center, const std::vector<std::size_t>& candidates);
+
+    Eigen::VectorXd getNoiseSample(const std::size_t number, std::mt19937_64& generator);
 
     bool noisy_;
 
@@ -73,7 +95,19 @@ protected:
 
     Eigen::Matrix3d sqrt_noise_covariance_;
 
-    simpleTriMesh trimesh_;
+    /**
+     * Dense oriented point cloud expressed in the object frame and average spacing between its points.
+     */
+    Eigen::Matrix3Xd dense_points_;
+
+    Eigen::Matrix3Xd dense_normals_;
+
+    double dense_spacing_;
+
+    /**
+     * Ratio between the size of the dense point cloud and the number of points to be sampled.
+     */
+    const std::size_t oversampling_ = 20;
 
     std::unique_ptr<bfl::SimulatedStateModel> simulated_model_;
 
@@ -83,11 +117,11 @@ protected:
 
     std::unordered_map<std::size_t, Eigen::MatrixXd> fetched_measurements_;
 
-    std::mt19937_64 generator_;
+    std::vector<Eigen::VectorXd> ground_truth_;
 
-    std::normal_distribution<float> distribution_;
+    unsigned int seed_;
 
-    std::function<float()> gauss_rnd_sample_;
+    std::mt19937_64 generator_;
 };
 
 #endif /* SIMULATEDPOINTCLOUD_H */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef STAGESTATISTICS_H
+#define STAGESTATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * Histogram of latencies with bounded relative error, in the spirit of HdrHistogram.
+ *
+ * Latencies are stored in microseconds. Values below 2^sub_bucket_bits are counted exactly, larger values are
+ * counted in 2^sub_bucket_bits linear sub-buckets for each power of two, i.e. with a relative error below 1/16.
+ * Recording only requires relaxed atomic increments, hence it is safe and cheap from any thread.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(const std::chrono::steady_clock::duration& latency);
+
+    void reset();
+
+    std::uint64_t count() const;
+
+    /**
+     * Mean and maximum latency, in milliseconds.
+     */
+    double mean() const;
+
+    double max() const;
+
+    /**
+     * Latency, in milliseconds, below which the given percentage of the samples falls.
+     */
+    double percentile(const double percentage) const;
+
+protected:
+    static std::size_t bucketIndex(const std::uint64_t value);
+
+    /**
+     * Middle value, in microseconds, of the given bucket.
+     */
+    static double bucketValue(const std::size_t index);
+
+    static constexpr std::size_t sub_bucket_bits_ = 4;
+
+    static constexpr std::size_t sub_buckets_ = 1 << sub_bucket_bits_;
+
+    /**
+     * Values up to 2^max_bits_ microseconds, i.e. about 19 hours, larger values are saturated.
+     */
+    static constexpr std::size_t max_bits_ = 36;
+
+    static constexpr std::size_t buckets_ = (max_bits_ - sub_bucket_bits_ + 1) * sub_buckets_;
+
+    std::array<std::atomic<std::uint64_t>, buckets_> counts_;
+
+    std::atomic<std::uint64_t> count_;
+
+    std::atomic<std::uint64_t> sum_;
+
+    std::atomic<std::uint64_t> max_;
+};
+
+
+/**
+ * Process-wide latency histograms of the stages of the filtering step.
+ *
+ * Stages are timed where they are implemented, so that also the components shared by other
+ * executables, e.g. object-tracking-batch, are instrumented without changing their interfaces.
+ */
+class StageStatistics
+{
+public:
+    enum class Stage : std::size_t
+    {
+        Step = 0,
+        BoundingBox,
+        Prediction,
+        Correction,
+        MeasurementFreeze,
+        DepthWait,
+        OPCWait,
+        Occlusion,
+        UKFCorrection,
+        Sampling,
+        Likelihood,
+        KdTreeQuery,
+        Resampling,
+        Publication
+    };
+
+    static StageStatistics& instance();
+
+    void record(const Stage stage, const std::chrono::steady_clock::duration& latency);
+
+    void reset();
+
+    /**
+     * Summary of each stage that has been recorded at least once,
+     * as "<stage> count <n> mean <ms> p50 <ms> p90 <ms> p99 <ms> p999 <ms> max <ms>".
+     */
+    std::vector<std::string> summary() const;
+
+protected:
+    StageStatistics();
+
+    static constexpr std::size_t number_stages_ = 14;
+
+    static const std::array<std::string, number_stages_> stage_names_;
+
+    std::array<LatencyHistogram, number_stages_> histograms_;
+};
+
+
+/**
+ * Record the time elapsed between construction and destruction in the histogram of the given stage.
+ */
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(const StageStatistics::Stage stage);
+
+    ~ScopedStageTimer();
+
+private:
+    const StageStatistics::Stage stage_;
+
+    const std::chrono::steady_clock::time_point start_;
+};
+
+#endif /* STAGESTATISTICS_H */
@@ -12,6 +12,9 @@
 
 #include <Eigen/Dense>
 
+#include <DebugPublisher.h>
+#include <DepthImageModel.h>
+#include <DepthSharedMemory.h>
 #include <GazeController.h>
 #include <iCubHandContactsModel.h>
 #include <ObjectOcclusion.h>
@@ -20,8 +23,10 @@
 
 #include <opencv2/opencv.hpp>
 
+#include <yarp/os/BufferedPort.h>
 #include <yarp/os/Mutex.h>
 #include <yarp/sig/Image.h>
+#include <yarp/sig/Vector.h>
 
 #include <string>
 #include <memory>
@@ -30,7 +35,7 @@
 class iCubPointCloudExogenousData;
 
 
-class iCubPointCloud : public PointCloudModel
+class iCubPointCloud : public PointCloudModel, public DepthImageModel
 {
 public:
     iCubPointCloud
@@ -41,10 +46,15 @@ public:
         const std::string port_prefix,
         const std::string eye_name,
         const std::string depth_fetch_mode,
+        const std::string depth_shared_memory_port,
+        const double depth_shared_memory_timeout,
         const double point_cloud_outlier_threshold,
         const std::size_t point_cloud_u_stride,
         const std::size_t point_cloud_v_stride,
         const bool send_hull,
+        const bool send_depth_roi,
+        const int depth_roi_margin,
+        const double depth_roi_depth_margin,
         std::shared_ptr<iCubPointCloudExogenousData> exogenous_data
     );
 
@@ -62,7 +72,9 @@ public:
 
     void addObjectContacts(std::unique_ptr<iCubHandContactsModel> object_contacts);
 
-    int getVisualPointCloudSize();
+    int getVisualPointCloudSize() override;
+
+    std::tuple<bool, DepthROI> getDepthROI() const override;
 
 protected:
     /**
@@ -83,14 +95,26 @@ protected:
     bool getDepth();
 
     /**
-     * Evaluate the point cloud starting from the depth image.
+     * Retrieve the depth image from the shared memory ring of the depth module, if it runs on the same host.
+     * Return false if the ring is not available, in which case the depth has to be received from the port.
      */
-    std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> get3DPoints(std::vector<std::pair<int, int>>& coordinates_2d, const float z_threshold = 1.0);
+    bool getSharedDepth(const std::string& mode, bool& received);
+
+    /**
+     * Depth image currently in use, either the local copy or the one within the shared memory ring.
+     */
+    const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depthImage() const;
+
+    /**
+     * Ask the depth module to evaluate the depth only within the bounding box, enlarged by depth_roi_margin_ pixels,
+     * and, if the position of the object is known, within depth_roi_depth_margin_ meters from the object.
+     */
+    void sendDepthROI(const Eigen::Ref<const Eigen::VectorXd>& bounding_box);
 
     /**
-     * Draw the region of interest used to obtain the 3D point cloud.
+     * Evaluate the point cloud starting from the depth image.
      */
-    void drawObjectROI(cv::Mat& image);
+    std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> get3DPoints(std::vector<std::pair<int, int>>& coordinates_2d, const float z_threshold = 1.0);
 
     /**
      * Default deprojection matrix.
@@ -104,6 +128,21 @@ protected:
     bool depth_initialized_ = false;
     std::string depth_fetch_mode_;
 
+    /**
+     * Reader of the shared memory ring of the depth module and depth image pinned within it, used in place.
+     */
+    std::unique_ptr<DepthSharedMemoryReader> depth_shared_memory_;
+    yarp::sig::ImageOf<yarp::sig::PixelFloat> depth_shared_image_;
+    bool depth_from_shared_memory_ = false;
+    std::uint64_t depth_shared_sequence_ = 0;
+
+    /**
+     * Camera pose associated to the last depth image.
+     */
+    Eigen::VectorXd camera_position_;
+    Eigen::VectorXd camera_orientation_;
+    bool camera_pose_set_ = false;
+
     /**
      * Local copy of measurements.
      * A vector of size 3 * L with L the number of points in the point cloud.
@@ -161,10 +200,21 @@ protected:
      * Image input/output.
      */
     yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelFloat>> port_depth_in_;
-    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_image_in_;
-    yarp::os::BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb>> port_hull_image_out_;
     bool send_hull_;
 
+    /**
+     * Region of interest requested to the depth module.
+     */
+    yarp::os::BufferedPort<yarp::sig::Vector> port_depth_roi_out_;
+    bool send_depth_roi_;
+    int depth_roi_margin_;
+    double depth_roi_depth_margin_;
+
+    /**
+     * Publisher of the camera image with the occlusion hulls and the region of interest used to obtain the 3D point cloud.
+     */
+    std::unique_ptr<DebugPublisher> hull_publisher_;
+
     /**
      * Exogenous data used by this class.
      */
@@ -220,6 +270,16 @@ public:
      */
     bool getUseContacts();
 
+    /**
+     * Set the position of the object as estimated by the filter.
+     */
+    void setObjectPosition(const Eigen::Ref<const Eigen::Vector3d>& position);
+
+    /**
+     * Get the position of the object as estimated by the filter.
+     */
+    std::pair<bool, Eigen::Vector3d> getObjectPosition();
+
     /**
      * Reset
      */
@@ -236,6 +296,10 @@ protected:
 
     bool use_contacts_;
 
+    Eigen::Vector3d object_position_;
+
+    bool object_position_set_;
+
     yarp::os::Mutex lock_;
 };
 
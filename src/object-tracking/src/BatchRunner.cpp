@@ -0,0 +1,467 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <BatchRunner.h>
+#include <Correction.h>
+#include <DiscretizedKinematicModel.h>
+#include <InitParticles.h>
+#include <KinematicModelPrediction.h>
+#include <NanoflannPointCloudPrediction.h>
+#include <ParticlesCorrection.h>
+#include <ProximityLikelihood.h>
+#include <Random3DPose.h>
+#include <SimulatedFilter.h>
+#include <SimulatedPFilter.h>
+#include <SimulatedPointCloud.h>
+#include <VCGTriMesh.h>
+
+#include <BayesFilters/Gaussian.h>
+#include <BayesFilters/GPFPrediction.h>
+#include <BayesFilters/Resampling.h>
+#include <BayesFilters/SimulatedStateModel.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace bfl;
+using namespace Eigen;
+
+
+namespace
+{
+    /**
+     * Nearest-rank percentile of sorted values.
+     */
+    double percentile(const std::vector<double>& sorted_values, const double p)
+    {
+        if (sorted_values.size() == 0)
+            return std::numeric_limits<double>::quiet_NaN();
+
+        std::size_t index = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted_values.size()));
+        index = std::min(std::max(index, std::size_t(1)), sorted_values.size());
+
+        return sorted_values[index - 1];
+    }
+
+
+    std::pair<double, double> meanAndStd(const std::vector<double>& values)
+    {
+        if (values.size() == 0)
+            return std::make_pair(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
+
+        const double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+
+        double variance = 0.0;
+        for (const double value : values)
+            variance += (value - mean) * (value - mean);
+        variance /= values.size();
+
+        return std::make_pair(mean, std::sqrt(variance));
+    }
+}
+
+
+BatchRunner::BatchRunner(const std::size_t number_of_threads, const std::size_t threads_per_trial, const std::size_t skip_steps) :
+    number_of_threads_(std::max(number_of_threads, std::size_t(1))),
+    threads_per_trial_(std::max(threads_per_trial, std::size_t(1))),
+    skip_steps_(skip_steps),
+    next_trial_(0),
+    completed_trials_(0)
+{ }
+
+
+BatchRunner::~BatchRunner()
+{ }
+
+
+void BatchRunner::addTrial(const std::string& description, const TrialParameters& parameters, const unsigned int seed)
+{
+    auto combination = std::find(combinations_.begin(), combinations_.end(), description);
+    if (combination == combinations_.end())
+        combination = combinations_.insert(combinations_.end(), description);
+
+    trials_.push_back({static_cast<std::size_t>(combination - combinations_.begin()), seed, parameters});
+}
+
+
+void BatchRunner::run()
+{
+    results_.clear();
+    results_.resize(trials_.size());
+    next_trial_ = 0;
+    completed_trials_ = 0;
+
+    std::cout << log_ID_ << " Running " << trials_.size() << " trials on " << number_of_threads_ << " threads..." << std::endl;
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < number_of_threads_; i++)
+        workers.emplace_back(&BatchRunner::worker, this);
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+
+void BatchRunner::worker()
+{
+    std::size_t index;
+    while ((index = next_trial_++) < trials_.size())
+    {
+        results_[index] = runTrial(trials_[index]);
+
+        std::size_t completed = ++completed_trials_;
+
+        std::lock_guard<std::mutex> lock(print_mutex_);
+
+        std::cout << log_ID_ << " [" << completed << "/" << trials_.size() << "] "
+                  << combinations_[trials_[index].combination] << " seed " << trials_[index].seed;
+        if (results_[index].valid)
+            std::cout << " position RMSE " << results_[index].position_rmse
+                      << " orientation RMSE " << results_[index].orientation_rmse << std::endl;
+        else
+            std::cout << " failed: " << results_[index].error << std::endl;
+    }
+}
+
+
+BatchRunner::TrialResult BatchRunner::runTrial(const Trial& trial)
+{
+    const TrialParameters& p = trial.parameters;
+
+    TrialResult result;
+
+#ifdef _OPENMP
+    /* Trials already run concurrently, hence limit the number of threads used within each trial,
+       i.e. by the simulation running on this thread and by the filter running on its own thread. */
+    omp_set_num_threads(threads_per_trial_);
+#endif
+
+    /* Seeds of the components of the trial, all derived from the seed of the trial. */
+    std::seed_seq seed_sequence{trial.seed};
+    std::vector<unsigned int> seeds(6);
+    seed_sequence.generate(seeds.begin(), seeds.end());
+
+    const std::size_t simulation_steps = p.sim_duration / p.sim_sample_time;
+
+    try
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        /* Simulated trajectory. */
+        VectorXd state_0(3 + 3 + 4 + 3);
+        state_0.head(3) = p.sim_x_0;
+        state_0.segment(3, 3) = p.sim_v_0;
+        state_0.segment(6, 4) = p.sim_q_0;
+        state_0.tail(3) = p.sim_w_0;
+
+        std::unique_ptr<StateModel> rand_pose(
+            new Random3DPose(p.sim_sample_time,
+                             p.sim_psd_acc(0), p.sim_psd_acc(1), p.sim_psd_acc(2),
+                             p.sim_psd_w(0), p.sim_psd_w(1), p.sim_psd_w(2),
+                             seeds[0]));
+
+        std::unique_ptr<SimulatedStateModel> sim_rand_pose(
+            new SimulatedStateModel(std::move(rand_pose), state_0, simulation_steps));
+
+        /* Object models. */
+        MatrixXd noise_covariance_diagonal = p.noise_covariance.asDiagonal();
+
+        std::unique_ptr<SimulatedPointCloud> pc_simulation;
+        std::unique_ptr<NanoflannPointCloudPrediction> distances_approximation;
+        {
+            std::lock_guard<std::mutex> lock(mesh_sampling_mutex_);
+
+            triMeshSurfSampler::SamplingRandomGenerator().initialize(seeds[1]);
+
+            std::unique_ptr<PointCloudPrediction> pc_prediction(
+                new NanoflannPointCloudPrediction(p.object_mesh_path_ply, p.pc_pred_num_samples));
+
+            pc_simulation = std::unique_ptr<SimulatedPointCloud>(
+                new SimulatedPointCloud(p.object_mesh_path_ply,
+                                        std::move(pc_prediction),
+                                        std::move(sim_rand_pose),
+                                        noise_covariance_diagonal,
+                                        p.sim_point_cloud_observer,
+                                        p.sim_point_cloud_number,
+                                        p.sim_point_cloud_back_culling,
+                                        seeds[2]));
+
+            if (p.filter_type == "upf")
+                distances_approximation = std::unique_ptr<NanoflannPointCloudPrediction>(
+                    new NanoflannPointCloudPrediction(p.object_mesh_path_ply, p.pc_pred_num_samples));
+        }
+
+        pc_simulation->enableNoise(p.sim_point_cloud_noise_std(0),
+                                   p.sim_point_cloud_noise_std(1),
+                                   p.sim_point_cloud_noise_std(2));
+        pc_simulation->prefetchMeasurements(simulation_steps);
+
+        /* The point cloud is owned by the filter, which outlives this reference. */
+        const SimulatedPointCloud& simulated_cloud = *pc_simulation;
+
+        /* Kinematic model using the sampling time of the simulation. */
+        std::unique_ptr<LinearStateModel> kinematic_model(
+            new DiscretizedKinematicModel(p.kin_q_x(0), p.kin_q_x(1), p.kin_q_x(2),
+                                          p.kin_q_eul(0), p.kin_q_eul(1), p.kin_q_eul(2),
+                                          p.sim_sample_time));
+
+        std::size_t dim_linear;
+        std::size_t dim_circular;
+        std::tie(dim_linear, dim_circular) = kinematic_model->getOutputSize();
+
+        VectorXd initial_covariance(12);
+        initial_covariance.head<3>() = p.cov_x_0;
+        initial_covariance.segment<3>(3) = p.cov_v_0;
+        initial_covariance.segment<3>(6) = p.cov_eul_dot_0;
+        initial_covariance.tail<3>() = p.cov_eul_0;
+
+        std::unique_ptr<GaussianPrediction> prediction(new KinematicModelPrediction(std::move(kinematic_model)));
+
+        std::unique_ptr<Correction> correction(
+            new Correction(std::move(pc_simulation),
+                           dim_linear + dim_circular,
+                           p.ut_alpha, p.ut_beta, p.ut_kappa,
+                           3));
+
+        if (p.filter_type == "ukf")
+        {
+            VectorXd initial_mean(12);
+            initial_mean.head<3>() = p.x_0;
+            initial_mean.segment<3>(3) = p.v_0;
+            initial_mean.segment<3>(6) = p.euler_dot_0;
+            initial_mean.tail<3>() = p.euler_0;
+
+            Gaussian initial_state(dim_linear, dim_circular);
+            initial_state.mean() = initial_mean;
+            initial_state.covariance() = initial_covariance.asDiagonal();
+
+            SimulatedFilter filter(initial_state, std::move(prediction), std::move(correction), simulation_steps);
+            filter.setVerbose(false);
+            filter.setNumberOfThreads(threads_per_trial_);
+
+            filter.boot();
+            filter.run();
+            if (!filter.wait())
+                throw(std::runtime_error("BATCHRUNNER::RUNTRIAL::ERROR\n\tError: the filter did not terminate correctly."));
+
+            evaluateErrors(filter.getEstimates(), simulated_cloud.getGroundTruth(), result);
+            result.step_durations = filter.getStepDurations();
+        }
+        else if (p.filter_type == "upf")
+        {
+            MatrixXd covariance_0 = initial_covariance.asDiagonal();
+            std::unique_ptr<InitParticles> pf_initialization(new InitParticles(seeds[3], p.center_0, p.radius_0, covariance_0));
+
+            std::unique_ptr<GPFPrediction> pf_prediction(new GPFPrediction(std::move(prediction)));
+
+            std::unique_ptr<LikelihoodModel> likelihood(
+                new ProximityLikelihood(p.likelihood_variance, std::move(distances_approximation)));
+
+            std::unique_ptr<ParticlesCorrection> pf_correction(
+                new ParticlesCorrection(std::move(correction), std::move(likelihood), seeds[4]));
+
+            std::unique_ptr<Resampling> pf_resampling(new Resampling(seeds[5]));
+
+            SimulatedPFilter filter(p.number_particles,
+                                    p.resampling_threshold,
+                                    p.point_estimate_method,
+                                    p.point_estimate_window_size,
+                                    std::move(pf_initialization),
+                                    std::move(pf_prediction),
+                                    std::move(pf_correction),
+                                    std::move(pf_resampling),
+                                    simulation_steps);
+            filter.setVerbose(false);
+            filter.setNumberOfThreads(threads_per_trial_);
+
+            filter.boot();
+            filter.run();
+            if (!filter.wait())
+                throw(std::runtime_error("BATCHRUNNER::RUNTRIAL::ERROR\n\tError: the filter did not terminate correctly."));
+
+            evaluateErrors(filter.getEstimates(), simulated_cloud.getGroundTruth(), result);
+            result.step_durations = filter.getStepDurations();
+        }
+        else
+            throw(std::runtime_error("BATCHRUNNER::RUNTRIAL::ERROR\n\tError: unknown filter type " + p.filter_type + "."));
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        result.duration = std::chrono::duration<double>(end - start).count();
+    }
+    catch (const std::exception& exception)
+    {
+        result.valid = false;
+        result.error = exception.what();
+    }
+
+    return result;
+}
+
+
+void BatchRunner::evaluateErrors(const std::vector<VectorXd>& estimates, const std::vector<VectorXd>& ground_truth, TrialResult& result) const
+{
+    const std::size_t number_of_steps = std::min(estimates.size(), ground_truth.size());
+
+    double squared_position_error = 0.0;
+    double squared_orientation_error = 0.0;
+    std::size_t valid_steps = 0;
+
+    result.invalid_estimates = 0;
+
+    for (std::size_t i = skip_steps_; i < number_of_steps; i++)
+    {
+        const VectorXd& estimate = estimates[i];
+        const VectorXd& state = ground_truth[i];
+
+        if (!estimate.allFinite())
+        {
+            result.invalid_estimates++;
+
+            continue;
+        }
+
+        squared_position_error += (estimate.head<3>() - state.head<3>()).squaredNorm();
+
+        /* The estimate uses ZYX Euler angles, the simulated state a quaternion (w, x, y, z). */
+        const Matrix3d estimated_rotation = (AngleAxisd(estimate(9), Vector3d::UnitZ()) *
+                                             AngleAxisd(estimate(10), Vector3d::UnitY()) *
+                                             AngleAxisd(estimate(11), Vector3d::UnitX())).toRotationMatrix();
+        const Matrix3d rotation = Quaterniond(state(6), state(7), state(8), state(9)).normalized().toRotationMatrix();
+
+        const double angle = AngleAxisd(estimated_rotation.transpose() * rotation).angle();
+        squared_orientation_error += angle * angle;
+
+        valid_steps++;
+    }
+
+    if (valid_steps == 0)
+    {
+        result.valid = false;
+        result.error = "no valid estimates";
+
+        return;
+    }
+
+    result.valid = true;
+    result.position_rmse = std::sqrt(squared_position_error / valid_steps);
+    result.orientation_rmse = std::sqrt(squared_orientation_error / valid_steps);
+}
+
+
+bool BatchRunner::writeSummary(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << log_ID_ << " Cannot open summary file " << path << std::endl;
+
+        return false;
+    }
+
+    file << "combination,trials,failed,"
+         << "position_rmse_mean,position_rmse_std,orientation_rmse_mean,orientation_rmse_std,"
+         << "latency_p50_ms,latency_p90_ms,latency_p99_ms,latency_max_ms,steps_per_second" << std::endl;
+
+    for (std::size_t c = 0; c < combinations_.size(); c++)
+    {
+        std::size_t number_of_trials = 0;
+        std::size_t failed_trials = 0;
+        std::vector<double> position_rmse;
+        std::vector<double> orientation_rmse;
+        std::vector<double> durations;
+
+        for (std::size_t i = 0; i < trials_.size(); i++)
+        {
+            if (trials_[i].combination != c)
+                continue;
+
+            number_of_trials++;
+
+            if (!results_[i].valid)
+            {
+                failed_trials++;
+
+                continue;
+            }
+
+            position_rmse.push_back(results_[i].position_rmse);
+            orientation_rmse.push_back(results_[i].orientation_rmse);
+            durations.insert(durations.end(), results_[i].step_durations.begin(), results_[i].step_durations.end());
+        }
+
+        std::sort(durations.begin(), durations.end());
+
+        const std::pair<double, double> position = meanAndStd(position_rmse);
+        const std::pair<double, double> orientation = meanAndStd(orientation_rmse);
+        const double total_duration = std::accumulate(durations.begin(), durations.end(), 0.0);
+
+        file << "\"" << combinations_[c] << "\","
+             << number_of_trials << ","
+             << failed_trials << ","
+             << position.first << "," << position.second << ","
+             << orientation.first << "," << orientation.second << ","
+             << percentile(durations, 50) * 1000.0 << ","
+             << percentile(durations, 90) * 1000.0 << ","
+             << percentile(durations, 99) * 1000.0 << ","
+             << percentile(durations, 100) * 1000.0 << ","
+             << ((total_duration > 0.0) ? durations.size() / total_duration : 0.0) << std::endl;
+    }
+
+    return true;
+}
+
+
+bool BatchRunner::writeTrials(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << log_ID_ << " Cannot open trials file " << path << std::endl;
+
+        return false;
+    }
+
+    file << "combination,seed,valid,position_rmse,orientation_rmse,invalid_estimates,latency_p50_ms,latency_p99_ms,duration_s" << std::endl;
+
+    for (std::size_t i = 0; i < trials_.size(); i++)
+    {
+        const TrialResult& result = results_[i];
+
+        file << "\"" << combinations_[trials_[i].combination] << "\","
+             << trials_[i].seed << ","
+             << result.valid << ",";
+
+        if (result.valid)
+        {
+            std::vector<double> durations(result.step_durations);
+            std::sort(durations.begin(), durations.end());
+
+            file << result.position_rmse << ","
+                 << result.orientation_rmse << ","
+                 << result.invalid_estimates << ","
+                 << percentile(durations, 50) * 1000.0 << ","
+                 << percentile(durations, 99) * 1000.0 << ","
+                 << result.duration << std::endl;
+        }
+        else
+            file << ",,,,," << std::endl;
+    }
+
+    return true;
+}
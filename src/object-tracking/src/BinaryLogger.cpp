@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <BinaryLogger.h>
+
+#include <yarp/os/LogStream.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace Eigen;
+
+
+namespace
+{
+    const char binary_log_magic[8] = {'O', 'T', 'B', 'L', 'O', 'G', '0', '1'};
+
+    std::size_t nextPowerOfTwo(const std::size_t value)
+    {
+        std::size_t power = 1;
+        while (power < value)
+            power <<= 1;
+
+        return power;
+    }
+}
+
+
+BinaryLog::BinaryLog(const std::string& file_name, const std::size_t buffer_size, const bool compress) :
+    file_name_(file_name),
+    compress_(compress),
+    file_(nullptr),
+    buffer_(nextPowerOfTwo(buffer_size)),
+    head_(0),
+    tail_(0),
+    mask_(buffer_.size() - 1),
+    block_size_(std::min(buffer_.size() / 4, std::size_t(1024 * 1024))),
+    running_(true),
+    dropped_(0)
+{
+#ifndef HAS_ZLIB
+    if (compress_)
+    {
+        yWarning() << log_ID_ << "Compression is not available, writing" << file_name_ << "uncompressed.";
+        compress_ = false;
+    }
+#endif
+
+    if (compress_)
+    {
+#ifdef HAS_ZLIB
+        file_name_ += ".bin.gz";
+
+        gzFile file = gzopen(file_name_.c_str(), "wb1");
+        if (file != nullptr)
+            gzbuffer(file, block_size_);
+
+        file_ = file;
+#endif
+    }
+    else
+    {
+        file_name_ += ".bin";
+
+        file_ = std::fopen(file_name_.c_str(), "wb");
+    }
+
+    if (file_ == nullptr)
+        throw(std::runtime_error("BINARYLOG::CTOR::ERROR\n\tError: cannot open file " + file_name_ + "."));
+
+    writeFile(binary_log_magic, sizeof(binary_log_magic));
+
+    writer_ = std::thread(&BinaryLog::flushLoop, this);
+}
+
+
+BinaryLog::~BinaryLog()
+{
+    running_ = false;
+    writer_.join();
+
+    /* Records written after the last iteration of the writer thread. */
+    flush();
+
+#ifdef HAS_ZLIB
+    if (compress_)
+        gzclose(static_cast<gzFile>(file_));
+    else
+#endif
+        std::fclose(static_cast<FILE*>(file_));
+
+    if (dropped_ > 0)
+        yWarning() << log_ID_ << dropped_ << "records have been dropped from" << file_name_ << ", consider increasing the buffer size.";
+}
+
+
+bool BinaryLog::write(const Ref<const MatrixXd>& data)
+{
+    const std::uint32_t rows = data.rows();
+    const std::uint32_t cols = data.cols();
+    const double time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    const std::size_t data_size = sizeof(double) * data.size();
+    const std::size_t record_size = 2 * sizeof(std::uint32_t) + sizeof(double) + data_size;
+
+    const std::uint64_t head = head_.load(std::memory_order_relaxed);
+    const std::uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (buffer_.size() - (head - tail) < record_size)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+
+        return false;
+    }
+
+    /* Copy, possibly wrapping around the end of the buffer. */
+    std::uint64_t position = head;
+    auto copy = [this, &position](const void* source, const std::size_t size)
+    {
+        const std::size_t offset = position & mask_;
+        const std::size_t first = std::min(size, buffer_.size() - offset);
+
+        std::memcpy(buffer_.data() + offset, source, first);
+        std::memcpy(buffer_.data(), static_cast<const char*>(source) + first, size - first);
+
+        position += size;
+    };
+
+    copy(&rows, sizeof(rows));
+    copy(&cols, sizeof(cols));
+    copy(&time, sizeof(time));
+
+    /* Data is contiguous unless it is a block of a larger matrix. */
+    if (data.outerStride() == data.rows())
+        copy(data.data(), data_size);
+    else
+    {
+        for (std::size_t j = 0; j < cols; j++)
+            copy(data.col(j).data(), sizeof(double) * rows);
+    }
+
+    head_.store(position, std::memory_order_release);
+
+    return true;
+}
+
+
+std::size_t BinaryLog::getDroppedRecords() const
+{
+    return dropped_;
+}
+
+
+const std::string& BinaryLog::getFileName() const
+{
+    return file_name_;
+}
+
+
+void BinaryLog::flushLoop()
+{
+    const std::chrono::milliseconds period(10);
+    const std::size_t periods_per_flush = 50;
+
+    std::size_t periods = 0;
+    while (running_)
+    {
+        std::this_thread::sleep_for(period);
+        periods++;
+
+        const std::uint64_t available = head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+        if ((available >= block_size_) || ((available > 0) && (periods >= periods_per_flush)))
+        {
+            flush();
+
+            periods = 0;
+        }
+    }
+}
+
+
+void BinaryLog::flush()
+{
+    const std::uint64_t head = head_.load(std::memory_order_acquire);
+    const std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (head == tail)
+        return;
+
+    const std::size_t size = head - tail;
+    const std::size_t offset = tail & mask_;
+    const std::size_t first = std::min(size, buffer_.size() - offset);
+
+    writeFile(buffer_.data() + offset, first);
+    if (size > first)
+        writeFile(buffer_.data(), size - first);
+
+    tail_.store(head, std::memory_order_release);
+}
+
+
+void BinaryLog::writeFile(const char* data, const std::size_t size)
+{
+#ifdef HAS_ZLIB
+    if (compress_)
+    {
+        gzwrite(static_cast<gzFile>(file_), data, size);
+
+        return;
+    }
+#endif
+
+    std::fwrite(data, 1, size, static_cast<FILE*>(file_));
+}
+
+
+BinaryLogger::~BinaryLogger()
+{ }
+
+
+bool BinaryLogger::enable_binary_log(const std::string& prefix_path, const std::string& prefix_name, const bool compress, const std::size_t buffer_size)
+{
+    disable_binary_log();
+
+    try
+    {
+        for (const std::string& file_name : binary_log_file_names(prefix_path, prefix_name))
+            binary_logs_.push_back(std::unique_ptr<BinaryLog>(new BinaryLog(file_name, buffer_size, compress)));
+    }
+    catch (const std::runtime_error& error)
+    {
+        yError() << error.what();
+
+        disable_binary_log();
+
+        return false;
+    }
+
+    return true;
+}
+
+
+void BinaryLogger::disable_binary_log()
+{
+    binary_logs_.clear();
+}
+
+
+bool BinaryLogger::is_binary_log_enabled() const
+{
+    return !binary_logs_.empty();
+}
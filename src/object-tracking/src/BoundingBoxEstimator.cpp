@@ -6,8 +6,8 @@
  */
 
 #include <BoundingBoxEstimator.h>
+#include <StageStatistics.h>
 
-#include <yarp/cv/Cv.h>
 #include <yarp/eigen/Eigen.h>
 #include <yarp/sig/Vector.h>
 
@@ -171,11 +171,7 @@ BoundingBoxEstimator::BoundingBoxEstimator
         }
 
         // Open image output port.
-        if(!port_mask_image_out_.open("/" + port_prefix + "/mask:o"))
-        {
-            std::string err = log_ID_ + "CTOR::ERROR\n\tError: cannot open mask output port.";
-            throw(std::runtime_error(err));
-        }
+        mask_publisher_ = std::unique_ptr<DebugPublisher>(new DebugPublisher("/" + port_prefix + "/mask:o"));
     }
 
     // Get iCub cameras intrinsics parameters
@@ -236,7 +232,6 @@ BoundingBoxEstimator::~BoundingBoxEstimator()
     if (send_mask_)
     {
         port_image_in_.close();
-        port_mask_image_out_.close();
     }
 }
 
@@ -540,7 +535,13 @@ std::pair<bool, VectorXd> BoundingBoxEstimator::measure()
     content.addString("==");
     content.addString(IOL_object_name_);
 
-    if(!opc_rpc_client_.write(cmd,reply))
+    bool valid_reply;
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::OPCWait);
+
+        valid_reply = opc_rpc_client_.write(cmd,reply);
+    }
+    if (!valid_reply)
         return std::make_pair(false, VectorXd());
 
     // reply message format: [nack]; [ack] ("id" (<num0> <num1> ...))
@@ -570,7 +571,11 @@ std::pair<bool, VectorXd> BoundingBoxEstimator::measure()
                     Bottle& list_items = list_propSet.addList();
                     list_items.addString("position_2d_left");
                     Bottle reply_prop;
-                    opc_rpc_client_.write(cmd,reply_prop);
+                    {
+                        ScopedStageTimer timer(StageStatistics::Stage::OPCWait);
+
+                        opc_rpc_client_.write(cmd,reply_prop);
+                    }
 
                     //reply message format: [nack]; [ack] (("prop0" <val0>) ("prop1" <val1>) ...)
                     if (reply_prop.get(0).asVocab() == Vocab::encode("ack"))
@@ -609,16 +614,15 @@ std::pair<bool, VectorXd> BoundingBoxEstimator::measure()
 
 void BoundingBoxEstimator::sendObjectMask()
 {
-    // Prepare output image
-    ImageOf<PixelRgb>& image_out_yarp = port_mask_image_out_.prepare();
-    image_out_yarp.resize(object_mask_.cols, object_mask_.rows);
-    cv::Mat image_out = yarp::cv::toCvMat(image_out_yarp);
+    if (!mask_publisher_->hasConnections())
+        return;
 
-    // Copy mask to the output image
-    cv::cvtColor(object_mask_, image_out, CV_GRAY2RGB);
+    // The publisher thread converts the mask to the output image
+    mask_publisher_->setBackgroundMask(object_mask_);
+    mask_publisher_->publish();
 
-    // Send the image
-    port_mask_image_out_.write();
+    // Render the next mask in a new buffer, as the current one now belongs to the publisher
+    object_mask_ = cv::Mat();
 }
 
 
@@ -689,10 +693,6 @@ std::pair<bool, Eigen::MatrixXd> BoundingBoxEstimator::updateObjectBoundingBox()
     // Convert to gray scale
     cv::cvtColor(object_mask_, object_mask_, CV_BGR2GRAY);
 
-    // Send mask for inspection if required
-    if (send_mask_)
-        sendObjectMask();
-
     // Evaluate bounding boxes
     MatrixXd curr_bbox(4, pred_bbox_.components);
     for (std::size_t i = 0; i < pred_bbox_.components; i++)
@@ -717,5 +717,9 @@ std::pair<bool, Eigen::MatrixXd> BoundingBoxEstimator::updateObjectBoundingBox()
         curr_bbox(3, i) = rect.height;
     }
 
+    // Send mask for inspection if required
+    if (send_mask_)
+        sendObjectMask();
+
     return std::make_pair(true, curr_bbox);
 }
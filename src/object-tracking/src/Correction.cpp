@@ -13,10 +13,10 @@ using namespace bfl;
 using namespace Eigen;
 
 MeasurementModelReference::MeasurementModelReference(AdditiveMeasurementModel& measurement_model) :
-    meas_model_(dynamic_cast<iCubPointCloud&>(measurement_model))
+    meas_model_(dynamic_cast<PointCloudModel&>(measurement_model))
 { }
 
-iCubPointCloud& MeasurementModelReference::getPointCloudModel()
+PointCloudModel& MeasurementModelReference::getPointCloudModel()
 {
     return meas_model_;
 }
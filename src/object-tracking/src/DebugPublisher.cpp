@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <DebugPublisher.h>
+
+#include <yarp/cv/Cv.h>
+
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+using namespace yarp::sig;
+
+
+DebugPublisher::DebugPublisher(const std::string& port_name, const std::string& background_port_name) :
+    use_background_port_(!background_port_name.empty()),
+    is_pending_(false),
+    running_(true),
+    dropped_(0)
+{
+    if (use_background_port_)
+    {
+        if (!port_background_in_.open(background_port_name))
+            throw(std::runtime_error("DEBUGPUBLISHER::CTOR::ERROR\n\tError: cannot open background input port " + background_port_name + "."));
+    }
+
+    if (!port_image_out_.open(port_name))
+        throw(std::runtime_error("DEBUGPUBLISHER::CTOR::ERROR\n\tError: cannot open image output port " + port_name + "."));
+
+    publisher_ = std::thread(&DebugPublisher::publishLoop, this);
+}
+
+
+DebugPublisher::~DebugPublisher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    frame_available_.notify_one();
+
+    publisher_.join();
+
+    if (use_background_port_)
+        port_background_in_.close();
+    port_image_out_.close();
+}
+
+
+bool DebugPublisher::hasConnections()
+{
+    return port_image_out_.getOutputCount() > 0;
+}
+
+
+void DebugPublisher::setBackgroundMask(const cv::Mat& mask)
+{
+    collecting_.background_mask = mask;
+}
+
+
+void DebugPublisher::drawPolygon(const std::vector<cv::Point>& polygon, const cv::Scalar& color)
+{
+    Command command;
+    command.type = Command::Type::Polygon;
+    command.points = polygon;
+    command.color = color;
+
+    collecting_.commands.push_back(std::move(command));
+}
+
+
+void DebugPublisher::drawMaskContour(const cv::Mat& mask, const cv::Scalar& color)
+{
+    Command command;
+    command.type = Command::Type::MaskContour;
+    command.mask = mask;
+    command.color = color;
+
+    collecting_.commands.push_back(std::move(command));
+}
+
+
+void DebugPublisher::drawBox(const cv::Point& top_left, const cv::Point& bottom_right, const cv::Scalar& color)
+{
+    Command command;
+    command.type = Command::Type::Box;
+    command.points = {top_left, bottom_right};
+    command.color = color;
+
+    collecting_.commands.push_back(std::move(command));
+}
+
+
+void DebugPublisher::drawPoints(const std::vector<cv::Point>& points, const cv::Scalar& color)
+{
+    Command command;
+    command.type = Command::Type::Points;
+    command.points = points;
+    command.color = color;
+
+    collecting_.commands.push_back(std::move(command));
+}
+
+
+void DebugPublisher::publish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (is_pending_)
+            dropped_++;
+
+        std::swap(pending_, collecting_);
+        is_pending_ = true;
+    }
+    frame_available_.notify_one();
+
+    collecting_.background_mask = cv::Mat();
+    collecting_.commands.clear();
+}
+
+
+std::size_t DebugPublisher::getDroppedFrames()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return dropped_;
+}
+
+
+void DebugPublisher::publishLoop()
+{
+#ifdef __linux__
+    /* Debugging images must not steal time from the filtering thread. */
+    sched_param parameters;
+    parameters.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameters);
+#endif
+
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            frame_available_.wait(lock, [this]{ return !running_ || is_pending_; });
+
+            if (!running_)
+                return;
+
+            std::swap(frame, pending_);
+            is_pending_ = false;
+        }
+
+        if (hasConnections())
+            render(frame);
+    }
+}
+
+
+void DebugPublisher::render(const Frame& frame)
+{
+    ImageOf<PixelRgb>* background = nullptr;
+    if (use_background_port_)
+    {
+        background = port_background_in_.read(false);
+        if (background == nullptr)
+            return;
+    }
+    else if (frame.background_mask.empty())
+        return;
+
+    // Prepare output image
+    ImageOf<PixelRgb>& image_out = port_image_out_.prepare();
+    cv::Mat image;
+    if (use_background_port_)
+    {
+        // Copy input to output and wrap around a cv::Mat
+        image_out = *background;
+        image = yarp::cv::toCvMat(image_out);
+        cv::cvtColor(image, image, cv::COLOR_RGB2BGR);
+    }
+    else
+    {
+        // Copy mask to the output image
+        image_out.resize(frame.background_mask.cols, frame.background_mask.rows);
+        image = yarp::cv::toCvMat(image_out);
+        cv::cvtColor(frame.background_mask, image, CV_GRAY2RGB);
+    }
+
+    for (const Command& command : frame.commands)
+        draw(image, command);
+
+    // Send the image
+    port_image_out_.write();
+}
+
+
+void DebugPublisher::draw(cv::Mat& image, const Command& command)
+{
+    switch (command.type)
+    {
+        case Command::Type::Polygon:
+        {
+            std::vector<std::vector<cv::Point>> contours;
+            contours.push_back(command.points);
+            cv::drawContours(image, contours, 0, command.color);
+
+            break;
+        }
+
+        case Command::Type::MaskContour:
+        {
+            // Find contours
+            std::vector<std::vector<cv::Point>> contours;
+            cv::findContours(command.mask.clone(), contours, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+
+            if (contours.size() == 0)
+                break;
+
+            // Find the contour with max area
+            std::size_t max_index = 0;
+            double max_area = cv::contourArea(contours[0]);
+
+            for (std::size_t i = 1; i < contours.size(); i++)
+            {
+                double area = cv::contourArea(contours[i]);
+
+                if (area > max_area)
+                {
+                    max_area = area;
+                    max_index = i;
+                }
+            }
+
+            cv::drawContours(image, contours, max_index, command.color);
+
+            break;
+        }
+
+        case Command::Type::Box:
+        {
+            cv::rectangle(image, command.points[0], command.points[1], command.color);
+
+            break;
+        }
+
+        case Command::Type::Points:
+        {
+            for (const cv::Point& point : command.points)
+                cv::circle(image, point, 1, command.color, CV_FILLED);
+
+            break;
+        }
+    }
+}
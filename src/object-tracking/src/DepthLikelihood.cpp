@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <DepthImageModel.h>
+#include <DepthLikelihood.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace bfl;
+using namespace Eigen;
+
+
+DepthLikelihood::DepthLikelihood(const double noise_variance, const double outlier_threshold, std::unique_ptr<DepthRasterizer> rasterizer) :
+    gain_(-0.5 / noise_variance),
+    outlier_threshold_(static_cast<float>(outlier_threshold)),
+    rasterizer_(std::move(rasterizer))
+{ }
+
+
+DepthLikelihood::~DepthLikelihood()
+{ }
+
+
+std::pair<bool, Eigen::VectorXd> DepthLikelihood::likelihood(const MeasurementModel& measurement_model, const Eigen::Ref<const Eigen::MatrixXd>& pred_states)
+{
+    const DepthImageModel* depth_model = dynamic_cast<const DepthImageModel*>(&measurement_model);
+    if (depth_model == nullptr)
+        return std::make_pair(false, VectorXd::Zero(1));
+
+    // Take the current measurements, i.e. the depth within the region of interest
+    bool valid_measurements;
+    DepthROI roi;
+    std::tie(valid_measurements, roi) = depth_model->getDepthROI();
+    if (!valid_measurements)
+        return std::make_pair(false, VectorXd::Zero(1));
+
+    // Render the depth of each particle within the same region
+    DepthRasterizer::Window window;
+    window.u_0 = roi.u_0;
+    window.v_0 = roi.v_0;
+    window.width = roi.depth.cols();
+    window.height = roi.depth.rows();
+
+    rasterizer_->setIntrinsics(roi.fx, roi.fy, roi.cx, roi.cy);
+    if (!rasterizer_->render(pred_states, roi.camera_position, roi.camera_orientation, window))
+        return std::make_pair(false, VectorXd::Zero(1));
+
+    // Eval likelihood in log space
+    const auto measured = roi.depth.array();
+    const auto valid = measured > 0.0f;
+    const float squared_threshold = outlier_threshold_ * outlier_threshold_;
+
+    VectorXd likelihood(pred_states.cols());
+    #pragma omp parallel for
+    for (int i = 0; i < pred_states.cols(); i++)
+    {
+        const auto rendered = rasterizer_->getDepth(i).leftCols(window.width).array();
+        const auto error = (rendered > 0.0f).select((rendered - measured).square().min(squared_threshold), squared_threshold);
+
+        likelihood(i) = gain_ * static_cast<double>(valid.select(error, 0.0f).sum());
+    }
+
+    return std::make_pair(true, likelihood);
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <DepthRasterizer.h>
+#include <VCGTriMesh.h>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace Eigen;
+
+
+DepthRasterizer::DepthRasterizer(const std::string& mesh_filename, const std::size_t tile_size, const bool enable_back_culling) :
+    MeshImporter(mesh_filename),
+    // Tiles are processed using packets of 8 pixels, hence the size is rounded to a multiple of 8
+    tile_size_(std::max<std::size_t>(8, ((tile_size + 7) / 8) * 8)),
+    enable_back_culling_(enable_back_culling)
+{
+    // Convert mesh using MeshImporter
+    std::istringstream mesh_input;
+    bool valid_mesh;
+
+    std::tie(valid_mesh, mesh_input) = getMesh("obj");
+
+    if (!valid_mesh)
+    {
+        std::string err = "DEPTHRASTERIZER::CTOR::ERROR\n\tError: cannot load mesh file " + mesh_filename + ".";
+        throw(std::runtime_error(err));
+    }
+
+    // Open converted obj using vcg mesh importer
+    simpleTriMesh trimesh;
+    OBJImportInfo info;
+    int outcome;
+    outcome = simpleTriMeshImporter::OpenStream(trimesh, mesh_input, info);
+
+    if(simpleTriMeshImporter::ErrorCritical(outcome))
+    {
+        std::string err = "DEPTHRASTERIZER::CTOR::ERROR\n\tError: cannot load mesh file " + mesh_filename +
+                          ". Error:" + std::string(simpleTriMeshImporter::ErrorMsg(outcome)) + ".";
+        throw(std::runtime_error(err));
+    }
+
+    // Store vertices and triangles
+    vertices_.resize(3, trimesh.vert.size());
+    std::size_t i = 0;
+    for (VertexIterator vi = trimesh.vert.begin(); vi != trimesh.vert.end(); vi++)
+    {
+        const auto p = vi->cP();
+        vertices_.col(i) << p[0], p[1], p[2];
+
+        i++;
+    }
+
+    triangles_.resize(3, trimesh.fn);
+    i = 0;
+    for (FaceIterator fi = trimesh.face.begin(); fi != trimesh.face.end(); fi++)
+    {
+        if (fi->IsD())
+            continue;
+
+        for (std::size_t k = 0; k < 3; k++)
+            triangles_(k, i) = vcg::tri::Index(trimesh, fi->cV(k));
+
+        i++;
+    }
+    triangles_.conservativeResize(3, i);
+}
+
+
+DepthRasterizer::~DepthRasterizer()
+{ }
+
+
+void DepthRasterizer::setIntrinsics(const double fx, const double fy, const double cx, const double cy)
+{
+    fx_ = fx;
+    fy_ = fy;
+    cx_ = cx;
+    cy_ = cy;
+
+    intrinsics_set_ = true;
+}
+
+
+bool DepthRasterizer::render(const Ref<const MatrixXd>& states, const Ref<const VectorXd>& camera_position, const Ref<const VectorXd>& camera_orientation, const Window& window)
+{
+    if (!intrinsics_set_)
+        return false;
+
+    if ((window.width <= 0) || (window.height <= 0))
+        return false;
+
+    if ((camera_position.size() != 3) || (camera_orientation.size() != 4))
+        return false;
+
+    // Configure tiling of the window
+    window_ = window;
+    stride_ = ((window_.width + 7) / 8) * 8;
+    tiles_u_ = (stride_ + tile_size_ - 1) / tile_size_;
+    tiles_v_ = (window_.height + tile_size_ - 1) / tile_size_;
+    const std::size_t number_tiles = tiles_u_ * tiles_v_;
+
+    // Grow the buffer pool if required
+    number_images_ = states.cols();
+    if (depth_pool_.size() < number_images_)
+    {
+        depth_pool_.resize(number_images_);
+        projected_pool_.resize(number_images_);
+        bins_pool_.resize(number_images_);
+    }
+
+    // Inverse of the camera pose
+    Transform<double, 3, Affine> camera_pose;
+    camera_pose = Translation<double, 3>(camera_position);
+    camera_pose.rotate(AngleAxisd(camera_orientation(3), camera_orientation.head<3>()));
+    const Transform<double, 3, Affine> camera_pose_inverse = camera_pose.inverse();
+
+    // Project vertices and bin triangles
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < number_images_; i++)
+    {
+        depth_pool_[i].setZero(window_.height, stride_);
+
+        bins_pool_[i].resize(number_tiles);
+        for (auto& bin : bins_pool_[i])
+            bin.clear();
+
+        setupState(i, states.col(i), camera_pose_inverse);
+    }
+
+    // Rasterize tiles
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for (std::size_t i = 0; i < number_images_; i++)
+    {
+        for (std::size_t t = 0; t < number_tiles; t++)
+            rasterizeTile(i, t);
+    }
+
+    // Convert inverse depth to depth
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < number_images_; i++)
+        resolveDepth(i);
+
+    return true;
+}
+
+
+const DepthRasterizer::DepthImage& DepthRasterizer::getDepth(const std::size_t index) const
+{
+    return depth_pool_.at(index);
+}
+
+
+std::size_t DepthRasterizer::getNumberImages() const
+{
+    return number_images_;
+}
+
+
+void DepthRasterizer::setupState(const std::size_t index, const Ref<const VectorXd>& state, const Transform<double, 3, Affine>& camera_pose_inverse)
+{
+    // Object pose
+    Transform<double, 3, Affine> object_pose;
+    object_pose = Translation<double, 3>(state.segment(0, 3));
+    object_pose.rotate(AngleAxisd(state(9),  Vector3d::UnitZ()));
+    object_pose.rotate(AngleAxisd(state(10), Vector3d::UnitY()));
+    object_pose.rotate(AngleAxisd(state(11), Vector3d::UnitX()));
+
+    const Transform<double, 3, Affine> object_in_camera = camera_pose_inverse * object_pose;
+    const Matrix3d rotation = object_in_camera.linear();
+    const Vector3d translation = object_in_camera.translation();
+
+    // Project vertices in window coordinates storing (u, v, 1 / z)
+    // A negative inverse depth marks vertices lying behind the near plane
+    Matrix3Xf& projected = projected_pool_[index];
+    projected.resize(3, vertices_.cols());
+    for (std::size_t j = 0; j < vertices_.cols(); j++)
+    {
+        const Vector3d p = rotation * vertices_.col(j) + translation;
+
+        if (p(2) > near_plane_)
+        {
+            const double inv_z = 1.0 / p(2);
+            projected(0, j) = static_cast<float>(fx_ * p(0) * inv_z + cx_ - window_.u_0);
+            projected(1, j) = static_cast<float>(fy_ * p(1) * inv_z + cy_ - window_.v_0);
+            projected(2, j) = static_cast<float>(inv_z);
+        }
+        else
+            projected.col(j) << 0.0f, 0.0f, -1.0f;
+    }
+
+    // Bin triangles in tiles
+    std::vector<std::vector<std::uint32_t>>& bins = bins_pool_[index];
+    const float max_u = static_cast<float>(window_.width - 1);
+    const float max_v = static_cast<float>(window_.height - 1);
+    for (std::size_t t = 0; t < triangles_.cols(); t++)
+    {
+        const Vector3f p0 = projected.col(triangles_(0, t));
+        const Vector3f p1 = projected.col(triangles_(1, t));
+        const Vector3f p2 = projected.col(triangles_(2, t));
+
+        if ((p0(2) < 0.0f) || (p1(2) < 0.0f) || (p2(2) < 0.0f))
+            continue;
+
+        // Front facing triangles have negative signed area on the image plane
+        if (enable_back_culling_)
+        {
+            const float area = (p1(0) - p0(0)) * (p2(1) - p0(1)) - (p2(0) - p0(0)) * (p1(1) - p0(1));
+            if (area >= 0.0f)
+                continue;
+        }
+
+        const float bb_min_u = std::max(0.0f,  std::min({p0(0), p1(0), p2(0)}));
+        const float bb_max_u = std::min(max_u, std::max({p0(0), p1(0), p2(0)}));
+        const float bb_min_v = std::max(0.0f,  std::min({p0(1), p1(1), p2(1)}));
+        const float bb_max_v = std::min(max_v, std::max({p0(1), p1(1), p2(1)}));
+
+        if ((bb_min_u > bb_max_u) || (bb_min_v > bb_max_v))
+            continue;
+
+        const std::size_t tile_u_0 = static_cast<std::size_t>(bb_min_u) / tile_size_;
+        const std::size_t tile_u_1 = static_cast<std::size_t>(bb_max_u) / tile_size_;
+        const std::size_t tile_v_0 = static_cast<std::size_t>(bb_min_v) / tile_size_;
+        const std::size_t tile_v_1 = static_cast<std::size_t>(bb_max_v) / tile_size_;
+
+        for (std::size_t tile_v = tile_v_0; tile_v <= tile_v_1; tile_v++)
+            for (std::size_t tile_u = tile_u_0; tile_u <= tile_u_1; tile_u++)
+                bins[tile_v * tiles_u_ + tile_u].push_back(t);
+    }
+}
+
+
+void DepthRasterizer::rasterizeTile(const std::size_t index, const std::size_t tile)
+{
+    using Packet = Array<float, 8, 1>;
+
+    std::vector<std::uint32_t>& bin = bins_pool_[index][tile];
+    if (bin.empty())
+        return;
+
+    const Matrix3Xf& projected = projected_pool_[index];
+    DepthImage& buffer = depth_pool_[index];
+
+    // Tile extent in window coordinates
+    // Since both the tile size and the stride are multiple of 8, packets never cross the tile boundary
+    const int tile_u = static_cast<int>((tile % tiles_u_) * tile_size_);
+    const int tile_v = static_cast<int>((tile / tiles_u_) * tile_size_);
+    const int tile_u_end = std::min(tile_u + static_cast<int>(tile_size_), stride_);
+    const int tile_v_end = std::min(tile_v + static_cast<int>(tile_size_), window_.height);
+
+    // Process triangles front to back so that the depth test discards most of the farthest fragments
+    auto closest = [&projected, this](const std::uint32_t t)
+    {
+        return std::max({projected(2, triangles_(0, t)), projected(2, triangles_(1, t)), projected(2, triangles_(2, t))});
+    };
+    std::sort(bin.begin(), bin.end(), [&closest](const std::uint32_t a, const std::uint32_t b) { return closest(a) > closest(b); });
+
+    Packet lanes;
+    lanes << 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f;
+
+    // Farthest inverse depth within the tile, zero as long as the tile is not fully covered
+    float tile_farthest = 0.0f;
+
+    for (std::size_t k = 0; k < bin.size(); k++)
+    {
+        // Early depth rejection of the whole triangle
+        if ((k % 16) == 15)
+            tile_farthest = buffer.block(tile_v, tile_u, tile_v_end - tile_v, tile_u_end - tile_u).minCoeff();
+
+        const std::uint32_t t = bin[k];
+        if (closest(t) <= tile_farthest)
+            continue;
+
+        Vector3f p0 = projected.col(triangles_(0, t));
+        Vector3f p1 = projected.col(triangles_(1, t));
+        Vector3f p2 = projected.col(triangles_(2, t));
+
+        float area = (p1(0) - p0(0)) * (p2(1) - p0(1)) - (p2(0) - p0(0)) * (p1(1) - p0(1));
+        if (area == 0.0f)
+            continue;
+        else if (area < 0.0f)
+        {
+            std::swap(p1, p2);
+            area = -area;
+        }
+
+        // Bounding box of the triangle clipped to the tile
+        int min_u = std::max(tile_u,         static_cast<int>(std::ceil(std::min({p0(0), p1(0), p2(0)}))));
+        int max_u = std::min(tile_u_end - 1, static_cast<int>(std::floor(std::max({p0(0), p1(0), p2(0)}))));
+        int min_v = std::max(tile_v,         static_cast<int>(std::ceil(std::min({p0(1), p1(1), p2(1)}))));
+        int max_v = std::min(tile_v_end - 1, static_cast<int>(std::floor(std::max({p0(1), p1(1), p2(1)}))));
+        if ((min_u > max_u) || (min_v > max_v))
+            continue;
+        min_u -= (min_u - tile_u) % 8;
+
+        // Normalized edge functions w_i(u, v) = a_i * u + b_i * v + c_i, i.e. the barycentric coordinates
+        const float inv_area = 1.0f / area;
+        const float a0 = (p1(1) - p2(1)) * inv_area;
+        const float b0 = (p2(0) - p1(0)) * inv_area;
+        const float c0 = (p1(0) * p2(1) - p1(1) * p2(0)) * inv_area;
+        const float a1 = (p2(1) - p0(1)) * inv_area;
+        const float b1 = (p0(0) - p2(0)) * inv_area;
+        const float c1 = (p2(0) * p0(1) - p2(1) * p0(0)) * inv_area;
+        const float a2 = (p0(1) - p1(1)) * inv_area;
+        const float b2 = (p1(0) - p0(0)) * inv_area;
+        const float c2 = (p0(0) * p1(1) - p0(1) * p1(0)) * inv_area;
+
+        // The inverse depth is linear on the image plane
+        const float a_z = a0 * p0(2) + a1 * p1(2) + a2 * p2(2);
+        const float b_z = b0 * p0(2) + b1 * p1(2) + b2 * p2(2);
+        const float c_z = c0 * p0(2) + c1 * p1(2) + c2 * p2(2);
+
+        for (int v = min_v; v <= max_v; v++)
+        {
+            float* row = buffer.data() + v * stride_;
+
+            const float v_f = static_cast<float>(v);
+            const float row_0 = b0 * v_f + c0;
+            const float row_1 = b1 * v_f + c1;
+            const float row_2 = b2 * v_f + c2;
+            const float row_z = b_z * v_f + c_z;
+
+            for (int u = min_u; u <= max_u; u += 8)
+            {
+                const Packet u_f = lanes + static_cast<float>(u);
+
+                const Packet w0 = a0 * u_f + row_0;
+                const Packet w1 = a1 * u_f + row_1;
+                const Packet w2 = a2 * u_f + row_2;
+                const Packet z = a_z * u_f + row_z;
+
+                Map<Packet> depth(row + u);
+                depth = ((w0 >= 0.0f) && (w1 >= 0.0f) && (w2 >= 0.0f) && (z > depth)).select(z, depth);
+            }
+        }
+    }
+}
+
+
+void DepthRasterizer::resolveDepth(const std::size_t index)
+{
+    DepthImage& buffer = depth_pool_[index];
+
+    buffer = (buffer.array() > 0.0f).select(buffer.array().inverse(), 0.0f);
+}
@@ -32,8 +32,25 @@ DiscretizedKinematicModel::DiscretizedKinematicModel
 
     // Evaluate F and Q matrices using a default
     // sampling time to be updated online
-    evaluateStateTransitionMatrix(0.01);
-    evaluateNoiseCovarianceMatrix(0.01);
+    T_ = 0.01;
+    evaluateStateTransitionMatrix(T_);
+    evaluateNoiseCovarianceMatrix(T_);
+}
+
+
+DiscretizedKinematicModel::DiscretizedKinematicModel
+(
+    const double sigma_x,  const double sigma_y,  const double sigma_z,
+    const double sigma_yaw, const double sigma_pitch, const double sigma_roll,
+    const double T
+) :
+    DiscretizedKinematicModel(sigma_x, sigma_y, sigma_z, sigma_yaw, sigma_pitch, sigma_roll)
+{
+    T_ = T;
+    evaluateStateTransitionMatrix(T_);
+    evaluateNoiseCovarianceMatrix(T_);
+
+    fixed_sample_time_ = true;
 }
 
 
@@ -73,6 +90,18 @@ void DiscretizedKinematicModel::evaluateNoiseCovarianceMatrix(const double T)
     Q_.block<6, 6>(6, 6) = Q_ang;
 }
 
+void DiscretizedKinematicModel::updateMatrices()
+{
+    if (matrices_updated_)
+        return;
+
+    evaluateStateTransitionMatrix(T_);
+    evaluateNoiseCovarianceMatrix(T_);
+
+    matrices_updated_ = true;
+}
+
+
 std::pair<std::size_t, std::size_t> DiscretizedKinematicModel::getOutputSize() const
 {
     // 9 linear components (x, y, z, x_dot, y_dot, z_dot, yaw_dot, pitch_dot, roll_dot)
@@ -81,14 +110,36 @@ std::pair<std::size_t, std::size_t> DiscretizedKinematicModel::getOutputSize() c
 }
 
 
+double DiscretizedKinematicModel::getSamplingTime() const
+{
+    return T_;
+}
+
+
+const Eigen::VectorXd& DiscretizedKinematicModel::getPositionPSD() const
+{
+    return sigma_position_;
+}
+
+
+const Eigen::VectorXd& DiscretizedKinematicModel::getOrientationPSD() const
+{
+    return sigma_orientation_;
+}
+
+
 Eigen::MatrixXd DiscretizedKinematicModel::getStateTransitionMatrix()
 {
+    updateMatrices();
+
     return F_;
 }
 
 
 Eigen::MatrixXd DiscretizedKinematicModel::getNoiseCovarianceMatrix()
 {
+    updateMatrices();
+
     return Q_;
 }
 
@@ -96,7 +147,10 @@ bool DiscretizedKinematicModel::setProperty(const std::string& property)
 {
     if (property == "tick")
     {
-        // Evaluate elapsed time and reset matrices F_ and Q_
+        if (fixed_sample_time_)
+            return true;
+
+        // Evaluate elapsed time, matrices F_ and Q_ are evaluated only if requested
         std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
 
         if (last_time_set_)
@@ -109,8 +163,8 @@ bool DiscretizedKinematicModel::setProperty(const std::string& property)
             if (delta > 0.3)
                 delta = 0.01;
 
-            evaluateStateTransitionMatrix(delta);
-            evaluateNoiseCovarianceMatrix(delta);
+            T_ = delta;
+            matrices_updated_ = false;
         }
 
         last_time_ = now;
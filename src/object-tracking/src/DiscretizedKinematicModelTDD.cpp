@@ -107,8 +107,9 @@ DiscretizedKinematicModelTDD::DiscretizedKinematicModelTDD
 
     // Evaluate F and Q matrices using a default
     // sampling time to be updated online
-    evaluateStateTransitionMatrix(0.01);
-    evaluateNoiseCovarianceMatrix(0.01);
+    T_ = 0.01;
+    evaluateStateTransitionMatrix(T_);
+    evaluateNoiseCovarianceMatrix(T_);
 
     // initialize matrix Q_damped_
     Q_damped_ = Q_;
@@ -154,6 +155,21 @@ void DiscretizedKinematicModelTDD::evaluateNoiseCovarianceMatrix(const double T)
 }
 
 
+void DiscretizedKinematicModelTDD::updateMatrices()
+{
+    if (matrices_updated_)
+        return;
+
+    evaluateStateTransitionMatrix(T_);
+    evaluateNoiseCovarianceMatrix(T_);
+
+    // Q_damped_ = Q_ * damper;
+    Q_damped_ = Q_;
+
+    matrices_updated_ = true;
+}
+
+
 std::pair<std::size_t, std::size_t> DiscretizedKinematicModelTDD::getOutputSize() const
 {
     // 9 linear components (x, y, z, x_dot, y_dot, z_dot, yaw_dot, pitch_dot, roll_dot)
@@ -162,14 +178,36 @@ std::pair<std::size_t, std::size_t> DiscretizedKinematicModelTDD::getOutputSize(
 }
 
 
+double DiscretizedKinematicModelTDD::getSamplingTime() const
+{
+    return T_;
+}
+
+
+const Eigen::VectorXd& DiscretizedKinematicModelTDD::getPositionPSD() const
+{
+    return sigma_position_;
+}
+
+
+const Eigen::VectorXd& DiscretizedKinematicModelTDD::getOrientationPSD() const
+{
+    return sigma_orientation_;
+}
+
+
 Eigen::MatrixXd DiscretizedKinematicModelTDD::getStateTransitionMatrix()
 {
+    updateMatrices();
+
     return F_;
 }
 
 
 Eigen::MatrixXd DiscretizedKinematicModelTDD::getNoiseCovarianceMatrix()
 {
+    updateMatrices();
+
     return Q_damped_;
 }
 
@@ -180,7 +218,7 @@ bool DiscretizedKinematicModelTDD::setProperty(const std::string& property)
 
     if (property == "tick")
     {
-        // Evaluate elapsed time and reset matrices F_ and Q_
+        // Evaluate elapsed time, matrices F_ and Q_ are evaluated only if requested
         std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
 
         if (last_time_set_)
@@ -274,11 +312,8 @@ bool DiscretizedKinematicModelTDD::setProperty(const std::string& property)
 
             delta *= damper;
 
-            evaluateStateTransitionMatrix(delta);
-            evaluateNoiseCovarianceMatrix(delta);
-
-            // Q_damped_ = Q_ * damper;
-            Q_damped_ = Q_;
+            T_ = delta;
+            matrices_updated_ = false;
         }
 
         last_time_ = now;
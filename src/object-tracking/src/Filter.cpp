@@ -6,6 +6,7 @@
  */
 
 #include <Filter.h>
+#include <StageStatistics.h>
 
 #include <Eigen/Dense>
 
@@ -156,6 +157,18 @@ bool Filter::set_history_window(const int16_t window)
 }
 
 
+std::vector<std::string> Filter::get_stats()
+{
+    return StageStatistics::instance().summary();
+}
+
+
+void Filter::reset_stats()
+{
+    StageStatistics::instance().reset();
+}
+
+
 bool Filter::quit()
 {
     return teardown();
@@ -169,6 +182,12 @@ std::vector<std::string> Filter::log_file_names(const std::string& prefix_path,
 }
 
 
+std::vector<std::string> Filter::binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name)
+{
+    return log_file_names(prefix_path, prefix_name);
+}
+
+
 void Filter::filteringStep()
 {
     if (pause_)
@@ -180,12 +199,17 @@ void Filter::filteringStep()
     }
     std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    bbox_estimator_->step();
-    icub_point_cloud_share_->setBoundingBox(bbox_estimator_->getEstimate());
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::BoundingBox);
+
+        bbox_estimator_->step();
+        icub_point_cloud_share_->setBoundingBox(bbox_estimator_->getEstimate());
+    }
 
     GaussianFilter_::filteringStep();
 
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    StageStatistics::instance().record(StageStatistics::Stage::Step, end - start);
 
     std::cout << "Executed step in "
               << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
@@ -211,6 +235,8 @@ void Filter::filteringStep()
     Vector& estimate_yarp = port_estimate_out_.prepare();
     estimate_yarp.resize(7);
     toEigen(estimate_yarp) = estimate;
+    estimate_stamp_.update();
+    port_estimate_out_.setEnvelope(estimate_stamp_);
     port_estimate_out_.write();
 
     // Allow the state model to evaluate the sampling time online
@@ -220,5 +246,8 @@ void Filter::filteringStep()
 
 void Filter::log()
 {
-    logger(predicted_state_.mean().transpose(), corrected_state_.mean().transpose());
+    if (is_binary_log_enabled())
+        binary_logger(predicted_state_.mean(), corrected_state_.mean());
+    else
+        logger(predicted_state_.mean().transpose(), corrected_state_.mean().transpose());
 }
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <KinematicModelPrediction.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace bfl;
+using namespace Eigen;
+
+
+KinematicModelPrediction::KinematicModelPrediction(std::unique_ptr<LinearStateModel> state_model) noexcept :
+    state_model_(std::move(state_model)),
+    parameters_(dynamic_cast<const KinematicModelParameters*>(state_model_.get()))
+{ }
+
+
+KinematicModelPrediction::~KinematicModelPrediction() noexcept
+{ }
+
+
+StateModel& KinematicModelPrediction::getStateModel() noexcept
+{
+    return *state_model_;
+}
+
+
+void KinematicModelPrediction::predictStep(const GaussianMixture& prev_state, GaussianMixture& pred_state)
+{
+    pred_state = prev_state;
+
+    if (getSkipState())
+        return;
+
+    // Sampling times and non-zero entries of the noise covariance matrix, i.e. the diagonals of its 3x3 blocks
+    double T_pos;
+    double T_ang;
+    Matrix<double, 3, 6> q;
+    if (parameters_ != nullptr)
+    {
+        const double T = parameters_->getSamplingTime();
+        const VectorXd& sigma_position = parameters_->getPositionPSD();
+        const VectorXd& sigma_orientation = parameters_->getOrientationPSD();
+
+        T_pos = T;
+        T_ang = T;
+
+        q.col(0) = sigma_position * (T * T * T / 3.0);
+        q.col(1) = sigma_position * (T * T / 2.0);
+        q.col(2) = sigma_position * T;
+        q.col(3) = sigma_orientation * T;
+        q.col(4) = sigma_orientation * (T * T / 2.0);
+        q.col(5) = sigma_orientation * (T * T * T / 3.0);
+    }
+    else
+    {
+        // As found in the non-identity blocks of the state transition matrix
+        const MatrixXd F = state_model_->getStateTransitionMatrix();
+        T_pos = F(0, 3);
+        T_ang = F(9, 6);
+
+        const MatrixXd Q = state_model_->getNoiseCovarianceMatrix();
+        for (std::size_t k = 0; k < 3; k++)
+        {
+            q(k, 0) = Q(k, k);
+            q(k, 1) = Q(k, k + 3);
+            q(k, 2) = Q(k + 3, k + 3);
+            q(k, 3) = Q(k + 6, k + 6);
+            q(k, 4) = Q(k + 6, k + 9);
+            q(k, 5) = Q(k + 9, k + 9);
+        }
+    }
+
+    // Predicted mean, i.e. F * x for all the components at once
+    MatrixXd& mean = pred_state.mean();
+    mean.middleRows<3>(0) += T_pos * mean.middleRows<3>(3);
+    mean.middleRows<3>(9) += T_ang * mean.middleRows<3>(6);
+
+    // Predicted covariance, i.e. F * P * F^{T} + Q
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < pred_state.components; i++)
+    {
+        Ref<MatrixXd> P = pred_state.covariance(i);
+
+        // P <- F * P
+        P.middleRows<3>(0) += T_pos * P.middleRows<3>(3);
+        P.middleRows<3>(9) += T_ang * P.middleRows<3>(6);
+
+        // P <- P * F^{T}
+        P.middleCols<3>(0) += T_pos * P.middleCols<3>(3);
+        P.middleCols<3>(9) += T_ang * P.middleCols<3>(6);
+
+        // P <- P + Q
+        for (std::size_t k = 0; k < 3; k++)
+        {
+            P(k, k) += q(k, 0);
+            P(k, k + 3) += q(k, 1);
+            P(k + 3, k) += q(k, 1);
+            P(k + 3, k + 3) += q(k, 2);
+
+            P(k + 6, k + 6) += q(k, 3);
+            P(k + 6, k + 9) += q(k, 4);
+            P(k + 9, k + 6) += q(k, 4);
+            P(k + 9, k + 9) += q(k, 5);
+        }
+    }
+}
@@ -6,6 +6,8 @@
  */
 
 #include <NanoflannPointCloudPrediction.h>
+#include <StageStatistics.h>
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -119,6 +121,8 @@ void NanoflannPointCloudPrediction::samplePointCloud()
 
 std::pair<bool, MatrixXd> NanoflannPointCloudPrediction::predictPointCloud(ConstMatrixXdRef state, ConstVectorXdRef meas)
 {
+    ScopedStageTimer timer(StageStatistics::Stage::KdTreeQuery);
+
     // Check if meas size is multiple of 3
     if ((meas.size() % 3) != 0)
         return std::make_pair(false, MatrixXd(0, 0));
@@ -188,6 +192,8 @@ std::pair<bool, MatrixXd> NanoflannPointCloudPrediction::predictPointCloud(Const
 
 std::pair<bool, MatrixXd> NanoflannPointCloudPrediction::evalDistances(ConstMatrixXdRef state, ConstVectorXdRef meas)
 {
+    ScopedStageTimer timer(StageStatistics::Stage::KdTreeQuery);
+
     // Check if meas size is multiple of 3
     if ((meas.size() % 3) != 0)
         return std::make_pair(false, MatrixXd(0, 0));
@@ -96,14 +96,10 @@ void ObjectOcclusion::findOcclusionArea()
 }
 
 
-void ObjectOcclusion::drawOcclusionArea(cv::Mat& image)
+void ObjectOcclusion::drawOcclusionArea(DebugPublisher& publisher)
 {
     if (occlusion_area_set_)
-    {
-        std::vector<std::vector<cv::Point>> contours;
-        contours.push_back(occlusion_area_);
-        drawContours(image, contours, 0, cv::Scalar(255, 0, 0));
-    }
+        publisher.drawPolygon(occlusion_area_, cv::Scalar(255, 0, 0));
 }
 
 
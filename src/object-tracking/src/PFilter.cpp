@@ -5,7 +5,9 @@
  * GPL-2+ license. See the accompanying LICENSE file for details.
  */
 
+#include <ParticleCloudCodec.h>
 #include <PFilter.h>
+#include <StageStatistics.h>
 
 #include <BayesFilters/utils.h>
 
@@ -15,6 +17,7 @@
 using namespace bfl;
 using namespace Eigen;
 using namespace yarp::eigen;
+using namespace yarp::os;
 using namespace yarp::sig;
 
 
@@ -30,7 +33,8 @@ PFilter::PFilter
     std::unique_ptr<ParticlesCorrection> correction,
     std::unique_ptr<Resampling> resampling,
     std::unique_ptr<BoundingBoxEstimator> bbox_estimator,
-    std::shared_ptr<iCubPointCloudExogenousData> icub_point_cloud_share
+    std::shared_ptr<iCubPointCloudExogenousData> icub_point_cloud_share,
+    const std::size_t particles_top_k
 ) :
     ParticleCorrectionReset(correction.get()),
     SIS
@@ -47,6 +51,7 @@ PFilter::PFilter
     bbox_estimator_(std::move(bbox_estimator)),
     icub_point_cloud_share_(icub_point_cloud_share),
     point_estimate_extraction_(9, 3),
+    particles_top_k_(particles_top_k),
     pause_(false)
 {
     // Setup point estimates extraction
@@ -67,6 +72,13 @@ PFilter::PFilter
         throw(std::runtime_error(err));
     }
 
+    // Open particles output port
+    if (!port_particles_out_.open("/" + port_prefix + "/particles:o"))
+    {
+        std::string err = "PFILTER::CTOR::ERROR\n\tError: cannot open particles output port.";
+        throw(std::runtime_error(err));
+    }
+
     // Open RPC input port for commands
     if (!port_rpc_command_.open("/" + port_prefix + "/cmd:i"))
     {
@@ -88,6 +100,7 @@ PFilter::~PFilter()
 {
     port_estimate_out_.close();
     port_timings_out_.close();
+    port_particles_out_.close();
 }
 
 
@@ -238,6 +251,18 @@ bool PFilter::set_history_window(const int16_t window)
 }
 
 
+std::vector<std::string> PFilter::get_stats()
+{
+    return StageStatistics::instance().summary();
+}
+
+
+void PFilter::reset_stats()
+{
+    StageStatistics::instance().reset();
+}
+
+
 bool PFilter::quit()
 {
     return teardown();
@@ -250,6 +275,12 @@ std::vector<std::string> PFilter::log_file_names(const std::string& prefix_path,
 }
 
 
+std::vector<std::string> PFilter::binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name)
+{
+    return log_file_names(prefix_path, prefix_name);
+}
+
+
 void PFilter::filteringStep()
 {
     if (pause_)
@@ -261,37 +292,66 @@ void PFilter::filteringStep()
     }
     std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    bbox_estimator_->step();
-    // Vector4d bounding_box;
-    // if (getFilteringStep() == 0)
-    //     bounding_box = bbox_estimator_->getEstimate(pred_particle_.weight());
-    // else
-    //     bounding_box = bbox_estimator_->getEstimate(cor_particle_.weight());
-    icub_point_cloud_share_->setBoundingBox(bbox_estimator_->getEstimate());
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::BoundingBox);
+
+        bbox_estimator_->step();
+        // Vector4d bounding_box;
+        // if (getFilteringStep() == 0)
+        //     bounding_box = bbox_estimator_->getEstimate(pred_particle_.weight());
+        // else
+        //     bounding_box = bbox_estimator_->getEstimate(cor_particle_.weight());
+        icub_point_cloud_share_->setBoundingBox(bbox_estimator_->getEstimate());
+    }
 
     if (getFilteringStep() != 0)
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::Prediction);
+
         prediction_->predict(cor_particle_, pred_particle_);
+    }
 
-    correction_->correct(pred_particle_, cor_particle_);
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::Correction);
+
+        correction_->correct(pred_particle_, cor_particle_);
+    }
 
     /* Normalize weights using LogSumExp. */
     cor_particle_.weight().array() -= utils::log_sum_exp(cor_particle_.weight());
 
     log();
 
-    double neff = resampling_->neff(cor_particle_.weight());
-    if (neff < static_cast<double>(num_particle_) * resampling_threshold_)
+    // Encode the weighted particle set before resampling makes the weights uniform, relative to its best particle
+    bool particles_encoded = false;
+    if (port_particles_out_.getOutputCount() > 0)
     {
-        // std::cout << "Resampling..." << std::endl;
-        ParticleSet res_particle(num_particle_, state_size_);
-        VectorXi res_parent(num_particle_, 1);
+        std::size_t best;
+        cor_particle_.weight().maxCoeff(&best);
+
+        Bottle& particles = port_particles_out_.prepare();
+        ParticleCloudCodec::encode(cor_particle_.state(), cor_particle_.weight(), cor_particle_.state(best), 9, particles_top_k_, particles);
+        particles_encoded = true;
+    }
 
-        resampling_->resample(cor_particle_, res_particle, res_parent);
+    double neff;
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::Resampling);
 
-        // resample also bounding box particles
-        // bbox_estimator_->resampleParticles(res_parent);
+        neff = resampling_->neff(cor_particle_.weight());
+        if (neff < static_cast<double>(num_particle_) * resampling_threshold_)
+        {
+            // std::cout << "Resampling..." << std::endl;
+            ParticleSet res_particle(num_particle_, state_size_);
+            VectorXi res_parent(num_particle_, 1);
 
-        cor_particle_ = res_particle;
+            resampling_->resample(cor_particle_, res_particle, res_parent);
+
+            // resample also bounding box particles
+            // bbox_estimator_->resampleParticles(res_parent);
+
+            cor_particle_ = res_particle;
+        }
     }
 
     // Use estimate as hint for the bounding box estimator
@@ -304,8 +364,11 @@ void PFilter::filteringStep()
     std::tie(valid_estimate, point_estimate_) =  point_estimate_extraction_.extract(cor_particle_.state(), cor_particle_.weight());
     if (!valid_estimate)
         yInfo() << log_ID_ << "Cannot extract point estimate!";
+    else
+        icub_point_cloud_share_->setObjectPosition(point_estimate_.head<3>());
 
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    StageStatistics::instance().record(StageStatistics::Stage::Step, end - start);
 
     std::cout << "Executed step in "
               << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
@@ -313,17 +376,26 @@ void PFilter::filteringStep()
               << std::endl;
     std::cout << "Neff is: " << neff<< std::endl << std::endl;
 
+    ScopedStageTimer publication_timer(StageStatistics::Stage::Publication);
+
+    // Execution time and estimate share the same envelope
+    estimate_stamp_.update();
+
     // Send execution time
     double execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
     Vector& timings = port_timings_out_.prepare();
     timings.resize(1);
     timings[0] = execution_time / 1000.0;
+    port_timings_out_.setEnvelope(estimate_stamp_);
     port_timings_out_.write();
 
     if (valid_estimate)
     {
         // Log
-        logger(point_estimate_.transpose());
+        if (is_binary_log_enabled())
+            binary_logger(point_estimate_);
+        else
+            logger(point_estimate_.transpose());
 
         // Send estimate over the port using axis/angle representation
         VectorXd estimate(13);
@@ -339,11 +411,19 @@ void PFilter::filteringStep()
         Vector& estimate_yarp = port_estimate_out_.prepare();
         estimate_yarp.resize(13);
         toEigen(estimate_yarp) = estimate;
+        port_estimate_out_.setEnvelope(estimate_stamp_);
         port_estimate_out_.write();
     }
     else
         std::cout << "Unable to extract the estimate!" << std::endl;
 
+    // Send the quantized particle set
+    if (particles_encoded)
+    {
+        port_particles_out_.setEnvelope(estimate_stamp_);
+        port_particles_out_.write();
+    }
+
     if ((icub_point_cloud_share_->getOcclusion()) && (!icub_point_cloud_share_->getContactState()))
         prediction_->getStateModel().setProperty("tdd_advance");
     else
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <ParticleCloudCodec.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+using namespace Eigen;
+using namespace yarp::os;
+
+
+namespace
+{
+    const double max_int16 = 32767.0;
+
+    const double max_uint16 = 65535.0;
+
+    double wrapAngle(const double angle)
+    {
+        return std::atan2(std::sin(angle), std::cos(angle));
+    }
+}
+
+
+void ParticleCloudCodec::encode
+(
+    const Ref<const MatrixXd>& states,
+    const Ref<const VectorXd>& log_weights,
+    const Ref<const VectorXd>& estimate,
+    const std::size_t angular_offset,
+    const std::size_t top_k,
+    Bottle& message
+)
+{
+    message.clear();
+
+    const std::size_t state_size = states.rows();
+
+    /* Indices of the particles to be sent, the ones having the largest weights if top_k is given. */
+    std::vector<std::size_t> indices(states.cols());
+    std::iota(indices.begin(), indices.end(), 0);
+    if ((top_k > 0) && (top_k < indices.size()))
+    {
+        std::partial_sort(indices.begin(), indices.begin() + top_k, indices.end(),
+                          [&log_weights](const std::size_t i, const std::size_t j) { return log_weights(i) > log_weights(j); });
+        indices.resize(top_k);
+    }
+
+    /* Differences with respect to the estimate. */
+    MatrixXd differences(state_size, indices.size());
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+        differences.col(i) = states.col(indices[i]) - estimate;
+        for (std::size_t j = angular_offset; j < state_size; j++)
+            differences(j, i) = wrapAngle(differences(j, i));
+    }
+
+    VectorXd steps(state_size);
+    for (std::size_t j = 0; j < state_size; j++)
+    {
+        const double range = (indices.size() > 0) ? differences.row(j).cwiseAbs().maxCoeff() : 0.0;
+        steps(j) = (range > 0.0) ? (range / max_int16) : 1.0;
+    }
+
+    double min_log_weight = 0.0;
+    double max_log_weight = 0.0;
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+        const double log_weight = log_weights(indices[i]);
+        if ((i == 0) || (log_weight < min_log_weight))
+            min_log_weight = log_weight;
+        if ((i == 0) || (log_weight > max_log_weight))
+            max_log_weight = log_weight;
+    }
+    /* Particles with null weight have log weight -inf. */
+    if (!std::isfinite(min_log_weight))
+        min_log_weight = max_log_weight - 1000.0;
+    const double log_weight_range = max_log_weight - min_log_weight;
+
+    /* Quantized particles. */
+    const std::size_t particle_bytes = state_size * sizeof(std::int16_t) + sizeof(std::uint16_t);
+    std::vector<char> blob(indices.size() * particle_bytes);
+    char* cursor = blob.data();
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+        for (std::size_t j = 0; j < state_size; j++)
+        {
+            const std::int16_t value = static_cast<std::int16_t>(std::lround(differences(j, i) / steps(j)));
+            std::memcpy(cursor, &value, sizeof(value));
+            cursor += sizeof(value);
+        }
+
+        double normalized_log_weight = 1.0;
+        if (log_weight_range > 0.0)
+            normalized_log_weight = (std::max(log_weights(indices[i]), min_log_weight) - min_log_weight) / log_weight_range;
+        const std::uint16_t weight = static_cast<std::uint16_t>(std::lround(normalized_log_weight * max_uint16));
+        std::memcpy(cursor, &weight, sizeof(weight));
+        cursor += sizeof(weight);
+    }
+
+    message.addInt(indices.size());
+
+    Bottle& estimate_list = message.addList();
+    for (std::size_t j = 0; j < state_size; j++)
+        estimate_list.addDouble(estimate(j));
+
+    Bottle& steps_list = message.addList();
+    for (std::size_t j = 0; j < state_size; j++)
+        steps_list.addDouble(steps(j));
+
+    message.addDouble(min_log_weight);
+    message.addDouble(max_log_weight);
+
+    message.add(Value(blob.data(), blob.size()));
+}
+
+
+std::tuple<bool, MatrixXd, VectorXd> ParticleCloudCodec::decode(const Bottle& message)
+{
+    if (message.size() != 6)
+        return std::make_tuple(false, MatrixXd(), VectorXd());
+
+    const std::size_t number_particles = message.get(0).asInt();
+
+    Bottle* estimate_list = message.get(1).asList();
+    Bottle* steps_list = message.get(2).asList();
+    if ((estimate_list == nullptr) || (steps_list == nullptr) || (estimate_list->size() != steps_list->size()))
+        return std::make_tuple(false, MatrixXd(), VectorXd());
+
+    const std::size_t state_size = estimate_list->size();
+    VectorXd estimate(state_size);
+    VectorXd steps(state_size);
+    for (std::size_t j = 0; j < state_size; j++)
+    {
+        estimate(j) = estimate_list->get(j).asDouble();
+        steps(j) = steps_list->get(j).asDouble();
+    }
+
+    const double min_log_weight = message.get(3).asDouble();
+    const double max_log_weight = message.get(4).asDouble();
+
+    const std::size_t particle_bytes = state_size * sizeof(std::int16_t) + sizeof(std::uint16_t);
+    if (!message.get(5).isBlob() || (static_cast<std::size_t>(message.get(5).asBlobLength()) != number_particles * particle_bytes))
+        return std::make_tuple(false, MatrixXd(), VectorXd());
+
+    MatrixXd states(state_size, number_particles);
+    VectorXd log_weights(number_particles);
+    const char* cursor = message.get(5).asBlob();
+    for (std::size_t i = 0; i < number_particles; i++)
+    {
+        for (std::size_t j = 0; j < state_size; j++)
+        {
+            std::int16_t value;
+            std::memcpy(&value, cursor, sizeof(value));
+            cursor += sizeof(value);
+
+            states(j, i) = estimate(j) + value * steps(j);
+        }
+
+        std::uint16_t weight;
+        std::memcpy(&weight, cursor, sizeof(weight));
+        cursor += sizeof(weight);
+
+        log_weights(i) = min_log_weight + (weight / max_uint16) * (max_log_weight - min_log_weight);
+    }
+
+    return std::make_tuple(true, states, log_weights);
+}
@@ -8,6 +8,7 @@
 #include <Eigen/Cholesky>
 
 #include <ParticlesCorrection.h>
+#include <StageStatistics.h>
 
 #include <exception>
 
@@ -22,7 +23,7 @@ using namespace Eigen;
 ParticlesCorrection::ParticlesCorrection
 (
     std::unique_ptr<Correction> gauss_corr,
-    std::unique_ptr<ProximityLikelihood> lik_model/*,
+    std::unique_ptr<LikelihoodModel> lik_model/*,
     std::unique_ptr<StateModel> state_model*/
 ) noexcept :
     ParticlesCorrection(std::move(gauss_corr), std::move(lik_model)/*, std::move(state_model)*/, 1)
@@ -32,7 +33,7 @@ ParticlesCorrection::ParticlesCorrection
 ParticlesCorrection::ParticlesCorrection
 (
     std::unique_ptr<Correction> gauss_corr,
-    std::unique_ptr<ProximityLikelihood> lik_model/*,
+    std::unique_ptr<LikelihoodModel> lik_model/*,
     std::unique_ptr<StateModel> state_model*/,
     unsigned int seed
 ) noexcept :
@@ -79,7 +80,7 @@ MeasurementModel& ParticlesCorrection::getMeasurementModel()
 
 LikelihoodModel& ParticlesCorrection::getLikelihoodModel()
 {
-    throw std::runtime_error("ERROR::PARTICLESCORRECTION::GETLIKELIHOODMODEL\nERROR:\n\tCall to unimplemented base class method.");
+    return *likelihood_model_;
 }
 
 
@@ -97,17 +98,29 @@ void ParticlesCorrection::reset()
 void ParticlesCorrection::correctStep(const bfl::ParticleSet& pred_particles, bfl::ParticleSet& corr_particles)
 {
     /* Propagate Gaussian belief associated to each particle. */
-    gaussian_correction_->correctStep(pred_particles, corr_particles);
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::UKFCorrection);
+
+        gaussian_correction_->correctStep(pred_particles, corr_particles);
+    }
 
     /* Sample from the proposal distribution. */
-    #pragma omp parallel for
-    for (std::size_t i = 0; i < pred_particles.components; i++)
     {
-        corr_particles.state(i) = sampleFromProposal(corr_particles.mean(i), corr_particles.covariance(i));
+        ScopedStageTimer timer(StageStatistics::Stage::Sampling);
+
+        #pragma omp parallel for
+        for (std::size_t i = 0; i < pred_particles.components; i++)
+        {
+            corr_particles.state(i) = sampleFromProposal(corr_particles.mean(i), corr_particles.covariance(i));
+        }
     }
 
     /* Evaluate the likelihood. */
-    std::tie(valid_likelihood_, likelihood_) = likelihood_model_->likelihood(getMeasurementModel(), corr_particles.state());
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::Likelihood);
+
+        std::tie(valid_likelihood_, likelihood_) = likelihood_model_->likelihood(getMeasurementModel(), corr_particles.state());
+    }
 
     if (!valid_likelihood_)
     {
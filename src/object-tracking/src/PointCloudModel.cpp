@@ -60,3 +60,9 @@ std::pair<bool, MatrixXd> PointCloudModel::getTactileNoiseCovarianceMatrix() con
 {
     return std::make_pair(true, tactile_model_noise_covariance_);
 }
+
+
+int PointCloudModel::getVisualPointCloudSize()
+{
+    return getOutputSize().first / 3;
+}
@@ -9,6 +9,12 @@
 
 #include <Eigen/Cholesky>
 
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace Eigen;
 
 
@@ -19,11 +25,18 @@ Random3DPose::Random3DPose
     const double sigma_wx, const double sigma_wy, const double sigma_wz,
     unsigned int seed
 ) noexcept :
-    generator_(std::mt19937_64(seed)),
-    distribution_(std::normal_distribution<double>(0.0, 1.0)),
-    gauss_rnd_sample_([&] { return (distribution_)(generator_); }),
     T_(T)
 {
+    /**
+     * Initialize one random number generator per lane.
+     */
+    for (std::size_t i = 0; i < number_lanes_; i++)
+    {
+        std::seed_seq lane_seed{seed, static_cast<unsigned int>(i)};
+        generators_.emplace_back(lane_seed);
+        distributions_.emplace_back(0.0, 1.0);
+    }
+
     Vector3d sigmas;
 
     /**
@@ -90,27 +103,36 @@ void Random3DPose::propagate(const Ref<const MatrixXd>& cur_states, Ref<MatrixXd
      *
      * exp( S(omega') = cos(norm(omega')) * I +
      *                  sin(norm(omega')) / norm(omega') * S(omega')
+     *
+     * The product is expanded in closed form and evaluated for all the states at once
+     * on a structure of arrays copy of the quaternions and of omega'.
      */
+    const std::size_t number_states = cur_states.cols();
 
-    for (std::size_t i = 0; i < cur_states.cols(); i++)
-    {
-        Matrix4d S_omega;
-        const Ref<const VectorXd> w = cur_states.bottomRows(3).col(i);
-        S_omega <<     0, -w(0), -w(1), -w(2),
-                    w(0),     0,  w(2), -w(1),
-                    w(1), -w(2),     0,  w(0),
-                    w(2),  w(1),  -w(0),    0;
-        S_omega *= 0.5 * T_;
-
-        double norm_w = (w * 0.5 * T_).norm();
-
-        /* This is to avoid sin(0) / 0 being calculated as -nan. */
-        norm_w += std::numeric_limits<double>::min();
-
-        prop_states.middleRows(6, 4).col(i).noalias() =
-            (cos(norm_w) * Matrix4d::Identity() + sin(norm_w) / norm_w * S_omega) *
-            cur_states.middleRows(6, 4).col(i);
-    }
+    soa_.resize(number_states, 9);
+    soa_.leftCols(4)      = cur_states.middleRows(6, 4).transpose().array();
+    soa_.middleCols(4, 3) = 0.5 * T_ * cur_states.bottomRows(3).transpose().array();
+
+    const auto q_w = soa_.col(0);
+    const auto q_x = soa_.col(1);
+    const auto q_y = soa_.col(2);
+    const auto q_z = soa_.col(3);
+    const auto w_x = soa_.col(4);
+    const auto w_y = soa_.col(5);
+    const auto w_z = soa_.col(6);
+
+    /* The smallest double is added to avoid sin(0) / 0 being calculated as -nan. */
+    soa_.col(7) = (w_x.square() + w_y.square() + w_z.square()).sqrt() + std::numeric_limits<double>::min();
+    soa_.col(8) = soa_.col(7).sin() / soa_.col(7);
+    soa_.col(7) = soa_.col(7).cos();
+
+    const auto cos_w = soa_.col(7);
+    const auto sinc_w = soa_.col(8);
+
+    prop_states.row(6) = (cos_w * q_w + sinc_w * (- w_x * q_x - w_y * q_y - w_z * q_z)).matrix().transpose();
+    prop_states.row(7) = (cos_w * q_x + sinc_w * (  w_x * q_w + w_z * q_y - w_y * q_z)).matrix().transpose();
+    prop_states.row(8) = (cos_w * q_y + sinc_w * (  w_y * q_w - w_z * q_x + w_x * q_z)).matrix().transpose();
+    prop_states.row(9) = (cos_w * q_z + sinc_w * (  w_z * q_w + w_y * q_x - w_x * q_y)).matrix().transpose();
 
     /**
      * Propagate angular velocity
@@ -133,9 +155,19 @@ void Random3DPose::motion(const Ref<const MatrixXd>& cur_states, Ref<MatrixXd> p
 
 MatrixXd Random3DPose::getNoiseSample(const std::size_t num)
 {
+    /* Each lane fills a contiguous chunk of columns using its own generator. */
     MatrixXd rand_vectors(6 + 3, num);
-    for (int i = 0; i < rand_vectors.size(); i++)
-        *(rand_vectors.data() + i) = gauss_rnd_sample_();
+    const std::size_t chunk_size = (num + number_lanes_ - 1) / number_lanes_;
+
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < number_lanes_; i++)
+    {
+        const std::size_t begin = std::min(num, i * chunk_size) * rand_vectors.rows();
+        const std::size_t end = std::min(num, (i + 1) * chunk_size) * rand_vectors.rows();
+
+        for (std::size_t j = begin; j < end; j++)
+            *(rand_vectors.data() + j) = distributions_[i](generators_[i]);
+    }
 
     MatrixXd noise(6 + 3, num);
     noise.topRows(6)    = sqrt_Q_pos_ * rand_vectors.topRows(6);
@@ -9,6 +9,10 @@
 
 #include <Eigen/Dense>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace bfl;
 using namespace Eigen;
 
@@ -21,14 +25,55 @@ SimulatedFilter::SimulatedFilter
     unsigned int simulation_steps
 ) :
     GaussianFilter_(initial_state, std::move(prediction), std::move(correction)),
-    simulation_steps_(simulation_steps)
-{ }
+    simulation_steps_(simulation_steps),
+    verbose_(true),
+    number_of_threads_(0)
+{
+    estimates_.reserve(simulation_steps_);
+    step_durations_.reserve(simulation_steps_);
+}
 
 
 SimulatedFilter::~SimulatedFilter()
 { }
 
 
+const std::vector<VectorXd>& SimulatedFilter::getEstimates() const
+{
+    return estimates_;
+}
+
+
+const std::vector<double>& SimulatedFilter::getStepDurations() const
+{
+    return step_durations_;
+}
+
+
+void SimulatedFilter::setVerbose(const bool verbose)
+{
+    verbose_ = verbose;
+}
+
+
+void SimulatedFilter::setNumberOfThreads(const std::size_t number_of_threads)
+{
+    number_of_threads_ = number_of_threads;
+}
+
+
+bool SimulatedFilter::initialization()
+{
+#ifdef _OPENMP
+    /* The number of threads is a property of the calling thread, i.e. the one running the filter. */
+    if (number_of_threads_ > 0)
+        omp_set_num_threads(number_of_threads_);
+#endif
+
+    return GaussianFilter_::initialization();
+}
+
+
 bool SimulatedFilter::runCondition()
 {
     if (getFilteringStep() < simulation_steps_)
@@ -45,6 +90,12 @@ std::vector<std::string> SimulatedFilter::log_file_names(const std::string& pref
 }
 
 
+std::vector<std::string> SimulatedFilter::binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name)
+{
+    return log_file_names(prefix_path, prefix_name);
+}
+
+
 void SimulatedFilter::filteringStep()
 {
     std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
@@ -53,10 +104,14 @@ void SimulatedFilter::filteringStep()
 
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
-    std::cout << "Executed step in "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
-              << " ms"
-              << std::endl;
+    estimates_.push_back(corrected_state_.mean());
+    step_durations_.push_back(std::chrono::duration<double>(end - start).count());
+
+    if (verbose_)
+        std::cout << "Executed step in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+                  << " ms"
+                  << std::endl;
 
     // Allow the state model to evaluate the sampling time online
     prediction_->getStateModel().setProperty("tick");
@@ -65,5 +120,8 @@ void SimulatedFilter::filteringStep()
 
 void SimulatedFilter::log()
 {
-    logger(predicted_state_.mean().transpose(), corrected_state_.mean().transpose());
+    if (is_binary_log_enabled())
+        binary_logger(predicted_state_.mean(), corrected_state_.mean());
+    else
+        logger(predicted_state_.mean().transpose(), corrected_state_.mean().transpose());
 }
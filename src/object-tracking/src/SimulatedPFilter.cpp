@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <SimulatedPFilter.h>
+
+#include <BayesFilters/utils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace bfl;
+using namespace Eigen;
+
+
+SimulatedPFilter::SimulatedPFilter
+(
+    const std::size_t num_particle,
+    const double resampling_threshold,
+    const std::string point_estimate_method,
+    const std::size_t point_estimate_window_size,
+    std::unique_ptr<ParticleSetInitialization> initialization,
+    std::unique_ptr<PFPrediction> prediction,
+    std::unique_ptr<ParticlesCorrection> correction,
+    std::unique_ptr<Resampling> resampling,
+    unsigned int simulation_steps
+) :
+    SIS
+    (
+        num_particle,
+        9, /* linear part of the state */
+        3, /* circular part of the state */
+        std::move(initialization),
+        std::move(prediction),
+        std::move(correction),
+        std::move(resampling)
+    ),
+    point_estimate_extraction_(9, 3),
+    resampling_threshold_(resampling_threshold),
+    simulation_steps_(simulation_steps),
+    verbose_(true),
+    number_of_threads_(0)
+{
+    // Setup point estimates extraction
+    set_point_estimate_method(point_estimate_method);
+    point_estimate_extraction_.setMobileAverageWindowSize(point_estimate_window_size);
+
+    step_durations_.reserve(simulation_steps_);
+    step_points_.reserve(simulation_steps_);
+    estimates_.reserve(simulation_steps_);
+}
+
+
+SimulatedPFilter::~SimulatedPFilter()
+{ }
+
+
+bool SimulatedPFilter::set_point_estimate_method(const std::string& method)
+{
+    const std::vector<std::pair<std::string, EstimatesExtraction::ExtractionMethod>> methods =
+    {
+        {"mean",  EstimatesExtraction::ExtractionMethod::mean},
+        {"smean", EstimatesExtraction::ExtractionMethod::smean},
+        {"wmean", EstimatesExtraction::ExtractionMethod::wmean},
+        {"emean", EstimatesExtraction::ExtractionMethod::emean},
+        {"mode",  EstimatesExtraction::ExtractionMethod::mode},
+        {"smode", EstimatesExtraction::ExtractionMethod::smode},
+        {"wmode", EstimatesExtraction::ExtractionMethod::wmode},
+        {"emode", EstimatesExtraction::ExtractionMethod::emode}
+    };
+
+    for (const auto& entry : methods)
+    {
+        if (entry.first == method)
+        {
+            point_estimate_extraction_.setMethod(entry.second);
+
+            return true;
+        }
+    }
+
+    /* map, smap, wmap and emap extraction methods are not supported. */
+    return false;
+}
+
+
+void SimulatedPFilter::printStatistics()
+{
+    if (step_durations_.size() == 0)
+        return;
+
+    std::vector<double> sorted_durations(step_durations_);
+    std::sort(sorted_durations.begin(), sorted_durations.end());
+
+    auto percentile = [&sorted_durations](const double p)
+    {
+        std::size_t index = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted_durations.size()));
+        index = std::min(std::max(index, std::size_t(1)), sorted_durations.size());
+
+        return sorted_durations[index - 1] * 1000.0;
+    };
+
+    const double total_duration = std::accumulate(step_durations_.begin(), step_durations_.end(), 0.0);
+    const double total_points = std::accumulate(step_points_.begin(), step_points_.end(), 0.0);
+
+    std::cout << log_ID_ << " Executed " << step_durations_.size() << " steps with " << num_particle_ << " particles in " << total_duration << " s" << std::endl;
+    std::cout << log_ID_ << " - step latency (ms): p50 " << percentile(50)
+                                                << " p90 " << percentile(90)
+                                                << " p99 " << percentile(99)
+                                                << " max " << sorted_durations.back() * 1000.0 << std::endl;
+    std::cout << log_ID_ << " - particles/s: " << num_particle_ * step_durations_.size() / total_duration << std::endl;
+    std::cout << log_ID_ << " - point queries/s: " << num_particle_ * total_points / total_duration << std::endl;
+}
+
+
+const std::vector<VectorXd>& SimulatedPFilter::getEstimates() const
+{
+    return estimates_;
+}
+
+
+const std::vector<double>& SimulatedPFilter::getStepDurations() const
+{
+    return step_durations_;
+}
+
+
+void SimulatedPFilter::setVerbose(const bool verbose)
+{
+    verbose_ = verbose;
+}
+
+
+void SimulatedPFilter::setNumberOfThreads(const std::size_t number_of_threads)
+{
+    number_of_threads_ = number_of_threads;
+}
+
+
+bool SimulatedPFilter::initialization()
+{
+#ifdef _OPENMP
+    /* The number of threads is a property of the calling thread, i.e. the one running the filter. */
+    if (number_of_threads_ > 0)
+        omp_set_num_threads(number_of_threads_);
+#endif
+
+    return SIS::initialization();
+}
+
+
+bool SimulatedPFilter::runCondition()
+{
+    if (getFilteringStep() < simulation_steps_)
+        return true;
+    else
+        return false;
+}
+
+
+std::vector<std::string> SimulatedPFilter::log_file_names(const std::string& prefix_path, const std::string& prefix_name)
+{
+    return  {prefix_path + "/" + prefix_name + "_estimate"};
+}
+
+
+std::vector<std::string> SimulatedPFilter::binary_log_file_names(const std::string& prefix_path, const std::string& prefix_name)
+{
+    return log_file_names(prefix_path, prefix_name);
+}
+
+
+void SimulatedPFilter::filteringStep()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (getFilteringStep() != 0)
+        prediction_->predict(cor_particle_, pred_particle_);
+
+    correction_->correct(pred_particle_, cor_particle_);
+
+    /* Normalize weights using LogSumExp. */
+    cor_particle_.weight().array() -= utils::log_sum_exp(cor_particle_.weight());
+
+    double neff = resampling_->neff(cor_particle_.weight());
+    if (neff < static_cast<double>(num_particle_) * resampling_threshold_)
+    {
+        ParticleSet res_particle(num_particle_, state_size_);
+        VectorXi res_parent(num_particle_, 1);
+
+        resampling_->resample(cor_particle_, res_particle, res_parent);
+
+        cor_particle_ = res_particle;
+    }
+
+    // Update the point estimate extraction
+    bool valid_estimate;
+    std::tie(valid_estimate, point_estimate_) =  point_estimate_extraction_.extract(cor_particle_.state(), cor_particle_.weight());
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    // Store statistics
+    step_durations_.push_back(std::chrono::duration<double>(end - start).count());
+    step_points_.push_back(correction_->getMeasurementModel().getOutputSize().first / 3);
+
+    if (valid_estimate)
+    {
+        estimates_.push_back(point_estimate_);
+
+        if (is_binary_log_enabled())
+            binary_logger(point_estimate_);
+        else
+            logger(point_estimate_.transpose());
+    }
+    else
+    {
+        estimates_.push_back(VectorXd::Constant(state_size_, std::numeric_limits<double>::quiet_NaN()));
+
+        if (verbose_)
+            std::cout << log_ID_ << " Unable to extract the estimate!" << std::endl;
+    }
+
+    // Allow the state model to evaluate the sampling time online
+    prediction_->getStateModel().setProperty("tick");
+
+    if (verbose_ && (step_durations_.size() == simulation_steps_))
+        printStatistics();
+}
+
+
+void SimulatedPFilter::log()
+{ }
@@ -7,6 +7,13 @@
 
 #include <SimulatedPointCloud.h>
 
+#include <algorithm>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace bfl;
 using namespace Eigen;
 
@@ -52,9 +59,8 @@ SimulatedPointCloud::SimulatedPointCloud
     noisy_(false),
     enable_back_culling_(enable_back_culling),
     step_(0),
-    generator_(std::mt19937_64(seed)),
-    distribution_(std::normal_distribution<float>(0.0, 1.0)),
-    gauss_rnd_sample_([&] { return (distribution_)(generator_); })
+    seed_(seed),
+    generator_(std::mt19937_64(seed))
 {
     // Convert mesh using MeshImporter
     std::istringstream mesh_input;
@@ -69,9 +75,10 @@ SimulatedPointCloud::SimulatedPointCloud
     }
 
     // Open converted obj using vcg mesh importer
+    simpleTriMesh trimesh;
     OBJImportInfo info;
     int outcome;
-    outcome = simpleTriMeshImporter::OpenStream(trimesh_, mesh_input, info);
+    outcome = simpleTriMeshImporter::OpenStream(trimesh, mesh_input, info);
 
     if(simpleTriMeshImporter::ErrorCritical(outcome))
     {
@@ -81,15 +88,18 @@ SimulatedPointCloud::SimulatedPointCloud
     }
 
     // Update bounding box
-    vcg::tri::UpdateBounding<simpleTriMesh>::Box(trimesh_);
+    vcg::tri::UpdateBounding<simpleTriMesh>::Box(trimesh);
 
     // Update face normals
-    if(trimesh_.fn > 0)
-        vcg::tri::UpdateNormal<simpleTriMesh>::PerFace(trimesh_);
+    if(trimesh.fn > 0)
+        vcg::tri::UpdateNormal<simpleTriMesh>::PerFace(trimesh);
 
     // Update vertex normals
-    if(trimesh_.vn > 0)
-	vcg::tri::UpdateNormal<simpleTriMesh>::PerVertex(trimesh_);
+    if(trimesh.vn > 0)
+	vcg::tri::UpdateNormal<simpleTriMesh>::PerVertex(trimesh);
+
+    // Sample the dense cloud once, measurements are then obtained by transforming and culling it
+    sampleDenseCloud(trimesh);
 }
 
 
@@ -106,28 +116,63 @@ void SimulatedPointCloud::enableNoise(const double std_noise_x, const double std
 }
 
 
-void SimulatedPointCloud::transformModel(const VectorXd& state, simpleTriMesh& transformed)
+void SimulatedPointCloud::sampleDenseCloud(simpleTriMesh& trimesh)
 {
-    // Duplicate the original mesh
-    copyTriMesh::Mesh(transformed, trimesh_);
+    const std::size_t number_dense_points = number_of_points_ * oversampling_;
+
+    // Perform Disk Poisson Sampling
+
+    // Some default parametrs as found in MeshLab
+    std::size_t oversampling = 10;
+    triMeshSurfSampler::PoissonDiskParam poiss_params;
+    poiss_params.radiusVariance = 1;
+    poiss_params.geodesicDistanceFlag = false;
+    poiss_params.bestSampleChoiceFlag = true;
+    poiss_params.bestSamplePoolSize = 10;
 
-    // Update the bounding box
-    vcg::tri::UpdateBounding<simpleTriMesh>::Box(transformed);
+    // Estimate radius required to obtain disk poisson sampling
+    // with the number_dense_points points
+    simpleTriMesh::ScalarType radius;
+    radius = triMeshSurfSampler::ComputePoissonDiskRadius(trimesh, number_dense_points);
+
+    // Generate preliminar montecarlo sampling with uniform probability
+    // (samples take the normal of the face they belong to)
+    simpleTriMesh montecarlo_mesh;
+    triMeshSampler mc_sampler(montecarlo_mesh);
+    mc_sampler.qualitySampling = true;
+    mc_sampler.perFaceNormal = true;
+    triMeshSurfSampler::Montecarlo(trimesh,
+                                   mc_sampler,
+                                   number_dense_points * oversampling);
+    // Copy the bounding box from the original mesh
+    montecarlo_mesh.bbox = trimesh.bbox;
+
+    // Generate disk poisson samples by pruning the montecarlo cloud
+    simpleTriMesh poiss_mesh;
+    triMeshSampler dp_sampler(poiss_mesh);
+    triMeshSurfSampler::PoissonDiskPruning(dp_sampler,
+                                           montecarlo_mesh,
+                                           radius,
+                                           poiss_params);
 
-    // Set the translational part of the transformation
-    vcgHomMatrix Htransl;
-    Htransl.SetTranslate(state(0), state(1), state(2));
+    // Store the oriented cloud
+    std::size_t number_points = std::distance(poiss_mesh.vert.begin(), poiss_mesh.vert.end());
+    dense_points_.resize(3, number_points);
+    dense_normals_.resize(3, number_points);
+    std::size_t i = 0;
+    for (VertexIterator vi = poiss_mesh.vert.begin(); vi != poiss_mesh.vert.end(); vi++)
+    {
+        const auto p = vi->cP();
+        const auto n = vi->cN();
 
-    // Set the rotational part of the transformation
-    vcgHomMatrix Hrot;
-    vcgQuaternion q(state(6), state(7), state(8), state(9));
-    q.ToMatrix(Hrot);
+        dense_points_.col(i) << p[0], p[1], p[2];
+        dense_normals_.col(i) << n[0], n[1], n[2];
+        dense_normals_.col(i).normalize();
 
-    // Compose the homogeneous matrix
-    vcgHomMatrix H = Htransl * Hrot;
+        i++;
+    }
 
-    // Apply transformation to the mesh.
-    transformTriMesh::Matrix(transformed, H, true);
+    dense_spacing_ = radius;
 }
 
 
@@ -147,104 +192,127 @@ bool SimulatedPointCloud::freeze(const Data& data)
 
         const Ref<const VectorXd>& state = any::any_cast<MatrixXd>(simulated_model_->getData());
 
-        measurement_ = samplePointCloud(state);
+        ground_truth_.push_back(state);
+
+        measurement_ = samplePointCloud(state, generator_);
     }
 
-    logger(measurement_.transpose());
+    if (is_binary_log_enabled())
+        binary_logger(measurement_);
+    else
+        logger(measurement_.transpose());
 
     step_++;
 
     return true;
 }
 
-VectorXd SimulatedPointCloud::samplePointCloud(const VectorXd& state)
+VectorXd SimulatedPointCloud::samplePointCloud(const VectorXd& state, std::mt19937_64& generator)
 {
-    // Transform the model using the current pose set
-    simpleTriMesh mesh_cp;
-    transformModel(state, mesh_cp);
+    // Transform the dense cloud using the current pose
+    const Vector3d position = state.head<3>();
+    const Matrix3d rotation = Quaterniond(state(6), state(7), state(8), state(9)).normalized().toRotationMatrix();
+
+    Matrix3Xd points = (rotation * dense_points_).colwise() + position;
 
+    std::vector<std::size_t> candidates;
+    candidates.reserve(points.cols());
     if (enable_back_culling_)
     {
-        // Perform back-face culling
-        Vector3d normal(3);
-        Vector3d vertex0(3);
-        for (FaceIterator fi = mesh_cp.face.begin(); fi != mesh_cp.face.end(); fi++)
+        // Keep points whose normal is facing the observer
+        for (std::size_t i = 0; i < points.cols(); i++)
         {
-            // Extract face normal
-            const auto n = fi->cN();
-            normal << n[0], n[1], n[2];
+            const Vector3d normal = rotation * dense_normals_.col(i);
 
-            // Extract position of first vertex of the face
-            const auto v = fi->cP(0);
-            vertex0 << v[0], v[1], v[2];
+            if ((points.col(i) - observer_origin_).dot(normal) < 0)
+                candidates.push_back(i);
+        }
 
-            // Eval vector from view point to first vertex
-            VectorXd diff = vertex0 - observer_origin_;
+        // Remove points occluded by other parts of the object
+        candidates = findUnoccludedPoints(points, position, candidates);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < points.cols(); i++)
+            candidates.push_back(i);
+    }
 
-            // Perform culling check
-            if (diff.dot(normal) >= 0)
-                // Remove face
-                simpleTriMeshAllocator::DeleteFace(mesh_cp, *fi);
-        }
-        // Perform face garbage collection after culling
-        simpleTriMeshAllocator::CompactFaceVector(mesh_cp);
+    // Subsample the remaining points uniformly at random (partial Fisher-Yates shuffle)
+    std::size_t number_points = std::min(number_of_points_, candidates.size());
+    for (std::size_t i = 0; i < number_points; i++)
+    {
+        std::uniform_int_distribution<std::size_t> index(i, candidates.size() - 1);
+        std::swap(candidates[i], candidates[index(generator)]);
     }
 
-    // Perform Disk Poisson Sampling
+    // Store the cloud
+    VectorXd cloud(3 * number_points);
+    for (std::size_t i = 0; i < number_points; i++)
+        cloud.segment(i * 3, 3) = points.col(candidates[i]);
 
-    // Some default parametrs as found in MeshLab
-    std::size_t oversampling = 20;
-    triMeshSurfSampler::PoissonDiskParam poiss_params;
-    poiss_params.radiusVariance = 1;
-    poiss_params.geodesicDistanceFlag = false;
-    poiss_params.bestSampleChoiceFlag = true;
-    poiss_params.bestSamplePoolSize = 10;
+    // Add noise if required
+    if (noisy_)
+        cloud += getNoiseSample(number_points, generator);
 
-    // Estimate radius required to obtain disk poisson sampling
-    // with the number_of_points points
-    simpleTriMesh::ScalarType radius;
-    radius = triMeshSurfSampler::ComputePoissonDiskRadius(mesh_cp, number_of_points_);
+    return cloud;
+}
 
-    // Generate preliminar montecarlo sampling with uniform probability
-    simpleTriMesh montecarlo_mesh;
-    triMeshSampler mc_sampler(montecarlo_mesh);
-    mc_sampler.qualitySampling=true;
-    triMeshSurfSampler::Montecarlo(mesh_cp,
-				   mc_sampler,
-				   number_of_points_ * oversampling);
-    // Copy the bounding box from the original mesh
-    montecarlo_mesh.bbox = mesh_cp.bbox;
 
-    // Generate disk poisson samples by pruning the montecarlo cloud
-    simpleTriMesh poiss_mesh;
-    triMeshSampler dp_sampler(poiss_mesh);
-    triMeshSurfSampler::PoissonDiskPruning(dp_sampler,
-					   montecarlo_mesh,
-					   radius,
-					   poiss_params);
-    vcg::tri::UpdateBounding<simpleTriMesh>::Box(poiss_mesh);
+std::vector<std::size_t> SimulatedPointCloud::findUnoccludedPoints(const Ref<const Matrix3Xd>& points, const Ref<const Vector3d>& center, const std::vector<std::size_t>& candidates)
+{
+    if (candidates.size() == 0)
+        return candidates;
+
+    // Frame attached to the observer having the z axis pointing towards the object
+    const Vector3d line_of_sight = center - observer_origin_;
+    const Vector3d axis_z = line_of_sight.normalized();
+    const Vector3d axis_x = axis_z.unitOrthogonal();
+    const Vector3d axis_y = axis_z.cross(axis_x);
+
+    // Project the candidates on the plane z = 1 and evaluate their distance from the observer
+    Matrix2Xd projections(2, candidates.size());
+    VectorXd ranges(candidates.size());
+    for (std::size_t i = 0; i < candidates.size(); i++)
+    {
+        const Vector3d ray = points.col(candidates[i]) - observer_origin_;
+        const double z = std::max(ray.dot(axis_z), std::numeric_limits<double>::epsilon());
 
+        projections(0, i) = ray.dot(axis_x) / z;
+        projections(1, i) = ray.dot(axis_y) / z;
+        ranges(i) = ray.norm();
+    }
 
-    // Store the cloud
-    std::size_t number_points = std::distance(poiss_mesh.vert.begin(), poiss_mesh.vert.end());
-    VectorXd cloud(3 * number_points);
-    std::size_t i = 0;
-    for (VertexIterator vi = poiss_mesh.vert.begin(); vi != poiss_mesh.vert.end(); vi++)
+    // Rays are discretized on a grid such that, on the object surface,
+    // a cell covers about twice the spacing of the dense cloud
+    const std::size_t max_cells = 1024;
+    const Vector2d min_projection = projections.rowwise().minCoeff();
+    const Vector2d extent = projections.rowwise().maxCoeff() - min_projection;
+    const double cell_size = std::max(2.0 * dense_spacing_ / line_of_sight.norm(), extent.maxCoeff() / (max_cells - 1));
+    const std::size_t cells_x = static_cast<std::size_t>(extent(0) / cell_size) + 1;
+    const std::size_t cells_y = static_cast<std::size_t>(extent(1) / cell_size) + 1;
+
+    std::vector<std::size_t> cells(candidates.size());
+    std::vector<double> closest(cells_x * cells_y, std::numeric_limits<double>::infinity());
+    for (std::size_t i = 0; i < candidates.size(); i++)
     {
-	// Extract the point
-	const auto p = vi->cP();
+        const std::size_t x = static_cast<std::size_t>((projections(0, i) - min_projection(0)) / cell_size);
+        const std::size_t y = static_cast<std::size_t>((projections(1, i) - min_projection(1)) / cell_size);
 
-        // Add to the cloud
-        cloud.segment(i * 3, 3) << p[0], p[1], p[2];
-
-        i++;
+        cells[i] = std::min(y, cells_y - 1) * cells_x + std::min(x, cells_x - 1);
+        closest[cells[i]] = std::min(closest[cells[i]], ranges(i));
     }
 
-    // Add noise if required
-    if (noisy_)
-        cloud += getNoiseSample(number_points);
+    // A point is visible if it is the closest, up to the surface sampling resolution, along its ray
+    const double tolerance = 2.0 * dense_spacing_;
+    std::vector<std::size_t> visible;
+    visible.reserve(candidates.size());
+    for (std::size_t i = 0; i < candidates.size(); i++)
+    {
+        if (ranges(i) <= closest[cells[i]] + tolerance)
+            visible.push_back(candidates[i]);
+    }
 
-    return cloud;
+    return visible;
 }
 
 
@@ -262,25 +330,61 @@ std::pair<std::size_t, std::size_t> SimulatedPointCloud::getOutputSize() const
 
 bool SimulatedPointCloud::prefetchMeasurements(const std::size_t number_of_steps)
 {
+    // Buffer the simulated states
+    bool valid_states = true;
+    std::vector<VectorXd> states;
+    states.reserve(number_of_steps);
     for (std::size_t i = 0; i < number_of_steps; i++)
     {
         if (!simulated_model_->bufferData())
-            return false;
+        {
+            valid_states = false;
+            break;
+        }
 
-        const Ref<const VectorXd>& state = any::any_cast<MatrixXd>(simulated_model_->getData());
+        states.push_back(any::any_cast<MatrixXd>(simulated_model_->getData()));
+    }
 
-        fetched_measurements_[i] = samplePointCloud(state);
+    // Sample the point clouds in parallel,
+    // each step uses its own generator so that the result does not depend on the number of threads
+    std::vector<VectorXd> clouds(states.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (std::size_t i = 0; i < states.size(); i++)
+    {
+        std::seed_seq step_seed{seed_, static_cast<unsigned int>(i)};
+        std::mt19937_64 generator(step_seed);
+
+        clouds[i] = samplePointCloud(states[i], generator);
     }
 
-    return true;
+    for (std::size_t i = 0; i < clouds.size(); i++)
+        fetched_measurements_[i] = std::move(clouds[i]);
+
+    ground_truth_.insert(ground_truth_.end(), states.begin(), states.end());
+
+    return valid_states;
+}
+
+
+const std::vector<VectorXd>& SimulatedPointCloud::getGroundTruth() const
+{
+    return ground_truth_;
 }
 
 
 VectorXd SimulatedPointCloud::getNoiseSample(const std::size_t number)
 {
+    return getNoiseSample(number, generator_);
+}
+
+
+VectorXd SimulatedPointCloud::getNoiseSample(const std::size_t number, std::mt19937_64& generator)
+{
+    std::normal_distribution<double> distribution(0.0, 1.0);
+
     MatrixXd rand_vectors(3, number);
     for (int i = 0; i < rand_vectors.size(); i++)
-        *(rand_vectors.data() + i) = gauss_rnd_sample_();
+        *(rand_vectors.data() + i) = distribution(generator);
 
     MatrixXd samples = sqrt_noise_covariance_ * rand_vectors;
 
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <StageStatistics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+
+void LatencyHistogram::record(const std::chrono::steady_clock::duration& latency)
+{
+    const std::int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    const std::uint64_t value = static_cast<std::uint64_t>(std::max(microseconds, std::int64_t(0)));
+
+    counts_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t max = max_.load(std::memory_order_relaxed);
+    while ((value > max) && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<std::uint64_t>& count : counts_)
+        count.store(0, std::memory_order_relaxed);
+
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+
+std::uint64_t LatencyHistogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+
+double LatencyHistogram::mean() const
+{
+    const std::uint64_t count = count_.load(std::memory_order_relaxed);
+    if (count == 0)
+        return 0.0;
+
+    return static_cast<double>(sum_.load(std::memory_order_relaxed)) / count / 1000.0;
+}
+
+
+double LatencyHistogram::max() const
+{
+    return static_cast<double>(max_.load(std::memory_order_relaxed)) / 1000.0;
+}
+
+
+double LatencyHistogram::percentile(const double percentage) const
+{
+    /* The histogram may be updated while it is read, hence the total is taken from the buckets themselves. */
+    std::array<std::uint64_t, buckets_> counts;
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < buckets_; i++)
+    {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (total == 0)
+        return 0.0;
+
+    const std::uint64_t rank = std::max(static_cast<std::uint64_t>(std::ceil(percentage / 100.0 * total)), std::uint64_t(1));
+
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < buckets_; i++)
+    {
+        cumulative += counts[i];
+        if (cumulative >= rank)
+            return std::min(bucketValue(i) / 1000.0, max());
+    }
+
+    return max();
+}
+
+
+std::size_t LatencyHistogram::bucketIndex(const std::uint64_t value)
+{
+    const std::uint64_t saturated = std::min(value, (std::uint64_t(1) << max_bits_) - 1);
+    if (saturated < sub_buckets_)
+        return saturated;
+
+    /* Position of the most significant bit. */
+    std::size_t exponent = 0;
+    for (std::uint64_t v = saturated; v > 1; v >>= 1)
+        exponent++;
+
+    const std::size_t shift = exponent - sub_bucket_bits_;
+
+    return (shift + 1) * sub_buckets_ + ((saturated >> shift) - sub_buckets_);
+}
+
+
+double LatencyHistogram::bucketValue(const std::size_t index)
+{
+    if (index < sub_buckets_)
+        return index;
+
+    const std::size_t shift = index / sub_buckets_ - 1;
+    const std::uint64_t lower = (sub_buckets_ + index % sub_buckets_) << shift;
+    const std::uint64_t width = std::uint64_t(1) << shift;
+
+    return lower + (width - 1) / 2.0;
+}
+
+
+const std::array<std::string, StageStatistics::number_stages_> StageStatistics::stage_names_ =
+{
+    "step",
+    "bounding_box",
+    "prediction",
+    "correction",
+    "measurement_freeze",
+    "depth_wait",
+    "opc_wait",
+    "occlusion",
+    "ukf_correction",
+    "sampling",
+    "likelihood",
+    "kdtree_query",
+    "resampling",
+    "publication"
+};
+
+
+StageStatistics::StageStatistics()
+{ }
+
+
+StageStatistics& StageStatistics::instance()
+{
+    static StageStatistics statistics;
+
+    return statistics;
+}
+
+
+void StageStatistics::record(const Stage stage, const std::chrono::steady_clock::duration& latency)
+{
+    histograms_[static_cast<std::size_t>(stage)].record(latency);
+}
+
+
+void StageStatistics::reset()
+{
+    for (LatencyHistogram& histogram : histograms_)
+        histogram.reset();
+}
+
+
+std::vector<std::string> StageStatistics::summary() const
+{
+    std::vector<std::string> summary;
+
+    for (std::size_t i = 0; i < number_stages_; i++)
+    {
+        const LatencyHistogram& histogram = histograms_[i];
+        if (histogram.count() == 0)
+            continue;
+
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(3)
+               << stage_names_[i]
+               << " count " << histogram.count()
+               << " mean "  << histogram.mean()
+               << " p50 "   << histogram.percentile(50.0)
+               << " p90 "   << histogram.percentile(90.0)
+               << " p99 "   << histogram.percentile(99.0)
+               << " p999 "  << histogram.percentile(99.9)
+               << " max "   << histogram.max();
+
+        summary.push_back(stream.str());
+    }
+
+    return summary;
+}
+
+
+ScopedStageTimer::ScopedStageTimer(const StageStatistics::Stage stage) :
+    stage_(stage),
+    start_(std::chrono::steady_clock::now())
+{ }
+
+
+ScopedStageTimer::~ScopedStageTimer()
+{
+    StageStatistics::instance().record(stage_, std::chrono::steady_clock::now() - start_);
+}
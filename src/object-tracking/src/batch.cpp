@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include <BatchRunner.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace Eigen;
+using namespace yarp::os;
+
+
+/**
+ * A value of the parameter grid, i.e. the group and the key of a parameter in config_simulation.ini and its value.
+ */
+using GridValue = std::tuple<std::string, std::string, Value>;
+
+
+/**
+ * Look up the parameters in the configuration, giving precedence to the values of the current grid point.
+ */
+class TrialConfiguration
+{
+public:
+    TrialConfiguration(const ResourceFinder& rf, const std::vector<GridValue>& overrides) :
+        rf_(rf),
+        overrides_(overrides)
+    { }
+
+    Value find(const std::string& group, const std::string& key) const
+    {
+        for (const GridValue& entry : overrides_)
+        {
+            if ((std::get<0>(entry) == group) && (std::get<1>(entry) == key))
+                return std::get<2>(entry);
+        }
+
+        return rf_.findGroup(group).find(key);
+    }
+
+    Value check(const std::string& group, const std::string& key, const Value& fallback) const
+    {
+        Value value = find(group, key);
+
+        return value.isNull() ? fallback : value;
+    }
+
+    VectorXd findVector(const std::string& group, const std::string& key, const std::size_t size) const
+    {
+        Value value = find(group, key);
+
+        Bottle* list = value.asList();
+        if ((list == nullptr) || (list->size() != size))
+            throw(std::runtime_error("TRIALCONFIGURATION::FINDVECTOR::ERROR\n\tError: unable to load vector " + group + "::" + key + "."));
+
+        VectorXd vector(size);
+        for (std::size_t i = 0; i < size; i++)
+            vector(i) = list->get(i).asDouble();
+
+        return vector;
+    }
+
+private:
+    const ResourceFinder& rf_;
+
+    const std::vector<GridValue>& overrides_;
+};
+
+
+TrialParameters loadTrialParameters(ResourceFinder& rf, const TrialConfiguration& config)
+{
+    TrialParameters p;
+
+    p.filter_type = config.check("MODE", "filter_type", Value("ukf")).asString();
+
+    p.number_particles           = config.check("PARTICLES", "number", Value(1)).asInt();
+    p.resampling_threshold       = config.check("PARTICLES", "resample_threshold", Value(0.5)).asDouble();
+    p.likelihood_variance        = config.check("LIKELIHOOD", "variance", Value(0.1)).asDouble();
+    p.point_estimate_method      = config.check("POINT_ESTIMATE", "method", Value("smean")).asString();
+    p.point_estimate_window_size = config.check("POINT_ESTIMATE", "window_size", Value(10)).asInt();
+
+    p.x_0           = config.findVector("INITIAL_CONDITION", "x_0",           3);
+    p.v_0           = config.findVector("INITIAL_CONDITION", "v_0",           3);
+    p.euler_0       = config.findVector("INITIAL_CONDITION", "euler_0",       3);
+    p.euler_dot_0   = config.findVector("INITIAL_CONDITION", "euler_dot_0",   3);
+    p.cov_x_0       = config.findVector("INITIAL_CONDITION", "cov_x_0",       3);
+    p.cov_v_0       = config.findVector("INITIAL_CONDITION", "cov_v_0",       3);
+    p.cov_eul_0     = config.findVector("INITIAL_CONDITION", "cov_eul_0",     3);
+    p.cov_eul_dot_0 = config.findVector("INITIAL_CONDITION", "cov_eul_dot_0", 3);
+    p.center_0      = config.findVector("INITIAL_CONDITION", "center_0",      6);
+    p.radius_0      = config.findVector("INITIAL_CONDITION", "radius_0",      6);
+
+    p.kin_q_x          = config.findVector("KINEMATIC_MODEL", "q_x", 3);
+    p.kin_q_eul        = config.findVector("KINEMATIC_MODEL", "q_eul", 3);
+    p.noise_covariance = config.findVector("MEASUREMENT_MODEL", "noise_covariance", 3);
+
+    p.ut_alpha = config.check("UNSCENTED_TRANSFORM", "alpha", Value(1.0)).asDouble();
+    p.ut_beta  = config.check("UNSCENTED_TRANSFORM", "beta", Value(2.0)).asDouble();
+    p.ut_kappa = config.check("UNSCENTED_TRANSFORM", "kappa", Value(0.0)).asDouble();
+
+    p.pc_pred_num_samples = config.check("POINT_CLOUD_PREDICTION", "number_samples", Value(100)).asInt();
+
+    p.sim_sample_time = config.check("SIMULATION", "sample_time", Value(1.0)).asDouble();
+    p.sim_duration    = config.check("SIMULATION", "duration", Value(1.0)).asDouble();
+    p.sim_psd_acc     = config.findVector("SIMULATION", "psd_acc", 3);
+    p.sim_psd_w       = config.findVector("SIMULATION", "psd_w", 3);
+    p.sim_x_0         = config.findVector("SIMULATION", "x_0", 3);
+    p.sim_v_0         = config.findVector("SIMULATION", "v_0", 3);
+    p.sim_q_0         = config.findVector("SIMULATION", "q_0", 4);
+    p.sim_w_0         = config.findVector("SIMULATION", "w_0", 3);
+
+    p.sim_point_cloud_number       = config.check("SIMULATED_POINT_CLOUD", "number_points", Value(1000)).asInt();
+    p.sim_point_cloud_observer     = config.findVector("SIMULATED_POINT_CLOUD", "observer_origin", 3);
+    p.sim_point_cloud_noise_std    = config.findVector("SIMULATED_POINT_CLOUD", "noise_std", 3);
+    p.sim_point_cloud_back_culling = config.check("SIMULATED_POINT_CLOUD", "back_culling", Value(true)).asBool();
+
+    const std::string object_name = config.check("OBJECT", "object_name", Value("ycb_mustard")).asString();
+    p.object_mesh_path_ply = rf.findPath("mesh/" + object_name) + "/nontextured.ply";
+
+    return p;
+}
+
+
+int main(int argc, char** argv)
+{
+    const std::string log_ID = "[Batch]";
+    yInfo() << log_ID << "Configuring batch experiment...";
+
+    ResourceFinder rf;
+    rf.setVerbose();
+    rf.setDefaultContext("object-tracking");
+    rf.setDefaultConfigFile("config_simulation.ini");
+    rf.configure(argc, argv);
+
+    /* Batch parameters. */
+    const Bottle& rf_batch = rf.findGroup("BATCH");
+    std::size_t number_of_threads = rf_batch.check("threads", Value(0)).asInt();
+    const std::size_t threads_per_trial = rf_batch.check("threads_per_trial", Value(1)).asInt();
+    const std::size_t skip_steps = rf_batch.check("skip_steps", Value(0)).asInt();
+    const std::string summary_path = rf_batch.check("summary_file", Value("batch_summary.csv")).asString();
+    const std::string trials_path = rf_batch.check("trials_file", Value("")).asString();
+
+    if (number_of_threads == 0)
+        number_of_threads = std::max(static_cast<std::size_t>(std::thread::hardware_concurrency()) / threads_per_trial, std::size_t(1));
+
+    std::vector<unsigned int> seeds;
+    Bottle* seeds_list = rf_batch.find("seeds").asList();
+    if (seeds_list != nullptr)
+    {
+        for (std::size_t i = 0; i < seeds_list->size(); i++)
+            seeds.push_back(seeds_list->get(i).asInt());
+    }
+    else
+        seeds.push_back(1);
+
+    /* Parameter grid, a list of (GROUP key (value_1 ... value_n)). */
+    std::vector<std::vector<GridValue>> axes;
+    Bottle* grid = rf_batch.find("grid").asList();
+    if (grid != nullptr)
+    {
+        for (std::size_t i = 0; i < grid->size(); i++)
+        {
+            Bottle* axis = grid->get(i).asList();
+            if ((axis == nullptr) || (axis->size() != 3) || (axis->get(2).asList() == nullptr) || (axis->get(2).asList()->size() == 0))
+            {
+                yError() << log_ID << "Invalid grid entry" << grid->get(i).toString() << ", expected (GROUP key (value_1 ... value_n)).";
+                return EXIT_FAILURE;
+            }
+
+            const std::string group = axis->get(0).asString();
+            const std::string key = axis->get(1).asString();
+            Bottle* values = axis->get(2).asList();
+
+            std::vector<GridValue> axis_values;
+            for (std::size_t j = 0; j < values->size(); j++)
+                axis_values.push_back(std::make_tuple(group, key, values->get(j)));
+
+            axes.push_back(axis_values);
+        }
+    }
+
+    yInfo() << log_ID << "Batch:";
+    yInfo() << log_ID << "- threads:"           << number_of_threads;
+    yInfo() << log_ID << "- threads_per_trial:" << threads_per_trial;
+    yInfo() << log_ID << "- skip_steps:"        << skip_steps;
+    yInfo() << log_ID << "- seeds:"             << seeds.size();
+    yInfo() << log_ID << "- grid axes:"         << axes.size();
+    yInfo() << log_ID << "- summary_file:"      << summary_path;
+    yInfo() << log_ID << "- trials_file:"       << trials_path;
+
+    /* Enumerate the cartesian product of the axes of the grid. */
+    BatchRunner runner(number_of_threads, threads_per_trial, skip_steps);
+
+    std::vector<std::size_t> indexes(axes.size(), 0);
+    bool done = false;
+    while (!done)
+    {
+        std::vector<GridValue> point;
+        std::string description;
+        for (std::size_t i = 0; i < axes.size(); i++)
+        {
+            const GridValue& value = axes[i][indexes[i]];
+            point.push_back(value);
+
+            description += (i > 0 ? " " : "") + std::get<0>(value) + "::" + std::get<1>(value) + "=" + std::get<2>(value).toString();
+        }
+        if (description.empty())
+            description = "default";
+
+        try
+        {
+            TrialParameters parameters = loadTrialParameters(rf, TrialConfiguration(rf, point));
+
+            for (const unsigned int seed : seeds)
+                runner.addTrial(description, parameters, seed);
+        }
+        catch (const std::runtime_error& error)
+        {
+            yError() << log_ID << error.what();
+            return EXIT_FAILURE;
+        }
+
+        /* Next grid point. */
+        done = true;
+        for (std::size_t i = 0; i < axes.size(); i++)
+        {
+            if (++indexes[i] < axes[i].size())
+            {
+                done = false;
+                break;
+            }
+
+            indexes[i] = 0;
+        }
+    }
+
+    runner.run();
+
+    if (!runner.writeSummary(summary_path))
+        return EXIT_FAILURE;
+
+    if (!trials_path.empty() && !runner.writeTrials(trials_path))
+        return EXIT_FAILURE;
+
+    yInfo() << log_ID << "Summary written to" << summary_path;
+
+    return EXIT_SUCCESS;
+}
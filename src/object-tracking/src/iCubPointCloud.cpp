@@ -6,9 +6,10 @@
  */
 
 #include <iCubPointCloud.h>
+#include <StageStatistics.h>
 
-#include <yarp/cv/Cv.h>
 #include <yarp/eigen/Eigen.h>
+#include <yarp/os/Time.h>
 #include <yarp/sig/Vector.h>
 
 #include <BayesFilters/Data.h>
@@ -18,6 +19,8 @@
 #include <SuperimposeMesh/Superimpose.h>
 #include <SuperimposeMesh/SICAD.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 using namespace bfl;
@@ -34,10 +37,15 @@ iCubPointCloud::iCubPointCloud
     const std::string port_prefix,
     const std::string eye_name,
     const std::string depth_fetch_mode,
+    const std::string depth_shared_memory_port,
+    const double depth_shared_memory_timeout,
     const double point_cloud_outlier_threshold,
     const std::size_t point_cloud_u_stride,
     const std::size_t point_cloud_v_stride,
     const bool send_hull,
+    const bool send_depth_roi,
+    const int depth_roi_margin,
+    const double depth_roi_depth_margin,
     std::shared_ptr<iCubPointCloudExogenousData> exogenous_data
 ) :
     PointCloudModel(std::move(prediction), noise_covariance_matrix, tactile_noise_covariance_matrix),
@@ -47,6 +55,9 @@ iCubPointCloud::iCubPointCloud
     pc_u_stride_(point_cloud_u_stride),
     pc_v_stride_(point_cloud_v_stride),
     send_hull_(send_hull),
+    send_depth_roi_(send_depth_roi),
+    depth_roi_margin_(depth_roi_margin),
+    depth_roi_depth_margin_(depth_roi_depth_margin),
     exogenous_data_(exogenous_data),
     gaze_(port_prefix)
 {
@@ -58,21 +69,23 @@ iCubPointCloud::iCubPointCloud
         throw(std::runtime_error(err));
     }
 
-    if (send_hull_)
+    // The port is used as fallback whenever the shared memory of the depth module is not available, e.g. if it runs on another host
+    if (!depth_shared_memory_port.empty())
+        depth_shared_memory_.reset(new DepthSharedMemoryReader(DepthSharedMemory::segmentName(depth_shared_memory_port), depth_shared_memory_timeout));
+
+    if (send_depth_roi_)
     {
-        // Open camera input port.
-        if(!port_image_in_.open("/" + port_prefix + "/cam/" + eye_name + ":i"))
+        if (!(port_depth_roi_out_.open("/" + port_prefix + "/depth/roi:o")))
         {
-            std::string err = "VIEWER::CTOR::ERROR\n\tError: cannot open " + eye_name + " camera input port.";
+            std::string err = "ICUBPOINTCLOUD::CTOR::ERROR\n\tError: cannot open depth region of interest output port.";
             throw(std::runtime_error(err));
         }
+    }
 
-        // Open image output port.
-        if(!port_hull_image_out_.open("/" + port_prefix + "/hull:o"))
-        {
-            std::string err = "VIEWER::CTOR::ERROR\n\tError: cannot open hull output port.";
-            throw(std::runtime_error(err));
-        }
+    if (send_hull_)
+    {
+        // Open camera input and image output ports.
+        hull_publisher_ = std::unique_ptr<DebugPublisher>(new DebugPublisher("/" + port_prefix + "/hull:o", "/" + port_prefix + "/cam/" + eye_name + ":i"));
     }
 
     // Get iCub cameras intrinsics parameters
@@ -92,11 +105,8 @@ iCubPointCloud::~iCubPointCloud()
     // Close ports
     port_depth_in_.close();
 
-    if (send_hull_)
-    {
-        port_image_in_.close();
-        port_hull_image_out_.close();
-    }
+    if (send_depth_roi_)
+        port_depth_roi_out_.close();
 }
 
 
@@ -108,6 +118,8 @@ std::pair<bool, Data> iCubPointCloud::measure(const Data& data) const
 
 bool iCubPointCloud::freeze(const Data& data)
 {
+    ScopedStageTimer timer(StageStatistics::Stage::MeasurementFreeze);
+
     // Get bounding box
     bool valid_bbox;
     VectorXd bbox;
@@ -116,42 +128,34 @@ bool iCubPointCloud::freeze(const Data& data)
         return false;
 
     // Update all the occlusions
-    for (auto& occlusion : occlusions_)
-        occlusion->findOcclusionArea();
+    {
+        ScopedStageTimer occlusion_timer(StageStatistics::Stage::Occlusion);
+
+        for (auto& occlusion : occlusions_)
+            occlusion->findOcclusionArea();
+    }
 
     // Get 2d coordinates
     std::vector<std::pair<int, int>> coordinates;
     coordinates = getObject2DCoordinates(bbox, pc_u_stride_, pc_v_stride_);
 
-    // Send hull over the network
-    if (send_hull_)
+    // Send hull over the network, drawing happens within the publisher thread
+    if (send_hull_ && hull_publisher_->hasConnections())
     {
-        // Get input image
-        ImageOf<PixelRgb>* image_in;
-        image_in = port_image_in_.read(false);
-
-        if (image_in != nullptr)
-        {
-            // Prepare output image
-            ImageOf<PixelRgb>& image_out = port_hull_image_out_.prepare();
-
-            // Copy input to output and wrap around a cv::Mat
-            image_out = *image_in;
-            cv::Mat image = yarp::cv::toCvMat(image_out);
-            cv::cvtColor(image, image, cv::COLOR_RGB2BGR);
-
-            // Draw hulls due to occlusions
-            for (auto& occlusion : occlusions_)
-                occlusion->drawOcclusionArea(image);
+        // Draw hulls due to occlusions
+        for (auto& occlusion : occlusions_)
+            occlusion->drawOcclusionArea(*hull_publisher_);
 
-            // Draw object ROI
-            drawObjectROI(image);
+        // Draw object ROI, a new ROI is allocated at each step hence it can be shared
+        hull_publisher_->drawMaskContour(object_ROI_, cv::Scalar(0, 255, 0));
 
-            // Send the image
-            port_hull_image_out_.write();
-        }
+        hull_publisher_->publish();
     }
 
+    // Restrict the evaluation of the depth to the object, for the next images
+    if (send_depth_roi_)
+        sendDepthROI(bbox);
+
     // Get depth image
     if(!getDepth())
         return false;
@@ -228,7 +232,10 @@ bool iCubPointCloud::freeze(const Data& data)
     measurement_.resize(3 * points.cols(), 1);
     measurement_.swap(Map<MatrixXd>(points.data(), points.size(), 1));
 
-    logger(measurement_.transpose());
+    if (is_binary_log_enabled())
+        binary_logger(measurement_);
+    else
+        logger(measurement_.transpose());
 
     return true;
 }
@@ -272,6 +279,47 @@ int iCubPointCloud::getVisualPointCloudSize()
     return visual_point_cloud_size_;
 }
 
+
+std::tuple<bool, DepthROI> iCubPointCloud::getDepthROI() const
+{
+    if (!depth_initialized_ || !camera_pose_set_ || object_ROI_.empty())
+        return std::make_tuple(false, DepthROI());
+
+    // Find the smallest rectangle containing the object mask
+    std::vector<cv::Point> mask_points;
+    cv::findNonZero(object_ROI_, mask_points);
+    if (mask_points.size() == 0)
+        return std::make_tuple(false, DepthROI());
+    cv::Rect rect = cv::boundingRect(mask_points);
+
+    DepthROI roi;
+    roi.u_0 = rect.x;
+    roi.v_0 = rect.y;
+    roi.camera_position = camera_position_;
+    roi.camera_orientation = camera_orientation_;
+    roi.fx = cam_fx_;
+    roi.fy = cam_fy_;
+    roi.cx = cam_cx_;
+    roi.cy = cam_cy_;
+
+    // Copy the depth within the mask
+    const ImageOf<PixelFloat>& depth_image = depthImage();
+    roi.depth.resize(rect.height, rect.width);
+    for (int v = 0; v < rect.height; v++)
+    {
+        const uchar* mask_row = object_ROI_.ptr<uchar>(rect.y + v);
+
+        for (int u = 0; u < rect.width; u++)
+        {
+            const float depth_u_v = depth_image(rect.x + u, rect.y + v);
+
+            roi.depth(v, u) = ((mask_row[rect.x + u] != 0) && std::isfinite(depth_u_v) && (depth_u_v > 0)) ? depth_u_v : 0.0f;
+        }
+    }
+
+    return std::make_tuple(true, roi);
+}
+
 std::vector<std::pair<int, int>> iCubPointCloud::getObject2DCoordinates(const Ref<const VectorXd>& bbox, std::size_t stride_u, std::size_t stride_v)
 {
     // Create white mask using the current bounding box
@@ -347,15 +395,34 @@ bool iCubPointCloud::getDepth()
         mode = "new_image";
     }
 
+    bool received;
+    if ((depth_shared_memory_ != nullptr) && getSharedDepth(mode, received))
+    {
+        if (mode == "skip")
+            return depth_initialized_ && received;
+        else
+            return depth_initialized_;
+    }
+
     ImageOf<PixelFloat>* tmp_depth_in;
 
-    tmp_depth_in = port_depth_in_.read(mode == "new_image");
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::DepthWait);
+
+        tmp_depth_in = port_depth_in_.read(mode == "new_image");
+    }
 
     if (tmp_depth_in != nullptr)
     {
         depth_image_ = *tmp_depth_in;
 
         depth_initialized_ = true;
+
+        if (depth_from_shared_memory_)
+        {
+            depth_shared_memory_->release();
+            depth_from_shared_memory_ = false;
+        }
     }
 
     if (mode == "skip")
@@ -365,6 +432,102 @@ bool iCubPointCloud::getDepth()
 }
 
 
+bool iCubPointCloud::getSharedDepth(const std::string& mode, bool& received)
+{
+    received = false;
+
+    if (!depth_shared_memory_->isAvailable())
+    {
+        // Keep a copy of the image in use so that the ring can be released, e.g. if the depth module has been restarted
+        if (depth_from_shared_memory_)
+        {
+            depth_image_ = depth_shared_image_;
+            depth_shared_memory_->release();
+            depth_from_shared_memory_ = false;
+        }
+
+        return false;
+    }
+
+    DepthSharedMemoryReader::Frame frame;
+
+    {
+        ScopedStageTimer timer(StageStatistics::Stage::DepthWait);
+
+        received = depth_shared_memory_->acquireLatest(depth_shared_sequence_, frame);
+
+        // Wait for the next image as long as the depth module is alive
+        while (!received && (mode == "new_image") && depth_shared_memory_->isAvailable())
+        {
+            yarp::os::Time::delay(0.001);
+
+            received = depth_shared_memory_->acquireLatest(depth_shared_sequence_, frame);
+        }
+    }
+
+    if (!received)
+        return depth_shared_memory_->isAvailable();
+
+    // The image is used in place until the next one is acquired
+    depth_shared_image_.setQuantum(1);
+    depth_shared_image_.setExternal(const_cast<float*>(frame.data), frame.width, frame.height);
+    depth_shared_sequence_ = frame.sequence;
+    depth_from_shared_memory_ = true;
+
+    depth_initialized_ = true;
+
+    return true;
+}
+
+
+const ImageOf<PixelFloat>& iCubPointCloud::depthImage() const
+{
+    return depth_from_shared_memory_ ? depth_shared_image_ : depth_image_;
+}
+
+
+void iCubPointCloud::sendDepthROI(const Ref<const VectorXd>& bbox)
+{
+    if (port_depth_roi_out_.getOutputCount() == 0)
+        return;
+
+    int tl_u = std::max(int(bbox(0) - bbox(2) / 2.0) - depth_roi_margin_, 0);
+    int tl_v = std::max(int(bbox(1) - bbox(3) / 2.0) - depth_roi_margin_, 0);
+    int br_u = std::min(int(bbox(0) + bbox(2) / 2.0) + depth_roi_margin_, cam_width_);
+    int br_v = std::min(int(bbox(1) + bbox(3) / 2.0) + depth_roi_margin_, cam_height_);
+    if ((br_u <= tl_u) || (br_v <= tl_v))
+        return;
+
+    // Depth of the object with respect to the camera used for the last depth image
+    bool valid_position;
+    Vector3d position;
+    std::tie(valid_position, position) = exogenous_data_->getObjectPosition();
+
+    double z = 0.0;
+    if (valid_position && camera_pose_set_)
+    {
+        AngleAxisd angle_axis(camera_orientation_(3), camera_orientation_.head<3>());
+        z = (angle_axis.toRotationMatrix().transpose() * (position - camera_position_))(2);
+    }
+
+    yarp::sig::Vector& roi = port_depth_roi_out_.prepare();
+    if (z - depth_roi_depth_margin_ > 0.0)
+    {
+        roi.resize(6);
+        roi[4] = z - depth_roi_depth_margin_;
+        roi[5] = z + depth_roi_depth_margin_;
+    }
+    else
+        roi.resize(4);
+    roi[0] = tl_u;
+    roi[1] = tl_v;
+    roi[2] = br_u - tl_u;
+    roi[3] = br_v - tl_v;
+
+    port_depth_roi_out_.write();
+}
+
+
 std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi>
 iCubPointCloud::get3DPoints(std::vector<std::pair<int, int>>& coordinates_2d, const float z_threshold)
 {
@@ -390,6 +553,11 @@ iCubPointCloud::get3DPoints(std::vector<std::pair<int, int>>& coordinates_2d, co
     }
     Eigen::AngleAxisd angle_axis(eye_att(3), eye_att.head<3>());
 
+    // Store the camera pose for later use, e.g. by getDepthROI()
+    camera_position_ = eye_pos;
+    camera_orientation_ = eye_att;
+    camera_pose_set_ = true;
+
     Eigen::Transform<double, 3, Eigen::Affine> camera_pose;
 
     // Compose translation
@@ -399,13 +567,14 @@ iCubPointCloud::get3DPoints(std::vector<std::pair<int, int>>& coordinates_2d, co
     camera_pose.rotate(angle_axis);
 
     // Valid points mask
+    const ImageOf<PixelFloat>& depth_image = depthImage();
     Eigen::VectorXi valid_points(coordinates_2d.size());
 
     for (std::size_t i = 0; i < valid_points.size(); i++)
     {
         valid_points(i) = 0;
 
-        float depth_u_v = depth_image_(coordinates_2d[i].first, coordinates_2d[i].second);
+        float depth_u_v = depth_image(coordinates_2d[i].first, coordinates_2d[i].second);
         if ((depth_u_v > 0) && (depth_u_v < z_threshold))
             valid_points(i) = 1;
     }
@@ -423,7 +592,7 @@ iCubPointCloud::get3DPoints(std::vector<std::pair<int, int>>& coordinates_2d, co
             const int& u = coordinates_2d[i].first;
             const int& v = coordinates_2d[i].second;
 
-            float depth_u_v = depth_image_(u, v);
+            float depth_u_v = depth_image(u, v);
 
             points.col(j) = default_deprojection_matrix_.col(u * cam_height_ + v) * depth_u_v;
 
@@ -438,41 +607,12 @@ iCubPointCloud::get3DPoints(std::vector<std::pair<int, int>>& coordinates_2d, co
 }
 
 
-void iCubPointCloud::drawObjectROI(cv::Mat& image)
-{
-    // Find contours
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(object_ROI_, contours, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
-
-    // Draw the contour
-    if (contours.size() != 0)
-    {
-        // Find the contour with max area
-        std::size_t max_index = 0;
-        std::size_t max_area = cv::contourArea(contours[0]);
-
-        for (std::size_t i = 1; i < contours.size(); i++)
-        {
-            double area = cv::contourArea(contours[i]);
-
-            if (area > max_area)
-            {
-                max_area = area;
-                max_index = i;
-            }
-        }
-
-        cv::drawContours(image, contours, max_index, cv::Scalar(0, 255, 0));
-    }
-
-}
-
-
 iCubPointCloudExogenousData::iCubPointCloudExogenousData() :
     bbox_set_(false),
     is_occlusion_(false),
     use_contacts_(true),
-    is_contact_(false)
+    is_contact_(false),
+    object_position_set_(false)
 { }
 
 
@@ -542,10 +682,26 @@ bool iCubPointCloudExogenousData::getUseContacts()
 }
 
 
+void iCubPointCloudExogenousData::setObjectPosition(const Ref<const Vector3d>& position)
+{
+    object_position_ = position;
+
+    object_position_set_ = true;
+}
+
+
+std::pair<bool, Vector3d> iCubPointCloudExogenousData::getObjectPosition()
+{
+    return std::make_pair(object_position_set_, object_position_);
+}
+
+
 void iCubPointCloudExogenousData::reset()
 {
     bbox_set_ = false;
 
+    object_position_set_ = false;
+
     is_occlusion_ = false;
 
     use_contacts_ = true;
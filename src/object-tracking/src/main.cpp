@@ -5,8 +5,11 @@
  * GPL-2+ license. See the accompanying LICENSE file for details.
  */
 
+#include <BinaryLogger.h>
 #include <BoundingBoxEstimator.h>
 #include <Correction.h>
+#include <DepthLikelihood.h>
+#include <DepthRasterizer.h>
 #include <Filter.h>
 #include <GaussianFilter_.h>
 #include <iCubArmModel.h>
@@ -15,6 +18,7 @@
 #include <iCubPointCloud.h>
 #include <iCubSpringyFingersDetection.h>
 #include <InitParticles.h>
+#include <KinematicModelPrediction.h>
 #include <DiscreteKinematicModel.h>
 #include <DiscretizedKinematicModel.h>
 #include <DiscretizedKinematicModelTDD.h>
@@ -24,6 +28,7 @@
 #include <ProximityLikelihood.h>
 #include <Random3DPose.h>
 #include <SimulatedFilter.h>
+#include <SimulatedPFilter.h>
 #include <SimulatedPointCloud.h>
 
 #include <BayesFilters/AdditiveMeasurementModel.h>
@@ -136,6 +141,25 @@ std::string eigenToString(VectorXd& v)
 }
 
 
+template<typename T>
+void enableLog(T* object, const std::string& format, const std::string& path, const bool compress, const std::size_t buffer_size)
+{
+    if (format == "binary")
+    {
+        BinaryLogger* binary_logger = dynamic_cast<BinaryLogger*>(object);
+        if (binary_logger != nullptr)
+        {
+            if (binary_logger->enable_binary_log(path, "object-tracking", compress, buffer_size))
+                return;
+        }
+
+        yWarning() << "[Main]" << "Binary log not available, falling back to the text log.";
+    }
+
+    object->enable_log(path, "object-tracking");
+}
+
+
 int main(int argc, char** argv)
 {
     const std::string log_ID = "[Main]";
@@ -169,7 +193,10 @@ int main(int argc, char** argv)
 
     std::size_t number_particles;
     std::size_t eff_number_particles;
+    std::string likelihood_type;
     double likelihood_variance;
+    double depth_likelihood_outlier_threshold;
+    std::size_t depth_likelihood_tile_size;
     std::string point_estimate_method;
     std::size_t point_estimate_window_size;
     double resampling_threshold;
@@ -180,9 +207,19 @@ int main(int argc, char** argv)
         number_particles     = rf_particles.check("number",  Value(1)).asInt();
         resampling_threshold = rf_particles.check("resample_threshold", Value(0.5)).asDouble();
 
-        /* Get likelihood variance */
+        /* Get likelihood type and parameters */
         ResourceFinder rf_likelihood = rf.findNestedResourceFinder("LIKELIHOOD");
-        likelihood_variance = rf_likelihood.check("variance",  Value(0.1)).asDouble();
+        likelihood_type                    = rf_likelihood.check("type", Value("proximity")).asString();
+        likelihood_variance                = rf_likelihood.check("variance",  Value(0.1)).asDouble();
+        depth_likelihood_outlier_threshold = rf_likelihood.check("depth_outlier_threshold", Value(0.05)).asDouble();
+        depth_likelihood_tile_size         = rf_likelihood.check("depth_tile_size", Value(32)).asInt();
+
+        if ((mode == "simulation") && (likelihood_type == "depth"))
+        {
+            yError() << log_ID << "The depth likelihood is not available in simulation, as SimulatedPointCloud does not provide depth images.";
+
+            return EXIT_FAILURE;
+        }
 
         /* Get point estimate extraction method and window size. */
         ResourceFinder rf_point_estimate = rf.findNestedResourceFinder("POINT_ESTIMATE");
@@ -246,6 +283,12 @@ int main(int argc, char** argv)
     std::string depth_fetch_mode = rf_depth.check("fetch_mode", Value("new_image")).toString();
     std::size_t depth_u_stride = rf_depth.check("u_stride", Value(1)).asInt();
     std::size_t depth_v_stride = rf_depth.check("v_stride", Value(1)).asInt();
+    bool depth_send_roi = rf_depth.check("send_roi", Value(false)).asBool();
+    int depth_roi_margin = rf_depth.check("roi_margin", Value(20)).asInt();
+    double depth_roi_depth_margin = rf_depth.check("roi_depth_margin", Value(0.15)).asDouble();
+    bool depth_shared_memory = rf_depth.check("shared_memory", Value(true)).asBool();
+    std::string depth_shared_memory_port = rf_depth.check("shared_memory_port", Value("/object-tracking-depth/SFM/depth:o")).asString();
+    double depth_shared_memory_timeout = rf_depth.check("shared_memory_timeout", Value(0.5)).asDouble();
 
     /* Hand occlusion. */
     ResourceFinder rf_hand_occlusion = rf.findNestedResourceFinder("HAND_OCCLUSION");
@@ -331,15 +374,33 @@ int main(int argc, char** argv)
         yWarning() << "Invalid log path. Disabling log...";
         enable_log = false;
     }
+    const std::string log_format = rf_logging.check("log_format", Value("text")).asString();
+    const bool log_compress = rf_logging.check("compress", Value(false)).asBool();
+    const int log_buffer_size_mb = rf_logging.check("buffer_size_mb", Value(16)).asInt();
+    if (log_format != "text" && log_format != "binary")
+    {
+        yError() << log_ID << "The requested log format" << log_format << "is not available.";
+
+        return EXIT_FAILURE;
+    }
+    if (log_buffer_size_mb <= 0)
+    {
+        yError() << log_ID << "The requested log buffer size" << log_buffer_size_mb << "is not valid.";
+
+        return EXIT_FAILURE;
+    }
+    const std::size_t log_buffer_size = static_cast<std::size_t>(log_buffer_size_mb) * 1024 * 1024;
 
     /* Miscellaneous. */
     bool enable_send_hull;
     bool enable_send_mask;
+    std::size_t particles_top_k = 0;
     if (mode != "SIMULATION")
     {
         ResourceFinder rf_misc = rf.findNestedResourceFinder("MISC");
         enable_send_hull = rf_misc.check("send_hull", Value(false)).asBool();
         enable_send_mask = rf_misc.check("send_mask", Value(false)).asBool();
+        particles_top_k = rf_misc.check("particles_top_k", Value(0)).asInt();
     }
 
     /* Log parameters. */
@@ -355,7 +416,13 @@ int main(int argc, char** argv)
         yInfo() << log_ID << "- resample_threshold:" << resampling_threshold;
 
         yInfo() << log_ID << "Likelihood:";
+        yInfo() << log_ID << "- type:"     << likelihood_type;
         yInfo() << log_ID << "- variance:" << likelihood_variance;
+        if (likelihood_type == "depth")
+        {
+            yInfo() << log_ID << "- depth_outlier_threshold:" << depth_likelihood_outlier_threshold;
+            yInfo() << log_ID << "- depth_tile_size:"         << depth_likelihood_tile_size;
+        }
     }
 
     yInfo() << log_ID << "Initial conditions:";
@@ -401,6 +468,12 @@ int main(int argc, char** argv)
     yInfo() << log_ID << "- fetch_mode:" << depth_fetch_mode;
     yInfo() << log_ID << "- u_stride:" << depth_u_stride;
     yInfo() << log_ID << "- v_stride:" << depth_v_stride;
+    yInfo() << log_ID << "- send_roi:" << depth_send_roi;
+    yInfo() << log_ID << "- roi_margin:" << depth_roi_margin;
+    yInfo() << log_ID << "- roi_depth_margin:" << depth_roi_depth_margin;
+    yInfo() << log_ID << "- shared_memory:" << depth_shared_memory;
+    yInfo() << log_ID << "- shared_memory_port:" << depth_shared_memory_port;
+    yInfo() << log_ID << "- shared_memory_timeout:" << depth_shared_memory_timeout;
 
     yInfo() << log_ID << "Hand occlusion:";
     yInfo() << log_ID << "- handle_occlusion:" << handle_hand_occlusion;
@@ -447,10 +520,14 @@ int main(int argc, char** argv)
     yInfo() << log_ID << "Logging:";
     yInfo() << log_ID << "- enable_log:"        << enable_log;
     yInfo() << log_ID << "- absolute_log_path:" << log_path;
+    yInfo() << log_ID << "- log_format:"        << log_format;
+    yInfo() << log_ID << "- compress:"          << log_compress;
+    yInfo() << log_ID << "- buffer_size_mb:"    << log_buffer_size_mb;
 
     yInfo() << log_ID << "Miscellaneous:";
     yInfo() << log_ID << "- send_hull:" << enable_send_hull;
     yInfo() << log_ID << "- send_mask:" << enable_send_mask;
+    yInfo() << log_ID << "- particles_top_k:" << particles_top_k;
 
     /**
      * Initialize point cloud prediction.
@@ -523,10 +600,15 @@ int main(int argc, char** argv)
                                port_prefix,
                                "left",
                                depth_fetch_mode,
+                               depth_shared_memory ? depth_shared_memory_port : "",
+                               depth_shared_memory_timeout,
                                pc_outlier_threshold,
                                depth_u_stride,
                                depth_v_stride,
                                enable_send_hull,
+                               depth_send_roi,
+                               depth_roi_margin,
+                               depth_roi_depth_margin,
                                icub_pc_shared_data));
 
         if (handle_hand_occlusion)
@@ -579,7 +661,7 @@ int main(int argc, char** argv)
     }
 
     if (enable_log)
-        measurement_model->enable_log(log_path, "object-tracking");
+        enableLog(measurement_model.get(), log_format, log_path, log_compress, log_buffer_size);
 
     /**
      * Filter construction.
@@ -634,7 +716,7 @@ int main(int argc, char** argv)
      * Prediction step.
      */
     std::unique_ptr<GaussianPrediction> prediction =
-        std::unique_ptr<KFPrediction>(new KFPrediction(std::move(kinematic_model)));
+        std::unique_ptr<KinematicModelPrediction>(new KinematicModelPrediction(std::move(kinematic_model)));
 
     /**
      * Correction step.
@@ -653,7 +735,11 @@ int main(int argc, char** argv)
      */
     std::unique_ptr<BoundingBoxEstimator> bbox_estimator;
 
-    if (use_bbox_0)
+    if (mode == "simulation")
+    {
+        // The bounding box is not required in simulation
+    }
+    else if (use_bbox_0)
     {
         // Giving the initial bounding box of the object from outside
         std::pair<int, int> top_left = std::make_pair(static_cast<int>(bbox_tl_0(0)), static_cast<int>(bbox_tl_0(1)));
@@ -740,21 +826,42 @@ int main(int argc, char** argv)
         std::unique_ptr<ParticlesCorrection> pf_correction;
 
         /* Likelihood. */
-        std::unique_ptr<NanoflannPointCloudPrediction> distances_approximation = std::unique_ptr<NanoflannPointCloudPrediction>(
-            new NanoflannPointCloudPrediction(object_mesh_path_ply, pc_pred_num_samples));
+        std::unique_ptr<LikelihoodModel> likelihood;
+        if (likelihood_type == "depth")
+        {
+            std::unique_ptr<DepthRasterizer> rasterizer = std::unique_ptr<DepthRasterizer>(
+                new DepthRasterizer(object_mesh_path_obj, depth_likelihood_tile_size));
 
-        std::unique_ptr<ProximityLikelihood> proximity_likelihood = std::unique_ptr<ProximityLikelihood>(
-            new ProximityLikelihood(likelihood_variance, std::move(distances_approximation)));
+            likelihood = std::unique_ptr<DepthLikelihood>(
+                new DepthLikelihood(likelihood_variance, depth_likelihood_outlier_threshold, std::move(rasterizer)));
+        }
+        else
+        {
+            std::unique_ptr<NanoflannPointCloudPrediction> distances_approximation = std::unique_ptr<NanoflannPointCloudPrediction>(
+                new NanoflannPointCloudPrediction(object_mesh_path_ply, pc_pred_num_samples));
+
+            likelihood = std::unique_ptr<ProximityLikelihood>(
+                new ProximityLikelihood(likelihood_variance, std::move(distances_approximation)));
+        }
 
         pf_correction = std::unique_ptr<ParticlesCorrection>(
-            new ParticlesCorrection(std::move(correction), std::move(proximity_likelihood)));
+            new ParticlesCorrection(std::move(correction), std::move(likelihood)));
 
         /* Resampling. */
         std::unique_ptr<Resampling> pf_resampling = std::unique_ptr<Resampling>(new Resampling());
 
         if (mode == "simulation")
         {
-            // TO BE DONE
+            filter = std::move(std::unique_ptr<SimulatedPFilter>(
+                                   new SimulatedPFilter(eff_number_particles,
+                                                        resampling_threshold,
+                                                        point_estimate_method,
+                                                        point_estimate_window_size,
+                                                        std::move(pf_initialization),
+                                                        std::move(pf_prediction),
+                                                        std::move(pf_correction),
+                                                        std::move(pf_resampling),
+                                                        sim_duration / sim_sample_time)));
         }
         else if ((mode == "robot" || mode == "play"))
         {
@@ -769,14 +876,15 @@ int main(int argc, char** argv)
                                                std::move(pf_correction),
                                                std::move(pf_resampling),
                                                std::move(bbox_estimator),
-                                               icub_pc_shared_data)));
+                                               icub_pc_shared_data,
+                                               particles_top_k)));
         }
     }
 
     std::cout << "done." << std::endl;
 
     if (enable_log)
-        filter->enable_log(log_path, "object-tracking");
+        enableLog(filter.get(), log_format, log_path, log_compress, log_buffer_size);
 
     std::cout << "Booting filter..." << std::flush;
 
@@ -95,6 +95,20 @@ service ObjectTrackingIDL
      */
     bool set_history_window(1:i16 window);
 
+    /**
+     * Get the latency statistics of the stages of the filtering step,
+     * including the time spent waiting for the depth and for the OPC.
+     *
+     * @return a list of strings, one per stage, with the number of samples
+     *         and the mean, percentiles and maximum latency in milliseconds.
+     */
+    list<string> get_stats();
+
+    /**
+     * Reset the latency statistics.
+     */
+    void reset_stats();
+
     /**
      * Quit the filter in graceful way.
      */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+
+/**
+ * First in first out queue with a maximum number of items, connecting two stages of a pipeline.
+ * The producer waits while the queue is full and the consumer while it is empty, so that a slow stage
+ * slows down the previous ones instead of accumulating frames.
+ */
+template <class T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(const std::size_t capacity = 2) :
+        capacity_(capacity),
+        closed_(false)
+    { }
+
+    /**
+     * Wait for room and add the item. Return false if the queue has been closed.
+     */
+    bool push(T&& item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this]{ return closed_ || (items_.size() < capacity_); });
+
+            if (closed_)
+                return false;
+
+            items_.push_back(std::move(item));
+        }
+        not_empty_.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Wait for an item and remove it. Return false if the queue has been closed.
+     */
+    bool pop(T& item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this]{ return closed_ || !items_.empty(); });
+
+            if (closed_)
+                return false;
+
+            item = std::move(items_.front());
+            items_.pop_front();
+        }
+        not_full_.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Add the item if there is room, without waiting. Return false if the queue is full or has been closed.
+     */
+    bool tryPush(T&& item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (closed_ || (items_.size() >= capacity_))
+                return false;
+
+            items_.push_back(std::move(item));
+        }
+        not_empty_.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Remove an item if there is one, without waiting. Return false if the queue is empty or has been closed.
+     */
+    bool tryPop(T& item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (closed_ || items_.empty())
+                return false;
+
+            item = std::move(items_.front());
+            items_.pop_front();
+        }
+        not_full_.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Discard the items and wake up the waiting producer and consumer.
+     */
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            items_.clear();
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    const std::size_t capacity_;
+
+    bool closed_;
+
+    std::deque<T> items_;
+
+    std::mutex mutex_;
+
+    std::condition_variable not_full_;
+
+    std::condition_variable not_empty_;
+};
+
+#endif /* BOUNDEDQUEUE_H */
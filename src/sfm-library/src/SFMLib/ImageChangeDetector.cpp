@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include "ImageChangeDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+ImageChangeDetector::ImageChangeDetector(const int tile_size, const double threshold) :
+    tile_size_(std::max(tile_size / scale_, 1)),
+    threshold_(threshold)
+{ }
+
+
+cv::Rect ImageChangeDetector::compare(const cv::Mat& left, const cv::Mat& right, const int max_disparity)
+{
+    image_size_ = left.size();
+    max_disparity_ = max_disparity;
+
+    downsample(left, left_);
+    downsample(right, right_);
+
+    const cv::Rect image(cv::Point(0, 0), image_size_);
+
+    if (left_reference_.empty() || (left_reference_.size() != left_.size()) ||
+        right_reference_.empty() || (right_reference_.size() != right_.size()))
+        return image;
+
+    cv::Rect changed = changedTiles(left_, left_reference_);
+
+    cv::Rect changed_right = changedTiles(right_, right_reference_);
+    if (changed_right.area() > 0)
+    {
+        changed_right.width += max_disparity;
+
+        if (changed.area() > 0)
+        {
+            const int x0 = std::min(changed.x, changed_right.x);
+            const int y0 = std::min(changed.y, changed_right.y);
+            const int x1 = std::max(changed.x + changed.width, changed_right.x + changed_right.width);
+            const int y1 = std::max(changed.y + changed.height, changed_right.y + changed_right.height);
+            changed = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+        }
+        else
+            changed = changed_right;
+    }
+
+    return changed & image;
+}
+
+
+void ImageChangeDetector::update(const cv::Rect& region)
+{
+    if (left_.empty() || right_.empty())
+        return;
+
+    const bool whole = (region.area() == 0) ||
+                       (left_reference_.size() != left_.size()) || (right_reference_.size() != right_.size());
+    if (whole)
+    {
+        left_.copyTo(left_reference_);
+        right_.copyTo(right_reference_);
+
+        return;
+    }
+
+    const cv::Rect small(cv::Point(0, 0), left_.size());
+
+    // Downsampled pixels covering the region
+    const int x0 = region.x / scale_;
+    const int y0 = region.y / scale_;
+    const int x1 = (region.x + region.width + scale_ - 1) / scale_;
+    const int y1 = (region.y + region.height + scale_ - 1) / scale_;
+
+    const cv::Rect left_region = cv::Rect(x0, y0, x1 - x0, y1 - y0) & small;
+    if (left_region.area() > 0)
+        left_(left_region).copyTo(left_reference_(left_region));
+
+    // The right pixels matched by the ones of the region lie up to max_disparity on their left
+    const int x0_right = std::max(x0 - max_disparity_ / scale_, 0);
+    const cv::Rect right_region = cv::Rect(x0_right, y0, x1 - x0_right, y1 - y0) & small;
+    if (right_region.area() > 0)
+        right_(right_region).copyTo(right_reference_(right_region));
+}
+
+
+void ImageChangeDetector::reset()
+{
+    left_reference_.release();
+    right_reference_.release();
+}
+
+
+void ImageChangeDetector::downsample(const cv::Mat& image, cv::Mat& gray)
+{
+    cv::resize(image, resized_, cv::Size(std::max(image.cols / scale_, 1), std::max(image.rows / scale_, 1)), 0, 0, cv::INTER_AREA);
+
+    if (resized_.channels() == 3)
+        cv::cvtColor(resized_, gray, CV_RGB2GRAY);
+    else
+        resized_.copyTo(gray);
+}
+
+
+cv::Rect ImageChangeDetector::changedTiles(const cv::Mat& current, const cv::Mat& reference)
+{
+    cv::absdiff(current, reference, difference_);
+
+    // Mean difference within each tile
+    const cv::Size tiles_size((difference_.cols + tile_size_ - 1) / tile_size_, (difference_.rows + tile_size_ - 1) / tile_size_);
+    cv::resize(difference_, tiles_, tiles_size, 0, 0, cv::INTER_AREA);
+
+    int x0 = tiles_.cols;
+    int y0 = tiles_.rows;
+    int x1 = -1;
+    int y1 = -1;
+    for (int y = 0; y < tiles_.rows; y++)
+    {
+        const unsigned char* row = tiles_.ptr<unsigned char>(y);
+        for (int x = 0; x < tiles_.cols; x++)
+        {
+            if (row[x] > threshold_)
+            {
+                x0 = std::min(x0, x);
+                y0 = std::min(y0, y);
+                x1 = std::max(x1, x);
+                y1 = std::max(y1, y);
+            }
+        }
+    }
+
+    if (x1 < 0)
+        return cv::Rect();
+
+    // Tiles to downsampled pixels
+    const double sx = double(difference_.cols) / tiles_.cols;
+    const double sy = double(difference_.rows) / tiles_.rows;
+    const int u0 = int(x0 * sx);
+    const int v0 = int(y0 * sy);
+    const int u1 = std::min(int(std::ceil((x1 + 1) * sx)), difference_.cols);
+    const int v1 = std::min(int(std::ceil((y1 + 1) * sy)), difference_.rows);
+
+    return toImage(cv::Rect(u0, v0, u1 - u0, v1 - v0));
+}
+
+
+cv::Rect ImageChangeDetector::toImage(const cv::Rect& small) const
+{
+    // The last downsampled pixels also cover the pixels left over by the integer division
+    const int x1 = (small.x + small.width == left_.cols) ? image_size_.width : (small.x + small.width) * scale_;
+    const int y1 = (small.y + small.height == left_.rows) ? image_size_.height : (small.y + small.height) * scale_;
+
+    return cv::Rect(small.x * scale_, small.y * scale_, x1 - small.x * scale_, y1 - small.y * scale_);
+}
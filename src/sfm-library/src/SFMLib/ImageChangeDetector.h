@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#ifndef IMAGECHANGEDETECTOR_H
+#define IMAGECHANGEDETECTOR_H
+
+#include <opencv2/opencv.hpp>
+
+
+/**
+ * Detects the parts of a stereo pair that changed with respect to a reference pair.
+ *
+ * The images are downsampled and converted to gray levels, then the mean absolute difference from the
+ * reference is evaluated within square tiles. Tiles whose difference exceeds a threshold are considered
+ * changed. Downsampling averages out most of the noise of the cameras, hence the comparison is cheap and
+ * stable compared to the matching of the full images.
+ */
+class ImageChangeDetector
+{
+public:
+    /**
+     * @param tile_size side of the tiles in pixels of the images.
+     * @param threshold mean absolute difference of gray levels within a tile above which it is changed.
+     */
+    ImageChangeDetector(const int tile_size = 32, const double threshold = 8.0);
+
+    /**
+     * Compare the pair with the reference and return the bounding box, in pixels of the left image, of the
+     * tiles that changed, or an empty rectangle if none did. Changes in the right image are extended to the
+     * right by max_disparity, as they affect the disparities of the left pixels up to that distance.
+     * The whole image is returned if there is no reference of the same size.
+     */
+    cv::Rect compare(const cv::Mat& left, const cv::Mat& right, const int max_disparity);
+
+    /**
+     * Make the pair given to the last call of compare() the reference within the region of the left image
+     * (the whole image if empty), e.g. after the depth has been computed again within the region.
+     */
+    void update(const cv::Rect& region = cv::Rect());
+
+    /**
+     * Forget the reference, so that the next comparison returns the whole image.
+     */
+    void reset();
+
+private:
+    void downsample(const cv::Mat& image, cv::Mat& gray);
+
+    cv::Rect changedTiles(const cv::Mat& current, const cv::Mat& reference);
+
+    cv::Rect toImage(const cv::Rect& small) const;
+
+    /**
+     * Factor of the downsampling of the images.
+     */
+    const int scale_ = 4;
+
+    /**
+     * Side of the tiles in downsampled pixels.
+     */
+    const int tile_size_;
+
+    const double threshold_;
+
+    cv::Size image_size_;
+
+    cv::Mat left_;
+
+    cv::Mat right_;
+
+    cv::Mat left_reference_;
+
+    cv::Mat right_reference_;
+
+    /**
+     * Buffers reused across the comparisons.
+     */
+    cv::Mat resized_;
+
+    cv::Mat difference_;
+
+    cv::Mat tiles_;
+
+    int max_disparity_ = 0;
+};
+
+#endif /* IMAGECHANGEDETECTOR_H */
@@ -8,12 +8,12 @@
 #include <cmath>
 #include <algorithm>
 #include "SFM.h"
-#include "fastBilateral.hpp"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
 SFM::SFM(const std::string port_prefix) :
+    pipelineRunning(false),
     port_prefix_(port_prefix),
     igaze_(port_prefix + "/SFM")
 { }
@@ -39,6 +39,7 @@ bool SFM::configure(ResourceFinder &rf)
     string outDispName=rf.check("outDispPort",Value("/disp:o")).asString();
     string outDepthName=rf.check("outDepthPort",Value("/depth:o")).asString();
     string outMatchName=rf.check("outMatchPort",Value("/match:o")).asString();
+    string inDepthROIName=rf.check("inDepthROIPort",Value("/depth/roi:i")).asString();
 
     string outLeftRectImgPortName=rf.check("outLeftRectImgPort",Value("/rect_left:o")).asString();
     string outRightRectImgPortName=rf.check("outRightRectImgPort",Value("/rect_right:o")).asString();
@@ -46,6 +47,7 @@ bool SFM::configure(ResourceFinder &rf)
     outMatchName=sname+outMatchName;
     outDispName=sname+outDispName;
     outDepthName=sname+outDepthName;
+    inDepthROIName=sname+inDepthROIName;
 
     outLeftRectImgPortName=sname+outLeftRectImgPortName;
     outRightRectImgPortName=sname+outRightRectImgPortName;
@@ -58,6 +60,25 @@ bool SFM::configure(ResourceFinder &rf)
     // outMatch.open(outMatchName);
     outDisp.open(outDispName);
     outDepth.open(outDepthName);
+    inDepthROI.open(inDepthROIName);
+    depthROIDispMin=0;
+    depthROIDispMax=-1;
+    depthROITime=0.0;
+    depthROITimeout=rf.check("depthROITimeout",Value(1.0)).asDouble();
+    motionGate=rf.check("motionGate",Value(false)).asBool();
+    motionGateVelocity=rf.check("motionGateVelocity",Value(1.0)).asDouble();
+    motionGateRefresh=rf.check("motionGateRefresh",Value(1.0)).asDouble();
+    motionGatePartialRatio=rf.check("motionGatePartialRatio",Value(0.5)).asDouble();
+    // Only ELAS restricts the matching to a region, SGBM would match the whole images anyway
+    motionGatePartial=rf.check("use_elas",Value(true)).asBool();
+    motionGateTime=0.0;
+    motionGateReset=false;
+    if (motionGate)
+        changeDetector.reset(new ImageChangeDetector(rf.check("motionGateTile",Value(32)).asInt(),
+                                                     rf.check("motionGateThreshold",Value(8.0)).asDouble()));
+    if (rf.check("depthSharedMemory",Value(true)).asBool())
+        depthSharedMemory.reset(new DepthSharedMemoryWriter(DepthSharedMemory::segmentName(outDepthName),
+                                                            rf.check("depthSharedMemorySlots",Value(4)).asInt()));
     // handlerPort.open(rpc_name);
     // worldCartPort.open(world_name+"/cartesian:o");
     // worldCylPort.open(world_name+"/cylindrical:o");
@@ -99,6 +120,11 @@ bool SFM::configure(ResourceFinder &rf)
     this->sigmaColorBLF = 10.0;
     this->sigmaSpaceBLF = 10.0;
 
+    this->doDepthBLF = rf.check("depthBLF",Value(false)).asBool();
+    this->sigmaColorDepthBLF = rf.check("sigmaColorDepthBLF",Value(0.05)).asDouble();
+    this->sigmaSpaceDepthBLF = rf.check("sigmaSpaceDepthBLF",Value(5.0)).asDouble();
+    cout << " Bilateral filter of the depth set to " << doDepthBLF << endl;
+
     this->HL_root=Mat::zeros(4,4,CV_64F);
     this->HR_root=Mat::zeros(4,4,CV_64F);
 
@@ -237,10 +263,14 @@ void SFM::updateViaGazeCtrl(const bool update)
 /******************************************************************************/
 bool SFM::close()
 {
+    stopDepthPipeline();
+
     leftImgPort.close();
     rightImgPort.close();
     outDisp.close();
     outDepth.close();
+    depthSharedMemory.reset();
+    inDepthROI.close();
     // outMatch.close();
     // handlerPort.close();
     // worldCartPort.close();
@@ -266,7 +296,7 @@ bool SFM::close()
 
 
 /******************************************************************************/
-bool SFM::updateDisparity(const bool do_block)
+bool SFM::readImages(const bool do_block)
 {
     ImageOf<PixelRgb> *yarp_imgL=leftImgPort.read(do_block);
     ImageOf<PixelRgb> *yarp_imgR=rightImgPort.read(do_block);
@@ -284,6 +314,8 @@ bool SFM::updateDisparity(const bool do_block)
         rightImgPort.getEnvelope(stamp_right);
     }
 
+    imagesStamp=stamp_left;
+
 	igaze_.getEyesConfiguration(eyes);
 
     updateViaKinematics(eyes-eyes0);
@@ -303,37 +335,55 @@ bool SFM::updateDisparity(const bool do_block)
     getCameraHGazeCtrl(LEFTCAM);
     getCameraHGazeCtrl(RIGHTCAM);
 
-    Mat leftMat=cvarrToMat(left);
-    Mat rightMat=cvarrToMat(right);
+    // Used by the temporal prior of ELAS to predict the support points from the previous images
+    mutexDisp.lock();
+    this->stereo->setLeftCameraPose(HL_root);
+    mutexDisp.unlock();
+
     this->stereo->setImages(left,right);
 
+    return true;
+}
+
+
+/******************************************************************************/
+bool SFM::updateDisparity(const bool do_block)
+{
+    if (!readImages(do_block))
+        return false;
+
     this->stereo->computeDisparity(this->useBestDisp,this->uniquenessRatio,this->speckleWindowSize,
             this->speckleRange,this->numberOfDisparities,this->SADWindowSize,
             this->minDisparity,this->preFilterCap,this->disp12MaxDiff);
 
     if (outDisp.getOutputCount()>0)
-    {
-        outputDm = stereo->getDisparity();
+        sendDisparity(stereo->getDisparity(),imagesStamp);
 
-        if (!outputDm.empty())
-        {
-            ImageOf<PixelMono> &outim = outDisp.prepare();
-            if (doBLF)
-            {
-                Mat outputDfiltm;
-                cv_extend::bilateralFilter(outputDm,outputDfiltm, sigmaColorBLF, sigmaSpaceBLF);
-                IplImage outputDfilt = outputDfiltm;
-                outim.wrapIplImage(&outputDfilt);
-            } else
-            {
-                IplImage outputD = outputDm;
-                outim.wrapIplImage(&outputD);
-            }
-            outDisp.write();
-        }
+    return true;
+}
+
+
+/******************************************************************************/
+void SFM::sendDisparity(const Mat& disparity, const Stamp& stamp)
+{
+    if (disparity.empty())
+        return;
+
+    ImageOf<PixelMono> &outim = outDisp.prepare();
+    if (doBLF)
+    {
+        gridBLF.apply(disparity,disparityBLF, sigmaColorBLF, sigmaSpaceBLF);
+        IplImage outputDfilt = disparityBLF;
+        outim.wrapIplImage(&outputDfilt);
+    } else
+    {
+        IplImage outputD = disparity;
+        outim.wrapIplImage(&outputD);
     }
 
-    return true;
+    Stamp envelope=stamp;
+    outDisp.setEnvelope(envelope);
+    outDisp.write();
 }
 
 
@@ -639,6 +689,13 @@ std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> SFM::get3DPoints(const std::v
         return std::make_tuple(false, Eigen::MatrixXd(0, 0), Eigen::VectorXi(0));
     }
 
+    return compute3DPoints(u_v_coordinates, left_z_threshold);
+}
+
+
+/******************************************************************************/
+std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> SFM::compute3DPoints(const std::vector<std::pair<int, int>> & u_v_coordinates, const float left_z_threshold)
+{
     Eigen::MatrixXd points_all(3, u_v_coordinates.size());
     Eigen::VectorXi valid_points(u_v_coordinates.size());
 
@@ -658,9 +715,15 @@ std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> SFM::get3DPoints(const std::v
         return std::make_tuple(false, Eigen::MatrixXd(0, 0), Eigen::VectorXi(0));
     }
 
-    // what is Q?
+    // Q maps (u, v, disparity, 1) to homogeneous points in the rectified left camera
     const Mat& Q=this->stereo->getQ();
-    IplImage disp16=disp16m;
+    const double q_00=Q.at<double>(0,0);
+    const double q_03=Q.at<double>(0,3);
+    const double q_11=Q.at<double>(1,1);
+    const double q_13=Q.at<double>(1,3);
+    const double q_23=Q.at<double>(2,3);
+    const double q_32=Q.at<double>(3,2);
+    const double q_33=Q.at<double>(3,3);
 
     #pragma omp parallel for
     for (int i = 0; i < u_v_coordinates.size(); i++)
@@ -670,6 +733,12 @@ std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> SFM::get3DPoints(const std::v
         const int& u_tmp = u_v_coordinates[i].first;
         const int& v_tmp = u_v_coordinates[i].second;
 
+        if ((u_tmp<0) || (u_tmp>=Mapper.cols) || (v_tmp<0) || (v_tmp>=Mapper.rows))
+        {
+            // skip this point as it is outside the image
+            continue;
+        }
+
         float usign=Mapper.ptr<float>(v_tmp)[2 * u_tmp];
         float vsign=Mapper.ptr<float>(v_tmp)[2 * u_tmp + 1];
 
@@ -682,13 +751,12 @@ std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> SFM::get3DPoints(const std::v
             continue;
         }
 
-        CvScalar scal=cvGet2D(&disp16,v,u);
-        double disparity=scal.val[0]/16.0;
-        float w=(float)(disparity*Q.at<double>(3,2)+Q.at<double>(3,3));
+        double disparity=disp16m.ptr<short>(v)[u]/16.0;
+        float w=(float)(disparity*q_32+q_33);
 
-        points_all(0, i) =(float)((usign+1)*Q.at<double>(0,0)+Q.at<double>(0,3));
-        points_all(1, i) =(float)((vsign+1)*Q.at<double>(1,1)+Q.at<double>(1,3));
-        points_all(2, i) =(float)Q.at<double>(2,3);
+        points_all(0, i) =(float)((usign+1)*q_00+q_03);
+        points_all(1, i) =(float)((vsign+1)*q_11+q_13);
+        points_all(2, i) =(float)q_23;
 
         // scale z coordinate
         points_all(2, i) = float(points_all(2, i)) / w;
@@ -744,15 +812,41 @@ std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> SFM::get3DPoints(const std::v
 
 bool SFM::updateDepth()
 {
-    // Get disparity
-    if (!updateDisparity(true))
+    // Restrict the computation to the region of interest, if requested
+    updateDepthROI();
+
+    if (!readImages(true))
         return false;
 
+    // Skip the computation, or restrict it to the parts of the images that changed, if the head is still
+    cv::Rect region = depthROI;
+    DepthUpdate update = DepthUpdate::Full;
+    if (motionGate)
+        update = checkMotion(region);
+
+    if (update == DepthUpdate::Cached)
+    {
+        sendCachedDepth(imagesStamp);
+        return true;
+    }
+
+    if (update == DepthUpdate::Partial)
+        this->stereo->setDisparityROI(region, depthROIDispMin, depthROIDispMax);
+
+    // Get disparity
+    this->stereo->computeDisparity(this->useBestDisp,this->uniquenessRatio,this->speckleWindowSize,
+            this->speckleRange,this->numberOfDisparities,this->SADWindowSize,
+            this->minDisparity,this->preFilterCap,this->disp12MaxDiff);
+
+    if (outDisp.getOutputCount()>0)
+        sendDisparity(stereo->getDisparity(),imagesStamp);
+
     const Mat& disparity = this->stereo->getDisparity16();
     if (disparity.empty())
+    {
+        motionGateReset = true;
         return false;
-
-    IplImage ipl_disparity = disparity;
+    }
 
     // Get disparity to depth map
     const Mat& Q = this->stereo->getQ();
@@ -760,40 +854,425 @@ bool SFM::updateDepth()
     // Get rotation matrix from unrectified left camera plane to rectified left camera plane
     const Mat& R = this->stereo->getRLrect();
 
+    if (motionGate)
+    {
+        updateCachedDepth(disparity, Q, R, region, update == DepthUpdate::Partial);
+        sendCachedDepth(imagesStamp);
+    }
+    else
+        sendDepth(disparity, Q, R, region, imagesStamp);
+
+    return true;
+}
+
+
+/******************************************************************************/
+void SFM::sendDepth(const Mat& disparity, const Mat& Q, const Mat& R, const cv::Rect& roi, const Stamp& stamp)
+{
+    const bool send_port = (outDepth.getOutputCount() > 0);
+
+    // Evaluate depth map directly within the shared memory ring, if possible
+    float* shared_depth = NULL;
+    if (depthSharedMemory)
+        shared_depth = depthSharedMemory->acquire(disparity.cols, disparity.rows);
+
+    if (shared_depth != NULL)
+    {
+        ImageOf<PixelFloat> depth_shared;
+        depth_shared.setQuantum(1);
+        depth_shared.setExternal(shared_depth, disparity.cols, disparity.rows);
+        disparityToDepth(disparity, Q, R, depth_shared, roi);
+        filterDepth(depth_shared, roi);
+
+        depthSharedMemory->publish(stamp.getCount(), stamp.getTime());
+
+        if (!send_port)
+            return;
+
+        outDepth.prepare() = depth_shared;
+    }
+    else
+    {
+        if (!send_port)
+            return;
+
+        ImageOf<PixelFloat>& depth_out = outDepth.prepare();
+        disparityToDepth(disparity, Q, R, depth_out, roi);
+        filterDepth(depth_out, roi);
+    }
+
+    // Send over the network, with the time stamp of the images
+    Stamp envelope = stamp;
+    outDepth.setEnvelope(envelope);
+    outDepth.write();
+}
+
+
+/******************************************************************************/
+SFM::DepthUpdate SFM::checkMotion(cv::Rect& region)
+{
+    const Mat& left = this->stereo->getImLeft();
+    const Mat& right = this->stereo->getImRight();
+    const cv::Rect image(0, 0, left.cols, left.rows);
+    const cv::Rect requested = (depthROI.area() > 0) ? (depthROI & image) : image;
+
+    region = depthROI;
+
+    // Head moving, according to the velocities of its joints or to the pose of the cameras
+    bool moving = false;
+    yarp::sig::Vector head_vel;
+    if (igaze_.getHeadVelocities(head_vel))
+        for (size_t i = 0; i < head_vel.length(); i++)
+            moving |= (std::fabs(head_vel[i]) > motionGateVelocity);
+
+    mutexDisp.lock();
+    Mat pose = HL_root.clone();
+    mutexDisp.unlock();
+
+    if (!moving && !motionGatePose.empty())
+    {
+        // Tolerances of 1 mm and of about 0.25 deg, i.e. less than one pixel for the usual focal lengths
+        Mat delta = motionGatePose.inv() * pose;
+        double translation = cv::norm(delta(cv::Rect(3, 0, 1, 3)));
+        double cos_angle = (cv::trace(delta(cv::Rect(0, 0, 3, 3)))[0] - 1.0) / 2.0;
+        moving = (translation > 0.001) || (cos_angle < std::cos(0.25 * CV_PI / 180.0));
+    }
+
+    cv::Rect changed = changeDetector->compare(left, right, this->numberOfDisparities) & requested;
+
+    bool full = moving || motionGateReset.exchange(false) || motionGatePose.empty() ||
+                (depthROI != motionGateROI) || (Time::now() - motionGateTime > motionGateRefresh);
+
+    if (!full)
+    {
+        if (changed.area() == 0)
+            return DepthUpdate::Cached;
+
+        // Leave some room to the support points of ELAS around the changes
+        const int margin = 16;
+        changed = cv::Rect(changed.x - margin, changed.y - margin, changed.width + 2 * margin, changed.height + 2 * margin) & requested;
+
+        if (motionGatePartial && (changed.area() <= motionGatePartialRatio * requested.area()))
+        {
+            changeDetector->update(changed);
+            region = changed;
+
+            return DepthUpdate::Partial;
+        }
+    }
+
+    // The images and the pose of this frame become the reference of the next ones
+    changeDetector->update();
+    motionGatePose = pose;
+    motionGateROI = depthROI;
+    motionGateTime = Time::now();
+
+    return DepthUpdate::Full;
+}
+
+
+/******************************************************************************/
+void SFM::updateCachedDepth(const Mat& disparity, const Mat& Q, const Mat& R, const cv::Rect& roi, const bool partial)
+{
+    disparityToDepth(disparity, Q, R, depthScratch, roi);
+    filterDepth(depthScratch, roi);
+
+    Mat depth(depthScratch.height(), depthScratch.width(), CV_32FC1, depthScratch.getRawImage(), depthScratch.getRowSize());
+
+    // Only the region computed again replaces the cached depth
+    if (partial && (cachedDepth.size() == depth.size()))
+    {
+        const cv::Rect region = roi & cv::Rect(0, 0, depth.cols, depth.rows);
+        depth(region).copyTo(cachedDepth(region));
+    }
+    else
+        depth.copyTo(cachedDepth);
+}
+
+
+/******************************************************************************/
+void SFM::sendCachedDepth(const Stamp& stamp)
+{
+    if (cachedDepth.empty())
+        return;
+
+    float* shared_depth = NULL;
+    if (depthSharedMemory)
+        shared_depth = depthSharedMemory->acquire(cachedDepth.cols, cachedDepth.rows);
+
+    if (shared_depth != NULL)
+    {
+        cachedDepth.copyTo(Mat(cachedDepth.rows, cachedDepth.cols, CV_32FC1, shared_depth));
+        depthSharedMemory->publish(stamp.getCount(), stamp.getTime());
+    }
+
+    if (outDepth.getOutputCount() == 0)
+        return;
+
+    ImageOf<PixelFloat>& depth_out = outDepth.prepare();
+    depth_out.resize(cachedDepth.cols, cachedDepth.rows);
+    cachedDepth.copyTo(Mat(depth_out.height(), depth_out.width(), CV_32FC1, depth_out.getRawImage(), depth_out.getRowSize()));
+
+    // Send over the network, with the time stamp of the new images
+    Stamp envelope = stamp;
+    outDepth.setEnvelope(envelope);
+    outDepth.write();
+}
+
+
+/******************************************************************************/
+void SFM::filterDepth(ImageOf<PixelFloat>& depth, const cv::Rect& roi)
+{
+    if (!doDepthBLF)
+        return;
+
+    // Filter in place, only within the region of interest as the depth is zero elsewhere
+    Mat depth_mat(depth.height(), depth.width(), CV_32FC1, depth.getRawImage(), depth.getRowSize());
+    if (roi.area() > 0)
+        depth_mat = depth_mat(roi & Rect(0, 0, depth_mat.cols, depth_mat.rows));
+
+    if (!depth_mat.empty())
+        depthGridBLF.apply(depth_mat, depth_mat, sigmaColorDepthBLF, sigmaSpaceDepthBLF, true);
+}
+
+
+/******************************************************************************/
+bool SFM::startDepthPipeline(const std::size_t queueSize)
+{
+    if (pipelineRunning)
+        return false;
+
+    rectifiedFrames.reset(new BoundedQueue<DepthFrame>(queueSize));
+    matchedFrames.reset(new BoundedQueue<DepthFrame>(queueSize));
+    // As many as the frames that can be in the pipeline at once
+    recycledFrames.reset(new BoundedQueue<DepthFrame>(2 * queueSize + 3));
+
+    pipelineRunning = true;
+    acquisitionThread = std::thread(&SFM::acquisitionLoop, this);
+    matchingThread = std::thread(&SFM::matchingLoop, this);
+    publicationThread = std::thread(&SFM::publicationLoop, this);
+
+    return true;
+}
+
+
+/******************************************************************************/
+void SFM::stopDepthPipeline()
+{
+    if (!pipelineRunning)
+        return;
+
+    pipelineRunning = false;
+
+    // Wake up the stages waiting for the images or for the frames
+    leftImgPort.interrupt();
+    rightImgPort.interrupt();
+    rectifiedFrames->close();
+    matchedFrames->close();
+    recycledFrames->close();
+
+    acquisitionThread.join();
+    matchingThread.join();
+    publicationThread.join();
+
+    leftImgPort.resume();
+    rightImgPort.resume();
+}
+
+
+/******************************************************************************/
+void SFM::acquisitionLoop()
+{
+    while (pipelineRunning)
+    {
+        // Restrict the computation to the region of interest, if requested
+        updateDepthROI();
+
+        if (!readImages(true))
+            continue;
+
+        // Reuse the buffers of a published frame, as the disparities are written in place by the stereo camera
+        DepthFrame frame;
+        recycledFrames->tryPop(frame);
+        frame.stamp = imagesStamp;
+        frame.roi = depthROI;
+        frame.update = DepthUpdate::Full;
+
+        // Skip the computation, or restrict it to the parts of the images that changed, if the head is still
+        if (motionGate)
+        {
+            frame.update = checkMotion(frame.roi);
+
+            if (frame.update == DepthUpdate::Cached)
+            {
+                // Passed on to the publication, so that the cached depth is sent after the frames ahead of this one
+                if (!rectifiedFrames->push(std::move(frame)))
+                    break;
+                continue;
+            }
+
+            if (frame.update == DepthUpdate::Partial)
+                this->stereo->setDisparityROI(frame.roi, depthROIDispMin, depthROIDispMax);
+        }
+
+        frame.stereo.left = this->stereo->getImLeft();
+        frame.stereo.right = this->stereo->getImRight();
+
+        if (!this->stereo->rectifyFrame(frame.stereo, this->numberOfDisparities))
+        {
+            motionGateReset = true;
+            continue;
+        }
+
+        // The images are the buffers of the ports, only the rectified ones are passed on
+        frame.stereo.left.release();
+        frame.stereo.right.release();
+
+        if (!rectifiedFrames->push(std::move(frame)))
+            break;
+    }
+}
+
+
+/******************************************************************************/
+void SFM::matchingLoop()
+{
+    DepthFrame frame;
+    while (rectifiedFrames->pop(frame))
+    {
+        if (frame.update != DepthUpdate::Cached)
+            this->stereo->matchFrame(frame.stereo,this->useBestDisp,this->uniquenessRatio,this->speckleWindowSize,
+                this->speckleRange,this->SADWindowSize,this->minDisparity,this->preFilterCap,this->disp12MaxDiff);
+
+        if (!matchedFrames->push(std::move(frame)))
+            break;
+    }
+}
+
+
+/******************************************************************************/
+void SFM::publicationLoop()
+{
+    DepthFrame frame;
+    while (matchedFrames->pop(frame))
+    {
+        if (frame.update == DepthUpdate::Cached)
+        {
+            sendCachedDepth(frame.stamp);
+            recycledFrames->tryPush(std::move(frame));
+            continue;
+        }
+
+        StereoCamera::remapFrame(frame.stereo);
+        if (!frame.stereo.success)
+        {
+            motionGateReset = true;
+            recycledFrames->tryPush(std::move(frame));
+            continue;
+        }
+
+        if (outDisp.getOutputCount()>0)
+            sendDisparity(frame.stereo.Disparity, frame.stamp);
+
+        if (motionGate)
+        {
+            updateCachedDepth(frame.stereo.Disparity16, frame.stereo.Q, frame.stereo.RLrect, frame.roi, frame.update == DepthUpdate::Partial);
+            sendCachedDepth(frame.stamp);
+        }
+        else
+            sendDepth(frame.stereo.Disparity16, frame.stereo.Q, frame.stereo.RLrect, frame.roi, frame.stamp);
+
+        recycledFrames->tryPush(std::move(frame));
+    }
+}
+
+
+/******************************************************************************/
+void SFM::updateDepthROI()
+{
+    yarp::sig::Vector* roi = inDepthROI.read(false);
+    if ((roi != NULL) && ((roi->size() == 4) || (roi->size() == 6)))
+    {
+        depthROI = cv::Rect(int((*roi)[0]), int((*roi)[1]), int((*roi)[2]), int((*roi)[3]));
+        depthROIDispMin = 0;
+        depthROIDispMax = -1;
+
+        // Convert the range of depths to a range of disparities, i.e. d = (q_23 / z - q_33) / q_32
+        const Mat& Q = this->stereo->getQ();
+        if ((roi->size() == 6) && !Q.empty() && ((*roi)[4] > 0.0) && ((*roi)[5] > (*roi)[4]))
+        {
+            double q_23 = Q.at<double>(2, 3);
+            double q_32 = Q.at<double>(3, 2);
+            double q_33 = Q.at<double>(3, 3);
+            double disp_near = (q_23 / (*roi)[4] - q_33) / q_32;
+            double disp_far = (q_23 / (*roi)[5] - q_33) / q_32;
+
+            depthROIDispMin = int(std::floor(std::min(disp_near, disp_far)));
+            depthROIDispMax = int(std::ceil(std::max(disp_near, disp_far)));
+        }
+
+        depthROITime = Time::now();
+    }
+    else if ((depthROI.area() > 0) && (Time::now() - depthROITime > depthROITimeout))
+    {
+        // Restore the whole image if requests stopped coming
+        depthROI = cv::Rect();
+        depthROIDispMin = 0;
+        depthROIDispMax = -1;
+    }
+
+    this->stereo->setDisparityROI(depthROI, depthROIDispMin, depthROIDispMax);
+}
+
+
+/******************************************************************************/
+void SFM::disparityToDepth(const Mat& disparity, const Mat& Q, const Mat& R, ImageOf<PixelFloat>& depth_out, const cv::Rect& roi)
+{
     // Store values required for next computation
     float q_00 = float(Q.at<double>(0, 0));
     float q_03 = float(Q.at<double>(0, 3));
     float q_11 = float(Q.at<double>(1, 1));
     float q_13 = float(Q.at<double>(1, 3));
     float q_23 = float(Q.at<double>(2, 3));
-    float q_32 = float(Q.at<double>(3, 2));
     float q_33 = float(Q.at<double>(3, 3));
     float r_02 = float(R.at<double>(0, 2));
     float r_12 = float(R.at<double>(1, 2));
     float r_22 = float(R.at<double>(2, 2));
 
-    // Evaluate depth map
-    ImageOf<PixelFloat>& depth_out = outDepth.prepare();
+    // Disparity is in 16-bit fixed point with 4 fractional bits
+    float q_32 = float(Q.at<double>(3, 2)) / 16.0f;
+
     depth_out.resize(disparity.cols, disparity.rows);
-    #pragma omp parallel for collapse(2)
-    for (int u = 0; u < disparity.cols; u++)
-    {
-        for (int v = 0; v < disparity.rows; v++)
-        {
-            // Evaluate disparity(u, v)
-            CvScalar scalar = cvGet2D(&ipl_disparity, v, u);
-            float disp = scalar.val[0] / 16.0;
 
-            // Evaluate depth(u, v)
-            depth_out(u, v) = (r_02 * (float(u) * q_00 + q_03) + r_12 * (float(v) * q_11 + q_13) + r_22 * q_23) /
-                              (disp * q_32 + q_33);
-        }
+    // An empty region of interest stands for the whole image
+    cv::Rect region(0, 0, disparity.cols, disparity.rows);
+    if (roi.area() > 0)
+    {
+        region &= roi;
+        depth_out.zero();
     }
 
-    // Send over the network
-    outDepth.write();
+    // Terms of the numerator depending on the column only
+    std::vector<float> column_terms(region.width);
+    for (int u = 0; u < region.width; u++)
+        column_terms[u] = r_02 * (float(region.x + u) * q_00 + q_03) + r_22 * q_23;
 
-    return true;
+    // Evaluate depth map row by row, non valid disparities (i.e. occlusions) are set to 0.0
+    #pragma omp parallel for
+    for (int v = region.y; v < region.y + region.height; v++)
+    {
+        const short* disparity_row = disparity.ptr<short>(v) + region.x;
+        float* depth_row = reinterpret_cast<float*>(depth_out.getRow(v)) + region.x;
+        const float* terms = column_terms.data();
+        const float row_term = r_12 * (float(v) * q_11 + q_13);
+
+        #pragma omp simd
+        for (int u = 0; u < region.width; u++)
+        {
+            float depth = (terms[u] + row_term) / (float(disparity_row[u]) * q_32 + q_33);
+            depth_row[u] = (disparity_row[u] > 0) ? depth : 0.0f;
+        }
+    }
 }
 
 
@@ -1012,6 +1491,8 @@ bool SFM::respond(const Bottle& command, Bottle& reply)
         reply.addString("- [Root x y]: Given the pixel coordinate x,y in the Left image the response is the 3D Point: X Y Z computed using the depth map wrt the ROOT reference system. Points with non valid disparity (i.e. occlusions) are handled with the value (0.0,0.0,0.0).");
         reply.addString("- [Rect tlx tly w h step]: Given the pixels in the rectangle defined by {(tlx,tly) (tlx+w,tly+h)} (parsed by columns), the response contains the corresponding 3D points in the ROOT frame. The optional parameter step defines the sampling quantum; by default step=1.");
         reply.addString("- [Points u_1 v_1 ... u_n v_n]: Given a list of n pixels, the response contains the corresponding 3D points in the ROOT frame.");
+        reply.addString("- [RectBlob tlx tly w h step masked]: As [Rect], but the response is (count time n points [mask]): the time stamp of the images, the number n of pixels and the 3D points as a blob of float (X Y Z), with (0.0,0.0,0.0) for the non valid ones. If the optional parameter masked is true, the blob contains only the valid points and is followed by a blob of n bytes, set to 1 for the valid pixels.");
+        reply.addString("- [PointsBlob u_1 v_1 ... u_n v_n]: As [Points], with the response of [RectBlob].");
         reply.addString("- [Flood3D x y dist]: Perform 3D flood-fill on the seed point (x,y), returning the following info: [u_1 v_1 x_1 y_1 z_1 ...]. The optional parameter dist expressed in meters regulates the fill (by default = 0.004).");
         reply.addString("- [uL_1 vL_1 uR_1 vR_1 ... uL_n vL_n uR_n vR_n]: Given n quadruples uL_i vL_i uR_i vR_i, where uL_i vL_i are the pixel coordinates in the Left image and uR_i vR_i are the coordinates of the matched pixel in the Right image, the response is a set of 3D points (X1 Y1 Z1 ... Xn Yn Zn) wrt the ROOT reference system.");
         reply.addString("- [cart2stereo X Y Z]: Given a world point X Y Z wrt to ROOT reference frame the response is the projection (uL vL uR vR) in the Left and Right images.");
@@ -1145,7 +1626,7 @@ bool SFM::respond(const Bottle& command, Bottle& reply)
         reply.addDouble(point.y);
         reply.addDouble(point.z);
     }
-    else if (command.get(0).asString()=="Rect")
+    else if ((command.get(0).asString()=="Rect") || (command.get(0).asString()=="RectBlob"))
     {
         int tl_u = command.get(1).asInt();
         int tl_v = command.get(2).asInt();
@@ -1154,30 +1635,28 @@ bool SFM::respond(const Bottle& command, Bottle& reply)
 
         int step = 1;
         if (command.size()>=6)
-            step=command.get(5).asInt();
+            step=std::max(command.get(5).asInt(),1);
 
+        std::vector<std::pair<int, int>> coordinates;
         for (int u=tl_u; u<br_u; u+=step)
-        {
             for (int v=tl_v; v<br_v; v+=step)
-            {
-                Point3f point=this->get3DPoint(u,v,"ROOT");
-                reply.addDouble(point.x);
-                reply.addDouble(point.y);
-                reply.addDouble(point.z);
-            }
-        }
+                coordinates.push_back(std::make_pair(u,v));
+
+        if (command.get(0).asString()=="RectBlob")
+            add3DPointsBlob(coordinates,(command.size()>=7) && command.get(6).asBool(),reply);
+        else
+            add3DPoints(coordinates,reply);
     }
-    else if (command.get(0).asString()=="Points")
+    else if ((command.get(0).asString()=="Points") || (command.get(0).asString()=="PointsBlob"))
     {
+        std::vector<std::pair<int, int>> coordinates;
         for (int cnt=1; cnt<command.size()-1; cnt+=2)
-        {
-            int u=command.get(cnt).asInt();
-            int v=command.get(cnt+1).asInt();
-            Point3f point=this->get3DPoint(u,v,"ROOT");
-            reply.addDouble(point.x);
-            reply.addDouble(point.y);
-            reply.addDouble(point.z);
-        }
+            coordinates.push_back(std::make_pair(command.get(cnt).asInt(),command.get(cnt+1).asInt()));
+
+        if (command.get(0).asString()=="PointsBlob")
+            add3DPointsBlob(coordinates,false,reply);
+        else
+            add3DPoints(coordinates,reply);
     }
     else if (command.get(0).asString()=="Flood3D")
     {
@@ -1302,6 +1781,84 @@ Point2f SFM::projectPoint(const string &camera, double x, double y, double z)
 }
 
 
+/******************************************************************************/
+void SFM::add3DPoints(const std::vector<std::pair<int, int>>& coordinates, Bottle& reply)
+{
+    // All the points from the same disparity map, non valid ones being (0.0,0.0,0.0)
+    bool valid;
+    Eigen::MatrixXd points;
+    Eigen::VectorXi valid_points;
+    std::tie(valid, points, valid_points) = get3DPoints(coordinates, true);
+
+    for (size_t i=0, j=0; i<coordinates.size(); i++)
+    {
+        if (valid && (valid_points(i) == 1))
+        {
+            reply.addDouble((float)points(0, j));
+            reply.addDouble((float)points(1, j));
+            reply.addDouble((float)points(2, j));
+            j++;
+        }
+        else
+        {
+            reply.addDouble(0.0);
+            reply.addDouble(0.0);
+            reply.addDouble(0.0);
+        }
+    }
+}
+
+
+/******************************************************************************/
+void SFM::add3DPointsBlob(const std::vector<std::pair<int, int>>& coordinates, const bool masked, Bottle& reply)
+{
+    if (!updateDisparity(true))
+    {
+        reply.addString("NACK");
+        return;
+    }
+
+    bool valid;
+    Eigen::MatrixXd points;
+    Eigen::VectorXi valid_points;
+    std::tie(valid, points, valid_points) = compute3DPoints(coordinates);
+
+    // Valid points only, followed by the mask, or all the points with the non valid ones set to zero
+    std::vector<unsigned char> mask(coordinates.size(), 0);
+    std::vector<float> blob;
+    if (valid)
+    {
+        Eigen::MatrixXf points_float = points.cast<float>();
+        for (size_t i=0; i<coordinates.size(); i++)
+            mask[i] = (unsigned char)valid_points(i);
+
+        if (masked)
+            blob.assign(points_float.data(), points_float.data() + points_float.size());
+        else
+        {
+            blob.assign(3 * coordinates.size(), 0.0f);
+            for (size_t i=0, j=0; i<coordinates.size(); i++)
+            {
+                if (mask[i])
+                {
+                    std::copy(points_float.col(j).data(), points_float.col(j).data() + 3, blob.data() + 3 * i);
+                    j++;
+                }
+            }
+        }
+    }
+    else if (!masked)
+        blob.assign(3 * coordinates.size(), 0.0f);
+
+    reply.addInt(imagesStamp.getCount());
+    reply.addDouble(imagesStamp.getTime());
+    reply.addInt((int)coordinates.size());
+    reply.add(Value(blob.data(), (int)(blob.size() * sizeof(float))));
+    if (masked)
+        reply.add(Value(mask.data(), (int)mask.size()));
+}
+
+
 /******************************************************************************/
 void SFM::fillWorld3D(ImageOf<PixelRgbFloat> &worldCartImg,
                       ImageOf<PixelRgbFloat> &worldCylImg)
@@ -102,6 +102,37 @@ tags \e /cartesian:o and \e /cylindrical:o are appended.
 --skipBLF
 - Disable Bilateral filter.
 
+--depthBLF \e false
+- If \e true, the depth map is smoothed by a bilateral filter. Pixels with non valid depth
+are neither used nor filtered.
+
+--sigmaColorDepthBLF \e 0.05
+- The parameter \e 0.05 specifies the range (in meters) of the bilateral filter of the depth map.
+It is enlarged when the range of the depths would need a grid with too many cells.
+
+--sigmaSpaceDepthBLF \e 5.0
+- The parameter \e 5.0 specifies the spatial extent (in pixels) of the bilateral filter of the depth map.
+
+--depthROITimeout \e 1.0
+- The parameter \e 1.0 specifies the time (in seconds) after which the region of interest
+received on \e /depth/roi:i is discarded if no other request arrives.
+
+--motionGate \e false
+- If \e true, the depth is computed again only where the images changed, as long as the head is still.
+The images are compared with the ones of the last computation within tiles of \e motionGateTile pixels
+(by default 32), which are changed if the mean absolute difference of their gray levels exceeds
+\e motionGateThreshold (by default 8.0). If no tile changed the last depth is sent again with the time stamp of the
+new images, otherwise the depth is computed within the bounding box of the changed tiles, unless it covers more than
+\e motionGatePartialRatio (by default 0.5) of the image. The whole depth is computed if any joint of the head moves
+faster than \e motionGateVelocity deg/s (by default 1.0), if the pose of the cameras changed, and at least every
+\e motionGateRefresh seconds (by default 1.0). As only LIBELAS computes the disparity within a region, with
+\e use_elas \e false changed images always trigger the computation of the whole depth.
+
+--depthSharedMemory \e true
+- If \e true, the depth map is also written in a ring of \e depthSharedMemorySlots (by default 4) images
+in shared memory, named after the \e /depth:o port (e.g. \e /SFM_depth:o), that readers running on the same host
+access in place instead of receiving it from the port.
+
 --use_sgbm
 - By default LIBELAS is used to compute the disparity. However, if you prefer to continue using the
 OpenCV's SGBM algorithm, you just need to pass the parameter \e use_sgbm.
@@ -174,11 +205,20 @@ set to \e true in \e MIDDLEBURY and \e false in \e ROBOTICS.
 - This is the \e filter_adaptive_mean parameter in <a href="https://github.com/robotology/stereo-vision/tree/master/lib/elas/include/elas.h">elas.h</a>,
 set to \e false in \e MIDDLEBURY and \e true in \e ROBOTICS.
 
+--elas_temporal_prior \e false
+- If \e true, the support points of ELAS are searched only within \e elas_temporal_prior_radius disparities (by default 4)
+from the ones of the previous images, warped according to the motion of the eyes given by the gaze controller.
+Support points without prior are searched over the full range, as well as all of them every
+\e elas_temporal_prior_refresh images (by default 10), so that objects moving in the scene are recovered.
+
 \section portsc_sec Ports Created
 - <i> /SFM/left:i </i> accepts the incoming images from the left eye.
 - <i> /SFM/right:i </i> accepts the incoming images from the right eye.
 
+- <i> /SFM/depth/roi:i </i> accepts the region of interest (tlx tly w h) of the left image where the depth is required, optionally followed by the expected range of depths (z_min z_max) in meters. With ELAS, rectification and matching run only on the rows of the region and the disparities are searched only within the range corresponding to the depths. A null width or height restores the full image, as well as not receiving any request for \e depthROITimeout seconds (by default 1.0).
+
 - <i> /SFM/disp:o </i> outputs the disparity map in grayscale values.
+- <i> /SFM/depth:o </i> outputs the depth map (float, in meters). Pixels with non valid disparity or outside the region of interest are set to 0.0. The envelope carries the time stamp of the left image the depth has been computed from, as the one of \e /SFM/disp:o. The depth is serialized only if the port has connections.
 - <i> /SFM/world/cartesian:o</i> outputs the world image (3-channel float with X Y Z values).
 - <i> /SFM/world/cylindrical:o</i> outputs the world image (3-channel float with R Theta Z values).
 - <i> /SFM/match:o</i> outputs the match image.
@@ -199,12 +239,22 @@ set to \e false in \e MIDDLEBURY and \e true in \e ROBOTICS.
     - [Root x y]: Given the pixel coordinate x,y in the Left image the response is the 3D Point: X Y Z computed using the depth map wrt the ROOT reference system. Points with non valid disparity (i.e. occlusions) are handled with the value (0.0,0.0,0.0).
     - [Rect tlx tly w h step]: Given the pixels in the rectangle defined by {(tlx,tly) (tlx+w,tly+h)} (parsed by columns), the response contains the corresponding 3D points in the ROOT frame. The optional parameter step defines the sampling quantum; by default step=1.
     - [Points u_1 v_1 ... u_n v_n]: Given a list of n pixels, the response contains the corresponding 3D points in the ROOT frame.
+    - [RectBlob tlx tly w h step masked]: As [Rect], but the response is (count time n points [mask]): the time stamp of the images the points are computed from, the number n of pixels and the 3D points as a single blob of float (X Y Z), with (0.0,0.0,0.0) for the non valid ones. If the optional parameter masked is true, the blob contains only the valid points and is followed by a blob of n bytes, set to 1 for the valid pixels.
+    - [PointsBlob u_1 v_1 ... u_n v_n]: As [Points], with the response of [RectBlob].
     - [Flood3D x y dist]: Perform 3D flood-fill on the seed point (x,y), returning the following info: [u_1 v_1 x_1 y_1 z_1 ...]. The optional parameter dist expressed in meters regulates the fill (by default = 0.004).
     - [uL_1 vL_1 uR_1 vR_1 ... uL_n vL_n uR_n vR_n]: Given n quadruples uL_i vL_i uR_i vR_i, where uL_i vL_i are the pixel coordinates in the Left image and uR_i vR_i are the coordinates of the matched pixel in the Right image, the response is a set of 3D points (X1 Y1 Z1 ... Xn Yn Zn) wrt the ROOT reference system.
     - [cart2stereo X Y Z]: Given a world point X Y Z wrt to ROOT reference frame the response is the projection (uL vL uR vR) in the Left and Right images.
     - [doBLF flag]: activate Bilateral filter for flag = true, and skip it for flag = false (default by config).
     - [bilatfilt sigmaColor sigmaSpace]: Set the parameters for the bilateral filer (default sigmaColor = 10.0, sigmaSpace = 10.0 .
 
+\section pipeline_sec Depth pipeline
+The depth can be computed on request, using updateDepth(), or continuously by the pipeline started with startDepthPipeline().
+The pipeline runs three stages on different threads, connected by queues holding at most a given number of frames:
+acquisition and rectification, matching, and remapping together with the conversion to depth and the publication. Hence a frame
+is rectified while the previous one is matched. A stage waits if the following one is late, so that the images read by the
+first stage are always the latest ones. While the pipeline is running, updateDisparity(), updateDepth() and the queries
+relying on them (e.g. get3DPoints()) must not be used.
+
 \section in_files_sec Input Data Files
 None.
 
@@ -224,6 +274,9 @@ against OpenCV versions: 2.4.
 #include <fstream>
 #include <set>
 #include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 #include <yarp/os/all.h>
 #include <yarp/dev/all.h>
@@ -237,6 +290,11 @@ against OpenCV versions: 2.4.
 #include <Eigen/Dense>
 
 #include <GazeController.h>
+#include <DepthSharedMemory.h>
+
+#include "BoundedQueue.h"
+#include "ImageChangeDetector.h"
+#include "fastBilateral.hpp"
 
 #ifdef USING_GPU
     #include <iCub/stereoVision/utils.h>
@@ -260,7 +318,6 @@ class SFM
     IplImage*     right;
     StereoCamera* stereo;
     IplImage*     output_match;
-    Mat           outputDm;
 
     Mat leftMat, rightMat;
 
@@ -278,6 +335,14 @@ class SFM
 
     BufferedPort<ImageOf<PixelMono> > outDisp;
     BufferedPort<ImageOf<PixelFloat>> outDepth;
+    std::unique_ptr<DepthSharedMemoryWriter> depthSharedMemory;
+    BufferedPort<yarp::sig::Vector> inDepthROI;
+    cv::Rect depthROI;
+    int depthROIDispMin;
+    int depthROIDispMax;
+    double depthROITime;
+    double depthROITimeout;
+    Stamp imagesStamp;
     BufferedPort<ImageOf<PixelBgr> >  outMatch;
 
     BufferedPort<ImageOf<PixelRgb> >  outLeftRectImgPort;
@@ -298,6 +363,30 @@ class SFM
     double sigmaColorBLF;
     double sigmaSpaceBLF;
     bool doBLF;
+    cv_extend::BilateralGrid gridBLF;
+    Mat disparityBLF;
+    bool doDepthBLF;
+    double sigmaColorDepthBLF;
+    double sigmaSpaceDepthBLF;
+    cv_extend::BilateralGrid depthGridBLF;
+
+    // Depth is recomputed only where the images changed, if the head is still
+    enum class DepthUpdate { Full, Partial, Cached };
+    bool motionGate;
+    double motionGateVelocity;
+    double motionGateRefresh;
+    double motionGatePartialRatio;
+    bool motionGatePartial;
+    std::unique_ptr<ImageChangeDetector> changeDetector;
+    Mat motionGatePose;
+    cv::Rect motionGateROI;
+    double motionGateTime;
+    std::atomic<bool> motionGateReset;
+    ImageOf<PixelFloat> depthScratch;
+    Mat cachedDepth;
+    DepthUpdate checkMotion(cv::Rect& region);
+    void updateCachedDepth(const Mat& disparity, const Mat& Q, const Mat& R, const cv::Rect& roi, const bool partial);
+    void sendCachedDepth(const Stamp& stamp);
     yarp::os::Mutex mutexRecalibration;
     Event calibEndEvent;
     yarp::os::Mutex mutexDisp;
@@ -318,13 +407,41 @@ class SFM
     void convert(Matrix& matrix, Mat& mat);
     void convert(Mat& mat, Matrix& matrix);
     void fillWorld3D(ImageOf<PixelRgbFloat> &worldCartImg, ImageOf<PixelRgbFloat> &worldCylImg);
+    std::tuple<bool, Eigen::MatrixXd, Eigen::VectorXi> compute3DPoints(const std::vector<std::pair<int, int>>& u_v_coordinates, const float left_z_threshold = 10.0);
+    void add3DPoints(const std::vector<std::pair<int, int>>& coordinates, Bottle& reply);
+    void add3DPointsBlob(const std::vector<std::pair<int, int>>& coordinates, const bool masked, Bottle& reply);
     void floodFill(const Point &seed,const Point3f &p0, const double dist, set<int> &visited, Bottle &res);
     bool loadExtrinsics(yarp::os::ResourceFinder& rf, Mat& Ro, Mat& To, yarp::sig::Vector& eyes);
     bool updateExtrinsics(Mat& Rot, Mat& Tr, yarp::sig::Vector& eyes, const string& groupname);
     void updateViaGazeCtrl(const bool update);
     void updateViaKinematics(const yarp::sig::Vector& deyes);
+    void updateDepthROI();
+    bool readImages(const bool do_block);
+    void sendDisparity(const Mat& disparity, const Stamp& stamp);
+    void sendDepth(const Mat& disparity, const Mat& Q, const Mat& R, const cv::Rect& roi, const Stamp& stamp);
+    void filterDepth(ImageOf<PixelFloat>& depth, const cv::Rect& roi);
     bool init;
 
+    // A frame going through the stages of the depth pipeline
+    struct DepthFrame
+    {
+        StereoFrame stereo;
+        Stamp stamp;
+        cv::Rect roi;
+        DepthUpdate update;
+    };
+    std::unique_ptr<BoundedQueue<DepthFrame>> rectifiedFrames;
+    std::unique_ptr<BoundedQueue<DepthFrame>> matchedFrames;
+    // Frames already published, whose buffers are reused by the next acquisitions
+    std::unique_ptr<BoundedQueue<DepthFrame>> recycledFrames;
+    std::thread acquisitionThread;
+    std::thread matchingThread;
+    std::thread publicationThread;
+    std::atomic<bool> pipelineRunning;
+    void acquisitionLoop();
+    void matchingLoop();
+    void publicationLoop();
+
 	const std::string port_prefix_;
 
 public:
@@ -334,6 +451,9 @@ public:
     bool close();
     bool updateDisparity(const bool do_block);
     bool updateDepth();
+    bool startDepthPipeline(const std::size_t queueSize = 2);
+    void stopDepthPipeline();
+    static void disparityToDepth(const Mat& disparity, const Mat& Q, const Mat& R, ImageOf<PixelFloat>& depth, const cv::Rect& roi = cv::Rect());
     bool respond(const Bottle& command, Bottle& reply);
 
     void setDispParameters(bool _useBestDisp, int _uniquenessRatio, int _speckleWindowSize,
@@ -31,161 +31,373 @@
 
 #include <opencv2/opencv.hpp>
 
-namespace cv_extend {
-
-void bilateralFilter(cv::InputArray src, cv::OutputArray dst,
-                     double sigmaColor, double sigmaSpace);
-
-void bilateralFilterImpl(cv::Mat1d src, cv::Mat1d dst,
-                         double sigmaColor, double sigmaSpace);
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-template<typename T, typename T_, typename T__>
-inline
-T clamp(const T_ min, const T__ max, const T x)
-{
-    return
-        ( x < static_cast<T>(min) ) ? static_cast<T>(min) :
-        ( x < static_cast<T>(max) ) ? static_cast<T>(x) :
-        static_cast<T>(max);
-}
+namespace cv_extend {
 
-template<typename T>
-inline
-T
-trilinear_interpolation( const cv::Mat mat,
-                         const double y,
-                         const double x,
-                         const double z)
+/**
+ * Bilateral grid of Paris and Durand, holding the sums of the values and of the weights of the pixels
+ * falling within each cell (y / sigmaSpace, x / sigmaSpace, value / sigmaColor).
+ *
+ * The grid is filled (splat), blurred and interpolated at the pixels (slice) by several threads, each
+ * one working on whole planes of the grid at a given y, so that the blur along x and along the values
+ * runs within the cache and on contiguous memory. The buffers are kept across calls, hence filtering
+ * images of the same size and range does not allocate memory.
+ *
+ * The number of cells is bounded: when the range of the values would need more cells than allowed,
+ * e.g. depths with far outliers or a fine sigmaColor, sigmaColor is enlarged until the grid fits.
+ */
+class BilateralGrid
 {
-    const size_t height = mat.size[0];
-    const size_t width  = mat.size[1];
-    const size_t depth  = mat.size[2];
-
-    const size_t y_index  = clamp(0, height-1, static_cast<size_t>(y));
-    const size_t yy_index = clamp(0, height-1, y_index+1);
-    const size_t x_index  = clamp(0, width-1, static_cast<size_t>(x));
-    const size_t xx_index = clamp(0, width-1, x_index+1);
-    const size_t z_index  = clamp(0, depth-1, static_cast<size_t>(z));
-    const size_t zz_index = clamp(0, depth-1, z_index+1);
-    const double y_alpha = y - y_index;
-    const double x_alpha = x - x_index;
-    const double z_alpha = z - z_index;
-
-    return
-        (1.0-y_alpha) * (1.0-x_alpha) * (1.0-z_alpha) * mat.at<T>(y_index, x_index, z_index) +
-        (1.0-y_alpha) * x_alpha       * (1.0-z_alpha) * mat.at<T>(y_index, xx_index, z_index) +
-        y_alpha       * (1.0-x_alpha) * (1.0-z_alpha) * mat.at<T>(yy_index, x_index, z_index) +
-        y_alpha       * x_alpha       * (1.0-z_alpha) * mat.at<T>(yy_index, xx_index, z_index) +
-        (1.0-y_alpha) * (1.0-x_alpha) * z_alpha       * mat.at<T>(y_index, x_index, zz_index) +
-        (1.0-y_alpha) * x_alpha       * z_alpha       * mat.at<T>(y_index, xx_index, zz_index) +
-        y_alpha       * (1.0-x_alpha) * z_alpha       * mat.at<T>(yy_index, x_index, zz_index) +
-        y_alpha       * x_alpha       * z_alpha       * mat.at<T>(yy_index, xx_index, zz_index);
-
-}
+public:
+    /**
+     * max_cells bounds the number of cells of the grid, i.e. its memory (four floats per cell)
+     * and the time spent blurring it. At least two cells along the values are always used.
+     */
+    explicit BilateralGrid(const std::size_t max_cells = 1 << 20) :
+        max_cells_(max_cells)
+    { }
+
+    /**
+     * Filter a single channel image of type CV_8U, CV_16U, CV_16S or CV_32F. dst can be src.
+     * If ignore_non_positive is true, pixels lower or equal to zero (or NaN), e.g. non valid disparities
+     * or depths, neither contribute to the grid nor are filtered, but are copied as they are.
+     */
+    void apply(const cv::Mat& src, cv::Mat& dst, double sigma_color, double sigma_space,
+               bool ignore_non_positive = false)
+    {
+        CV_Assert(src.channels() == 1);
+        CV_Assert((sigma_color > 0) && (sigma_space > 0));
+
+        dst.create(src.size(), src.type());
+
+        switch (src.depth())
+        {
+            case CV_8U:  applyImpl<unsigned char>(src, dst, sigma_color, sigma_space, ignore_non_positive); break;
+            case CV_16U: applyImpl<unsigned short>(src, dst, sigma_color, sigma_space, ignore_non_positive); break;
+            case CV_16S: applyImpl<short>(src, dst, sigma_color, sigma_space, ignore_non_positive); break;
+            case CV_32F: applyImpl<float>(src, dst, sigma_color, sigma_space, ignore_non_positive); break;
+            default: CV_Error(cv::Error::StsUnsupportedFormat, "cv_extend::BilateralGrid supports CV_8U, CV_16U, CV_16S and CV_32F images");
+        }
+    }
 
+private:
+    static const int padding = 2;
 
-/**
- * Implementation
- */
+    /* Maximum number of cells along the values, regardless of the budget. */
+    static const int max_value_cells = 1024;
 
-void bilateralFilter(cv::InputArray _src, cv::OutputArray _dst,
-                     double sigmaColor, double sigmaSpace)
-{
-    cv::Mat src = _src.getMat();
+    static int threadCount()
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
 
-    CV_Assert(src.channels() == 1);
+    static int threadIndex()
+    {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
 
-    // bilateralFilterImpl runs with double depth, single channel
-    if ( src.depth() != CV_64FC1 ) {
-        src = cv::Mat(_src.size(), CV_64FC1);
-        _src.getMat().convertTo(src, CV_64FC1);
+    template<typename T>
+    static bool isValid(const T v, const bool ignore_non_positive)
+    {
+        return !ignore_non_positive || (v > 0);
     }
 
-    cv::Mat dst_tmp = cv::Mat(_src.size(), CV_64FC1);
-    bilateralFilterImpl(src, dst_tmp, sigmaColor, sigmaSpace);
+    /* Blur [1 2 1] / 4 along the values (step = 1) or along x (step = depth) of a plane of width x depth cells;
+       only the interior cells are written, the border cells are zero. */
+    static void blurPlane(const float* in, float* out, const int width, const int depth, const int step)
+    {
+        std::fill(out, out + depth, 0.0f);
+        std::fill(out + (width - 1) * depth, out + width * depth, 0.0f);
 
-    _dst.create(dst_tmp.size(), _src.type());
-    dst_tmp.convertTo(_dst.getMat(), _src.type());
+        for (int x = 1; x < width - 1; ++x)
+        {
+            const float* i = in + x * depth;
+            float* o = out + x * depth;
 
-}
+            o[0] = 0.0f;
+            o[depth - 1] = 0.0f;
 
-void bilateralFilterImpl(cv::Mat1d src, cv::Mat1d dst,
-                         double sigma_color, double sigma_space)
-{
-    using namespace cv;
-    const size_t height = src.rows, width = src.cols;
-    const size_t padding_xy = 2, padding_z = 2;
-    double src_min, src_max;
-    cv::minMaxLoc(src, &src_min, &src_max);
-
-    const size_t small_height = static_cast<size_t>((height-1)/sigma_space) + 1 + 2 * padding_xy;
-    const size_t small_width  = static_cast<size_t>((width-1)/sigma_space) + 1 + 2 * padding_xy;
-    const size_t small_depth  = static_cast<size_t>((src_max-src_min)/sigma_color) + 1 + 2 * padding_xy;
-
-    int data_size[] = {small_height, small_width, small_depth};
-    cv::Mat data(3, data_size, CV_64FC2);
-    data.setTo(0);
-
-    // down sample
-    for ( int y = 0; y < height; ++y ) {
-        for ( int x = 0; x < width; ++x) {
-            const size_t small_x = static_cast<size_t>( x/sigma_space + 0.5) + padding_xy;
-            const size_t small_y = static_cast<size_t>( y/sigma_space + 0.5) + padding_xy;
-            const double z = src.at<double>(y,x) - src_min;
-            const size_t small_z = static_cast<size_t>( z/sigma_color + 0.5 ) + padding_z;
-
-            cv::Vec2d v = data.at<cv::Vec2d>(small_y, small_x, small_z);
-            v[0] += src.at<double>(y,x);
-            v[1] += 1.0;
-            data.at<cv::Vec2d>(small_y, small_x, small_z) = v;
+            #pragma omp simd
+            for (int z = 1; z < depth - 1; ++z)
+                o[z] = 0.25f * (i[z - step] + i[z + step]) + 0.5f * i[z];
         }
     }
 
-    // convolution
-    cv::Mat buffer(3, data_size, CV_64FC2);
-    buffer.setTo(0);
-    int offset[3];
-    offset[0] = &(data.at<cv::Vec2d>(1,0,0)) - &(data.at<cv::Vec2d>(0,0,0));
-    offset[1] = &(data.at<cv::Vec2d>(0,1,0)) - &(data.at<cv::Vec2d>(0,0,0));
-    offset[2] = &(data.at<cv::Vec2d>(0,0,1)) - &(data.at<cv::Vec2d>(0,0,0));
-
-    for ( int dim = 0; dim < 3; ++dim ) { // dim = 3 stands for x, y, and depth
-        const int off = offset[dim];
-        for ( int ittr = 0; ittr < 2; ++ittr ) {
-            cv::swap(data, buffer);
-
-            for ( int y = 1; y < small_height-1; ++y ) {
-                for ( int x = 1; x < small_width-1; ++x ) {
-                    cv::Vec2d *d_ptr = &(data.at<cv::Vec2d>(y,x,1));
-                    cv::Vec2d *b_ptr = &(buffer.at<cv::Vec2d>(y,x,1));
-                    for ( int z = 1; z < small_depth-1; ++z, ++d_ptr, ++b_ptr ) {
-                        cv::Vec2d b_prev = *(b_ptr-off), b_curr = *b_ptr, b_next = *(b_ptr+off);
-                        *d_ptr = (b_prev + b_next + 2.0 * b_curr) / 4.0;
-                    } // z
-                } // x
-            } // y
-
-        } // ittr
-    } // dim
-
-    // upsample
-
-    for ( cv::MatIterator_<cv::Vec2d> d = data.begin<cv::Vec2d>(); d != data.end<cv::Vec2d>(); ++d )
+    template<typename T>
+    void applyImpl(const cv::Mat& src, cv::Mat& dst, double sigma_color, const double sigma_space,
+                   const bool ignore_non_positive)
     {
-        (*d)[0] /= (*d)[1] != 0 ? (*d)[1] : 1;
-    }
+        const int height = src.rows;
+        const int width = src.cols;
+
+        // Range of the valid values
+        float src_min = 0.0f;
+        float src_max = 0.0f;
+        bool any_valid = false;
+        for (int y = 0; y < height; ++y)
+        {
+            const T* row = src.ptr<T>(y);
+            for (int x = 0; x < width; ++x)
+            {
+                if (!isValid(row[x], ignore_non_positive))
+                    continue;
+
+                const float v = static_cast<float>(row[x]);
+                src_min = any_valid ? std::min(src_min, v) : v;
+                src_max = any_valid ? std::max(src_max, v) : v;
+                any_valid = true;
+            }
+        }
+
+        if (!any_valid)
+        {
+            if (dst.data != src.data)
+                src.copyTo(dst);
+            return;
+        }
 
-    for ( int y = 0; y < height; ++y ) {
-        for ( int x = 0; x < width; ++x ) {
-            const double z = src.at<double>(y,x) - src_min;
-            const double px = static_cast<double>(x) / sigma_space + padding_xy;
-            const double py = static_cast<double>(y) / sigma_space + padding_xy;
-            const double pz = static_cast<double>(z) / sigma_color + padding_z;
-            dst.at<double>(y,x) = trilinear_interpolation<cv::Vec2d>(data, py, px, pz)[0];
+        const int small_height = static_cast<int>((height - 1) / sigma_space) + 1 + 2 * padding;
+        const int small_width  = static_cast<int>((width - 1) / sigma_space) + 1 + 2 * padding;
+
+        // Cells along the values allowed by the budget, enlarging sigma_color if the range needs more
+        const std::size_t budget = max_cells_ / (static_cast<std::size_t>(small_width) * small_height);
+        const int value_cells = std::max(static_cast<int>(std::min<std::size_t>(budget, max_value_cells + 2 * padding)) - 2 * padding, 2);
+        if ((src_max - src_min) / sigma_color >= value_cells)
+            sigma_color = (src_max - src_min) / (value_cells - 1);
+
+        const int small_depth  = static_cast<int>((src_max - src_min) / sigma_color) + 1 + 2 * padding;
+        const std::size_t plane = static_cast<std::size_t>(small_width) * small_depth;
+        const std::size_t size = plane * small_height;
+        const float inv_color = static_cast<float>(1.0 / sigma_color);
+
+        value_.resize(size);
+        weight_.resize(size);
+        value_tmp_.resize(size);
+        weight_tmp_.resize(size);
+        scratch_.resize(2 * plane * threadCount());
+
+        // Cells of the pixels along x and along y, the latter as the range of rows of each plane
+        small_x_.resize(width);
+        for (int x = 0; x < width; ++x)
+            small_x_[x] = static_cast<int>(x / sigma_space + 0.5) + padding;
+
+        first_row_.assign(small_height + 1, height);
+        for (int y = height - 1; y >= 0; --y)
+            first_row_[static_cast<int>(y / sigma_space + 0.5) + padding] = y;
+        for (int i = small_height - 1; i >= 0; --i)
+            first_row_[i] = std::min(first_row_[i], first_row_[i + 1]);
+
+        // Splat, each plane being filled only by its rows
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < small_height; ++i)
+        {
+            float* value = value_.data() + i * plane;
+            float* weight = weight_.data() + i * plane;
+            std::fill(value, value + plane, 0.0f);
+            std::fill(weight, weight + plane, 0.0f);
+
+            for (int y = first_row_[i]; y < first_row_[i + 1]; ++y)
+            {
+                const T* row = src.ptr<T>(y);
+                for (int x = 0; x < width; ++x)
+                {
+                    if (!isValid(row[x], ignore_non_positive))
+                        continue;
+
+                    const float v = static_cast<float>(row[x]);
+                    const std::size_t cell = small_x_[x] * small_depth + static_cast<int>((v - src_min) * inv_color + 0.5f) + padding;
+                    value[cell] += v;
+                    weight[cell] += 1.0f;
+                }
+            }
+        }
+
+        // Blur along the values and along x, twice each, plane by plane
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < small_height; ++i)
+        {
+            float* value = value_.data() + i * plane;
+            float* weight = weight_.data() + i * plane;
+
+            if ((i == 0) || (i == small_height - 1))
+            {
+                std::fill(value, value + plane, 0.0f);
+                std::fill(weight, weight + plane, 0.0f);
+                continue;
+            }
+
+            float* value_tmp = scratch_.data() + 2 * plane * threadIndex();
+            float* weight_tmp = value_tmp + plane;
+
+            for (int step : {1, 1, small_depth, small_depth})
+            {
+                blurPlane(value, value_tmp, small_width, small_depth, step);
+                blurPlane(weight, weight_tmp, small_width, small_depth, step);
+                std::swap(value, value_tmp);
+                std::swap(weight, weight_tmp);
+            }
+            // After an even number of passes the result is back in the plane of the grid
+        }
+
+        // Blur along y, twice, then normalize the values by the weights
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            const float* value_in = (pass == 0) ? value_.data() : value_tmp_.data();
+            const float* weight_in = (pass == 0) ? weight_.data() : weight_tmp_.data();
+            float* value_out = (pass == 0) ? value_tmp_.data() : value_.data();
+            float* weight_out = (pass == 0) ? weight_tmp_.data() : weight_.data();
+            const bool normalize = (pass == 1);
+
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < small_height; ++i)
+            {
+                float* vo = value_out + i * plane;
+                float* wo = weight_out + i * plane;
+
+                if ((i == 0) || (i == small_height - 1))
+                {
+                    std::fill(vo, vo + plane, 0.0f);
+                    std::fill(wo, wo + plane, 0.0f);
+                    continue;
+                }
+
+                for (int x = 0; x < small_width; ++x)
+                {
+                    const std::size_t begin = i * plane + x * small_depth;
+                    float* v = value_out + begin;
+                    float* w = weight_out + begin;
+
+                    if ((x == 0) || (x == small_width - 1))
+                    {
+                        std::fill(v, v + small_depth, 0.0f);
+                        std::fill(w, w + small_depth, 0.0f);
+                        continue;
+                    }
+
+                    const float* v_prev = value_in + begin - plane;
+                    const float* v_curr = value_in + begin;
+                    const float* v_next = value_in + begin + plane;
+                    const float* w_prev = weight_in + begin - plane;
+                    const float* w_curr = weight_in + begin;
+                    const float* w_next = weight_in + begin + plane;
+
+                    v[0] = w[0] = 0.0f;
+                    v[small_depth - 1] = w[small_depth - 1] = 0.0f;
+
+                    #pragma omp simd
+                    for (int z = 1; z < small_depth - 1; ++z)
+                    {
+                        const float vz = 0.25f * (v_prev[z] + v_next[z]) + 0.5f * v_curr[z];
+                        const float wz = 0.25f * (w_prev[z] + w_next[z]) + 0.5f * w_curr[z];
+                        v[z] = normalize ? vz / ((wz != 0.0f) ? wz : 1.0f) : vz;
+                        w[z] = wz;
+                    }
+                }
+            }
+        }
+
+        // Slice, interpolating the normalized values at the pixels
+        small_x_alpha_.resize(width);
+        for (int x = 0; x < width; ++x)
+        {
+            const float px = static_cast<float>(x / sigma_space) + padding;
+            small_x_[x] = std::min(static_cast<int>(px), small_width - 2);
+            small_x_alpha_[x] = px - small_x_[x];
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (int y = 0; y < height; ++y)
+        {
+            const float py = static_cast<float>(y / sigma_space) + padding;
+            const int y0 = std::min(static_cast<int>(py), small_height - 1);
+            const int y1 = std::min(y0 + 1, small_height - 1);
+            const float ay = py - y0;
+
+            // Interpolate the two planes around the row first, then each pixel within the resulting plane
+            const float* p0 = value_.data() + y0 * plane;
+            const float* p1 = value_.data() + y1 * plane;
+            float* row_plane = scratch_.data() + 2 * plane * threadIndex();
+
+            #pragma omp simd
+            for (std::size_t i = 0; i < plane; ++i)
+                row_plane[i] = (1.0f - ay) * p0[i] + ay * p1[i];
+
+            const T* src_row = src.ptr<T>(y);
+            T* dst_row = dst.ptr<T>(y);
+
+            for (int x = 0; x < width; ++x)
+            {
+                const T s = src_row[x];
+                if (!isValid(s, ignore_non_positive))
+                {
+                    dst_row[x] = s;
+                    continue;
+                }
+
+                const float pz = (static_cast<float>(s) - src_min) * inv_color + padding;
+                const int z0 = std::min(static_cast<int>(pz), small_depth - 2);
+                const float az = pz - z0;
+
+                const int x0 = small_x_[x];
+                const float ax = small_x_alpha_[x];
+
+                const float* c0 = row_plane + x0 * small_depth + z0;
+                const float* c1 = c0 + small_depth;
+
+                const float v = (1.0f - ax) * ((1.0f - az) * c0[0] + az * c0[1]) + ax * ((1.0f - az) * c1[0] + az * c1[1]);
+
+                dst_row[x] = cv::saturate_cast<T>(v);
+            }
         }
     }
 
+    const std::size_t max_cells_;
+
+    /* Sums of the values and of the weights, and the buffers of the blur. */
+    std::vector<float> value_;
+    std::vector<float> weight_;
+    std::vector<float> value_tmp_;
+    std::vector<float> weight_tmp_;
+    std::vector<float> scratch_;
+
+    /* Cells of the columns and of the rows of the image. */
+    std::vector<int> small_x_;
+    std::vector<float> small_x_alpha_;
+    std::vector<int> first_row_;
+};
+
+
+/**
+ * Filter a single channel image, see BilateralGrid::apply(). The grid is allocated at each call,
+ * hence a BilateralGrid should be kept when filtering a stream of images.
+ */
+inline
+void bilateralFilter(cv::InputArray _src, cv::OutputArray _dst,
+                     double sigmaColor, double sigmaSpace,
+                     bool ignoreNonPositive = false)
+{
+    cv::Mat src = _src.getMat();
+
+    _dst.create(src.size(), src.type());
+    cv::Mat dst = _dst.getMat();
+
+    BilateralGrid grid;
+    grid.apply(src, dst, sigmaColor, sigmaSpace, ignoreNonPositive);
 }
 
 } // end of namespace cv_extend
@@ -52,6 +52,11 @@ public:
   
   // constructor creates filters
   Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution);
+
+  // constructor creates filters within memory provided by the caller, which is not released:
+  // I_desc must hold 16*width*height bytes, I_du and I_dv bpl*height bytes, all 16 byte aligned
+  Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution,
+             uint8_t* I_desc,uint8_t* I_du,uint8_t* I_dv);
   
   // deconstructor releases memory
   ~Descriptor();
@@ -61,6 +66,9 @@ public:
   
 private:
 
+  // true if I_desc has been allocated by the constructor
+  bool owns_memory;
+
   // build descriptor I_desc from I_du and I_dv
   void createDescriptor(uint8_t* I_du,uint8_t* I_dv,int32_t width,int32_t height,int32_t bpl,bool half_resolution);
 
@@ -146,10 +146,12 @@ public:
   };
 
   // constructor, input: parameters
-  Elas (parameters param) : param(param) {}
+  Elas (parameters param) : param(param),I1(0),I2(0),I1_desc(0),I2_desc(0),I_du(0),I_dv(0),
+                            disparity_grid_1(0),disparity_grid_2(0),image_capacity(0),grid_capacity(0),use_avx2(false),
+                            prior_active(false),prior_radius(0) {}
 
   // deconstructor
-  ~Elas () {}
+  ~Elas () { releaseBuffers(); }
 
   // matching function
   // inputs: pointers to left (I1) and right (I2) intensity image (uint8, input)
@@ -162,6 +164,17 @@ public:
   //               otherwise width/2 x height/2 (rounded towards zero)
   bool process (uint8_t* I1,uint8_t* I2,float* D1,float* D2,const int32_t* dims);
 
+  // temporal prior on the support points, used by the following calls of process()
+  // inputs: W      = 4x4 matrix (row-major) mapping the homogeneous coordinates (u,v,d,1)
+  //                  of the previous images to the ones of the next images
+  //         radius = half width of the range of disparities searched around the prior
+  //         note: the support points of the previous call are warped by W and the candidates
+  //               close to them are matched only within the range of their disparities;
+  //               candidates without prior, or whose best match lies on the border of the range,
+  //               are matched over the full range of disparities
+  void setSupportPrior (const float* W,int32_t radius);
+  void clearSupportPrior () { prior_active = false; }
+
 private:
 
   struct support_pt {
@@ -191,8 +204,10 @@ private:
   void removeRedundantSupportPoints (int16_t* D_can,int32_t D_can_width,int32_t D_can_height,
                                      int32_t redun_max_dist, int32_t redun_threshold, bool vertical);
   void addCornerSupportPoints (std::vector<support_pt> &p_support);
-  inline int16_t computeMatchingDisparity (const int32_t &u,const int32_t &v,uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image);
+  inline int16_t computeMatchingDisparity (const int32_t &u,const int32_t &v,uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image,
+                                           const int32_t prior_min_d=-1,const int32_t prior_max_d=-1);
   std::vector<support_pt> computeSupportMatches (uint8_t* I1_desc,uint8_t* I2_desc);
+  bool warpSupportPrior (int32_t D_can_width,int32_t D_can_height,int32_t D_candidate_stepsize);
 
   // triangulation & grid
   std::vector<triangle> computeDelaunayTriangulation (std::vector<support_pt> p_support,int32_t right_image);
@@ -221,6 +236,38 @@ private:
   void adaptiveMean (float* D);
   void median (float* D);
 
+  // workspace reused across calls of process(), grown only when larger images or grids are required
+  void reserveBuffers (int32_t image_size,int32_t grid_size) {
+    if (image_size>image_capacity) {
+      _mm_free(I1); _mm_free(I2); _mm_free(I1_desc); _mm_free(I2_desc); _mm_free(I_du); _mm_free(I_dv);
+      I1      = (uint8_t*)_mm_malloc(image_size*sizeof(uint8_t),16);
+      I2      = (uint8_t*)_mm_malloc(image_size*sizeof(uint8_t),16);
+      I1_desc = (uint8_t*)_mm_malloc(16*image_size*sizeof(uint8_t),16);
+      I2_desc = (uint8_t*)_mm_malloc(16*image_size*sizeof(uint8_t),16);
+      I_du    = (uint8_t*)_mm_malloc(image_size*sizeof(uint8_t),16);
+      I_dv    = (uint8_t*)_mm_malloc(image_size*sizeof(uint8_t),16);
+      image_capacity = image_size;
+    }
+    if (grid_size>grid_capacity) {
+      free(disparity_grid_1); free(disparity_grid_2);
+      disparity_grid_1 = (int32_t*)malloc(grid_size*sizeof(int32_t));
+      disparity_grid_2 = (int32_t*)malloc(grid_size*sizeof(int32_t));
+      grid_capacity = grid_size;
+    }
+  }
+
+  void releaseBuffers () {
+    _mm_free(I1); _mm_free(I2); _mm_free(I1_desc); _mm_free(I2_desc); _mm_free(I_du); _mm_free(I_dv);
+    free(disparity_grid_1); free(disparity_grid_2);
+    I1 = I2 = I1_desc = I2_desc = I_du = I_dv = 0;
+    disparity_grid_1 = disparity_grid_2 = 0;
+    image_capacity = grid_capacity = 0;
+  }
+
+  // the workspace is owned, hence copies are not allowed
+  Elas (const Elas&);
+  Elas& operator= (const Elas&);
+
 protected:
   // parameter set
   parameters param;
@@ -230,6 +277,26 @@ private:
   uint8_t *I1,*I2;
   int32_t width,height,bpl;
 
+  // memory aligned descriptors, gradients used to compute them and disparity grids
+  uint8_t *I1_desc,*I2_desc,*I_du,*I_dv;
+  int32_t *disparity_grid_1,*disparity_grid_2;
+  int32_t image_capacity,grid_capacity;
+
+  // matching kernels selected at runtime, see matching_avx2.h
+  bool use_avx2;
+
+  // temporal prior, see setSupportPrior(): warp, consistent support points of the previous call
+  // and range of the disparities expected for each candidate (-1 if none)
+  bool    prior_active;
+  float   prior_W[16];
+  int32_t prior_radius;
+  std::vector<support_pt> prior_support;
+  std::vector<int16_t> prior_min,prior_max;
+
+  // scratch of computeSupportMatches() and leftRightConsistencyCheck(), reused across calls
+  std::vector<int16_t> D_can_buffer;
+  std::vector<float>   D1_copy_buffer,D2_copy_buffer;
+
   // profiling timer
 #ifdef PROFILE
   Timer timer;
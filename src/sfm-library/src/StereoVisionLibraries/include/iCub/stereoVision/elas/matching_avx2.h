@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+// AVX2 variants of the matching kernels of libelas. Blocks of adjacent disparities are
+// adjacent in the descriptor image, hence a single 256 bit SAD evaluates two disparities.
+// Results are identical to the SSE kernels, including the tie breaking.
+
+#ifndef __MATCHING_AVX2_H__
+#define __MATCHING_AVX2_H__
+
+// define fixed-width datatypes for Visual Studio projects
+#ifndef _MSC_VER
+  #include <stdint.h>
+#else
+  typedef __int16           int16_t;
+  typedef __int32           int32_t;
+  typedef unsigned __int8   uint8_t;
+#endif
+
+namespace matching_avx2 {
+
+  // true if the kernels have been compiled and the CPU supports AVX2
+  bool available ();
+
+  // support matching of the block at I1_block_addr against the blocks of I2_line_addr
+  // for all disparities in [disp_min,disp_max], each block being compared at the 4 desc_offsets;
+  // best and second best energies and disparities are updated as in Elas::computeMatchingDisparity()
+  void supportMatch (const uint8_t* I1_block_addr,const uint8_t* I2_line_addr,int32_t u,
+                     int32_t disp_min,int32_t disp_max,bool right_image,const int32_t* desc_offsets,
+                     int16_t &min_1_E,int16_t &min_1_d,int16_t &min_2_E,int16_t &min_2_d);
+
+  // dense matching of the block at I1_block_addr against the blocks of I2_line_addr
+  // for all disparities in [d_min,d_max], adding the prior P[|d-d_plane|] if P is given;
+  // the posterior minimum is updated as in Elas::updatePosteriorMinimum()
+  void planeMatch (const uint8_t* I1_block_addr,const uint8_t* I2_line_addr,int32_t u,
+                   int32_t d_min,int32_t d_max,bool right_image,const int32_t* P,int32_t d_plane,
+                   int32_t &min_val,int32_t &min_d);
+}
+
+#endif
@@ -35,6 +35,12 @@ class elasWrapper : public Elas {
 
     double io_scaling_factor;
 
+    // workspace reused across frames, reallocated only if the size of the images changes
+    cv::Mat imL_gray, imR_gray;
+    cv::Mat imL_scaled, imR_scaled;
+    cv::Mat imL_contiguous, imR_contiguous;
+    cv::Mat dispL_scaled, dispR_scaled;
+
 public:
 
     int64 workBegin();
@@ -43,7 +49,13 @@ public:
     elasWrapper();
     elasWrapper(double scaling_factor, string elas_setting);
 
-    bool compute_disparity(cv::Mat &imL, cv::Mat &imR, cv::Mat &dispL, int num_disparities);
+    // disparities are searched within [disp_min, num_disparities - 1]
+    bool compute_disparity(cv::Mat &imL, cv::Mat &imR, cv::Mat &dispL, int num_disparities, int disp_min = 0);
+
+    // temporal prior on the support points of the next calls of compute_disparity(), see Elas::setSupportPrior();
+    // W (4x4) maps the homogeneous coordinates (u,v,d,1) of the previous images to the ones of the next images
+    void set_support_prior(const cv::Mat &W, int radius);
+    void clear_support_prior();
 
     int get_disp_min();
     int get_disp_max();
@@ -61,6 +61,40 @@ using cv::Vec3f;
 using cv::Range;
 using cv::Scalar;
 using cv::TermCriteria;
+
+/**
+* \ingroup StereoVisionLib
+*
+* The data of a stereo pair going through the stages of StereoCamera::computeDisparity(), i.e.
+* StereoCamera::rectifyFrame(), StereoCamera::matchFrame() and StereoCamera::remapFrame().
+* The matching and the remapping only access the data of the frame, hence different frames
+* can go through different stages at the same time.
+*/
+struct StereoFrame
+{
+    Mat left; // Left Image (needed only by rectifyFrame())
+    Mat right; // Right Image (needed only by rectifyFrame())
+    Mat leftRect; // Rectified Left Image (only the processed band)
+    Mat rightRect; // Rectified Right Image (only the processed band)
+    Mat Q; // Depth Matrix 4x4 at the time of the images
+    Mat RLrect; // Rotation from Left Camera to Rectified Left Camera 3x3 at the time of the images
+    Mat leftPose; // Pose of the Left Camera 4x4 at the time of the images (empty if not known)
+    Mat MapperL; // pixels mapping from original left camera to rectified left camera
+    Rect band; // Band of the image that is rectified and matched
+    Rect roi; // Region of interest within the band
+    bool useROI; // Whether the disparity is computed only within the region of interest
+    int numberOfDisparities;
+    int dispMin; // Smallest disparity searched
+    int dispMax; // Largest disparity searched
+    Mat dispBand; // Disparity of the processed band, when restricted to the region of interest
+    Mat dispRaw; // Disparity as computed by the matcher, before scaling
+    Mat map; // Disparity Map scaled to 8 bit, before remapping
+    Mat mapRemapped; // Disparity Map scaled to 8 bit, remapped to the original left camera
+    Mat Disparity; // Disparity Map Image
+    Mat Disparity16; // Disparity 16 Bit Signed
+    bool success; // Whether the matching succeeded
+};
+
 /**
 * \ingroup StereoVisionLib
 *
@@ -150,6 +184,22 @@ private:
     bool use_elas;
     elasWrapper*  elaswrap;
 
+    Rect dispROI; // Region of interest of the left image where the disparity is computed (empty for the whole image)
+    int dispROIMin; // Smallest disparity searched within the region of interest
+    int dispROIMax; // Largest disparity searched within the region of interest (negative for the full range)
+
+    Mat leftPose; // Pose of the left camera 4x4 set by setLeftCameraPose() (empty if not known)
+
+    bool temporalPrior; // Whether the support points of ELAS are searched around the ones of the previous frame
+    int temporalPriorRadius; // Half width of the range of disparities searched around the prior
+    int temporalPriorRefresh; // Number of frames after which the support points are searched again over the full range
+    int framesSincePriorRefresh;
+    Mat priorQ; // Geometry of the previous frame matched (empty pose if not available)
+    Mat priorRLrect;
+    Mat priorPose;
+    Rect priorBand;
+    void updateSupportPrior(const StereoFrame& frame);
+
 public:
 
     /**
@@ -225,6 +275,48 @@ public:
     */
     void computeDisparity(bool best=true, int uniquenessRatio=15, int speckleWindowSize=50,int speckleRange=16, int numberOfDisparities=64, int SADWindowSize=7, int minDisparity=0, int preFilterCap=63, int disp12MaxDiff=0);
 
+    /**
+    * First stage of computeDisparity(): it updates the rectification, if the cameras changed, and rectifies
+    * the band of frame.left and frame.right to be processed. The geometry needed by the following stages
+    * (Q, RLrect and MapperL) is stored within the frame.
+    * @param frame the stereo pair, with the left and right images set.
+    * @param numberOfDisparities the expected number of disparities.
+    * @return false if the cameras are not calibrated or the images are not set.
+    */
+    bool rectifyFrame(StereoFrame& frame, int numberOfDisparities=64);
+
+    /**
+    * Second stage of computeDisparity(): it matches the rectified images of the frame.
+    * The parameters are those of computeDisparity().
+    * @param frame the stereo pair, as returned by rectifyFrame().
+    */
+    void matchFrame(StereoFrame& frame, bool best=true, int uniquenessRatio=15, int speckleWindowSize=50, int speckleRange=16, int SADWindowSize=7, int minDisparity=0, int preFilterCap=63, int disp12MaxDiff=0);
+
+    /**
+    * Third stage of computeDisparity(): it maps the disparity back to the original left camera (frame.Disparity)
+    * and converts the rectified one to 16 bit signed (frame.Disparity16).
+    * @param frame the stereo pair, as returned by matchFrame().
+    */
+    static void remapFrame(StereoFrame& frame);
+
+    /**
+    * It restricts the computation of the Disparity Map to a region of interest of the left image and, optionally,
+    * to a range of disparities. Rectification and matching run only on the rows of the region, extended to the left
+    * by the largest disparity; the disparity outside the region is marked as non valid. Used only with ELAS.
+    * @param roi the region of interest, an empty region restores the whole image.
+    * @param dispMin the smallest disparity to be searched.
+    * @param dispMax the largest disparity to be searched, a negative value restores the full range.
+    * @note The rectified images returned by getLRectified() and getRRectified() only cover the processed region.
+    */
+    void setDisparityROI(const Rect& roi, int dispMin=0, int dispMax=-1);
+
+    /**
+    * It sets the pose of the left camera for the next frames to be rectified. With the temporal prior of ELAS enabled,
+    * the motion of the camera between two frames is used to predict the support points of the second from the ones of the first.
+    * @param H the 4x4 pose of the left camera with respect to a fixed reference frame (meters).
+    */
+    void setLeftCameraPose(const Mat& H);
+
     /** It undistorts the images. 
     * @note Set undistortion coefficients before using this method.
     */
@@ -22,10 +22,12 @@ Street, Fifth Floor, Boston, MA 02110-1301, USA
 #include "descriptor.h"
 #include "filter.h"
 #include <emmintrin.h>
+#include <string.h>
 
 using namespace std;
 
 Descriptor::Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution) {
+  owns_memory   = true;
   I_desc        = (uint8_t*)_mm_malloc(16*width*height*sizeof(uint8_t),16);
   uint8_t* I_du = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
   uint8_t* I_dv = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
@@ -35,21 +37,43 @@ Descriptor::Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool
   _mm_free(I_dv);
 }
 
+Descriptor::Descriptor(uint8_t* I,int32_t width,int32_t height,int32_t bpl,bool half_resolution,
+                       uint8_t* I_desc_,uint8_t* I_du,uint8_t* I_dv) {
+  owns_memory = false;
+  I_desc      = I_desc_;
+  filter::sobel3x3(I,I_du,I_dv,bpl,height);
+  createDescriptor(I_du,I_dv,width,height,bpl,half_resolution);
+}
+
 Descriptor::~Descriptor() {
-  _mm_free(I_desc);
+  if (owns_memory)
+    _mm_free(I_desc);
 }
 
 void Descriptor::createDescriptor (uint8_t* I_du,uint8_t* I_dv,int32_t width,int32_t height,int32_t bpl,bool half_resolution) {
 
-  uint8_t *I_desc_curr;  
-  uint32_t addr_v0,addr_v1,addr_v2,addr_v3,addr_v4;
-  
+  // the borders are not filled but are read when matching close to the image borders (e.g. with
+  // corner support points), hence they are cleared to avoid depending on the previous content of I_desc
+  int32_t v_first = half_resolution ? 4 : 3;
+  memset(I_desc,0,16*width*v_first*sizeof(uint8_t));
+  memset(I_desc+16*width*(height-3),0,16*width*3*sizeof(uint8_t));
+  for (int32_t v=v_first; v<height-3; v++) {
+    memset(I_desc+16*v*width,0,16*3*sizeof(uint8_t));
+    memset(I_desc+16*(v*width+width-3),0,16*3*sizeof(uint8_t));
+  }
+
+  // rows are independent, hence they are shared among the threads if OpenMP is enabled
+
   // do not compute every second line
   if (half_resolution) {
   
     // create filter strip
+#pragma omp parallel for
     for (int32_t v=4; v<height-3; v+=2) {
 
+      uint8_t *I_desc_curr;
+      uint32_t addr_v0,addr_v1,addr_v2,addr_v3,addr_v4;
+
       addr_v2 = v*bpl;
       addr_v0 = addr_v2-2*bpl;
       addr_v1 = addr_v2-1*bpl;
@@ -81,8 +105,12 @@ void Descriptor::createDescriptor (uint8_t* I_du,uint8_t* I_dv,int32_t width,int
   } else {
     
     // create filter strip
+#pragma omp parallel for
     for (int32_t v=3; v<height-3; v++) {
 
+      uint8_t *I_desc_curr;
+      uint32_t addr_v0,addr_v1,addr_v2,addr_v3,addr_v4;
+
       addr_v2 = v*bpl;
       addr_v0 = addr_v2-2*bpl;
       addr_v1 = addr_v2-1*bpl;
@@ -26,36 +26,46 @@ Street, Fifth Floor, Boston, MA 02110-1301, USA
 #include "descriptor.h"
 #include "triangle.h"
 #include "matrix.h"
+#include "matching_avx2.h"
 
 using namespace std;
 
 bool Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t* dims){
 
+    // select the matching kernels
+    use_avx2 = matching_avx2::available();
+
     // get width, height and bytes per line
     width  = dims[0];
     height = dims[1];
     bpl    = width + 15-(width-1)%16;
 
+    // size of the disparity grid
+    int32_t grid_width   = (int32_t)ceil((float)width/(float)param.grid_size);
+    int32_t grid_height  = (int32_t)ceil((float)height/(float)param.grid_size);
+    int32_t grid_dims[3] = {param.disp_max+2,grid_width,grid_height};
+
+    // get the workspace, allocated only at the first call or if larger images are given
+    reserveBuffers(bpl*height,(param.disp_max+2)*grid_height*grid_width);
+
     // copy images to byte aligned memory
-    I1 = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-    I2 = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-    memset (I1,0,bpl*height*sizeof(uint8_t));
-    memset (I2,0,bpl*height*sizeof(uint8_t));
-    if (bpl==dims[2]) {
+    if (bpl==dims[2] && bpl==width) {
         memcpy(I1,I1_,bpl*height*sizeof(uint8_t));
         memcpy(I2,I2_,bpl*height*sizeof(uint8_t));
     } else {
         for (int32_t v=0; v<height; v++) {
             memcpy(I1+v*bpl,I1_+v*dims[2],width*sizeof(uint8_t));
             memcpy(I2+v*bpl,I2_+v*dims[2],width*sizeof(uint8_t));
+            memset(I1+v*bpl+width,0,(bpl-width)*sizeof(uint8_t));
+            memset(I2+v*bpl+width,0,(bpl-width)*sizeof(uint8_t));
         }
     }
 
 #ifdef PROFILE
     timer.start("Descriptor");
 #endif
-    Descriptor desc1(I1,width,height,bpl,param.subsampling);
-    Descriptor desc2(I2,width,height,bpl,param.subsampling);
+    Descriptor desc1(I1,width,height,bpl,param.subsampling,I1_desc,I_du,I_dv);
+    Descriptor desc2(I2,width,height,bpl,param.subsampling,I2_desc,I_du,I_dv);
 
 #ifdef PROFILE
     timer.start("Support Matches");
@@ -91,12 +101,9 @@ bool Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
         timer.start("Grid");
 #endif
 
-        // allocate memory for disparity grid
-        int32_t grid_width   = (int32_t)ceil((float)width/(float)param.grid_size);
-        int32_t grid_height  = (int32_t)ceil((float)height/(float)param.grid_size);
-        int32_t grid_dims[3] = {param.disp_max+2,grid_width,grid_height};
-        int32_t* disparity_grid_1 = (int32_t*)calloc((param.disp_max+2)*grid_height*grid_width,sizeof(int32_t));
-        int32_t* disparity_grid_2 = (int32_t*)calloc((param.disp_max+2)*grid_height*grid_width,sizeof(int32_t));
+        // clear disparity grid
+        memset(disparity_grid_1,0,(param.disp_max+2)*grid_height*grid_width*sizeof(int32_t));
+        memset(disparity_grid_2,0,(param.disp_max+2)*grid_height*grid_width*sizeof(int32_t));
 
         createGrid(p_support,disparity_grid_1,grid_dims,0);
         createGrid(p_support,disparity_grid_2,grid_dims,1);
@@ -148,9 +155,6 @@ bool Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
         timer.plot();
 #endif
 
-        free(disparity_grid_1);
-        free(disparity_grid_2);
-
         success = true;
 
     } else
@@ -158,10 +162,6 @@ bool Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
         success = false;
     }
 
-    // release memory
-    _mm_free(I1);
-    _mm_free(I2);
-
     return success;
 }
 
@@ -281,7 +281,74 @@ void Elas::addCornerSupportPoints(vector<support_pt> &p_support) {
         p_support.push_back(p_border[i]);
 }
 
-inline int16_t Elas::computeMatchingDisparity (const int32_t &u,const int32_t &v,uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image) {
+void Elas::setSupportPrior (const float* W,int32_t radius) {
+    memcpy(prior_W,W,16*sizeof(float));
+    prior_radius = max(radius,1);
+    prior_active = true;
+}
+
+bool Elas::warpSupportPrior (int32_t D_can_width,int32_t D_can_height,int32_t D_candidate_stepsize) {
+
+    if (prior_support.empty())
+        return false;
+
+    // ranges of disparities of the warped support points falling on each candidate
+    vector<int16_t> warped_min(D_can_width*D_can_height,-1);
+    vector<int16_t> warped_max(D_can_width*D_can_height,-1);
+    int32_t num_warped = 0;
+    for (size_t i=0; i<prior_support.size(); i++) {
+        float u = prior_support[i].u;
+        float v = prior_support[i].v;
+        float d = prior_support[i].d;
+        float w = prior_W[12]*u+prior_W[13]*v+prior_W[14]*d+prior_W[15];
+        if (fabs(w)<1e-6)
+            continue;
+        float u_warp = (prior_W[0]*u+prior_W[1]*v+prior_W[2]*d+prior_W[3])/w;
+        float v_warp = (prior_W[4]*u+prior_W[5]*v+prior_W[6]*d+prior_W[7])/w;
+        float d_warp = (prior_W[8]*u+prior_W[9]*v+prior_W[10]*d+prior_W[11])/w;
+        int32_t u_can = (int32_t)floor(u_warp/(float)D_candidate_stepsize+0.5);
+        int32_t v_can = (int32_t)floor(v_warp/(float)D_candidate_stepsize+0.5);
+        if (u_can<1 || u_can>=D_can_width || v_can<1 || v_can>=D_can_height || d_warp<param.disp_min || d_warp>param.disp_max)
+            continue;
+        int16_t d_min = (int16_t)floor(d_warp);
+        int16_t d_max = (int16_t)ceil(d_warp);
+        int32_t addr  = getAddressOffsetImage(u_can,v_can,D_can_width);
+        if (warped_min[addr]<0 || d_min<warped_min[addr]) warped_min[addr] = d_min;
+        if (warped_max[addr]<0 || d_max>warped_max[addr]) warped_max[addr] = d_max;
+        num_warped++;
+    }
+
+    // a prior leaving most of the support points out of the images is not consistent with them
+    if (2*num_warped<(int32_t)prior_support.size())
+        return false;
+
+    // candidates without a warped support point take the range of their neighbors
+    prior_min = warped_min;
+    prior_max = warped_max;
+    for (int32_t v_can=1; v_can<D_can_height; v_can++) {
+        for (int32_t u_can=1; u_can<D_can_width; u_can++) {
+            int32_t addr = getAddressOffsetImage(u_can,v_can,D_can_width);
+            if (warped_min[addr]>=0)
+                continue;
+            for (int32_t dv=-1; dv<=1; dv++) {
+                for (int32_t du=-1; du<=1; du++) {
+                    if (u_can+du<0 || u_can+du>=D_can_width || v_can+dv<0 || v_can+dv>=D_can_height)
+                        continue;
+                    int32_t addr_n = getAddressOffsetImage(u_can+du,v_can+dv,D_can_width);
+                    if (warped_min[addr_n]<0)
+                        continue;
+                    if (prior_min[addr]<0 || warped_min[addr_n]<prior_min[addr]) prior_min[addr] = warped_min[addr_n];
+                    if (prior_max[addr]<0 || warped_max[addr_n]>prior_max[addr]) prior_max[addr] = warped_max[addr_n];
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+inline int16_t Elas::computeMatchingDisparity (const int32_t &u,const int32_t &v,uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image,
+                                               const int32_t prior_min_d,const int32_t prior_max_d) {
 
     const int32_t u_step      = 2;
     const int32_t v_step      = 2;
@@ -344,39 +411,60 @@ inline int16_t Elas::computeMatchingDisparity (const int32_t &u,const int32_t &v
         if (disp_max_valid-disp_min_valid<10)
             return -1;
 
-        // for all disparities do
-        for (int16_t d=disp_min_valid; d<=disp_max_valid; d++) {
-
-            // warp u coordinate
-            if (!right_image) u_warp = u-d;
-            else              u_warp = u+d;
-
-            // compute I2 block start addresses
-            I2_block_addr = I2_line_addr+16*u_warp;
-
-            // compute match energy at this disparity
-            xmm6 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_1));
-            xmm6 = _mm_sad_epu8(xmm1,xmm6);
-            xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_2));
-            xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm2,xmm5),xmm6);
-            xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_3));
-            xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm3,xmm5),xmm6);
-            xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_4));
-            xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm4,xmm5),xmm6);
-            sum  = _mm_extract_epi16(xmm6,0)+_mm_extract_epi16(xmm6,4);
-
-            // best + second best match
-            if (sum<min_1_E) {
-                min_2_E = min_1_E;
-                min_2_d = min_1_d;
-                min_1_E = sum;
-                min_1_d = d;
-            } else if (sum<min_2_E) {
-                min_2_E = sum;
-                min_2_d = d;
+        // restrict the search to the range expected from the prior, if any
+        int32_t disp_min_search = disp_min_valid;
+        int32_t disp_max_search = disp_max_valid;
+        if (prior_min_d>=0) {
+            disp_min_search = max(disp_min_valid,prior_min_d);
+            disp_max_search = min(disp_max_valid,prior_max_d);
+            if (disp_max_search-disp_min_search<2)
+                return computeMatchingDisparity(u,v,I1_desc,I2_desc,right_image);
+        }
+
+        // for all disparities do, two at once if AVX2 is available
+        if (use_avx2) {
+            const int32_t desc_offsets[4] = {desc_offset_1,desc_offset_2,desc_offset_3,desc_offset_4};
+            matching_avx2::supportMatch(I1_block_addr,I2_line_addr,u,disp_min_search,disp_max_search,right_image,desc_offsets,
+                                        min_1_E,min_1_d,min_2_E,min_2_d);
+        } else {
+            for (int16_t d=disp_min_search; d<=disp_max_search; d++) {
+
+                // warp u coordinate
+                if (!right_image) u_warp = u-d;
+                else              u_warp = u+d;
+
+                // compute I2 block start addresses
+                I2_block_addr = I2_line_addr+16*u_warp;
+
+                // compute match energy at this disparity
+                xmm6 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_1));
+                xmm6 = _mm_sad_epu8(xmm1,xmm6);
+                xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_2));
+                xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm2,xmm5),xmm6);
+                xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_3));
+                xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm3,xmm5),xmm6);
+                xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_4));
+                xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm4,xmm5),xmm6);
+                sum  = _mm_extract_epi16(xmm6,0)+_mm_extract_epi16(xmm6,4);
+
+                // best + second best match
+                if (sum<min_1_E) {
+                    min_2_E = min_1_E;
+                    min_2_d = min_1_d;
+                    min_1_E = sum;
+                    min_1_d = d;
+                } else if (sum<min_2_E) {
+                    min_2_E = sum;
+                    min_2_d = d;
+                }
             }
         }
 
+        // a best match on the border of the restricted range means that the prior is not reliable
+        if ((disp_min_search>disp_min_valid && min_1_d==disp_min_search) ||
+            (disp_max_search<disp_max_valid && min_1_d==disp_max_search))
+            return computeMatchingDisparity(u,v,I1_desc,I2_desc,right_image);
+
         // check if best and second best match are available and if matching ratio is sufficient
         if (min_1_d>=0 && min_2_d>=0 && (float)min_1_E<param.support_threshold*(float)min_2_E)
             return min_1_d;
@@ -400,11 +488,16 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
     int32_t D_can_height = 0;
     for (int32_t u=0; u<width;  u+=D_candidate_stepsize) D_can_width++;
     for (int32_t v=0; v<height; v+=D_candidate_stepsize) D_can_height++;
-    int16_t* D_can = (int16_t*)calloc(D_can_width*D_can_height,sizeof(int16_t));
+    D_can_buffer.assign(D_can_width*D_can_height,0);
+    int16_t* D_can = &D_can_buffer[0];
 
     // loop variables
     int32_t u,v;
     int16_t d,d2;
+    int32_t prior_min_d,prior_max_d;
+
+    // ranges of disparities expected from the support points of the previous images, if any
+    bool use_prior = prior_active && warpSupportPrior(D_can_width,D_can_height,D_candidate_stepsize);
 
     // for all point candidates in image 1 do
     for (int32_t u_can=1; u_can<D_can_width; u_can++) {
@@ -415,12 +508,18 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
             // initialize disparity candidate to invalid
             *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = -1;
 
-            // find forwards
-            d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false);
+            // find forwards, around the prior if available
+            prior_min_d = prior_max_d = -1;
+            if (use_prior && prior_min[getAddressOffsetImage(u_can,v_can,D_can_width)]>=0) {
+                prior_min_d = max(prior_min[getAddressOffsetImage(u_can,v_can,D_can_width)]-prior_radius,0);
+                prior_max_d = prior_max[getAddressOffsetImage(u_can,v_can,D_can_width)]+prior_radius;
+            }
+            d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false,prior_min_d,prior_max_d);
             if (d>=0) {
 
-                // find backwards
-                d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
+                // find backwards, around the forward match if the prior is used
+                if (use_prior) d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true,max(d-prior_radius,0),d+prior_radius);
+                else           d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
                 if (d2>=0 && abs(d-d2)<=param.lr_threshold)
                     *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = d;
             }
@@ -430,6 +529,14 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
     // remove inconsistent support points
     removeInconsistentSupportPoints(D_can,D_can_width,D_can_height);
 
+    // the consistent support points are the prior of the next images
+    prior_support.clear();
+    for (int32_t v_can=1; v_can<D_can_height; v_can++)
+        for (int32_t u_can=1; u_can<D_can_width; u_can++)
+            if (*(D_can+getAddressOffsetImage(u_can,v_can,D_can_width))>=0)
+                prior_support.push_back(support_pt(u_can*D_candidate_stepsize,v_can*D_candidate_stepsize,
+                                                   *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width))));
+
     // remove support points on straight lines, since they are redundant
     // this reduces the number of triangles a little bit and hence speeds up
     // the triangulation process
@@ -450,9 +557,6 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
     if (param.add_corners)
         addCornerSupportPoints(p_support);
 
-    // free memory
-    free(D_can);
-
     // return support point vector
     return p_support;
 }
@@ -763,11 +867,17 @@ inline void Elas::findMatch(int32_t &u,int32_t &v,float &plane_a,float &plane_b,
                 updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,xmm1,xmm2,val,min_val,min_d);
             }
         }
-        for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
-            u_warp = u-d_curr;
-            if (u_warp<window_size || u_warp>=width-window_size)
-                continue;
-            updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+        if (use_avx2) {
+            // disparities warping outside the image are skipped
+            matching_avx2::planeMatch(I1_block_addr,I2_line_addr,u,max(d_plane_min,u-width+window_size+1),min(d_plane_max,u-window_size),
+                                      false,valid?P:0,d_plane,min_val,min_d);
+        } else {
+            for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
+                u_warp = u-d_curr;
+                if (u_warp<window_size || u_warp>=width-window_size)
+                    continue;
+                updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+            }
         }
 
         // right image
@@ -781,11 +891,17 @@ inline void Elas::findMatch(int32_t &u,int32_t &v,float &plane_a,float &plane_b,
                 updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,xmm1,xmm2,val,min_val,min_d);
             }
         }
-        for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
-            u_warp = u+d_curr;
-            if (u_warp<window_size || u_warp>=width-window_size)
-                continue;
-            updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+        if (use_avx2) {
+            // disparities warping outside the image are skipped
+            matching_avx2::planeMatch(I1_block_addr,I2_line_addr,u,max(d_plane_min,window_size-u),min(d_plane_max,width-window_size-1-u),
+                                      true,valid?P:0,d_plane,min_val,min_d);
+        } else {
+            for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
+                u_warp = u+d_curr;
+                if (u_warp<window_size || u_warp>=width-window_size)
+                    continue;
+                updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+            }
         }
     }
 
@@ -932,8 +1048,10 @@ void Elas::leftRightConsistencyCheck(float* D1,float* D2) {
     }
 
     // make a copy of both images
-    float* D1_copy = (float*)malloc(D_width*D_height*sizeof(float));
-    float* D2_copy = (float*)malloc(D_width*D_height*sizeof(float));
+    D1_copy_buffer.resize(D_width*D_height);
+    D2_copy_buffer.resize(D_width*D_height);
+    float* D1_copy = &D1_copy_buffer[0];
+    float* D2_copy = &D2_copy_buffer[0];
     memcpy(D1_copy,D1,D_width*D_height*sizeof(float));
     memcpy(D2_copy,D2,D_width*D_height*sizeof(float));
 
@@ -987,10 +1105,6 @@ void Elas::leftRightConsistencyCheck(float* D1,float* D2) {
                 *(D2+addr) = -10;
         }
     }
-
-    // release memory
-    free(D1_copy);
-    free(D2_copy);
 }
 
 void Elas::removeSmallSegments (float* D) {
@@ -1313,6 +1427,8 @@ void Elas::adaptiveMean (float* D) {
     float* D_copy = (float*)malloc(D_width*D_height*sizeof(float));
     float* D_tmp  = (float*)malloc(D_width*D_height*sizeof(float));
     memcpy(D_copy,D,D_width*D_height*sizeof(float));
+    // the borders of D_tmp are not written by the horizontal filter but are read by the vertical one
+    memcpy(D_tmp,D,D_width*D_height*sizeof(float));
 
     // zero input disparity maps to -10 (this makes the bilateral
     // weights of all valid disparities to 0 in this region)
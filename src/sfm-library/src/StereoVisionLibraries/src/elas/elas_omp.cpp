@@ -26,6 +26,7 @@ Street, Fifth Floor, Boston, MA 02110-1301, USA
 #include "descriptor.h"
 #include "triangle.h"
 #include "matrix.h"
+#include "matching_avx2.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -35,38 +36,44 @@ using namespace std;
 
 bool Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t* dims){
 
+    // select the matching kernels
+    use_avx2 = matching_avx2::available();
+
     // get width, height and bytes per line
     width  = dims[0];
     height = dims[1];
     bpl    = width + 15-(width-1)%16;
 
+    // size of the disparity grid
+    int32_t grid_width   = (int32_t)ceil((float)width/(float)param.grid_size);
+    int32_t grid_height  = (int32_t)ceil((float)height/(float)param.grid_size);
+    int32_t grid_dims[3] = {param.disp_max+2,grid_width,grid_height};
+
+    // get the workspace, allocated only at the first call or if larger images are given
+    reserveBuffers(bpl*height,(param.disp_max+2)*grid_height*grid_width);
+
     // copy images to byte aligned memory
-    I1 = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-    I2 = (uint8_t*)_mm_malloc(bpl*height*sizeof(uint8_t),16);
-    memset (I1,0,bpl*height*sizeof(uint8_t));
-    memset (I2,0,bpl*height*sizeof(uint8_t));
-    if (bpl==dims[2]) {
+    if (bpl==dims[2] && bpl==width) {
         memcpy(I1,I1_,bpl*height*sizeof(uint8_t));
         memcpy(I2,I2_,bpl*height*sizeof(uint8_t));
     } else {
         for (int32_t v=0; v<height; v++) {
             memcpy(I1+v*bpl,I1_+v*dims[2],width*sizeof(uint8_t));
             memcpy(I2+v*bpl,I2_+v*dims[2],width*sizeof(uint8_t));
+            memset(I1+v*bpl+width,0,(bpl-width)*sizeof(uint8_t));
+            memset(I2+v*bpl+width,0,(bpl-width)*sizeof(uint8_t));
         }
     }
 
-    // allocate memory for disparity grid
-    int32_t grid_width   = (int32_t)ceil((float)width/(float)param.grid_size);
-    int32_t grid_height  = (int32_t)ceil((float)height/(float)param.grid_size);
-    int32_t grid_dims[3] = {param.disp_max+2,grid_width,grid_height};
-    int32_t* disparity_grid_1 = (int32_t*)calloc((param.disp_max+2)*grid_height*grid_width,sizeof(int32_t));
-    int32_t* disparity_grid_2 = (int32_t*)calloc((param.disp_max+2)*grid_height*grid_width,sizeof(int32_t));
+    // clear disparity grid
+    memset(disparity_grid_1,0,(param.disp_max+2)*grid_height*grid_width*sizeof(int32_t));
+    memset(disparity_grid_2,0,(param.disp_max+2)*grid_height*grid_width*sizeof(int32_t));
 
 #ifdef PROFILE
     timer.start("Descriptor");
 #endif
-    Descriptor desc1(I1,width,height,bpl,param.subsampling);
-    Descriptor desc2(I2,width,height,bpl,param.subsampling);
+    Descriptor desc1(I1,width,height,bpl,param.subsampling,I1_desc,I_du,I_dv);
+    Descriptor desc2(I2,width,height,bpl,param.subsampling,I2_desc,I_du,I_dv);
 
 #ifdef PROFILE
     timer.start("Support Matches");
@@ -109,14 +116,9 @@ bool Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
 #ifdef PROFILE
         timer.start("Matching");
 #endif
-
-#pragma omp sections
-        {
-#pragma omp section
-            computeDisparity(p_support,tri_1,disparity_grid_1,grid_dims,desc1.I_desc,desc2.I_desc,0,D1);
-#pragma omp section
-            computeDisparity(p_support,tri_2,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I_desc,1,D2);
-        }
+        // each image is matched by all the threads, band by band
+        computeDisparity(p_support,tri_1,disparity_grid_1,grid_dims,desc1.I_desc,desc2.I_desc,0,D1);
+        computeDisparity(p_support,tri_2,disparity_grid_2,grid_dims,desc1.I_desc,desc2.I_desc,1,D2);
 
 #ifdef PROFILE
         timer.start("L/R Consistency Check");
@@ -165,19 +167,12 @@ bool Elas::process (uint8_t* I1_,uint8_t* I2_,float* D1,float* D2,const int32_t*
         success = false;
     }
 
-    // release memory
-    free(disparity_grid_1);
-    free(disparity_grid_2);
-    _mm_free(I1);
-    _mm_free(I2);
-
     return success;
 }
 
 void Elas::removeInconsistentSupportPoints (int16_t* D_can,int32_t D_can_width,int32_t D_can_height) {
 
     // for all valid support points do
-#pragma omp for
     for (int32_t u_can=0; u_can<D_can_width; u_can++) {
         for (int32_t v_can=0; v_can<D_can_height; v_can++) {
             int16_t d_can = *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width));
@@ -218,7 +213,6 @@ void Elas::removeRedundantSupportPoints(int16_t* D_can,int32_t D_can_width,int32
     }
 
     // for all valid support points do
-#pragma omp for
     for (int32_t u_can=0; u_can<D_can_width; u_can++) {
         for (int32_t v_can=0; v_can<D_can_height; v_can++) {
             int16_t d_can = *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width));
@@ -292,7 +286,74 @@ void Elas::addCornerSupportPoints(vector<support_pt> &p_support) {
         p_support.push_back(p_border[i]);
 }
 
-inline int16_t Elas::computeMatchingDisparity (const int32_t &u,const int32_t &v,uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image) {
+void Elas::setSupportPrior (const float* W,int32_t radius) {
+    memcpy(prior_W,W,16*sizeof(float));
+    prior_radius = max(radius,1);
+    prior_active = true;
+}
+
+bool Elas::warpSupportPrior (int32_t D_can_width,int32_t D_can_height,int32_t D_candidate_stepsize) {
+
+    if (prior_support.empty())
+        return false;
+
+    // ranges of disparities of the warped support points falling on each candidate
+    vector<int16_t> warped_min(D_can_width*D_can_height,-1);
+    vector<int16_t> warped_max(D_can_width*D_can_height,-1);
+    int32_t num_warped = 0;
+    for (size_t i=0; i<prior_support.size(); i++) {
+        float u = prior_support[i].u;
+        float v = prior_support[i].v;
+        float d = prior_support[i].d;
+        float w = prior_W[12]*u+prior_W[13]*v+prior_W[14]*d+prior_W[15];
+        if (fabs(w)<1e-6)
+            continue;
+        float u_warp = (prior_W[0]*u+prior_W[1]*v+prior_W[2]*d+prior_W[3])/w;
+        float v_warp = (prior_W[4]*u+prior_W[5]*v+prior_W[6]*d+prior_W[7])/w;
+        float d_warp = (prior_W[8]*u+prior_W[9]*v+prior_W[10]*d+prior_W[11])/w;
+        int32_t u_can = (int32_t)floor(u_warp/(float)D_candidate_stepsize+0.5);
+        int32_t v_can = (int32_t)floor(v_warp/(float)D_candidate_stepsize+0.5);
+        if (u_can<1 || u_can>=D_can_width || v_can<1 || v_can>=D_can_height || d_warp<param.disp_min || d_warp>param.disp_max)
+            continue;
+        int16_t d_min = (int16_t)floor(d_warp);
+        int16_t d_max = (int16_t)ceil(d_warp);
+        int32_t addr  = getAddressOffsetImage(u_can,v_can,D_can_width);
+        if (warped_min[addr]<0 || d_min<warped_min[addr]) warped_min[addr] = d_min;
+        if (warped_max[addr]<0 || d_max>warped_max[addr]) warped_max[addr] = d_max;
+        num_warped++;
+    }
+
+    // a prior leaving most of the support points out of the images is not consistent with them
+    if (2*num_warped<(int32_t)prior_support.size())
+        return false;
+
+    // candidates without a warped support point take the range of their neighbors
+    prior_min = warped_min;
+    prior_max = warped_max;
+    for (int32_t v_can=1; v_can<D_can_height; v_can++) {
+        for (int32_t u_can=1; u_can<D_can_width; u_can++) {
+            int32_t addr = getAddressOffsetImage(u_can,v_can,D_can_width);
+            if (warped_min[addr]>=0)
+                continue;
+            for (int32_t dv=-1; dv<=1; dv++) {
+                for (int32_t du=-1; du<=1; du++) {
+                    if (u_can+du<0 || u_can+du>=D_can_width || v_can+dv<0 || v_can+dv>=D_can_height)
+                        continue;
+                    int32_t addr_n = getAddressOffsetImage(u_can+du,v_can+dv,D_can_width);
+                    if (warped_min[addr_n]<0)
+                        continue;
+                    if (prior_min[addr]<0 || warped_min[addr_n]<prior_min[addr]) prior_min[addr] = warped_min[addr_n];
+                    if (prior_max[addr]<0 || warped_max[addr_n]>prior_max[addr]) prior_max[addr] = warped_max[addr_n];
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+inline int16_t Elas::computeMatchingDisparity (const int32_t &u,const int32_t &v,uint8_t* I1_desc,uint8_t* I2_desc,const bool &right_image,
+                                               const int32_t prior_min_d,const int32_t prior_max_d) {
 
     const int32_t u_step      = 2;
     const int32_t v_step      = 2;
@@ -355,37 +416,60 @@ inline int16_t Elas::computeMatchingDisparity (const int32_t &u,const int32_t &v
         if (disp_max_valid-disp_min_valid<10)
             return -1;
 
-        // for all disparities do
-        for (int16_t d=disp_min_valid; d<=disp_max_valid; d++) {
-
-            // warp u coordinate
-            if (!right_image) u_warp = u-d;
-            else              u_warp = u+d;
-
-            // compute I2 block start addresses
-            I2_block_addr = I2_line_addr+16*u_warp;
-
-            // compute match energy at this disparity
-            xmm6 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_1));
-            xmm6 = _mm_sad_epu8(xmm1,xmm6);
-            xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_2));
-            xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm2,xmm5),xmm6);
-            xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_3));
-            xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm3,xmm5),xmm6);
-            xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_4));
-            xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm4,xmm5),xmm6);
-            sum  = _mm_extract_epi16(xmm6,0)+_mm_extract_epi16(xmm6,4);
-
-            // best + second best match
-            if (sum<min_1_E) {
-                min_1_E = sum;
-                min_1_d = d;
-            } else if (sum<min_2_E) {
-                min_2_E = sum;
-                min_2_d = d;
+        // restrict the search to the range expected from the prior, if any
+        int32_t disp_min_search = disp_min_valid;
+        int32_t disp_max_search = disp_max_valid;
+        if (prior_min_d>=0) {
+            disp_min_search = max(disp_min_valid,prior_min_d);
+            disp_max_search = min(disp_max_valid,prior_max_d);
+            if (disp_max_search-disp_min_search<2)
+                return computeMatchingDisparity(u,v,I1_desc,I2_desc,right_image);
+        }
+
+        // for all disparities do, two at once if AVX2 is available
+        if (use_avx2) {
+            const int32_t desc_offsets[4] = {desc_offset_1,desc_offset_2,desc_offset_3,desc_offset_4};
+            matching_avx2::supportMatch(I1_block_addr,I2_line_addr,u,disp_min_search,disp_max_search,right_image,desc_offsets,
+                                        min_1_E,min_1_d,min_2_E,min_2_d);
+        } else {
+            for (int16_t d=disp_min_search; d<=disp_max_search; d++) {
+
+                // warp u coordinate
+                if (!right_image) u_warp = u-d;
+                else              u_warp = u+d;
+
+                // compute I2 block start addresses
+                I2_block_addr = I2_line_addr+16*u_warp;
+
+                // compute match energy at this disparity
+                xmm6 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_1));
+                xmm6 = _mm_sad_epu8(xmm1,xmm6);
+                xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_2));
+                xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm2,xmm5),xmm6);
+                xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_3));
+                xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm3,xmm5),xmm6);
+                xmm5 = _mm_load_si128((__m128i*)(I2_block_addr+desc_offset_4));
+                xmm6 = _mm_add_epi16(_mm_sad_epu8(xmm4,xmm5),xmm6);
+                sum  = _mm_extract_epi16(xmm6,0)+_mm_extract_epi16(xmm6,4);
+
+                // best + second best match
+                if (sum<min_1_E) {
+                    min_2_E = min_1_E;
+                    min_2_d = min_1_d;
+                    min_1_E = sum;
+                    min_1_d = d;
+                } else if (sum<min_2_E) {
+                    min_2_E = sum;
+                    min_2_d = d;
+                }
             }
         }
 
+        // a best match on the border of the restricted range means that the prior is not reliable
+        if ((disp_min_search>disp_min_valid && min_1_d==disp_min_search) ||
+            (disp_max_search<disp_max_valid && min_1_d==disp_max_search))
+            return computeMatchingDisparity(u,v,I1_desc,I2_desc,right_image);
+
         // check if best and second best match are available and if matching ratio is sufficient
         if (min_1_d>=0 && min_2_d>=0 && (float)min_1_E<param.support_threshold*(float)min_2_E)
             return min_1_d;
@@ -409,20 +493,26 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
     int32_t D_can_height = 0;
     for (int32_t u=0; u<width;  u+=D_candidate_stepsize) D_can_width++;
     for (int32_t v=0; v<height; v+=D_candidate_stepsize) D_can_height++;
-    int16_t* D_can = (int16_t*)calloc(D_can_width*D_can_height,sizeof(int16_t));
+    D_can_buffer.assign(D_can_width*D_can_height,0);
+    int16_t* D_can = &D_can_buffer[0];
 
     // loop variables
     int32_t u,v;
     int16_t d,d2;
     int32_t u_can, v_can;
+    int32_t prior_min_d,prior_max_d;
     int32_t lr_threshold = param.lr_threshold;
     vector<support_pt> p_support;
-    vector<support_pt> partial_p_support[2];
-    // for all point candidates in image 1 do
-#pragma omp parallel default(none) num_threads(2) private(u_can, v_can, u, d, v, d2) shared(partial_p_support,lr_threshold, D_can, D_can_width, D_can_height, D_candidate_stepsize, I1_desc, I2_desc)
+    vector< vector<support_pt> > partial_p_support(omp_get_max_threads());
+
+    // ranges of disparities expected from the support points of the previous images, if any
+    bool use_prior = prior_active && warpSupportPrior(D_can_width,D_can_height,D_candidate_stepsize);
+
+    // for all point candidates in image 1 do, rows of candidates are shared among all the threads
+#pragma omp parallel default(none) private(u_can, v_can, u, d, v, d2, prior_min_d, prior_max_d) shared(partial_p_support,lr_threshold, use_prior, D_can, D_can_width, D_can_height, D_candidate_stepsize, I1_desc, I2_desc)
     {
         int tid = omp_get_thread_num();
-#pragma omp for
+#pragma omp for schedule(dynamic)
         for (v_can=1; v_can<D_can_height; v_can++) {
             v = v_can*D_candidate_stepsize;
             for (u_can=1; u_can<D_can_width; u_can++) {
@@ -431,12 +521,18 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
                 // initialize disparity candidate to invalid
                 *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = -1;
 
-                // find forwards
-                d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false);
+                // find forwards, around the prior if available
+                prior_min_d = prior_max_d = -1;
+                if (use_prior && prior_min[getAddressOffsetImage(u_can,v_can,D_can_width)]>=0) {
+                    prior_min_d = max(prior_min[getAddressOffsetImage(u_can,v_can,D_can_width)]-prior_radius,0);
+                    prior_max_d = prior_max[getAddressOffsetImage(u_can,v_can,D_can_width)]+prior_radius;
+                }
+                d = computeMatchingDisparity(u,v,I1_desc,I2_desc,false,prior_min_d,prior_max_d);
                 if (d>=0) {
 
-                    // find backwards
-                    d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
+                    // find backwards, around the forward match if the prior is used
+                    if (use_prior) d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true,max(d-prior_radius,0),d+prior_radius);
+                    else           d2 = computeMatchingDisparity(u-d,v,I1_desc,I2_desc,true);
                     if (d2>=0 && abs(d-d2)<=lr_threshold)
                         *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width)) = d;
                 }
@@ -445,16 +541,29 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
 
 
 
-        // remove inconsistent support points
-        //timer.start("removeInconsistentSupportPoints");
-        removeInconsistentSupportPoints(D_can,D_can_width,D_can_height);
-
-        // remove support points on straight lines, since they are redundant
-        // this reduces the number of triangles a little bit and hence speeds up
-        // the triangulation process
-        //timer.start("removeRedundantSupportPoints");
-        removeRedundantSupportPoints(D_can,D_can_width,D_can_height,5,1,true);
-        removeRedundantSupportPoints(D_can,D_can_width,D_can_height,5,1,false);
+        // the following filters invalidate candidates in place, hence the result depends on the
+        // order of the visit: they run in a single thread to give the same support points of elas.cpp
+#pragma omp single
+        {
+            // remove inconsistent support points
+            //timer.start("removeInconsistentSupportPoints");
+            removeInconsistentSupportPoints(D_can,D_can_width,D_can_height);
+
+            // the consistent support points are the prior of the next images
+            prior_support.clear();
+            for (int32_t v_can=1; v_can<D_can_height; v_can++)
+                for (int32_t u_can=1; u_can<D_can_width; u_can++)
+                    if (*(D_can+getAddressOffsetImage(u_can,v_can,D_can_width))>=0)
+                        prior_support.push_back(support_pt(u_can*D_candidate_stepsize,v_can*D_candidate_stepsize,
+                                                           *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width))));
+
+            // remove support points on straight lines, since they are redundant
+            // this reduces the number of triangles a little bit and hence speeds up
+            // the triangulation process
+            //timer.start("removeRedundantSupportPoints");
+            removeRedundantSupportPoints(D_can,D_can_width,D_can_height,5,1,true);
+            removeRedundantSupportPoints(D_can,D_can_width,D_can_height,5,1,false);
+        }
 
         //}
         // move support points from image representation into a vector representation
@@ -462,7 +571,9 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
 
 
 
-#pragma omp for
+        // static scheduling assigns consecutive rows to consecutive threads,
+        // hence the support points are collected in raster order
+#pragma omp for schedule(static)
         for (int32_t v_can=1; v_can<D_can_height; v_can++)
             for (int32_t u_can=1; u_can<D_can_width; u_can++)
                 if (*(D_can+getAddressOffsetImage(u_can,v_can,D_can_width))>=0)
@@ -470,8 +581,8 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
                             v_can*D_candidate_stepsize,
                             *(D_can+getAddressOffsetImage(u_can,v_can,D_can_width))));
     }
-    p_support = partial_p_support[0];
-    p_support.insert(p_support.end(),partial_p_support[1].begin(),partial_p_support[1].end());
+    for (size_t i=0; i<partial_p_support.size(); i++)
+        p_support.insert(p_support.end(),partial_p_support[i].begin(),partial_p_support[i].end());
 
     // if flag is set, add support points in image corners
     // with the same disparity as the nearest neighbor support point
@@ -479,9 +590,6 @@ vector<Elas::support_pt> Elas::computeSupportMatches (uint8_t* I1_desc,uint8_t*
         addCornerSupportPoints(p_support);
 
 
-    // free memory
-    free(D_can);
-
     // return support point vector
     return p_support;
 }
@@ -792,11 +900,17 @@ inline void Elas::findMatch(int32_t &u,int32_t &v,float &plane_a,float &plane_b,
                 updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,xmm1,xmm2,val,min_val,min_d);
             }
         }
-        for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
-            u_warp = u-d_curr;
-            if (u_warp<window_size || u_warp>=width-window_size)
-                continue;
-            updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+        if (use_avx2) {
+            // disparities warping outside the image are skipped
+            matching_avx2::planeMatch(I1_block_addr,I2_line_addr,u,max(d_plane_min,u-width+window_size+1),min(d_plane_max,u-window_size),
+                                      false,valid?P:0,d_plane,min_val,min_d);
+        } else {
+            for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
+                u_warp = u-d_curr;
+                if (u_warp<window_size || u_warp>=width-window_size)
+                    continue;
+                updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+            }
         }
 
         // right image
@@ -810,11 +924,17 @@ inline void Elas::findMatch(int32_t &u,int32_t &v,float &plane_a,float &plane_b,
                 updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,xmm1,xmm2,val,min_val,min_d);
             }
         }
-        for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
-            u_warp = u+d_curr;
-            if (u_warp<window_size || u_warp>=width-window_size)
-                continue;
-            updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+        if (use_avx2) {
+            // disparities warping outside the image are skipped
+            matching_avx2::planeMatch(I1_block_addr,I2_line_addr,u,max(d_plane_min,window_size-u),min(d_plane_max,width-window_size-1-u),
+                                      true,valid?P:0,d_plane,min_val,min_d);
+        } else {
+            for (d_curr=d_plane_min; d_curr<=d_plane_max; d_curr++) {
+                u_warp = u+d_curr;
+                if (u_warp<window_size || u_warp>=width-window_size)
+                    continue;
+                updatePosteriorMinimum((__m128i*)(I2_line_addr+16*u_warp),d_curr,valid?*(P+abs(d_curr-d_plane)):0,xmm1,xmm2,val,min_val,min_d);
+            }
         }
     }
 
@@ -835,13 +955,10 @@ void Elas::computeDisparity(vector<support_pt> p_support,vector<triangle> tri,in
     int32_t window_size = 2;
 
     // init disparity image to -10
-    if (param.subsampling) {
-        for (int32_t i=0; i<(width/2)*(height/2); i++)
-            *(D+i) = -10;
-    } else {
-        for (int32_t i=0; i<width*height; i++)
-            *(D+i) = -10;
-    }
+    int32_t D_size = param.subsampling ? (width/2)*(height/2) : width*height;
+#pragma omp parallel for
+    for (int32_t i=0; i<D_size; i++)
+        *(D+i) = -10;
 
     // pre-compute prior
     float two_sigma_squared = 2*param.sigma*param.sigma;
@@ -850,36 +967,40 @@ void Elas::computeDisparity(vector<support_pt> p_support,vector<triangle> tri,in
         P[delta_d] = (int32_t)((-log(param.gamma+exp(-delta_d*delta_d/two_sigma_squared))+log(param.gamma))/param.beta);
     int32_t plane_radius = (int32_t)max((float)ceil(param.sigma*param.sradius),(float)2.0);
 
-    // loop variables
-    int32_t c1, c2, c3;
-    float plane_a,plane_b,plane_c,plane_d;
-    uint32_t i;
+    // plane and edges of each triangle, sorted wrt. u
+    struct scan_triangle {
+        float plane_a,plane_b,plane_c;
+        float A_u,B_u,C_u;
+        float AB_a,AB_b,AC_a,AC_b,BC_a,BC_b;
+        float v_min,v_max;
+        bool  valid;
+    };
+    vector<scan_triangle> tri_scan(tri.size());
 
     // for all triangles do
-#pragma omp parallel for num_threads(3) default(none)\
-        private(i, plane_a, plane_b, plane_c, plane_d, c1, c2, c3)\
-        shared(P, plane_radius, two_sigma_squared, disp_num, window_size, p_support, tri, disparity_grid, grid_dims, I1_desc, I2_desc, right_image, D)
-    for (i=0; i<tri.size(); i++) {
+#pragma omp parallel for
+    for (int32_t i=0; i<(int32_t)tri.size(); i++) {
+
+        scan_triangle& t = tri_scan[i];
+        float plane_d;
 
-        //printf("Matching thread %d\n", omp_get_thread_num());
         // get plane parameters
-        uint32_t p_i = i*3;
         if (!right_image) {
-            plane_a = tri[i].t1a;
-            plane_b = tri[i].t1b;
-            plane_c = tri[i].t1c;
-            plane_d = tri[i].t2a;
+            t.plane_a = tri[i].t1a;
+            t.plane_b = tri[i].t1b;
+            t.plane_c = tri[i].t1c;
+            plane_d   = tri[i].t2a;
         } else {
-            plane_a = tri[i].t2a;
-            plane_b = tri[i].t2b;
-            plane_c = tri[i].t2c;
-            plane_d = tri[i].t1a;
+            t.plane_a = tri[i].t2a;
+            t.plane_b = tri[i].t2b;
+            t.plane_c = tri[i].t2c;
+            plane_d   = tri[i].t1a;
         }
 
         // triangle corners
-        c1 = tri[i].c1;
-        c2 = tri[i].c2;
-        c3 = tri[i].c3;
+        int32_t c1 = tri[i].c1;
+        int32_t c2 = tri[i].c2;
+        int32_t c3 = tri[i].c3;
 
         // sort triangle corners wrt. u (ascending)
         float tri_u[3];
@@ -904,53 +1025,75 @@ void Elas::computeDisparity(vector<support_pt> p_support,vector<triangle> tri,in
         }
 
         // rename corners
-        float A_u = tri_u[0]; float A_v = tri_v[0];
-        float B_u = tri_u[1]; float B_v = tri_v[1];
-        float C_u = tri_u[2]; float C_v = tri_v[2];
+        t.A_u = tri_u[0]; float A_v = tri_v[0];
+        t.B_u = tri_u[1]; float B_v = tri_v[1];
+        t.C_u = tri_u[2]; float C_v = tri_v[2];
+        t.v_min = min(min(A_v,B_v),C_v);
+        t.v_max = max(max(A_v,B_v),C_v);
 
         // compute straight lines connecting triangle corners
-        float AB_a = 0; float AC_a = 0; float BC_a = 0;
-        if ((int32_t)(A_u)!=(int32_t)(B_u)) AB_a = (A_v-B_v)/(A_u-B_u);
-        if ((int32_t)(A_u)!=(int32_t)(C_u)) AC_a = (A_v-C_v)/(A_u-C_u);
-        if ((int32_t)(B_u)!=(int32_t)(C_u)) BC_a = (B_v-C_v)/(B_u-C_u);
-        float AB_b = A_v-AB_a*A_u;
-        float AC_b = A_v-AC_a*A_u;
-        float BC_b = B_v-BC_a*B_u;
+        t.AB_a = 0; t.AC_a = 0; t.BC_a = 0;
+        if ((int32_t)(t.A_u)!=(int32_t)(t.B_u)) t.AB_a = (A_v-B_v)/(t.A_u-t.B_u);
+        if ((int32_t)(t.A_u)!=(int32_t)(t.C_u)) t.AC_a = (A_v-C_v)/(t.A_u-t.C_u);
+        if ((int32_t)(t.B_u)!=(int32_t)(t.C_u)) t.BC_a = (B_v-C_v)/(t.B_u-t.C_u);
+        t.AB_b = A_v-t.AB_a*t.A_u;
+        t.AC_b = A_v-t.AC_a*t.A_u;
+        t.BC_b = B_v-t.BC_a*t.B_u;
 
         // a plane is only valid if itself and its projection
         // into the other image is not too much slanted
-        bool valid = fabs(plane_a)<0.7 && fabs(plane_d)<0.7;
-
-        // first part (triangle corner A->B)
-        if ((int32_t)(A_u)!=(int32_t)(B_u)) {
-            for (int32_t u=max((int32_t)A_u,0); u<min((int32_t)B_u,width); u++){
-                if (!param.subsampling || u%2==0) {
-                    int32_t v_1 = (uint32_t)(AC_a*(float)u+AC_b);
-                    int32_t v_2 = (uint32_t)(AB_a*(float)u+AB_b);
-                    for (int32_t v=min(v_1,v_2); v<max(v_1,v_2); v++)
-                        if (!param.subsampling || v%2==0) {
-                            findMatch(u,v,plane_a,plane_b,plane_c,disparity_grid,grid_dims,
-                                    I1_desc,I2_desc,P,plane_radius,valid,right_image,D);
-                        }
+        t.valid = fabs(t.plane_a)<0.7 && fabs(plane_d)<0.7;
+    }
+
+    // match bands of rows in parallel; within a band, triangles are visited in the same order
+    // of the sequential version, hence pixels shared by adjacent triangles get the same disparity
+    const int32_t band_height = 8;
+    const int32_t num_bands   = (height+band_height-1)/band_height;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int32_t b=0; b<num_bands; b++) {
+
+        int32_t band_v_min = b*band_height;
+        int32_t band_v_max = min(band_v_min+band_height,height);
+
+        for (size_t i=0; i<tri_scan.size(); i++) {
+
+            scan_triangle t = tri_scan[i];
+
+            // skip triangles not crossing this band (rows of the edges are truncated, hence the margin)
+            if (t.v_max+1<band_v_min || t.v_min-1>=band_v_max)
+                continue;
+
+            // first part (triangle corner A->B)
+            if ((int32_t)(t.A_u)!=(int32_t)(t.B_u)) {
+                for (int32_t u=max((int32_t)t.A_u,0); u<min((int32_t)t.B_u,width); u++){
+                    if (!param.subsampling || u%2==0) {
+                        int32_t v_1 = (uint32_t)(t.AC_a*(float)u+t.AC_b);
+                        int32_t v_2 = (uint32_t)(t.AB_a*(float)u+t.AB_b);
+                        for (int32_t v=max(min(v_1,v_2),band_v_min); v<min(max(v_1,v_2),band_v_max); v++)
+                            if (!param.subsampling || v%2==0) {
+                                findMatch(u,v,t.plane_a,t.plane_b,t.plane_c,disparity_grid,grid_dims,
+                                        I1_desc,I2_desc,P,plane_radius,t.valid,right_image,D);
+                            }
+                    }
                 }
             }
-        }
 
-        // second part (triangle corner B->C)
-        if ((int32_t)(B_u)!=(int32_t)(C_u)) {
-            for (int32_t u=max((int32_t)B_u,0); u<min((int32_t)C_u,width); u++){
-                if (!param.subsampling || u%2==0) {
-                    int32_t v_1 = (uint32_t)(AC_a*(float)u+AC_b);
-                    int32_t v_2 = (uint32_t)(BC_a*(float)u+BC_b);
-                    for (int32_t v=min(v_1,v_2); v<max(v_1,v_2); v++)
-                        if (!param.subsampling || v%2==0) {
-                            findMatch(u,v,plane_a,plane_b,plane_c,disparity_grid,grid_dims,
-                                    I1_desc,I2_desc,P,plane_radius,valid,right_image,D);
-                        }
+            // second part (triangle corner B->C)
+            if ((int32_t)(t.B_u)!=(int32_t)(t.C_u)) {
+                for (int32_t u=max((int32_t)t.B_u,0); u<min((int32_t)t.C_u,width); u++){
+                    if (!param.subsampling || u%2==0) {
+                        int32_t v_1 = (uint32_t)(t.AC_a*(float)u+t.AC_b);
+                        int32_t v_2 = (uint32_t)(t.BC_a*(float)u+t.BC_b);
+                        for (int32_t v=max(min(v_1,v_2),band_v_min); v<min(max(v_1,v_2),band_v_max); v++)
+                            if (!param.subsampling || v%2==0) {
+                                findMatch(u,v,t.plane_a,t.plane_b,t.plane_c,disparity_grid,grid_dims,
+                                        I1_desc,I2_desc,P,plane_radius,t.valid,right_image,D);
+                            }
+                    }
                 }
             }
         }
-
     }
 
     delete[] P;
@@ -967,18 +1110,21 @@ void Elas::leftRightConsistencyCheck(float* D1,float* D2) {
     }
 
     // make a copy of both images
-    float* D1_copy = (float*)malloc(D_width*D_height*sizeof(float));
-    float* D2_copy = (float*)malloc(D_width*D_height*sizeof(float));
+    D1_copy_buffer.resize(D_width*D_height);
+    D2_copy_buffer.resize(D_width*D_height);
+    float* D1_copy = &D1_copy_buffer[0];
+    float* D2_copy = &D2_copy_buffer[0];
     memcpy(D1_copy,D1,D_width*D_height*sizeof(float));
     memcpy(D2_copy,D2,D_width*D_height*sizeof(float));
 
-    // loop variables
-    uint32_t addr,addr_warp;
-    float    u_warp_1,u_warp_2,d1,d2;
+    // for all image points do, rows are shared among the threads
+#pragma omp parallel for
+    for (int32_t v=0; v<D_height; v++) {
+        for (int32_t u=0; u<D_width; u++) {
 
-    // for all image points do
-    for (int32_t u=0; u<D_width; u++) {
-        for (int32_t v=0; v<D_height; v++) {
+            // loop variables
+            uint32_t addr,addr_warp;
+            float    u_warp_1,u_warp_2,d1,d2;
 
             // compute address (u,v) and disparity value
             addr     = getAddressOffsetImage(u,v,D_width);
@@ -1022,10 +1168,6 @@ void Elas::leftRightConsistencyCheck(float* D1,float* D2) {
                 *(D2+addr) = -10;
         }
     }
-
-    // release memory
-    free(D1_copy);
-    free(D2_copy);
 }
 
 void Elas::removeSmallSegments (float* D) {
@@ -1163,14 +1305,15 @@ void Elas::gapInterpolation(float* D) {
     // discontinuity threshold
     float discon_threshold = 3.0;
 
-    // declare loop variables
-    int32_t count,addr,v_first,v_last,u_first,u_last;
-    float   d1,d2,d_ipol;
-
     // 1. Row-wise:
     // for each row do
+#pragma omp parallel for
     for (int32_t v=0; v<D_height; v++) {
 
+        // declare loop variables
+        int32_t count,addr,u_first,u_last;
+        float   d1,d2,d_ipol;
+
         // init counter
         count = 0;
 
@@ -1250,8 +1393,13 @@ void Elas::gapInterpolation(float* D) {
 
     // 2. Column-wise:
     // for each column do
+#pragma omp parallel for
     for (int32_t u=0; u<D_width; u++) {
 
+        // declare loop variables
+        int32_t count,addr,v_first,v_last;
+        float   d1,d2,d_ipol;
+
         // init counter
         count = 0;
 
@@ -1313,6 +1461,8 @@ void Elas::adaptiveMean (float* D) {
     float* D_copy = (float*)malloc(D_width*D_height*sizeof(float));
     float* D_tmp  = (float*)malloc(D_width*D_height*sizeof(float));
     memcpy(D_copy,D,D_width*D_height*sizeof(float));
+    // the borders of D_tmp are not written by the horizontal filter but are read by the vertical one
+    memcpy(D_tmp,D,D_width*D_height*sizeof(float));
 
     // zero input disparity maps to -10 (this makes the bilateral
     // weights of all valid disparities to 0 in this region)
@@ -1323,185 +1473,194 @@ void Elas::adaptiveMean (float* D) {
         }
     }
 
-    __m128 xconst0 = _mm_set1_ps(0);
-    __m128 xconst4 = _mm_set1_ps(4);
-    __m128 xval,xweight1,xweight2,xfactor1,xfactor2;
+    // rows, then columns, are shared among the threads, each one having its own buffers
+#pragma omp parallel
+    {
+        __m128 xconst0 = _mm_set1_ps(0);
+        __m128 xconst4 = _mm_set1_ps(4);
+        __m128 xval,xweight1,xweight2,xfactor1,xfactor2;
 
-    float *val     = (float *)_mm_malloc(8*sizeof(float),16);
-    float *weight  = (float*)_mm_malloc(4*sizeof(float),16);
-    float *factor  = (float*)_mm_malloc(4*sizeof(float),16);
+        float *val     = (float *)_mm_malloc(8*sizeof(float),16);
+        float *weight  = (float*)_mm_malloc(4*sizeof(float),16);
+        float *factor  = (float*)_mm_malloc(4*sizeof(float),16);
 
-    // set absolute mask
-    __m128 xabsmask = _mm_set1_ps(0x7FFFFFFF);
+        // set absolute mask
+        __m128 xabsmask = _mm_set1_ps(0x7FFFFFFF);
 
-    // when doing subsampling: 4 pixel bilateral filter width
-    if (param.subsampling) {
+        // when doing subsampling: 4 pixel bilateral filter width
+        if (param.subsampling) {
 
-        // horizontal filter
-        for (int32_t v=3; v<D_height-3; v++) {
+            // horizontal filter
+#pragma omp for
+            for (int32_t v=3; v<D_height-3; v++) {
 
-            // init
-            for (int32_t u=0; u<3; u++)
-                val[u] = *(D_copy+v*D_width+u);
+                // init
+                for (int32_t u=0; u<3; u++)
+                    val[u] = *(D_copy+v*D_width+u);
 
-            // loop
-            for (int32_t u=3; u<D_width; u++) {
+                // loop
+                for (int32_t u=3; u<D_width; u++) {
 
-                // set
-                float val_curr = *(D_copy+v*D_width+(u-1));
-                val[u%4] = *(D_copy+v*D_width+u);
+                    // set
+                    float val_curr = *(D_copy+v*D_width+(u-1));
+                    val[u%4] = *(D_copy+v*D_width+u);
 
-                xval     = _mm_load_ps(val);
-                xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
-                xweight1 = _mm_and_ps(xweight1,xabsmask);
-                xweight1 = _mm_sub_ps(xconst4,xweight1);
-                xweight1 = _mm_max_ps(xconst0,xweight1);
-                xfactor1 = _mm_mul_ps(xval,xweight1);
+                    xval     = _mm_load_ps(val);
+                    xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
+                    xweight1 = _mm_and_ps(xweight1,xabsmask);
+                    xweight1 = _mm_sub_ps(xconst4,xweight1);
+                    xweight1 = _mm_max_ps(xconst0,xweight1);
+                    xfactor1 = _mm_mul_ps(xval,xweight1);
 
-                _mm_store_ps(weight,xweight1);
-                _mm_store_ps(factor,xfactor1);
+                    _mm_store_ps(weight,xweight1);
+                    _mm_store_ps(factor,xfactor1);
 
-                float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
-                float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
+                    float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
+                    float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
 
-                if (weight_sum>0) {
-                    float d = factor_sum/weight_sum;
-                    if (d>=0) *(D_tmp+v*D_width+(u-1)) = d;
+                    if (weight_sum>0) {
+                        float d = factor_sum/weight_sum;
+                        if (d>=0) *(D_tmp+v*D_width+(u-1)) = d;
+                    }
                 }
             }
-        }
 
-        // vertical filter
-        for (int32_t u=3; u<D_width-3; u++) {
+            // vertical filter
+#pragma omp for
+            for (int32_t u=3; u<D_width-3; u++) {
 
-            // init
-            for (int32_t v=0; v<3; v++)
-                val[v] = *(D_tmp+v*D_width+u);
+                // init
+                for (int32_t v=0; v<3; v++)
+                    val[v] = *(D_tmp+v*D_width+u);
 
-            // loop
-            for (int32_t v=3; v<D_height; v++) {
+                // loop
+                for (int32_t v=3; v<D_height; v++) {
 
-                // set
-                float val_curr = *(D_tmp+(v-1)*D_width+u);
-                val[v%4] = *(D_tmp+v*D_width+u);
+                    // set
+                    float val_curr = *(D_tmp+(v-1)*D_width+u);
+                    val[v%4] = *(D_tmp+v*D_width+u);
 
-                xval     = _mm_load_ps(val);
-                xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
-                xweight1 = _mm_and_ps(xweight1,xabsmask);
-                xweight1 = _mm_sub_ps(xconst4,xweight1);
-                xweight1 = _mm_max_ps(xconst0,xweight1);
-                xfactor1 = _mm_mul_ps(xval,xweight1);
+                    xval     = _mm_load_ps(val);
+                    xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
+                    xweight1 = _mm_and_ps(xweight1,xabsmask);
+                    xweight1 = _mm_sub_ps(xconst4,xweight1);
+                    xweight1 = _mm_max_ps(xconst0,xweight1);
+                    xfactor1 = _mm_mul_ps(xval,xweight1);
 
-                _mm_store_ps(weight,xweight1);
-                _mm_store_ps(factor,xfactor1);
+                    _mm_store_ps(weight,xweight1);
+                    _mm_store_ps(factor,xfactor1);
 
-                float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
-                float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
+                    float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
+                    float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
 
-                if (weight_sum>0) {
-                    float d = factor_sum/weight_sum;
-                    if (d>=0) *(D+(v-1)*D_width+u) = d;
+                    if (weight_sum>0) {
+                        float d = factor_sum/weight_sum;
+                        if (d>=0) *(D+(v-1)*D_width+u) = d;
+                    }
                 }
             }
-        }
 
-        // full resolution: 8 pixel bilateral filter width
-    } else {
+            // full resolution: 8 pixel bilateral filter width
+        } else {
 
 
-        // horizontal filter
-        for (int32_t v=3; v<D_height-3; v++) {
+            // horizontal filter
+#pragma omp for
+            for (int32_t v=3; v<D_height-3; v++) {
 
-            // init
-            for (int32_t u=0; u<7; u++)
-                val[u] = *(D_copy+v*D_width+u);
+                // init
+                for (int32_t u=0; u<7; u++)
+                    val[u] = *(D_copy+v*D_width+u);
 
-            // loop
-            for (int32_t u=7; u<D_width; u++) {
+                // loop
+                for (int32_t u=7; u<D_width; u++) {
 
-                // set
-                float val_curr = *(D_copy+v*D_width+(u-3));
-                val[u%8] = *(D_copy+v*D_width+u);
+                    // set
+                    float val_curr = *(D_copy+v*D_width+(u-3));
+                    val[u%8] = *(D_copy+v*D_width+u);
 
-                xval     = _mm_load_ps(val);
-                xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
-                xweight1 = _mm_and_ps(xweight1,xabsmask);
-                xweight1 = _mm_sub_ps(xconst4,xweight1);
-                xweight1 = _mm_max_ps(xconst0,xweight1);
-                xfactor1 = _mm_mul_ps(xval,xweight1);
+                    xval     = _mm_load_ps(val);
+                    xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
+                    xweight1 = _mm_and_ps(xweight1,xabsmask);
+                    xweight1 = _mm_sub_ps(xconst4,xweight1);
+                    xweight1 = _mm_max_ps(xconst0,xweight1);
+                    xfactor1 = _mm_mul_ps(xval,xweight1);
 
-                xval     = _mm_load_ps(val+4);
-                xweight2 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
-                xweight2 = _mm_and_ps(xweight2,xabsmask);
-                xweight2 = _mm_sub_ps(xconst4,xweight2);
-                xweight2 = _mm_max_ps(xconst0,xweight2);
-                xfactor2 = _mm_mul_ps(xval,xweight2);
+                    xval     = _mm_load_ps(val+4);
+                    xweight2 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
+                    xweight2 = _mm_and_ps(xweight2,xabsmask);
+                    xweight2 = _mm_sub_ps(xconst4,xweight2);
+                    xweight2 = _mm_max_ps(xconst0,xweight2);
+                    xfactor2 = _mm_mul_ps(xval,xweight2);
 
-                xweight1 = _mm_add_ps(xweight1,xweight2);
-                xfactor1 = _mm_add_ps(xfactor1,xfactor2);
+                    xweight1 = _mm_add_ps(xweight1,xweight2);
+                    xfactor1 = _mm_add_ps(xfactor1,xfactor2);
 
-                _mm_store_ps(weight,xweight1);
-                _mm_store_ps(factor,xfactor1);
+                    _mm_store_ps(weight,xweight1);
+                    _mm_store_ps(factor,xfactor1);
 
-                float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
-                float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
+                    float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
+                    float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
 
-                if (weight_sum>0) {
-                    float d = factor_sum/weight_sum;
-                    if (d>=0) *(D_tmp+v*D_width+(u-3)) = d;
+                    if (weight_sum>0) {
+                        float d = factor_sum/weight_sum;
+                        if (d>=0) *(D_tmp+v*D_width+(u-3)) = d;
+                    }
                 }
             }
-        }
 
-        // vertical filter
-        for (int32_t u=3; u<D_width-3; u++) {
+            // vertical filter
+#pragma omp for
+            for (int32_t u=3; u<D_width-3; u++) {
 
-            // init
-            for (int32_t v=0; v<7; v++)
-                val[v] = *(D_tmp+v*D_width+u);
+                // init
+                for (int32_t v=0; v<7; v++)
+                    val[v] = *(D_tmp+v*D_width+u);
 
-            // loop
-            for (int32_t v=7; v<D_height; v++) {
+                // loop
+                for (int32_t v=7; v<D_height; v++) {
 
-                // set
-                float val_curr = *(D_tmp+(v-3)*D_width+u);
-                val[v%8] = *(D_tmp+v*D_width+u);
+                    // set
+                    float val_curr = *(D_tmp+(v-3)*D_width+u);
+                    val[v%8] = *(D_tmp+v*D_width+u);
 
-                xval     = _mm_load_ps(val);
-                xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
-                xweight1 = _mm_and_ps(xweight1,xabsmask);
-                xweight1 = _mm_sub_ps(xconst4,xweight1);
-                xweight1 = _mm_max_ps(xconst0,xweight1);
-                xfactor1 = _mm_mul_ps(xval,xweight1);
+                    xval     = _mm_load_ps(val);
+                    xweight1 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
+                    xweight1 = _mm_and_ps(xweight1,xabsmask);
+                    xweight1 = _mm_sub_ps(xconst4,xweight1);
+                    xweight1 = _mm_max_ps(xconst0,xweight1);
+                    xfactor1 = _mm_mul_ps(xval,xweight1);
 
-                xval     = _mm_load_ps(val+4);
-                xweight2 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
-                xweight2 = _mm_and_ps(xweight2,xabsmask);
-                xweight2 = _mm_sub_ps(xconst4,xweight2);
-                xweight2 = _mm_max_ps(xconst0,xweight2);
-                xfactor2 = _mm_mul_ps(xval,xweight2);
+                    xval     = _mm_load_ps(val+4);
+                    xweight2 = _mm_sub_ps(xval,_mm_set1_ps(val_curr));
+                    xweight2 = _mm_and_ps(xweight2,xabsmask);
+                    xweight2 = _mm_sub_ps(xconst4,xweight2);
+                    xweight2 = _mm_max_ps(xconst0,xweight2);
+                    xfactor2 = _mm_mul_ps(xval,xweight2);
 
-                xweight1 = _mm_add_ps(xweight1,xweight2);
-                xfactor1 = _mm_add_ps(xfactor1,xfactor2);
+                    xweight1 = _mm_add_ps(xweight1,xweight2);
+                    xfactor1 = _mm_add_ps(xfactor1,xfactor2);
 
-                _mm_store_ps(weight,xweight1);
-                _mm_store_ps(factor,xfactor1);
+                    _mm_store_ps(weight,xweight1);
+                    _mm_store_ps(factor,xfactor1);
 
-                float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
-                float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
+                    float weight_sum = weight[0]+weight[1]+weight[2]+weight[3];
+                    float factor_sum = factor[0]+factor[1]+factor[2]+factor[3];
 
-                if (weight_sum>0) {
-                    float d = factor_sum/weight_sum;
-                    if (d>=0) *(D+(v-3)*D_width+u) = d;
+                    if (weight_sum>0) {
+                        float d = factor_sum/weight_sum;
+                        if (d>=0) *(D+(v-3)*D_width+u) = d;
+                    }
                 }
             }
         }
+
+        // free memory
+        _mm_free(val);
+        _mm_free(weight);
+        _mm_free(factor);
     }
 
-    // free memory
-    _mm_free(val);
-    _mm_free(weight);
-    _mm_free(factor);
     free(D_copy);
     free(D_tmp);
 }
@@ -1521,55 +1680,62 @@ void Elas::median (float* D) {
 
     int32_t window_size = 3;
 
-    float *vals = new float[window_size*2+1];
-    int32_t i,j;
-    float temp;
-
-    // first step: horizontal median filter
-    for (int32_t u=window_size; u<D_width-window_size; u++) {
-        for (int32_t v=window_size; v<D_height-window_size; v++) {
-            if (*(D+getAddressOffsetImage(u,v,D_width))>=0) {
-                j = 0;
-                for (int32_t u2=u-window_size; u2<=u+window_size; u2++) {
-                    temp = *(D+getAddressOffsetImage(u2,v,D_width));
-                    i = j-1;
-                    while (i>=0 && *(vals+i)>temp) {
-                        *(vals+i+1) = *(vals+i);
-                        i--;
+    // columns are shared among the threads, each one having its own window
+#pragma omp parallel
+    {
+        float *vals = new float[window_size*2+1];
+        int32_t i,j;
+        float temp;
+
+        // first step: horizontal median filter
+#pragma omp for
+        for (int32_t u=window_size; u<D_width-window_size; u++) {
+            for (int32_t v=window_size; v<D_height-window_size; v++) {
+                if (*(D+getAddressOffsetImage(u,v,D_width))>=0) {
+                    j = 0;
+                    for (int32_t u2=u-window_size; u2<=u+window_size; u2++) {
+                        temp = *(D+getAddressOffsetImage(u2,v,D_width));
+                        i = j-1;
+                        while (i>=0 && *(vals+i)>temp) {
+                            *(vals+i+1) = *(vals+i);
+                            i--;
+                        }
+                        *(vals+i+1) = temp;
+                        j++;
                     }
-                    *(vals+i+1) = temp;
-                    j++;
+                    *(D_temp+getAddressOffsetImage(u,v,D_width)) = *(vals+window_size);
+                } else {
+                    *(D_temp+getAddressOffsetImage(u,v,D_width)) = *(D+getAddressOffsetImage(u,v,D_width));
                 }
-                *(D_temp+getAddressOffsetImage(u,v,D_width)) = *(vals+window_size);
-            } else {
-                *(D_temp+getAddressOffsetImage(u,v,D_width)) = *(D+getAddressOffsetImage(u,v,D_width));
-            }
 
+            }
         }
-    }
 
-    // second step: vertical median filter
-    for (int32_t u=window_size; u<D_width-window_size; u++) {
-        for (int32_t v=window_size; v<D_height-window_size; v++) {
-            if (*(D+getAddressOffsetImage(u,v,D_width))>=0) {
-                j = 0;
-                for (int32_t v2=v-window_size; v2<=v+window_size; v2++) {
-                    temp = *(D_temp+getAddressOffsetImage(u,v2,D_width));
-                    i = j-1;
-                    while (i>=0 && *(vals+i)>temp) {
-                        *(vals+i+1) = *(vals+i);
-                        i--;
+        // second step: vertical median filter
+#pragma omp for
+        for (int32_t u=window_size; u<D_width-window_size; u++) {
+            for (int32_t v=window_size; v<D_height-window_size; v++) {
+                if (*(D+getAddressOffsetImage(u,v,D_width))>=0) {
+                    j = 0;
+                    for (int32_t v2=v-window_size; v2<=v+window_size; v2++) {
+                        temp = *(D_temp+getAddressOffsetImage(u,v2,D_width));
+                        i = j-1;
+                        while (i>=0 && *(vals+i)>temp) {
+                            *(vals+i+1) = *(vals+i);
+                            i--;
+                        }
+                        *(vals+i+1) = temp;
+                        j++;
                     }
-                    *(vals+i+1) = temp;
-                    j++;
+                    *(D+getAddressOffsetImage(u,v,D_width)) = *(vals+window_size);
+                } else {
+                    *(D+getAddressOffsetImage(u,v,D_width)) = *(D+getAddressOffsetImage(u,v,D_width));
                 }
-                *(D+getAddressOffsetImage(u,v,D_width)) = *(vals+window_size);
-            } else {
-                *(D+getAddressOffsetImage(u,v,D_width)) = *(D+getAddressOffsetImage(u,v,D_width));
             }
         }
+
+        delete[] vals;
     }
 
     free(D_temp);
-    free(vals);
 }
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2019 Istituto Italiano di Tecnologia (IIT)
+ *
+ * This software may be modified and distributed under the terms of the
+ * GPL-2+ license. See the accompanying LICENSE file for details.
+ */
+
+#include "matching_avx2.h"
+
+#include <stdlib.h>
+
+// kernels are compiled for AVX2 function by function, so that the rest of the library
+// keeps running on CPUs without it; define ELAS_DISABLE_AVX2 to always use the SSE kernels
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(ELAS_DISABLE_AVX2)
+  #define ELAS_AVX2_KERNELS
+  #include <immintrin.h>
+  #define ELAS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+  inline void updateBestMatches (const int32_t &sum,const int32_t &d,
+                                 int16_t &min_1_E,int16_t &min_1_d,int16_t &min_2_E,int16_t &min_2_d) {
+    if (sum<min_1_E) {
+      min_2_E = min_1_E;
+      min_2_d = min_1_d;
+      min_1_E = sum;
+      min_1_d = d;
+    } else if (sum<min_2_E) {
+      min_2_E = sum;
+      min_2_d = d;
+    }
+  }
+
+  inline void updatePosteriorMinimum (const int32_t &val,const int32_t &d,int32_t &min_val,int32_t &min_d) {
+    if (val<min_val) {
+      min_val = val;
+      min_d   = d;
+    }
+  }
+
+#ifdef ELAS_AVX2_KERNELS
+
+  // sum of the two 64 bit lanes holding the SADs of one block
+  ELAS_TARGET_AVX2 inline int32_t sumLanes (const __m128i &xmm) {
+    return _mm_extract_epi16(xmm,0)+_mm_extract_epi16(xmm,4);
+  }
+
+#endif
+}
+
+#ifdef ELAS_AVX2_KERNELS
+
+bool matching_avx2::available () {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+
+ELAS_TARGET_AVX2
+void matching_avx2::supportMatch (const uint8_t* I1_block_addr,const uint8_t* I2_line_addr,int32_t u,
+                                  int32_t disp_min,int32_t disp_max,bool right_image,const int32_t* desc_offsets,
+                                  int16_t &min_1_E,int16_t &min_1_d,int16_t &min_2_E,int16_t &min_2_d) {
+
+  // the blocks of image 1 in both lanes
+  __m256i ymm1[4];
+  for (int32_t i=0; i<4; i++)
+    ymm1[i] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)(I1_block_addr+desc_offsets[i])));
+
+  // two disparities at once: the block of d+1 precedes the one of d in the right image
+  // when matching the left image and follows it otherwise
+  int32_t d = disp_min;
+  for (; d<disp_max; d+=2) {
+    const uint8_t* I2_block_addr = right_image ? I2_line_addr+16*(u+d) : I2_line_addr+16*(u-d-1);
+
+    __m256i ymm2 = _mm256_sad_epu8(ymm1[0],_mm256_loadu_si256((const __m256i*)(I2_block_addr+desc_offsets[0])));
+    for (int32_t i=1; i<4; i++)
+      ymm2 = _mm256_add_epi32(_mm256_sad_epu8(ymm1[i],_mm256_loadu_si256((const __m256i*)(I2_block_addr+desc_offsets[i]))),ymm2);
+
+    int32_t sum_lo = sumLanes(_mm256_castsi256_si128(ymm2));
+    int32_t sum_hi = sumLanes(_mm256_extracti128_si256(ymm2,1));
+
+    updateBestMatches(right_image ? sum_lo : sum_hi,d,min_1_E,min_1_d,min_2_E,min_2_d);
+    updateBestMatches(right_image ? sum_hi : sum_lo,d+1,min_1_E,min_1_d,min_2_E,min_2_d);
+  }
+
+  // last disparity, if the range has odd size
+  if (d==disp_max) {
+    const uint8_t* I2_block_addr = right_image ? I2_line_addr+16*(u+d) : I2_line_addr+16*(u-d);
+
+    __m128i xmm2 = _mm_sad_epu8(_mm256_castsi256_si128(ymm1[0]),_mm_load_si128((const __m128i*)(I2_block_addr+desc_offsets[0])));
+    for (int32_t i=1; i<4; i++)
+      xmm2 = _mm_add_epi32(_mm_sad_epu8(_mm256_castsi256_si128(ymm1[i]),_mm_load_si128((const __m128i*)(I2_block_addr+desc_offsets[i]))),xmm2);
+
+    updateBestMatches(sumLanes(xmm2),d,min_1_E,min_1_d,min_2_E,min_2_d);
+  }
+}
+
+ELAS_TARGET_AVX2
+void matching_avx2::planeMatch (const uint8_t* I1_block_addr,const uint8_t* I2_line_addr,int32_t u,
+                                int32_t d_min,int32_t d_max,bool right_image,const int32_t* P,int32_t d_plane,
+                                int32_t &min_val,int32_t &min_d) {
+
+  __m256i ymm1 = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)I1_block_addr));
+
+  int32_t d = d_min;
+  for (; d<d_max; d+=2) {
+    const uint8_t* I2_block_addr = right_image ? I2_line_addr+16*(u+d) : I2_line_addr+16*(u-d-1);
+
+    __m256i ymm2 = _mm256_sad_epu8(ymm1,_mm256_loadu_si256((const __m256i*)I2_block_addr));
+
+    int32_t val_lo = sumLanes(_mm256_castsi256_si128(ymm2));
+    int32_t val_hi = sumLanes(_mm256_extracti128_si256(ymm2,1));
+    int32_t val_d  = right_image ? val_lo : val_hi;
+    int32_t val_d1 = right_image ? val_hi : val_lo;
+    if (P) {
+      val_d  += P[abs(d-d_plane)];
+      val_d1 += P[abs(d+1-d_plane)];
+    }
+
+    updatePosteriorMinimum(val_d,d,min_val,min_d);
+    updatePosteriorMinimum(val_d1,d+1,min_val,min_d);
+  }
+
+  // last disparity, if the range has odd size
+  if (d==d_max) {
+    const uint8_t* I2_block_addr = right_image ? I2_line_addr+16*(u+d) : I2_line_addr+16*(u-d);
+
+    __m128i xmm2 = _mm_sad_epu8(_mm256_castsi256_si128(ymm1),_mm_load_si128((const __m128i*)I2_block_addr));
+    int32_t val  = sumLanes(xmm2);
+    if (P)
+      val += P[abs(d-d_plane)];
+
+    updatePosteriorMinimum(val,d,min_val,min_d);
+  }
+}
+
+#else
+
+bool matching_avx2::available () {
+  return false;
+}
+
+void matching_avx2::supportMatch (const uint8_t*,const uint8_t*,int32_t,int32_t,int32_t,bool,const int32_t*,
+                                  int16_t&,int16_t&,int16_t&,int16_t&) {}
+
+void matching_avx2::planeMatch (const uint8_t*,const uint8_t*,int32_t,int32_t,int32_t,bool,const int32_t*,int32_t,
+                                int32_t&,int32_t&) {}
+
+#endif
@@ -34,7 +34,7 @@ elasWrapper::elasWrapper() : Elas(parameters(ROBOTICS))
     io_scaling_factor = 1.0;
 }
 
-bool elasWrapper::compute_disparity(cv::Mat &imL, cv::Mat &imR, cv::Mat &dispL, int num_disparities)
+bool elasWrapper::compute_disparity(cv::Mat &imL, cv::Mat &imR, cv::Mat &dispL, int num_disparities, int disp_min)
 {
 
     // check for correct size
@@ -49,59 +49,92 @@ bool elasWrapper::compute_disparity(cv::Mat &imL, cv::Mat &imR, cv::Mat &dispL,
 
     Size im_size = imL.size();
 
+    param.disp_min = disp_min;
     param.disp_max = num_disparities - 1;
 
-    Mat imR_scaled, imL_scaled;
+    // convert to greyscale first, so that scaling works on a single channel
+    const Mat* imL_in = &imL;
+    const Mat* imR_in = &imR;
+    if (imL.channels() == 3)
+    {
+        cv::cvtColor(imL, imL_gray, CV_BGR2GRAY);
+        cv::cvtColor(imR, imR_gray, CV_BGR2GRAY);
+        imL_in = &imL_gray;
+        imR_in = &imR_gray;
+    }
+
     if (io_scaling_factor!=1.0)
     {
-        resize(imR, imR_scaled, Size(), io_scaling_factor, io_scaling_factor);
-        resize(imL, imL_scaled, Size(), io_scaling_factor, io_scaling_factor);
-    } else
+        resize(*imL_in, imL_scaled, Size(), io_scaling_factor, io_scaling_factor);
+        resize(*imR_in, imR_scaled, Size(), io_scaling_factor, io_scaling_factor);
+        imL_in = &imL_scaled;
+        imR_in = &imR_scaled;
+    }
+
+    // ELAS uses the same stride for both images, hence copy them if their rows are laid out differently
+    if (imL_in->step != imR_in->step)
     {
-        imR_scaled = imR.clone();
-        imL_scaled = imL.clone();
+        if (!imL_in->isContinuous())
+        {
+            imL_in->copyTo(imL_contiguous);
+            imL_in = &imL_contiguous;
+        }
+        if (!imR_in->isContinuous())
+        {
+            imR_in->copyTo(imR_contiguous);
+            imR_in = &imR_contiguous;
+        }
     }
-    int width = imL_scaled.cols;
-    int height = imL_scaled.rows;
+
+    int width = imL_in->cols;
+    int height = imL_in->rows;
 
     int width_disp_data = param.subsampling ? width>>1 : width;
     int height_disp_data = param.subsampling ? height>>1 : height;
 
-    float *dispL_data = (float*) malloc(width_disp_data * height_disp_data * sizeof(float));
-    float *dispR_data = (float*) malloc(width_disp_data * height_disp_data * sizeof(float));
-
-    // prepare input images
-    if (imL_scaled.channels() == 3)
+    // if no resize is needed, the left disparity is written straight into the output
+    bool direct_output = (io_scaling_factor==1.0 && param.subsampling==false);
+    if (direct_output)
     {
-        cv::cvtColor(imL_scaled, imL_scaled, CV_BGR2GRAY);
-        cv::cvtColor(imR_scaled, imR_scaled, CV_BGR2GRAY);
+        if (!dispL.isContinuous())
+            dispL.release();
+        dispL.create(height_disp_data, width_disp_data, CV_32FC1);
     }
-    if (!imL_scaled.isContinuous())
-        imL_scaled = imL_scaled.clone();
-    if (!imR_scaled.isContinuous())
-        imR_scaled = imR_scaled.clone();
+    else
+        dispL_scaled.create(height_disp_data, width_disp_data, CV_32FC1);
+    dispR_scaled.create(height_disp_data, width_disp_data, CV_32FC1);
 
-    // compute disparity
-    const int32_t dims[3] = {width,height,width}; // bytes per line = width
+    float *dispL_data = direct_output ? dispL.ptr<float>() : dispL_scaled.ptr<float>();
+    float *dispR_data = dispR_scaled.ptr<float>();
 
-    bool success = process((unsigned char*)imL_scaled.data,(unsigned char*)imR_scaled.data, dispL_data, dispR_data, dims);
-
-    if (success)
-    {
-        Mat dispL_scaled = Mat(height_disp_data, width_disp_data, CV_32FC1, dispL_data);
+    // compute disparity, rows of the input images need not be contiguous
+    const int32_t dims[3] = {width,height,(int32_t)imL_in->step}; // bytes per line
 
-        if (io_scaling_factor!=1.0 || param.subsampling==true)
-            resize(dispL_scaled, dispL, im_size);
-        else
-            dispL = dispL_scaled.clone();
-    }
+    bool success = process(imL_in->data, imR_in->data, dispL_data, dispR_data, dims);
 
-    free(dispL_data);
-    free(dispR_data);
+    if (success && !direct_output)
+        resize(dispL_scaled, dispL, im_size);
 
     return success;
 }
 
+void elasWrapper::set_support_prior(const cv::Mat &W, int radius)
+{
+    // the images given to ELAS are scaled by io_scaling_factor, as well as their disparities
+    Mat S = Mat::eye(4, 4, CV_64F);
+    S.at<double>(0, 0) = S.at<double>(1, 1) = S.at<double>(2, 2) = io_scaling_factor;
+
+    Mat W_scaled;
+    Mat(S * W * S.inv()).convertTo(W_scaled, CV_32F);
+
+    setSupportPrior(W_scaled.ptr<float>(), std::max(int(radius * io_scaling_factor + 0.5), 1));
+}
+
+void elasWrapper::clear_support_prior()
+{
+    clearSupportPrior();
+}
+
 int elasWrapper::get_disp_min()
 {
     return param.disp_min;
@@ -5,6 +5,7 @@
  * GPL-2+ license. See the accompanying LICENSE file for details.
  */
 
+#include <algorithm>
 #include <chrono>
 
 #ifndef USING_GPU
@@ -61,6 +62,14 @@ StereoCamera::StereoCamera(bool rectify) {
 #endif 
 
     use_elas = false;
+
+    dispROIMin = 0;
+    dispROIMax = -1;
+
+    temporalPrior = false;
+    temporalPriorRadius = 4;
+    temporalPriorRefresh = 10;
+    framesSincePriorRefresh = 0;
 }
 
 StereoCamera::StereoCamera(yarp::os::ResourceFinder &rf, bool rectify) {
@@ -81,6 +90,14 @@ StereoCamera::StereoCamera(yarp::os::ResourceFinder &rf, bool rectify) {
 #endif 
 
     use_elas = false;
+
+    dispROIMin = 0;
+    dispROIMax = -1;
+
+    temporalPrior = false;
+    temporalPriorRadius = 4;
+    temporalPriorRefresh = 10;
+    framesSincePriorRefresh = 0;
 }
 
 StereoCamera::StereoCamera(Camera Left, Camera Right,bool rectify) {
@@ -100,6 +117,14 @@ StereoCamera::StereoCamera(Camera Left, Camera Right,bool rectify) {
 #endif 
 
     use_elas = false;
+
+    dispROIMin = 0;
+    dispROIMax = -1;
+
+    temporalPrior = false;
+    temporalPriorRadius = 4;
+    temporalPriorRefresh = 10;
+    framesSincePriorRefresh = 0;
 }
 
 void StereoCamera::initELAS(yarp::os::ResourceFinder &rf)
@@ -143,6 +168,10 @@ void StereoCamera::initELAS(yarp::os::ResourceFinder &rf)
     if (rf.check("elas_filter_adaptive_mean"))
         elaswrap->set_filter_adaptive_mean(rf.find("elas_filter_adaptive_mean").asBool());
 
+    temporalPrior = rf.check("elas_temporal_prior",Value(false)).asBool();
+    temporalPriorRadius = rf.check("elas_temporal_prior_radius",Value(4)).asInt();
+    temporalPriorRefresh = rf.check("elas_temporal_prior_refresh",Value(10)).asInt();
+
     cout << endl << "ELAS parameters:" << endl << endl;
 
     cout << "disp_scaling_factor: " << disp_scaling_factor << endl;
@@ -165,6 +194,10 @@ void StereoCamera::initELAS(yarp::os::ResourceFinder &rf)
     cout << "filter_median: " << elaswrap->get_filter_median() << endl;
     cout << "filter_adaptive_mean: " << elaswrap->get_filter_adaptive_mean() << endl;
 
+    cout << "temporal_prior: " << temporalPrior << endl;
+    cout << "temporal_prior_radius: " << temporalPriorRadius << endl;
+    cout << "temporal_prior_refresh: " << temporalPriorRefresh << endl;
+
     cout << endl;
 }
 
@@ -509,24 +542,101 @@ void StereoCamera::rectifyImages()
 }
 
 
+void StereoCamera::setDisparityROI(const Rect& roi, int dispMin, int dispMax)
+{
+    this->dispROI=roi;
+    this->dispROIMin=dispMin;
+    this->dispROIMax=dispMax;
+}
+
+
+void StereoCamera::setLeftCameraPose(const Mat& H)
+{
+    H.convertTo(this->leftPose,CV_64F);
+}
+
+
+void StereoCamera::updateSupportPrior(const StereoFrame& frame)
+{
+    // The support points are searched again over the full range from time to time,
+    // so that the errors of the prior, e.g. due to objects moving in the scene, do not persist
+    if (priorPose.empty() || frame.leftPose.empty() || (framesSincePriorRefresh >= temporalPriorRefresh))
+    {
+        elaswrap->clear_support_prior();
+        framesSincePriorRefresh = 0;
+        return;
+    }
+
+    // (u,v,d,1) of the previous band -> rectified previous camera -> root -> rectified current camera -> (u,v,d,1) of the current band
+    Mat Bprev=Mat::eye(4,4,CV_64F);
+    Bprev.at<double>(0,3)=priorBand.x;
+    Bprev.at<double>(1,3)=priorBand.y;
+
+    Mat Bcurr=Mat::eye(4,4,CV_64F);
+    Bcurr.at<double>(0,3)=frame.band.x;
+    Bcurr.at<double>(1,3)=frame.band.y;
+
+    Mat Rprev=Mat::eye(4,4,CV_64F);
+    priorRLrect.convertTo(Rprev(Rect(0,0,3,3)),CV_64F);
+
+    Mat Rcurr=Mat::eye(4,4,CV_64F);
+    frame.RLrect.convertTo(Rcurr(Rect(0,0,3,3)),CV_64F);
+
+    Mat Qprev,Qcurr;
+    priorQ.convertTo(Qprev,CV_64F);
+    frame.Q.convertTo(Qcurr,CV_64F);
+
+    Mat W=Bcurr.inv()*Qcurr.inv()*Rcurr*frame.leftPose.inv()*priorPose*Rprev.t()*Qprev*Bprev;
+
+    elaswrap->set_support_prior(W,temporalPriorRadius);
+    framesSincePriorRefresh++;
+}
+
+
 void StereoCamera::computeDisparity(bool best, int uniquenessRatio, int speckleWindowSize,
         int speckleRange, int numberOfDisparities, int SADWindowSize,
         int minDisparity, int preFilterCap, int disp12MaxDiff)
+{
+    StereoFrame frame;
+    frame.left=this->imleft;
+    frame.right=this->imright;
+
+    if (!rectifyFrame(frame,numberOfDisparities))
+        return;
+
+    imgLeftRect = frame.leftRect;
+    imgRightRect = frame.rightRect;
+
+    matchFrame(frame,best,uniquenessRatio,speckleWindowSize,speckleRange,
+               SADWindowSize,minDisparity,preFilterCap,disp12MaxDiff);
+    remapFrame(frame);
+
+    // this->mutex->wait();
+
+    this->Disparity = frame.Disparity;
+    this->Disparity16 = frame.Disparity16;
+
+    // this->mutex->post();
+
+}
+
+
+bool StereoCamera::rectifyFrame(StereoFrame& frame, int numberOfDisparities)
 {
 
     if (this->Kleft.empty() || this->DistL.empty() || this->Kright.empty() || this->DistR.empty())
     {
         cout <<" Cameras are not calibrated! Run the Calibration first!" << endl;
-        return;
+        return false;
     }
 
-    if (this->imleft.empty() || this->imright.empty())
+    if (frame.left.empty() || frame.right.empty())
     {
         cout << "Images are not set! set the images first!" << endl;
-        return;
+        return false;
     }
 
-    Size img_size=this->imleft.size();
+    Size img_size=frame.left.size();
 
     if (cameraChanged)
     {
@@ -551,30 +661,121 @@ void StereoCamera::computeDisparity(bool best, int uniquenessRatio, int speckleW
                 img_size, CV_32FC1, this->map11, this->map12);
         initUndistortRectifyMap(this->Kright,  this->DistR, this->RRrect, this->PRrect,
                 img_size, CV_32FC1, this->map21, this->map22);
+
+        // this->mutex->wait();
+
+        Mat inverseMapL(img_size.height*img_size.width,1,CV_32FC2);
+        Mat inverseMapR(img_size.height*img_size.width,1,CV_32FC2);
+
+        for (int y=0; y<img_size.height; y++)
+        {
+            for (int x=0; x<img_size.width; x++)
+            {
+                inverseMapL.ptr<float>(y*img_size.width+x)[0]=(float)x;
+                inverseMapL.ptr<float>(y*img_size.width+x)[1]=(float)y;
+                inverseMapR.ptr<float>(y*img_size.width+x)[0]=(float)x;
+                inverseMapR.ptr<float>(y*img_size.width+x)[1]=(float)y;
+            }
+        }
+
+        undistortPoints(inverseMapL,inverseMapL,this->Kleft,this->DistL,this->RLrect,this->PLrect);
+        undistortPoints(inverseMapR,inverseMapR,this->Kright,this->DistR,this->RRrect,this->PRrect);
+
+        Mat mapperL=inverseMapL.reshape(2,img_size.height);
+        Mat mapperR=inverseMapR.reshape(2,img_size.height);
+        this->MapperL=mapperL;
+        this->MapperR=mapperR;
+
+        // this->mutex->post();
+
+        cameraChanged = false;
     }
 
-    Mat img1r, img2r;
-    remap(this->imleft, img1r, this->map11, this->map12, cv::INTER_LINEAR);
-    remap(this->imright, img2r, this->map21,this->map22, cv::INTER_LINEAR);
+    // Q and RLrect are overwritten in place at the next change of the cameras, while MapperL is reallocated
+    frame.Q=this->Q.clone();
+    frame.RLrect=this->RLrect.clone();
+    frame.leftPose=this->leftPose.clone();
+    frame.MapperL=this->MapperL;
+
+    // Region to be processed and range of disparities
+    frame.numberOfDisparities = numberOfDisparities;
+    frame.band = Rect(0, 0, img_size.width, img_size.height);
+    frame.roi = dispROI & frame.band;
+    frame.dispMin = 0;
+    frame.dispMax = numberOfDisparities - 1;
+    // Too small regions do not leave room to the support points of ELAS
+    frame.useROI = use_elas && (frame.roi.width >= 32) && (frame.roi.height >= 32);
+    if (frame.useROI)
+    {
+        // Keep a range of at least 16 disparities, as the support points of ELAS need some room
+        if (dispROIMax >= 0)
+        {
+            frame.dispMin = std::min(std::max(dispROIMin, 0), numberOfDisparities - 17);
+            frame.dispMax = std::max(std::min(dispROIMax, numberOfDisparities - 1), frame.dispMin + 16);
+        }
 
-    imgLeftRect = img1r;
-    imgRightRect = img2r;
+        // The rows of the region, extended to the left to let its pixels match up to the largest disparity
+        // (plus the size of the descriptor window)
+        int left = std::max(frame.roi.x - frame.dispMax - 8, 0);
+        frame.band = Rect(left, frame.roi.y, frame.roi.x + frame.roi.width - left, frame.roi.height);
+    }
+
+    // Rectify only the region to be processed, using the corresponding part of the maps
+    remap(frame.left, frame.leftRect, this->map11(frame.band), this->map12(frame.band), cv::INTER_LINEAR);
+    remap(frame.right, frame.rightRect, this->map21(frame.band), this->map22(frame.band), cv::INTER_LINEAR);
 
-    Mat disp,disp8,map,dispTemp;
+    return true;
+}
+
+
+void StereoCamera::matchFrame(StereoFrame& frame, bool best, int uniquenessRatio, int speckleWindowSize,
+        int speckleRange, int SADWindowSize, int minDisparity, int preFilterCap, int disp12MaxDiff)
+{
+    const Mat& img1r = frame.leftRect;
+    const Mat& img2r = frame.rightRect;
+    int numberOfDisparities = frame.numberOfDisparities;
+
+    // The buffers of the frame are reused when frames are recycled, hence they are written in place
+    Mat& disp = frame.dispRaw;
 
     bool success;
 
     if (use_elas)
     {
-        success = elaswrap->compute_disparity(img1r, img2r, disp, numberOfDisparities);
+        if (temporalPrior)
+            updateSupportPrior(frame);
+
+        if (frame.useROI)
+        {
+            success = elaswrap->compute_disparity(frame.leftRect, frame.rightRect, frame.dispBand, frame.dispMax + 1, frame.dispMin);
+            if (success)
+            {
+                // Pixels outside the region of interest are marked as non valid, as done by ELAS
+                disp.create(frame.MapperL.size(), CV_32FC1);
+                disp.setTo(Scalar(-10.0));
+                frame.dispBand(Rect(frame.roi.x - frame.band.x, 0, frame.roi.width, frame.roi.height)).copyTo(disp(frame.roi));
+            }
+        }
+        else
+            success = elaswrap->compute_disparity(frame.leftRect, frame.rightRect, disp, numberOfDisparities);
+
+        if (temporalPrior)
+        {
+            // The support points of this frame are the prior of the next one
+            priorQ=frame.Q;
+            priorRLrect=frame.RLrect;
+            priorBand=frame.band;
+            priorPose=success ? frame.leftPose : Mat();
+        }
+
         if (success)
         {
-            map = disp * (255.0 / numberOfDisparities);
+            disp.convertTo(frame.map, CV_32FC1, 255.0 / numberOfDisparities);
             //threshold(map, map, 0, 255.0, THRESH_TOZERO);
         }
     } else
     {
-        int cn=this->imleft.channels();
+        int cn=frame.leftRect.channels();
     #ifdef OPENCV_GREATER_2
         Ptr<StereoSGBM> sgbm=cv::StereoSGBM::create(minDisparity,numberOfDisparities,SADWindowSize,
                                                     8*cn*SADWindowSize*SADWindowSize,
@@ -600,61 +801,31 @@ void StereoCamera::computeDisparity(bool best, int uniquenessRatio, int speckleW
         sgbm(img1r, img2r, disp);
     #endif
 
-        disp.convertTo(map, CV_32FC1, 1.0,0.0);
-        map.convertTo(map,CV_32FC1,255/(numberOfDisparities*16.));
+        disp.convertTo(frame.map,CV_32FC1,255/(numberOfDisparities*16.));
         //normalize(map,map, 0, 255, cv::NORM_MINMAX, CV_8UC1);
 
         success = true;
     }
 
-    if (success)
-    {
-        if (cameraChanged)
-        {
-            // this->mutex->wait();
-
-            Mat inverseMapL(map.rows*map.cols,1,CV_32FC2);
-            Mat inverseMapR(map.rows*map.cols,1,CV_32FC2);
-
-            for (int y=0; y<map.rows; y++)
-            {
-                for (int x=0; x<map.cols; x++)
-                {
-                    inverseMapL.ptr<float>(y*map.cols+x)[0]=(float)x;
-                    inverseMapL.ptr<float>(y*map.cols+x)[1]=(float)y;
-                    inverseMapR.ptr<float>(y*map.cols+x)[0]=(float)x;
-                    inverseMapR.ptr<float>(y*map.cols+x)[1]=(float)y;
-                }
-            }
-
-            undistortPoints(inverseMapL,inverseMapL,this->Kleft,this->DistL,this->RLrect,this->PLrect);
-            undistortPoints(inverseMapR,inverseMapR,this->Kright,this->DistR,this->RRrect,this->PRrect);
-
-            Mat mapperL=inverseMapL.reshape(2,map.rows);
-            Mat mapperR=inverseMapR.reshape(2,map.rows);
-            this->MapperL=mapperL;
-            this->MapperR=mapperR;
-
-            // this->mutex->post();
+    frame.success = success;
+}
 
-            cameraChanged = false;
-        }
 
-        Mat x;
-        remap(map,dispTemp,this->MapperL,x,cv::INTER_LINEAR);
-        dispTemp.convertTo(disp8,CV_8U);
+void StereoCamera::remapFrame(StereoFrame& frame)
+{
+    if (frame.success)
+    {
+        remap(frame.map,frame.mapRemapped,frame.MapperL,Mat(),cv::INTER_LINEAR);
+        frame.mapRemapped.convertTo(frame.Disparity,CV_8U);
 
-        if (use_elas)
-            disp.convertTo(disp, CV_16SC1, 16.0);
+        // ELAS gives float disparities, SGBM fixed point ones with 4 fractional bits
+        if (frame.dispRaw.type() != CV_16SC1)
+            frame.dispRaw.convertTo(frame.Disparity16, CV_16SC1, 16.0);
+        else
+            frame.Disparity16 = frame.dispRaw;
     }
-
-    // this->mutex->wait();
-
-    this->Disparity = disp8;
-    this->Disparity16 = disp;
-
-    // this->mutex->post();
-
+    else
+        frame.Disparity.release();
 }
 
 